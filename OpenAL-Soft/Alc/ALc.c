@@ -22,6 +22,7 @@
 
 #include <math.h>
 #include <stdlib.h>
+#include <limits.h>
 #include <stdio.h>
 #include <memory.h>
 #include <ctype.h>
@@ -91,6 +92,12 @@ static struct BackendInfo BackendLoopback = {
 static struct BackendInfo PlaybackBackend;
 static struct BackendInfo CaptureBackend;
 
+#ifdef HAVE_DYNLOAD
+// Modules loaded for the effect-plugins config option
+static void *EffectPluginLibs[MAX_EFFECT_TYPES];
+static ALuint NumEffectPluginLibs;
+#endif
+
 ///////////////////////////////////////////////////////
 // STRING and EXTENSIONS
 
@@ -290,6 +297,19 @@ static const ALCenums enumeration[] = {
     { "ALC_FORMAT_CHANNELS_SOFT",             ALC_FORMAT_CHANNELS_SOFT            },
     { "ALC_FORMAT_TYPE_SOFT",                 ALC_FORMAT_TYPE_SOFT                },
 
+    // Output limiter Properties
+    { "ALC_OUTPUT_LIMITER_SOFT",              ALC_OUTPUT_LIMITER_SOFT             },
+    { "ALC_OUTPUT_LIMITER_REDUCTION_SOFT",    ALC_OUTPUT_LIMITER_REDUCTION_SOFT   },
+    { "ALC_OUTPUT_LATENCY_SOFT",              ALC_OUTPUT_LATENCY_SOFT             },
+
+    // Float buffer storage Properties
+    { "ALC_FLOAT_BUFFER_EXTRA_BYTES_SOFT",    ALC_FLOAT_BUFFER_EXTRA_BYTES_SOFT   },
+    { "ALC_FLOAT_BUFFER_PEAK_BYTES_SOFT",     ALC_FLOAT_BUFFER_PEAK_BYTES_SOFT    },
+
+    // HRTF cache Properties
+    { "ALC_HRTF_CACHE_HITS_SOFT",             ALC_HRTF_CACHE_HITS_SOFT            },
+    { "ALC_HRTF_CACHE_MISSES_SOFT",           ALC_HRTF_CACHE_MISSES_SOFT          },
+
     // Buffer Channel Configurations
     { "ALC_MONO",                             ALC_MONO                            },
     { "ALC_STEREO",                           ALC_STEREO                          },
@@ -345,7 +365,9 @@ static const ALCchar alcNoDeviceExtList[] =
 static const ALCchar alcExtensionList[] =
     "ALC_ENUMERATE_ALL_EXT ALC_ENUMERATION_EXT ALC_EXT_CAPTURE "
     "ALC_EXT_DEDICATED ALC_EXT_disconnect ALC_EXT_EFX "
-    "ALC_EXT_thread_local_context ALC_SOFTX_loopback_device";
+    "ALC_EXT_thread_local_context ALC_SOFTX_loopback_device "
+    "ALC_SOFTX_output_limiter ALC_SOFTX_float_buffer_storage "
+    "ALC_SOFTX_hrtf_cache";
 static const ALCint alcMajorVersion = 1;
 static const ALCint alcMinorVersion = 1;
 
@@ -520,6 +542,7 @@ static void alc_deinit_safe(void)
 {
     ReleaseALC(ALC_FALSE);
 
+    FreeHrtf();
     FreeALConfig();
 
     ThunkExit();
@@ -544,12 +567,73 @@ static void alc_deinit(void)
         BackendList[i].Deinit();
     BackendLoopback.Deinit();
 
+#ifdef HAVE_DYNLOAD
+    /* Registered effects follow the built-in ones, so clearing the first
+     * truncates the list before their modules go away */
+    for(i = 0;EffectList[i].name;i++)
+    {
+        if(EffectList[i].Plugin)
+        {
+            memset(&EffectList[i], 0, sizeof(EffectList[i]));
+            break;
+        }
+    }
+    while(NumEffectPluginLibs > 0)
+        CloseLib(EffectPluginLibs[--NumEffectPluginLibs]);
+#endif
+
     alc_deinit_safe();
 }
 
+#ifdef HAVE_DYNLOAD
+static void LoadEffectPlugin(const char *fname)
+{
+    const ALeffectPluginSOFT *const *plugins;
+    LPALSOFTGETEFFECTPLUGINS getPlugins;
+    ALuint count = 0;
+    void *handle;
+
+    if(NumEffectPluginLibs >= MAX_EFFECT_TYPES)
+    {
+        ERR("Too many effect plugins, not loading %s\n", fname);
+        return;
+    }
+
+    handle = LoadLib(fname);
+    if(!handle)
+    {
+        ERR("Failed to load effect plugin %s\n", fname);
+        return;
+    }
+    getPlugins = (LPALSOFTGETEFFECTPLUGINS)GetSymbol(handle, ALSOFT_EFFECT_PLUGIN_ENTRY);
+    if(!getPlugins || !(plugins=getPlugins(ALSOFT_EFFECT_PLUGIN_VERSION)))
+    {
+        ERR("No effects found in %s\n", fname);
+        CloseLib(handle);
+        return;
+    }
+
+    while(*plugins)
+    {
+        if(RegisterEffectPlugin(*plugins))
+            count++;
+        plugins++;
+    }
+    if(count == 0)
+    {
+        CloseLib(handle);
+        return;
+    }
+
+    TRACE("Loaded %u effect(s) from %s\n", count, fname);
+    EffectPluginLibs[NumEffectPluginLibs++] = handle;
+}
+#endif
+
 static void alc_initconfig(void)
 {
     const char *devs, *str;
+    ALuint capfilter;
     int i, n;
 
     str = getenv("ALSOFT_LOGLEVEL");
@@ -570,6 +654,42 @@ static void alc_initconfig(void)
 
     ReadALConfig();
 
+    capfilter = ~0u;
+    str = GetConfigValue(NULL, "disable-cpu-exts", "");
+    if(strcasecmp(str, "all") == 0)
+        capfilter = 0;
+    else if(str[0])
+    {
+        size_t len;
+        const char *next = str;
+
+        do {
+            str = next;
+            next = strchr(str, ',');
+
+            while(isspace(str[0]))
+                str++;
+            if(!str[0] || str[0] == ',')
+                continue;
+
+            len = (next ? ((size_t)(next-str)) : strlen(str));
+            while(len > 0 && isspace(str[len-1]))
+                len--;
+            if(len == 4 && strncasecmp(str, "sse2", len) == 0)
+                capfilter &= ~CPU_CAP_SSE2;
+            else if(len == 6 && strncasecmp(str, "sse4.1", len) == 0)
+                capfilter &= ~CPU_CAP_SSE4_1;
+            else if(len == 4 && strncasecmp(str, "avx2", len) == 0)
+                capfilter &= ~CPU_CAP_AVX2;
+            else if(len == 4 && strncasecmp(str, "neon", len) == 0)
+                capfilter &= ~CPU_CAP_NEON;
+            else
+                WARN("Invalid CPU extension \"%.*s\"\n", (int)len, str);
+        } while(next++);
+    }
+    FillCPUCaps(capfilter);
+    aluInitMixers();
+
     InitHrtf();
 
 #ifdef _WIN32
@@ -582,6 +702,9 @@ static void alc_initconfig(void)
     if(DefaultResampler >= RESAMPLER_MAX || DefaultResampler <= RESAMPLER_MIN)
         DefaultResampler = RESAMPLER_DEFAULT;
 
+    FloatBufferStorage = GetConfigValueBool(NULL, "float-buffers", AL_FALSE);
+    CompressedBufferStorage = GetConfigValueBool(NULL, "compressed-buffers", AL_FALSE);
+
     if(!TrapALCError)
         TrapALCError = GetConfigValueBool(NULL, "trap-alc-error", ALC_FALSE);
 
@@ -676,6 +799,41 @@ static void alc_initconfig(void)
     }
     BackendLoopback.Init(&BackendLoopback.Funcs);
 
+    str = GetConfigValue(NULL, "effect-plugins", "");
+    if(str[0])
+    {
+#ifdef HAVE_DYNLOAD
+        char fname[1024];
+        size_t len;
+        const char *next = str;
+
+        do {
+            str = next;
+            next = strchr(str, ',');
+
+            if(!str[0] || next == str)
+                continue;
+
+            len = (next ? ((size_t)(next-str)) : strlen(str));
+            while(len > 0 && isspace(str[len-1]))
+                len--;
+            while(len > 0 && isspace(*str))
+            {
+                str++;
+                len--;
+            }
+            if(len == 0 || len >= sizeof(fname))
+                continue;
+
+            memcpy(fname, str, len);
+            fname[len] = 0;
+            LoadEffectPlugin(fname);
+        } while(next++);
+#else
+        ERR("Effect plugins are not supported in this build\n");
+#endif
+    }
+
     str = GetConfigValue(NULL, "excludefx", "");
     if(str[0])
     {
@@ -694,7 +852,7 @@ static void alc_initconfig(void)
             {
                 if(len == strlen(EffectList[n].name) &&
                    strncmp(EffectList[n].name, str, len) == 0)
-                    DisabledEffects[EffectList[n].type] = AL_TRUE;
+                    EffectList[n].Disabled = AL_TRUE;
             }
         } while(next++);
     }
@@ -1065,6 +1223,7 @@ static ALCboolean IsContext(ALCcontext *context)
 static ALCboolean UpdateDeviceParams(ALCdevice *device, const ALCint *attrList)
 {
     ALCcontext *context;
+    ALuint numDry;
     ALuint i;
 
     // Check for attributes
@@ -1154,6 +1313,15 @@ static ALCboolean UpdateDeviceParams(ALCdevice *device, const ALCint *attrList)
                     numSends = MAX_SENDS;
             }
 
+            if(attrList[attrIdx] == ALC_OUTPUT_LIMITER_SOFT &&
+               !ConfigValueExists(NULL, "output-limiter"))
+            {
+                if(attrList[attrIdx + 1] != ALC_FALSE)
+                    device->Flags |= DEVICE_USE_LIMITER;
+                else
+                    device->Flags &= ~DEVICE_USE_LIMITER;
+            }
+
             attrIdx += 2;
         }
 
@@ -1183,6 +1351,53 @@ static ALCboolean UpdateDeviceParams(ALCdevice *device, const ALCint *attrList)
         UnlockDevice(device);
         return ALC_FALSE;
     }
+    if(device->OutBuffer != device->DryBuffer)
+        al_free(device->OutBuffer);
+    device->OutBuffer = NULL;
+    numDry = (device->AmbiOrder ? (device->AmbiOrder+1)*(device->AmbiOrder+1) :
+                                  ChannelsFromDevFmt(device->FmtChans));
+    if(device->NumDryChannels != numDry)
+    {
+        /* Only allocate the channels that are actually mixed. Rows are
+         * aligned for the vector mixers (BUFFERSIZE keeps each row aligned
+         * given the first is). */
+        al_free(device->DryBuffer);
+        device->NumDryChannels = numDry;
+        device->DryBuffer = al_malloc(32, device->NumDryChannels *
+                                          sizeof(device->DryBuffer[0]));
+        if(!device->DryBuffer)
+        {
+            ERR("Failed to allocate %u-channel mixing buffer\n", device->NumDryChannels);
+            device->NumDryChannels = 0;
+            UnlockDevice(device);
+            ALCdevice_StopPlayback(device);
+            return ALC_FALSE;
+        }
+    }
+    if(!device->AmbiOrder)
+        device->OutBuffer = device->DryBuffer;
+    else
+    {
+        /* The ambisonic bus gets decoded to separate output channels */
+        device->OutBuffer = al_malloc(32, ChannelsFromDevFmt(device->FmtChans) *
+                                          sizeof(device->OutBuffer[0]));
+        if(!device->AmbiDecoder)
+            device->AmbiDecoder = aluCreateAmbiDecoder();
+        if(!device->OutBuffer || !device->AmbiDecoder)
+        {
+            ERR("Failed to allocate ambisonic decoder\n");
+            al_free(device->OutBuffer);
+            device->OutBuffer = NULL;
+            UnlockDevice(device);
+            ALCdevice_StopPlayback(device);
+            return ALC_FALSE;
+        }
+    }
+    if(aluInitMixThreads(device) == AL_FALSE)
+    {
+        ERR("Failed to start %u mixing threads, mixing on one\n", device->NumMixThreads);
+        device->NumMixThreads = 1;
+    }
     device->Flags |= DEVICE_RUNNING;
     TRACE("Format post-setup: %s%s, %s, %uhz%s, %u update size x%d\n",
           DevFmtChannelsString(device->FmtChans),
@@ -1201,8 +1416,53 @@ static ALCboolean UpdateDeviceParams(ALCdevice *device, const ALCint *attrList)
 
     if(!device->IsLoopbackDevice && GetConfigValueBool(NULL, "hrtf", AL_FALSE))
         device->Flags |= DEVICE_USE_HRTF;
-    if((device->Flags&DEVICE_USE_HRTF) && !IsHrtfCompatible(device))
+    device->Hrtf = NULL;
+    DestroyHrtfCache(device->HrtfCache);
+    device->HrtfCache = NULL;
+    if((device->Flags&DEVICE_USE_HRTF))
+    {
+        device->Hrtf = GetHrtf(device);
+        if(device->Hrtf && !(device->HrtfCache=CreateHrtfCache(device->Hrtf)))
+        {
+            ERR("Failed to allocate HRTF cache\n");
+            device->Hrtf = NULL;
+        }
+    }
+    if(!device->Hrtf)
         device->Flags &= ~DEVICE_USE_HRTF;
+
+    /* Sources' HRTF state is sized for the HRIRs, so resize it for the new
+     * ones. If that fails, it's still big enough without HRTF. */
+    context = device->ContextList;
+    while(context)
+    {
+        ALboolean ok = AL_TRUE;
+        ALsizei pos;
+
+        LockUIntMapRead(&context->SourceMap);
+        for(pos = 0;pos < context->SourceMap.size && ok;pos++)
+            ok = AllocSourceParams(context->SourceMap.array[pos].value, device);
+        UnlockUIntMapRead(&context->SourceMap);
+
+        while(context->FreeSourceParams)
+        {
+            ALsourceParams *params = context->FreeSourceParams;
+            context->FreeSourceParams = params->next;
+            free(params);
+        }
+
+        if(!ok && (device->Flags&DEVICE_USE_HRTF))
+        {
+            ERR("Failed to allocate source HRTF state, disabling HRTF\n");
+            device->Flags &= ~DEVICE_USE_HRTF;
+            device->Hrtf = NULL;
+            DestroyHrtfCache(device->HrtfCache);
+            device->HrtfCache = NULL;
+            context = device->ContextList;
+            continue;
+        }
+        context = context->next;
+    }
     TRACE("HRTF %s\n", (device->Flags&DEVICE_USE_HRTF)?"enabled":"disabled");
 
     if(!(device->Flags&DEVICE_USE_HRTF) && device->Bs2bLevel > 0 && device->Bs2bLevel <= 6)
@@ -1223,6 +1483,28 @@ static ALCboolean UpdateDeviceParams(ALCdevice *device, const ALCint *attrList)
         TRACE("BS2B disabled\n");
     }
 
+    if(device->AmbiOrder)
+        aluInitAmbiDecoder(device);
+
+    if((device->Flags&DEVICE_USE_LIMITER))
+    {
+        if(!device->Limiter)
+            device->Limiter = aluCreateLimiter();
+        if(!device->Limiter)
+        {
+            ERR("Failed to allocate output limiter\n");
+            device->Flags &= ~DEVICE_USE_LIMITER;
+        }
+        else
+            aluInitLimiter(device);
+    }
+    else
+    {
+        aluDestroyLimiter(device->Limiter);
+        device->Limiter = NULL;
+    }
+    TRACE("Output limiter %s\n", (device->Flags&DEVICE_USE_LIMITER)?"enabled":"disabled");
+
     device->Flags &= ~DEVICE_DUPLICATE_STEREO;
     switch(device->FmtChans)
     {
@@ -1269,6 +1551,12 @@ static ALCboolean UpdateDeviceParams(ALCdevice *device, const ALCint *attrList)
         {
             ALsource *source = context->SourceMap.array[pos].value;
             ALuint s = device->NumAuxSends;
+
+            /* Take any pending property and parameter updates now, so an old
+             * one can't bring back a removed send. The parameters are worked
+             * out again for the new setup below. */
+            ApplySourceProps(source, context);
+            ApplySourceParams(source, context);
             while(s < MAX_SENDS)
             {
                 if(source->Send[s].Slot)
@@ -1276,10 +1564,13 @@ static ALCboolean UpdateDeviceParams(ALCdevice *device, const ALCint *attrList)
                 source->Send[s].Slot = NULL;
                 source->Send[s].WetGain = 1.0f;
                 source->Send[s].WetGainHF = 1.0f;
+                source->Props.Send[s].Slot = NULL;
+                source->Props.Send[s].WetGain = 1.0f;
+                source->Props.Send[s].WetGainHF = 1.0f;
                 s++;
             }
             source->NeedsUpdate = AL_FALSE;
-            ALsource_Update(source, context);
+            ALsource_Update(source, source->Params, context);
         }
         UnlockUIntMapRead(&context->SourceMap);
 
@@ -1305,6 +1596,9 @@ static ALCvoid FreeDevice(ALCdevice *device)
         ReleaseALBuffers(device);
     }
     ResetUIntMap(&device->BufferMap);
+    if(device->FloatBufferPeak > 0)
+        TRACE("Float buffer storage peaked at %.1fKiB extra\n",
+              device->FloatBufferPeak/1024.0);
 
     if(device->EffectMap.size > 0)
     {
@@ -1323,9 +1617,28 @@ static ALCvoid FreeDevice(ALCdevice *device)
     free(device->Bs2b);
     device->Bs2b = NULL;
 
+    DestroyHrtfCache(device->HrtfCache);
+    device->HrtfCache = NULL;
+
+    aluFreeMixThreads(device);
+
+    if(device->OutBuffer != device->DryBuffer)
+        al_free(device->OutBuffer);
+    device->OutBuffer = NULL;
+    al_free(device->DryBuffer);
+    device->DryBuffer = NULL;
+    device->NumDryChannels = 0;
+
+    aluDestroyAmbiDecoder(device->AmbiDecoder);
+    device->AmbiDecoder = NULL;
+
+    aluDestroyLimiter(device->Limiter);
+    device->Limiter = NULL;
+
     free(device->szDeviceName);
     device->szDeviceName = NULL;
 
+    DeleteCriticalSection(&device->ParamsLock);
     DeleteCriticalSection(&device->Mutex);
 
     free(device);
@@ -1447,6 +1760,12 @@ static ALvoid InitContext(ALCcontext *pContext)
     pContext->flSpeedOfSound = SPEEDOFSOUNDMETRESPERSEC;
     pContext->DeferUpdates = AL_FALSE;
 
+    InitializeCriticalSection(&pContext->PropLock);
+    pContext->FreeSourceProps = NULL;
+    pContext->FreeSourceParams = NULL;
+    pContext->PendingSourceCmds = NULL;
+    pContext->FreeSourceCmds = NULL;
+
     pContext->ExtensionList = alExtList;
 }
 
@@ -1467,6 +1786,32 @@ static ALCvoid FreeContext(ALCcontext *context)
     }
     ResetUIntMap(&context->SourceMap);
 
+    while(context->FreeSourceProps)
+    {
+        ALsourceProps *props = context->FreeSourceProps;
+        context->FreeSourceProps = props->next;
+        free(props);
+    }
+    while(context->FreeSourceParams)
+    {
+        ALsourceParams *params = context->FreeSourceParams;
+        context->FreeSourceParams = params->next;
+        free(params);
+    }
+    while(context->PendingSourceCmds)
+    {
+        ALsourceCmd *cmd = context->PendingSourceCmds;
+        context->PendingSourceCmds = cmd->next;
+        free(cmd);
+    }
+    while(context->FreeSourceCmds)
+    {
+        ALsourceCmd *cmd = context->FreeSourceCmds;
+        context->FreeSourceCmds = cmd->next;
+        free(cmd);
+    }
+    DeleteCriticalSection(&context->PropLock);
+
     if(context->EffectSlotMap.size > 0)
     {
         ERR("(%p) Deleting %d AuxiliaryEffectSlot(s)\n", context, context->EffectSlotMap.size);
@@ -1659,6 +2004,7 @@ ALC_API ALCdevice* ALC_APIENTRY alcCaptureOpenDevice(const ALCchar *deviceName,
     device->IsCaptureDevice = AL_TRUE;
     device->IsLoopbackDevice = AL_FALSE;
     InitializeCriticalSection(&device->Mutex);
+    InitializeCriticalSection(&device->ParamsLock);
 
     InitUIntMap(&device->BufferMap, ~0);
     InitUIntMap(&device->EffectMap, ~0);
@@ -1689,6 +2035,7 @@ ALC_API ALCdevice* ALC_APIENTRY alcCaptureOpenDevice(const ALCchar *deviceName,
     }
     else
     {
+        DeleteCriticalSection(&device->ParamsLock);
         DeleteCriticalSection(&device->Mutex);
         free(device);
         device = NULL;
@@ -1811,11 +2158,26 @@ ALC_API ALCvoid ALC_APIENTRY alcSuspendContext(ALCcontext *Context)
 /*
     alcProcessContext
 
-    Not functional
+    Commits the context's changes, when the app's thread calculates source
+    parameters
 */
 ALC_API ALCvoid ALC_APIENTRY alcProcessContext(ALCcontext *Context)
 {
-    (void)Context;
+    LockLists();
+    if(!IsContext(Context))
+    {
+        alcSetError(NULL, ALC_INVALID_CONTEXT);
+        UnlockLists();
+        return;
+    }
+    ALCcontext_IncRef(Context);
+    UnlockLists();
+
+    EnterCriticalSection(&Context->PropLock);
+    aluCommitUpdates(Context);
+    LeaveCriticalSection(&Context->PropLock);
+
+    ALCcontext_DecRef(Context);
 }
 
 
@@ -1991,6 +2353,13 @@ ALC_API ALCvoid ALC_APIENTRY alcGetIntegerv(ALCdevice *device,ALCenum param,ALsi
             case ALC_CAPTURE_SAMPLES:
             case ALC_FORMAT_CHANNELS_SOFT:
             case ALC_FORMAT_TYPE_SOFT:
+            case ALC_OUTPUT_LIMITER_SOFT:
+            case ALC_OUTPUT_LIMITER_REDUCTION_SOFT:
+            case ALC_OUTPUT_LATENCY_SOFT:
+            case ALC_FLOAT_BUFFER_EXTRA_BYTES_SOFT:
+            case ALC_FLOAT_BUFFER_PEAK_BYTES_SOFT:
+            case ALC_HRTF_CACHE_HITS_SOFT:
+            case ALC_HRTF_CACHE_MISSES_SOFT:
                 alcSetError(NULL, ALC_INVALID_DEVICE);
                 break;
 
@@ -2130,6 +2499,56 @@ ALC_API ALCvoid ALC_APIENTRY alcGetIntegerv(ALCdevice *device,ALCenum param,ALsi
                 *data = device->Connected;
                 break;
 
+            case ALC_OUTPUT_LIMITER_SOFT:
+                *data = ((device->Flags&DEVICE_USE_LIMITER) ? ALC_TRUE : ALC_FALSE);
+                break;
+
+            case ALC_OUTPUT_LIMITER_REDUCTION_SOFT:
+                LockDevice(device);
+                *data = ((device->Flags&DEVICE_USE_LIMITER) ?
+                         aluGetLimiterReduction(device) : 0);
+                UnlockDevice(device);
+                break;
+
+            case ALC_OUTPUT_LATENCY_SOFT:
+                LockDevice(device);
+                *data = (device->IsLoopbackDevice ? 0 :
+                         device->UpdateSize*device->NumUpdates);
+                if((device->Flags&DEVICE_USE_LIMITER))
+                    *data += device->LimiterLookAhead;
+                UnlockDevice(device);
+                break;
+
+            case ALC_FLOAT_BUFFER_EXTRA_BYTES_SOFT:
+                LockDevice(device);
+                *data = (ALCint)minu64(device->FloatBufferExtra, INT_MAX);
+                UnlockDevice(device);
+                break;
+
+            case ALC_FLOAT_BUFFER_PEAK_BYTES_SOFT:
+                LockDevice(device);
+                *data = (ALCint)minu64(device->FloatBufferPeak, INT_MAX);
+                UnlockDevice(device);
+                break;
+
+            case ALC_HRTF_CACHE_HITS_SOFT:
+            case ALC_HRTF_CACHE_MISSES_SOFT:
+                /* The cache is used by whichever thread calculates source
+                 * parameters, so both of their locks are needed */
+                EnterCriticalSection(&device->ParamsLock);
+                LockDevice(device);
+                *data = 0;
+                if(device->HrtfCache)
+                {
+                    ALuint hits, misses;
+                    GetHrtfCacheStats(device->HrtfCache, &hits, &misses);
+                    *data = (ALCint)minu((param == ALC_HRTF_CACHE_HITS_SOFT) ?
+                                         hits : misses, INT_MAX);
+                }
+                UnlockDevice(device);
+                LeaveCriticalSection(&device->ParamsLock);
+                break;
+
             default:
                 alcSetError(device, ALC_INVALID_ENUM);
                 break;
@@ -2252,21 +2671,28 @@ ALC_API ALCcontext* ALC_APIENTRY alcCreateContext(ALCdevice *device, const ALCin
     /* Reset Context Last Error code */
     device->LastError = ALC_NO_ERROR;
 
+    /* Keep the app's threads from calculating source parameters while the
+     * device's setup changes */
+    EnterCriticalSection(&device->ParamsLock);
     if(UpdateDeviceParams(device, attrList) == ALC_FALSE)
     {
+        LeaveCriticalSection(&device->ParamsLock);
         UnlockLists();
         alcSetError(device, ALC_INVALID_DEVICE);
         aluHandleDisconnect(device);
         ALCdevice_DecRef(device);
         return NULL;
     }
+    LeaveCriticalSection(&device->ParamsLock);
 
     ALContext = calloc(1, sizeof(ALCcontext));
     if(ALContext)
     {
         ALContext->ref = 1;
 
-        ALContext->MaxActiveSources = 256;
+        /* The mixer adds sources to the list as it starts them, so it has to
+         * be big enough to hold every source the context can have. */
+        ALContext->MaxActiveSources = device->MaxNoOfSources;
         ALContext->ActiveSources = malloc(sizeof(ALContext->ActiveSources[0]) *
                                           ALContext->MaxActiveSources);
     }
@@ -2490,6 +2916,29 @@ static void GetFormatFromString(const char *str, enum DevFmtChannels *chans, enu
     *type = DevFmtShort;
 }
 
+/* ReadLimiterConfig
+ *
+ * Reads the output limiter settings from the config, clamped to usable values.
+ */
+static ALCvoid ReadLimiterConfig(ALCdevice *device)
+{
+    if(GetConfigValueBool(NULL, "output-limiter", AL_FALSE))
+        device->Flags |= DEVICE_USE_LIMITER;
+    device->LimiterThreshold = GetConfigValueFloat(NULL, "limiter-threshold", -1.0f);
+    if(!(device->LimiterThreshold <= 0.0f))
+        device->LimiterThreshold = 0.0f;
+    else if(device->LimiterThreshold < -60.0f)
+        device->LimiterThreshold = -60.0f;
+    device->LimiterRelease = GetConfigValueFloat(NULL, "limiter-release", 100.0f);
+    if(!(device->LimiterRelease >= 1.0f))
+        device->LimiterRelease = 1.0f;
+    device->LimiterLookAhead = GetConfigValueInt(NULL, "limiter-lookahead", 64);
+    if((ALint)device->LimiterLookAhead < 0)
+        device->LimiterLookAhead = 0;
+    else if(device->LimiterLookAhead > LIMITER_MAX_LOOKAHEAD)
+        device->LimiterLookAhead = LIMITER_MAX_LOOKAHEAD;
+}
+
 /*
     alcOpenDevice
 
@@ -2526,6 +2975,7 @@ ALC_API ALCdevice* ALC_APIENTRY alcOpenDevice(const ALCchar *deviceName)
     device->IsCaptureDevice = AL_FALSE;
     device->IsLoopbackDevice = AL_FALSE;
     InitializeCriticalSection(&device->Mutex);
+    InitializeCriticalSection(&device->ParamsLock);
     device->LastError = ALC_NO_ERROR;
 
     device->Flags = 0;
@@ -2575,6 +3025,22 @@ ALC_API ALCdevice* ALC_APIENTRY alcOpenDevice(const ALCchar *deviceName)
 
     device->Bs2bLevel = GetConfigValueInt(NULL, "cf_level", 0);
 
+    device->NumMixThreads = GetConfigValueInt(NULL, "mix-threads", 1);
+    if((ALint)device->NumMixThreads <= 0)
+        device->NumMixThreads = 1;
+    else if(device->NumMixThreads > MAX_MIX_THREADS)
+        device->NumMixThreads = MAX_MIX_THREADS;
+    if(GetConfigValueBool(NULL, "app-source-updates", AL_FALSE))
+        device->Flags |= DEVICE_APP_SOURCE_UPDATES;
+
+    device->AmbiOrder = GetConfigValueInt(NULL, "ambisonics", 0);
+    if((ALint)device->AmbiOrder < 0)
+        device->AmbiOrder = 0;
+    else if(device->AmbiOrder > MAX_AMBI_ORDER)
+        device->AmbiOrder = MAX_AMBI_ORDER;
+
+    ReadLimiterConfig(device);
+
     // Find a playback device to open
     LockLists();
     if((err=ALCdevice_OpenPlayback(device, deviceName)) == ALC_NO_ERROR)
@@ -2586,6 +3052,7 @@ ALC_API ALCdevice* ALC_APIENTRY alcOpenDevice(const ALCchar *deviceName)
     else
     {
         // No suitable output device found
+        DeleteCriticalSection(&device->ParamsLock);
         DeleteCriticalSection(&device->Mutex);
         free(device);
         device = NULL;
@@ -2660,6 +3127,7 @@ ALC_API ALCdevice* ALC_APIENTRY alcLoopbackOpenDeviceSOFT(void)
     device->IsCaptureDevice = AL_FALSE;
     device->IsLoopbackDevice = AL_TRUE;
     InitializeCriticalSection(&device->Mutex);
+    InitializeCriticalSection(&device->ParamsLock);
     device->LastError = ALC_NO_ERROR;
 
     device->Flags = 0;
@@ -2697,6 +3165,22 @@ ALC_API ALCdevice* ALC_APIENTRY alcLoopbackOpenDeviceSOFT(void)
 
     device->Bs2bLevel = GetConfigValueInt(NULL, "cf_level", 0);
 
+    device->NumMixThreads = GetConfigValueInt(NULL, "mix-threads", 1);
+    if((ALint)device->NumMixThreads <= 0)
+        device->NumMixThreads = 1;
+    else if(device->NumMixThreads > MAX_MIX_THREADS)
+        device->NumMixThreads = MAX_MIX_THREADS;
+    if(GetConfigValueBool(NULL, "app-source-updates", AL_FALSE))
+        device->Flags |= DEVICE_APP_SOURCE_UPDATES;
+
+    device->AmbiOrder = GetConfigValueInt(NULL, "ambisonics", 0);
+    if((ALint)device->AmbiOrder < 0)
+        device->AmbiOrder = 0;
+    else if(device->AmbiOrder > MAX_AMBI_ORDER)
+        device->AmbiOrder = MAX_AMBI_ORDER;
+
+    ReadLimiterConfig(device);
+
     // Open the "backend"
     LockLists();
     ALCdevice_OpenPlayback(device, "Loopback");
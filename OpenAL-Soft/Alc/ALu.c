@@ -35,6 +35,7 @@
 #include "alAuxEffectSlot.h"
 #include "alu.h"
 #include "bs2b.h"
+#include "mixer_defs.h"
 
 
 static __inline ALvoid aluCrossproduct(const ALfloat *inVector1, const ALfloat *inVector2, ALfloat *outVector)
@@ -76,7 +77,7 @@ static __inline ALvoid aluMatrixVector(ALfloat *vector,ALfloat w,ALfloat matrix[
 }
 
 
-ALvoid CalcNonAttnSourceParams(ALsource *ALSource, const ALCcontext *ALContext)
+ALvoid CalcNonAttnSourceParams(ALsource *ALSource, ALsourceParams *Params, const ALCcontext *ALContext)
 {
     static const ALfloat angles_Mono[1] = { 0.0f };
     static const ALfloat angles_Stereo[2] = { -30.0f, 30.0f };
@@ -135,46 +136,44 @@ ALvoid CalcNonAttnSourceParams(ALsource *ALSource, const ALCcontext *ALContext)
     ListenerGain = ALContext->Listener.Gain;
 
     /* Get source properties */
-    SourceVolume    = ALSource->flGain;
-    MinVolume       = ALSource->flMinGain;
-    MaxVolume       = ALSource->flMaxGain;
-    Pitch           = ALSource->flPitch;
-    Resampler       = ALSource->Resampler;
-    VirtualChannels = ALSource->VirtualChannels;
+    SourceVolume    = ALSource->Props.flGain;
+    MinVolume       = ALSource->Props.flMinGain;
+    MaxVolume       = ALSource->Props.flMaxGain;
+    Pitch           = ALSource->Props.flPitch;
+    Resampler       = ALSource->Props.Resampler;
+    VirtualChannels = ALSource->Props.VirtualChannels;
 
     /* Calculate the stepping value */
     Channels = FmtMono;
+    Params->Resampler = Resampler;
     BufferListItem = ALSource->queue;
     while(BufferListItem != NULL)
     {
         ALbuffer *ALBuffer;
         if((ALBuffer=BufferListItem->buffer) != NULL)
         {
-            ALint maxstep = STACK_DATA_SIZE / ALSource->NumChannels /
-                                              ALSource->SampleSize;
-            maxstep -= ResamplerPadding[Resampler] +
-                       ResamplerPrePadding[Resampler] + 1;
-            maxstep = mini(maxstep, INT_MAX>>FRACTIONBITS);
+            const ALint maxstep = INT_MAX>>FRACTIONBITS;
 
             Pitch = Pitch * ALBuffer->Frequency / Frequency;
             if(Pitch > (ALfloat)maxstep)
-                ALSource->Params.Step = maxstep<<FRACTIONBITS;
+                Params->Step = maxstep<<FRACTIONBITS;
             else
             {
-                ALSource->Params.Step = Pitch*FRACTIONONE;
-                if(ALSource->Params.Step == 0)
-                    ALSource->Params.Step = 1;
+                Params->Step = Pitch*FRACTIONONE;
+                if(Params->Step == 0)
+                    Params->Step = 1;
             }
 
             Channels = ALBuffer->FmtChannels;
 
-            if(ALSource->VirtualChannels && (Device->Flags&DEVICE_USE_HRTF))
-                ALSource->Params.DoMix = SelectHrtfMixer(ALBuffer,
-                       (ALSource->Params.Step==FRACTIONONE) ? POINT_RESAMPLER :
+            if(ALSource->Props.VirtualChannels && (Device->Flags&DEVICE_USE_HRTF) &&
+               !Device->AmbiOrder)
+                Params->DoMix = SelectHrtfMixer(ALBuffer,
+                       (Params->Step==FRACTIONONE) ? POINT_RESAMPLER :
                                                               Resampler);
             else
-                ALSource->Params.DoMix = SelectMixer(ALBuffer,
-                       (ALSource->Params.Step==FRACTIONONE) ? POINT_RESAMPLER :
+                Params->DoMix = SelectMixer(ALBuffer,
+                       (Params->Step==FRACTIONONE) ? POINT_RESAMPLER :
                                                               Resampler);
             break;
         }
@@ -183,16 +182,16 @@ ALvoid CalcNonAttnSourceParams(ALsource *ALSource, const ALCcontext *ALContext)
 
     /* Calculate gains */
     DryGain  = clampf(SourceVolume, MinVolume, MaxVolume);
-    DryGain *= ALSource->DirectGain;
-    DryGainHF = ALSource->DirectGainHF;
+    DryGain *= ALSource->Props.DirectGain;
+    DryGainHF = ALSource->Props.DirectGainHF;
     for(i = 0;i < NumSends;i++)
     {
         WetGain[i]  = clampf(SourceVolume, MinVolume, MaxVolume);
-        WetGain[i] *= ALSource->Send[i].WetGain;
-        WetGainHF[i] = ALSource->Send[i].WetGainHF;
+        WetGain[i] *= ALSource->Props.Send[i].WetGain;
+        WetGainHF[i] = ALSource->Props.Send[i].WetGainHF;
     }
 
-    SrcMatrix = ALSource->Params.DryGains;
+    SrcMatrix = Params->DryGains;
     for(i = 0;i < MAXCHANNELS;i++)
     {
         for(c = 0;c < MAXCHANNELS;c++)
@@ -211,6 +210,20 @@ ALvoid CalcNonAttnSourceParams(ALsource *ALSource, const ALCcontext *ALContext)
             DryGain *= aluSqrt(2.0f/4.0f);
             for(c = 0;c < 2;c++)
             {
+                if(Device->AmbiOrder)
+                {
+                    ALfloat coeffs[MAXCHANNELS];
+                    ALfloat dir[3];
+
+                    dir[0] =  sin(angles_Rear[c] * (M_PI/180.0));
+                    dir[1] =  0.0f;
+                    dir[2] = -cos(angles_Rear[c] * (M_PI/180.0));
+                    aluCalcAmbiCoeffs(Device, dir, 1.0f, coeffs);
+                    for(i = 0;i < (ALint)Device->NumDryChannels;i++)
+                        SrcMatrix[c][i] += DryGain * ListenerGain * coeffs[i];
+                    continue;
+                }
+
                 pos = aluCart2LUTpos(cos(angles_Rear[c] * (M_PI/180.0)),
                                      sin(angles_Rear[c] * (M_PI/180.0)));
                 SpeakerGain = Device->PanningLUT[pos];
@@ -259,36 +272,61 @@ ALvoid CalcNonAttnSourceParams(ALsource *ALSource, const ALCcontext *ALContext)
         break;
     }
 
-    if(VirtualChannels == AL_FALSE)
+    if(Device->AmbiOrder)
+    {
+        /* Encode each channel from its speaker's direction. Without virtual
+         * channels they still have to go through the bus, and LFE is
+         * dropped since the bus has nowhere to put it. */
+        for(c = 0;c < num_channels;c++)
+        {
+            ALfloat coeffs[MAXCHANNELS];
+            ALfloat dir[3];
+
+            if(chans[c] == LFE)
+                continue;
+
+            dir[0] =  sin(angles[c] * (M_PI/180.0));
+            dir[1] =  0.0f;
+            dir[2] = -cos(angles[c] * (M_PI/180.0));
+            aluCalcAmbiCoeffs(Device, dir, 1.0f, coeffs);
+            for(i = 0;i < (ALint)Device->NumDryChannels;i++)
+                SrcMatrix[c][i] += DryGain * ListenerGain * coeffs[i];
+        }
+    }
+    else if(VirtualChannels == AL_FALSE)
     {
         for(c = 0;c < num_channels;c++)
             SrcMatrix[c][chans[c]] += DryGain * ListenerGain;
     }
     else if((Device->Flags&DEVICE_USE_HRTF))
     {
+        const ALuint IrSize = GetHrtfIrSize(Device->Hrtf);
+
         for(c = 0;c < num_channels;c++)
         {
+            ALfloat (*coeffs)[2] = &Params->HrtfCoeffs[c*IrSize];
+
             if(chans[c] == LFE)
             {
                 /* Skip LFE */
-                ALSource->Params.HrtfDelay[c][0] = 0;
-                ALSource->Params.HrtfDelay[c][1] = 0;
-                for(i = 0;i < HRIR_LENGTH;i++)
+                Params->HrtfDelay[c][0] = 0;
+                Params->HrtfDelay[c][1] = 0;
+                for(i = 0;i < (ALint)IrSize;i++)
                 {
-                    ALSource->Params.HrtfCoeffs[c][i][0] = 0.0f;
-                    ALSource->Params.HrtfCoeffs[c][i][1] = 0.0f;
+                    coeffs[i][0] = 0.0f;
+                    coeffs[i][1] = 0.0f;
                 }
             }
             else
             {
                 /* Get the static HRIR coefficients and delays for this
                  * channel. */
-                GetLerpedHrtfCoeffs(0.0, angles[c] * (M_PI/180.0),
-                                    DryGain*ListenerGain,
-                                    ALSource->Params.HrtfCoeffs[c],
-                                    ALSource->Params.HrtfDelay[c]);
+                GetLerpedHrtfCoeffs(Device->HrtfCache,
+                                    0.0, angles[c] * (M_PI/180.0),
+                                    DryGain*ListenerGain, coeffs,
+                                    Params->HrtfDelay[c]);
             }
-            ALSource->HrtfCounter = 0;
+            Params->HrtfCounter = 0;
         }
     }
     else
@@ -314,8 +352,8 @@ ALvoid CalcNonAttnSourceParams(ALsource *ALSource, const ALCcontext *ALContext)
     }
     for(i = 0;i < NumSends;i++)
     {
-        ALSource->Params.Send[i].Slot = ALSource->Send[i].Slot;
-        ALSource->Params.Send[i].WetGain = WetGain[i] * ListenerGain;
+        Params->Send[i].Slot = ALSource->Props.Send[i].Slot;
+        Params->Send[i].WetGain = WetGain[i] * ListenerGain;
     }
 
     /* Update filter coefficients. Calculations based on the I3DL2
@@ -325,24 +363,169 @@ ALvoid CalcNonAttnSourceParams(ALsource *ALSource, const ALCcontext *ALContext)
     /* We use two chained one-pole filters, so we need to take the
      * square root of the squared gain, which is the same as the base
      * gain. */
-    ALSource->Params.iirFilter.coeff = lpCoeffCalc(DryGainHF, cw);
+    Params->iirCoeff = lpCoeffCalc(DryGainHF, cw);
     for(i = 0;i < NumSends;i++)
     {
         /* We use a one-pole filter, so we need to take the squared gain */
         ALfloat a = lpCoeffCalc(WetGainHF[i]*WetGainHF[i], cw);
-        ALSource->Params.Send[i].iirFilter.coeff = a;
+        Params->Send[i].iirCoeff = a;
     }
 }
 
-ALvoid CalcSourceParams(ALsource *ALSource, const ALCcontext *ALContext)
+/* Sources tend to need their parameters recalculated together, such as when
+ * the listener moves, so they're done in batches. The spatial properties of a
+ * batch's sources are gathered into an array each, and the parts that only
+ * need plain arithmetic (transforming into listener space, distances, cone
+ * angles and doppler shifts) are worked out in loops over the whole batch that
+ * the compiler can vectorize. The rest (attenuation, which depends on each
+ * source's distance model and uses pow, and then the panning, which depends on
+ * the buffer and output mode) is done for each source in turn.
+ */
+#define SOURCE_BATCH_SIZE  64
+
+typedef struct SourceBatch {
+    // Position, orientation, and velocity, transformed into listener space
+    ALfloat PosX[SOURCE_BATCH_SIZE], PosY[SOURCE_BATCH_SIZE], PosZ[SOURCE_BATCH_SIZE];
+    ALfloat DirX[SOURCE_BATCH_SIZE], DirY[SOURCE_BATCH_SIZE], DirZ[SOURCE_BATCH_SIZE];
+    ALfloat VelX[SOURCE_BATCH_SIZE], VelY[SOURCE_BATCH_SIZE], VelZ[SOURCE_BATCH_SIZE];
+    // Non-0 for head-relative sources, which aren't transformed
+    ALuint  Relative[SOURCE_BATCH_SIZE];
+
+    ALfloat DopplerFactor[SOURCE_BATCH_SIZE];
+
+    // Distance to the listener, the cosine of the angle from the source's
+    // direction to the listener, and the pitch change from doppler
+    ALfloat Distance[SOURCE_BATCH_SIZE];
+    ALfloat ConeCos[SOURCE_BATCH_SIZE];
+    ALfloat DopplerShift[SOURCE_BATCH_SIZE];
+
+    // Filter coefficient term for the device's frequency
+    ALfloat LowpassCw;
+} SourceBatch;
+
+/* Transforms a batch of vectors by the matrix, the same as aluMatrixVector
+ * does for one, leaving those of head-relative sources alone. */
+static __inline ALvoid aluMatrixVectorBatch(ALfloat *RESTRICT x, ALfloat *RESTRICT y,
+                                            ALfloat *RESTRICT z, ALfloat w,
+                                            ALfloat matrix[4][4],
+                                            const ALuint *RESTRICT Relative,
+                                            ALuint count)
+{
+    ALuint i;
+
+    for(i = 0;i < count;i++)
+    {
+        const ALfloat temp[4] = { x[i], y[i], z[i], w };
+        ALfloat out[3];
+
+        out[0] = temp[0]*matrix[0][0] + temp[1]*matrix[1][0] + temp[2]*matrix[2][0] + temp[3]*matrix[3][0];
+        out[1] = temp[0]*matrix[0][1] + temp[1]*matrix[1][1] + temp[2]*matrix[2][1] + temp[3]*matrix[3][1];
+        out[2] = temp[0]*matrix[0][2] + temp[1]*matrix[1][2] + temp[2]*matrix[2][2] + temp[3]*matrix[3][2];
+
+        x[i] = (Relative[i] ? temp[0] : out[0]);
+        y[i] = (Relative[i] ? temp[1] : out[1]);
+        z[i] = (Relative[i] ? temp[2] : out[2]);
+    }
+}
+
+static ALvoid CalcBatchGeometry(SourceBatch *RESTRICT batch, ALuint count, const ALCcontext *ALContext)
+{
+    ALfloat U[3],V[3],N[3];
+    ALfloat Matrix[4][4];
+    ALfloat ListenerVel[3];
+    ALfloat SpeedOfSound;
+    ALuint i;
+
+    // Scaled by the doppler velocity, as only the product is used
+    SpeedOfSound = ALContext->flSpeedOfSound * ALContext->DopplerVelocity;
+
+    // Build transform matrix
+    memcpy(N, ALContext->Listener.Forward, sizeof(N));  // At-vector
+    aluNormalize(N);  // Normalized At-vector
+    memcpy(V, ALContext->Listener.Up, sizeof(V));  // Up-vector
+    aluNormalize(V);  // Normalized Up-vector
+    aluCrossproduct(N, V, U); // Right-vector
+    aluNormalize(U);  // Normalized Right-vector
+    Matrix[0][0] = U[0]; Matrix[0][1] = V[0]; Matrix[0][2] = -N[0]; Matrix[0][3] = 0.0f;
+    Matrix[1][0] = U[1]; Matrix[1][1] = V[1]; Matrix[1][2] = -N[1]; Matrix[1][3] = 0.0f;
+    Matrix[2][0] = U[2]; Matrix[2][1] = V[2]; Matrix[2][2] = -N[2]; Matrix[2][3] = 0.0f;
+    Matrix[3][0] = 0.0f; Matrix[3][1] = 0.0f; Matrix[3][2] =  0.0f; Matrix[3][3] = 1.0f;
+
+    // Transform source position, direction, and velocity, and the listener's
+    // velocity, into listener space. Source positions were already made
+    // relative to the listener when gathered.
+    aluMatrixVectorBatch(batch->PosX, batch->PosY, batch->PosZ, 1.0f, Matrix,
+                         batch->Relative, count);
+    aluMatrixVectorBatch(batch->DirX, batch->DirY, batch->DirZ, 0.0f, Matrix,
+                         batch->Relative, count);
+    aluMatrixVectorBatch(batch->VelX, batch->VelY, batch->VelZ, 0.0f, Matrix,
+                         batch->Relative, count);
+    memcpy(ListenerVel, ALContext->Listener.Velocity, sizeof(ListenerVel));
+    aluMatrixVector(ListenerVel, 0.0f, Matrix);
+
+    for(i = 0;i < count;i++)
+    {
+        ALfloat ToListener[3], Direction[3], LisVel[3];
+        ALfloat length, invlen;
+        ALfloat VSS, VLS, MaxVelocity;
+
+        ToListener[0] = -batch->PosX[i];
+        ToListener[1] = -batch->PosY[i];
+        ToListener[2] = -batch->PosZ[i];
+        length = aluSqrt(ToListener[0]*ToListener[0] + ToListener[1]*ToListener[1] +
+                         ToListener[2]*ToListener[2]);
+        invlen = ((length != 0.0f) ? 1.0f/length : 1.0f);
+        ToListener[0] *= invlen;
+        ToListener[1] *= invlen;
+        ToListener[2] *= invlen;
+
+        Direction[0] = batch->DirX[i];
+        Direction[1] = batch->DirY[i];
+        Direction[2] = batch->DirZ[i];
+        length = aluSqrt(Direction[0]*Direction[0] + Direction[1]*Direction[1] +
+                         Direction[2]*Direction[2]);
+        invlen = ((length != 0.0f) ? 1.0f/length : 1.0f);
+        Direction[0] *= invlen;
+        Direction[1] *= invlen;
+        Direction[2] *= invlen;
+
+        batch->Distance[i] = aluSqrt(batch->PosX[i]*batch->PosX[i] +
+                                     batch->PosY[i]*batch->PosY[i] +
+                                     batch->PosZ[i]*batch->PosZ[i]);
+        batch->ConeCos[i] = Direction[0]*ToListener[0] + Direction[1]*ToListener[1] +
+                            Direction[2]*ToListener[2];
+
+        // Calculate Velocity
+        LisVel[0] = (batch->Relative[i] ? 0.0f : ListenerVel[0]);
+        LisVel[1] = (batch->Relative[i] ? 0.0f : ListenerVel[1]);
+        LisVel[2] = (batch->Relative[i] ? 0.0f : ListenerVel[2]);
+        MaxVelocity = SpeedOfSound / batch->DopplerFactor[i];
+
+        VSS = batch->VelX[i]*ToListener[0] + batch->VelY[i]*ToListener[1] +
+              batch->VelZ[i]*ToListener[2];
+        VSS = ((VSS >= MaxVelocity) ? (MaxVelocity - 1.0f) :
+               (VSS <= -MaxVelocity) ? (-MaxVelocity + 1.0f) : VSS);
+
+        VLS = LisVel[0]*ToListener[0] + LisVel[1]*ToListener[1] +
+              LisVel[2]*ToListener[2];
+        VLS = ((VLS >= MaxVelocity) ? (MaxVelocity - 1.0f) :
+               (VLS <= -MaxVelocity) ? (-MaxVelocity + 1.0f) : VLS);
+
+        batch->DopplerShift[i] = ((batch->DopplerFactor[i] != 0.0f) ?
+            (SpeedOfSound - (batch->DopplerFactor[i]*VLS)) /
+            (SpeedOfSound - (batch->DopplerFactor[i]*VSS)) : 1.0f);
+    }
+}
+
+static ALvoid CalcBatchSourceParams(ALsource *ALSource, ALsourceParams *Params,
+                                   const ALCcontext *ALContext,
+                                   const SourceBatch *batch, ALuint idx)
 {
     const ALCdevice *Device = ALContext->Device;
     ALfloat InnerAngle,OuterAngle,Angle,Distance,ClampedDist;
-    ALfloat Direction[3],Position[3],SourceToListener[3];
-    ALfloat Velocity[3],ListenerVel[3];
+    ALfloat Position[3];
     ALfloat MinVolume,MaxVolume,MinDist,MaxDist,Rolloff;
     ALfloat ConeVolume,ConeHF,SourceVolume,ListenerGain;
-    ALfloat DopplerFactor, DopplerVelocity, SpeedOfSound;
     ALfloat AirAbsorptionFactor;
     ALfloat RoomAirAbsorption[MAX_SENDS];
     ALbufferlistitem *BufferListItem;
@@ -363,7 +546,6 @@ ALvoid CalcSourceParams(ALsource *ALSource, const ALCcontext *ALContext)
     ALfloat Pitch;
     ALuint Frequency;
     ALint NumSends;
-    ALfloat cw;
     ALint i;
 
     DryGainHF = 1.0f;
@@ -371,39 +553,32 @@ ALvoid CalcSourceParams(ALsource *ALSource, const ALCcontext *ALContext)
         WetGainHF[i] = 1.0f;
 
     //Get context properties
-    DopplerFactor   = ALContext->DopplerFactor * ALSource->DopplerFactor;
-    DopplerVelocity = ALContext->DopplerVelocity;
-    SpeedOfSound    = ALContext->flSpeedOfSound;
     NumSends        = Device->NumAuxSends;
     Frequency       = Device->Frequency;
 
     //Get listener properties
     ListenerGain = ALContext->Listener.Gain;
     MetersPerUnit = ALContext->Listener.MetersPerUnit;
-    memcpy(ListenerVel, ALContext->Listener.Velocity, sizeof(ALContext->Listener.Velocity));
 
     //Get source properties
-    SourceVolume = ALSource->flGain;
-    MinVolume    = ALSource->flMinGain;
-    MaxVolume    = ALSource->flMaxGain;
-    Pitch        = ALSource->flPitch;
-    Resampler    = ALSource->Resampler;
-    memcpy(Position,  ALSource->vPosition,    sizeof(ALSource->vPosition));
-    memcpy(Direction, ALSource->vOrientation, sizeof(ALSource->vOrientation));
-    memcpy(Velocity,  ALSource->vVelocity,    sizeof(ALSource->vVelocity));
-    MinDist = ALSource->flRefDistance;
-    MaxDist = ALSource->flMaxDistance;
-    Rolloff = ALSource->flRollOffFactor;
-    InnerAngle = ALSource->flInnerAngle * ConeScale;
-    OuterAngle = ALSource->flOuterAngle * ConeScale;
-    AirAbsorptionFactor = ALSource->AirAbsorptionFactor;
-    DryGainHFAuto = ALSource->DryGainHFAuto;
-    WetGainAuto   = ALSource->WetGainAuto;
-    WetGainHFAuto = ALSource->WetGainHFAuto;
-    RoomRolloffBase = ALSource->RoomRolloffFactor;
+    SourceVolume = ALSource->Props.flGain;
+    MinVolume    = ALSource->Props.flMinGain;
+    MaxVolume    = ALSource->Props.flMaxGain;
+    Pitch        = ALSource->Props.flPitch;
+    Resampler    = ALSource->Props.Resampler;
+    MinDist = ALSource->Props.flRefDistance;
+    MaxDist = ALSource->Props.flMaxDistance;
+    Rolloff = ALSource->Props.flRollOffFactor;
+    InnerAngle = ALSource->Props.flInnerAngle * ConeScale;
+    OuterAngle = ALSource->Props.flOuterAngle * ConeScale;
+    AirAbsorptionFactor = ALSource->Props.AirAbsorptionFactor;
+    DryGainHFAuto = ALSource->Props.DryGainHFAuto;
+    WetGainAuto   = ALSource->Props.WetGainAuto;
+    WetGainHFAuto = ALSource->Props.WetGainHFAuto;
+    RoomRolloffBase = ALSource->Props.RoomRolloffFactor;
     for(i = 0;i < NumSends;i++)
     {
-        ALeffectslot *Slot = ALSource->Send[i].Slot;
+        ALeffectslot *Slot = ALSource->Props.Send[i].Slot;
 
         if(!Slot || Slot->effect.type == AL_EFFECT_NULL)
         {
@@ -436,56 +611,22 @@ ALvoid CalcSourceParams(ALsource *ALSource, const ALCcontext *ALContext)
             RoomAirAbsorption[i] = AIRABSORBGAINHF;
         }
 
-        ALSource->Params.Send[i].Slot = Slot;
+        Params->Send[i].Slot = Slot;
     }
 
-    //1. Translate Listener to origin (convert to head relative)
-    if(ALSource->bHeadRelative == AL_FALSE)
-    {
-        ALfloat U[3],V[3],N[3];
-        ALfloat Matrix[4][4];
-
-        // Build transform matrix
-        memcpy(N, ALContext->Listener.Forward, sizeof(N));  // At-vector
-        aluNormalize(N);  // Normalized At-vector
-        memcpy(V, ALContext->Listener.Up, sizeof(V));  // Up-vector
-        aluNormalize(V);  // Normalized Up-vector
-        aluCrossproduct(N, V, U); // Right-vector
-        aluNormalize(U);  // Normalized Right-vector
-        Matrix[0][0] = U[0]; Matrix[0][1] = V[0]; Matrix[0][2] = -N[0]; Matrix[0][3] = 0.0f;
-        Matrix[1][0] = U[1]; Matrix[1][1] = V[1]; Matrix[1][2] = -N[1]; Matrix[1][3] = 0.0f;
-        Matrix[2][0] = U[2]; Matrix[2][1] = V[2]; Matrix[2][2] = -N[2]; Matrix[2][3] = 0.0f;
-        Matrix[3][0] = 0.0f; Matrix[3][1] = 0.0f; Matrix[3][2] =  0.0f; Matrix[3][3] = 1.0f;
-
-        // Translate position
-        Position[0] -= ALContext->Listener.Position[0];
-        Position[1] -= ALContext->Listener.Position[1];
-        Position[2] -= ALContext->Listener.Position[2];
-
-        // Transform source position and direction into listener space
-        aluMatrixVector(Position, 1.0f, Matrix);
-        aluMatrixVector(Direction, 0.0f, Matrix);
-        // Transform source and listener velocity into listener space
-        aluMatrixVector(Velocity, 0.0f, Matrix);
-        aluMatrixVector(ListenerVel, 0.0f, Matrix);
-    }
-    else
-        ListenerVel[0] = ListenerVel[1] = ListenerVel[2] = 0.0f;
-
-    SourceToListener[0] = -Position[0];
-    SourceToListener[1] = -Position[1];
-    SourceToListener[2] = -Position[2];
-    aluNormalize(SourceToListener);
-    aluNormalize(Direction);
+    //1. Get the source's position in listener space
+    Position[0] = batch->PosX[idx];
+    Position[1] = batch->PosY[idx];
+    Position[2] = batch->PosZ[idx];
 
     //2. Calculate distance attenuation
-    Distance = aluSqrt(aluDotproduct(Position, Position));
+    Distance = batch->Distance[idx];
     ClampedDist = Distance;
 
     Attenuation = 1.0f;
     for(i = 0;i < NumSends;i++)
         RoomAttenuation[i] = 1.0f;
-    switch(ALContext->SourceDistanceModel ? ALSource->DistanceModel :
+    switch(ALContext->SourceDistanceModel ? ALSource->Props.DistanceModel :
                                             ALContext->DistanceModel)
     {
         case InverseDistanceClamped:
@@ -560,17 +701,17 @@ ALvoid CalcSourceParams(ALsource *ALSource, const ALCcontext *ALContext)
     }
 
     //3. Apply directional soundcones
-    Angle = aluAcos(aluDotproduct(Direction,SourceToListener)) * (180.0/M_PI);
+    Angle = aluAcos(batch->ConeCos[idx]) * (180.0/M_PI);
     if(Angle >= InnerAngle && Angle <= OuterAngle)
     {
         ALfloat scale = (Angle-InnerAngle) / (OuterAngle-InnerAngle);
-        ConeVolume = lerp(1.0, ALSource->flOuterGain, scale);
-        ConeHF = lerp(1.0, ALSource->OuterGainHF, scale);
+        ConeVolume = lerp(1.0, ALSource->Props.flOuterGain, scale);
+        ConeHF = lerp(1.0, ALSource->Props.OuterGainHF, scale);
     }
     else if(Angle > OuterAngle)
     {
-        ConeVolume = ALSource->flOuterGain;
-        ConeHF = ALSource->OuterGainHF;
+        ConeVolume = ALSource->Props.flOuterGain;
+        ConeHF = ALSource->Props.OuterGainHF;
     }
     else
     {
@@ -598,12 +739,12 @@ ALvoid CalcSourceParams(ALsource *ALSource, const ALCcontext *ALContext)
         WetGain[i] = clampf(WetGain[i], MinVolume, MaxVolume);
 
     // Apply filter gains and filters
-    DryGain   *= ALSource->DirectGain * ListenerGain;
-    DryGainHF *= ALSource->DirectGainHF;
+    DryGain   *= ALSource->Props.DirectGain * ListenerGain;
+    DryGainHF *= ALSource->Props.DirectGainHF;
     for(i = 0;i < NumSends;i++)
     {
-        WetGain[i]   *= ALSource->Send[i].WetGain * ListenerGain;
-        WetGainHF[i] *= ALSource->Send[i].WetGainHF;
+        WetGain[i]   *= ALSource->Props.Send[i].WetGain * ListenerGain;
+        WetGainHF[i] *= ALSource->Props.Send[i].WetGainHF;
     }
 
     if(WetGainAuto)
@@ -623,65 +764,70 @@ ALvoid CalcSourceParams(ALsource *ALSource, const ALCcontext *ALContext)
         }
     }
 
-    // Calculate Velocity
-    if(DopplerFactor != 0.0f)
-    {
-        ALfloat VSS, VLS;
-        ALfloat MaxVelocity = (SpeedOfSound*DopplerVelocity) /
-                              DopplerFactor;
-
-        VSS = aluDotproduct(Velocity, SourceToListener);
-        if(VSS >= MaxVelocity)
-            VSS = (MaxVelocity - 1.0f);
-        else if(VSS <= -MaxVelocity)
-            VSS = -MaxVelocity + 1.0f;
-
-        VLS = aluDotproduct(ListenerVel, SourceToListener);
-        if(VLS >= MaxVelocity)
-            VLS = (MaxVelocity - 1.0f);
-        else if(VLS <= -MaxVelocity)
-            VLS = -MaxVelocity + 1.0f;
-
-        Pitch *= ((SpeedOfSound*DopplerVelocity) - (DopplerFactor*VLS)) /
-                 ((SpeedOfSound*DopplerVelocity) - (DopplerFactor*VSS));
-    }
+    // Apply the doppler shift
+    Pitch *= batch->DopplerShift[idx];
 
+    Params->Resampler = Resampler;
     BufferListItem = ALSource->queue;
     while(BufferListItem != NULL)
     {
         ALbuffer *ALBuffer;
         if((ALBuffer=BufferListItem->buffer) != NULL)
         {
-            ALint maxstep = STACK_DATA_SIZE / ALSource->NumChannels /
-                                              ALSource->SampleSize;
-            maxstep -= ResamplerPadding[Resampler] +
-                       ResamplerPrePadding[Resampler] + 1;
-            maxstep = mini(maxstep, INT_MAX>>FRACTIONBITS);
+            const ALint maxstep = INT_MAX>>FRACTIONBITS;
 
             Pitch = Pitch * ALBuffer->Frequency / Frequency;
             if(Pitch > (ALfloat)maxstep)
-                ALSource->Params.Step = maxstep<<FRACTIONBITS;
+                Params->Step = maxstep<<FRACTIONBITS;
             else
             {
-                ALSource->Params.Step = Pitch*FRACTIONONE;
-                if(ALSource->Params.Step == 0)
-                    ALSource->Params.Step = 1;
+                Params->Step = Pitch*FRACTIONONE;
+                if(Params->Step == 0)
+                    Params->Step = 1;
             }
 
-            if((Device->Flags&DEVICE_USE_HRTF))
-                ALSource->Params.DoMix = SelectHrtfMixer(ALBuffer,
-                       (ALSource->Params.Step==FRACTIONONE) ? POINT_RESAMPLER :
+            if((Device->Flags&DEVICE_USE_HRTF) && !Device->AmbiOrder)
+                Params->DoMix = SelectHrtfMixer(ALBuffer,
+                       (Params->Step==FRACTIONONE) ? POINT_RESAMPLER :
                                                               Resampler);
             else
-                ALSource->Params.DoMix = SelectMixer(ALBuffer,
-                       (ALSource->Params.Step==FRACTIONONE) ? POINT_RESAMPLER :
+                Params->DoMix = SelectMixer(ALBuffer,
+                       (Params->Step==FRACTIONONE) ? POINT_RESAMPLER :
                                                               Resampler);
             break;
         }
         BufferListItem = BufferListItem->next;
     }
 
-    if((Device->Flags&DEVICE_USE_HRTF))
+    if(Device->AmbiOrder)
+    {
+        // Encode the source's direction onto the ambisonic bus. Like with
+        // panning, it gets less directional closer than the reference
+        // distance.
+        ALfloat coeffs[MAXCHANNELS];
+        ALfloat dir[3] = { 0.0f, 0.0f, -1.0f };
+        ALfloat DirGain = 0.0f;
+
+        if(Distance > 0.0f)
+        {
+            ALfloat invlen = 1.0f/Distance;
+            dir[0] = Position[0] * invlen;
+            dir[1] = Position[1] * invlen;
+            dir[2] = Position[2] * invlen * ZScale;
+            DirGain = Distance / maxf(Distance, MinDist);
+        }
+        aluCalcAmbiCoeffs(Device, dir, DirGain, coeffs);
+
+        for(i = 0;i < MAXCHANNELS;i++)
+        {
+            ALuint i2;
+            for(i2 = 0;i2 < MAXCHANNELS;i2++)
+                Params->DryGains[i][i2] = 0.0f;
+        }
+        for(i = 0;i < (ALint)Device->NumDryChannels;i++)
+            Params->DryGains[0][i] = DryGain * coeffs[i];
+    }
+    else if((Device->Flags&DEVICE_USE_HRTF))
     {
         // Use a binaural HRTF algorithm for stereo headphone playback
         ALfloat delta, ev = 0.0f, az = 0.0f;
@@ -704,35 +850,36 @@ ALvoid CalcSourceParams(ALsource *ALSource, const ALCcontext *ALContext)
         if(ALSource->HrtfMoving)
         {
             // Calculate the normalized HRTF transition factor (delta).
-            delta = CalcHrtfDelta(ALSource->Params.HrtfGain, DryGain,
-                                  ALSource->Params.HrtfDir, Position);
+            delta = CalcHrtfDelta(Params->HrtfGain, DryGain,
+                                  Params->HrtfDir, Position);
             // If the delta is large enough, get the moving HRIR target
             // coefficients, target delays, steppping values, and counter.
             if(delta > 0.001f)
             {
-                ALSource->HrtfCounter = GetMovingHrtfCoeffs(ev, az, DryGain,
-                                          delta, ALSource->HrtfCounter,
-                                          ALSource->Params.HrtfCoeffs[0],
-                                          ALSource->Params.HrtfDelay[0],
-                                          ALSource->Params.HrtfCoeffStep,
-                                          ALSource->Params.HrtfDelayStep);
-                ALSource->Params.HrtfGain = DryGain;
-                ALSource->Params.HrtfDir[0] = Position[0];
-                ALSource->Params.HrtfDir[1] = Position[1];
-                ALSource->Params.HrtfDir[2] = Position[2];
+                Params->HrtfCounter = GetMovingHrtfCoeffs(Device->HrtfCache,
+                                          ev, az, DryGain,
+                                          delta, Params->HrtfCounter,
+                                          Params->HrtfCoeffs,
+                                          Params->HrtfDelay[0],
+                                          Params->HrtfCoeffStep,
+                                          Params->HrtfDelayStep);
+                Params->HrtfGain = DryGain;
+                Params->HrtfDir[0] = Position[0];
+                Params->HrtfDir[1] = Position[1];
+                Params->HrtfDir[2] = Position[2];
             }
         }
         else
         {
             // Get the initial (static) HRIR coefficients and delays.
-            GetLerpedHrtfCoeffs(ev, az, DryGain,
-                                ALSource->Params.HrtfCoeffs[0],
-                                ALSource->Params.HrtfDelay[0]);
-            ALSource->HrtfCounter = 0;
-            ALSource->Params.HrtfGain = DryGain;
-            ALSource->Params.HrtfDir[0] = Position[0];
-            ALSource->Params.HrtfDir[1] = Position[1];
-            ALSource->Params.HrtfDir[2] = Position[2];
+            GetLerpedHrtfCoeffs(Device->HrtfCache, ev, az, DryGain,
+                                Params->HrtfCoeffs,
+                                Params->HrtfDelay[0]);
+            Params->HrtfCounter = 0;
+            Params->HrtfGain = DryGain;
+            Params->HrtfDir[0] = Position[0];
+            Params->HrtfDir[1] = Position[1];
+            Params->HrtfDir[2] = Position[2];
         }
     }
     else
@@ -763,127 +910,291 @@ ALvoid CalcSourceParams(ALsource *ALSource, const ALCcontext *ALContext)
         {
             ALuint i2;
             for(i2 = 0;i2 < MAXCHANNELS;i2++)
-                ALSource->Params.DryGains[i][i2] = 0.0f;
+                Params->DryGains[i][i2] = 0.0f;
         }
         for(i = 0;i < (ALint)Device->NumChan;i++)
         {
             enum Channel chan = Device->Speaker2Chan[i];
             ALfloat gain = lerp(AmbientGain, SpeakerGain[chan], DirGain);
-            ALSource->Params.DryGains[0][chan] = DryGain * gain;
+            Params->DryGains[0][chan] = DryGain * gain;
         }
     }
     for(i = 0;i < NumSends;i++)
-        ALSource->Params.Send[i].WetGain = WetGain[i];
+        Params->Send[i].WetGain = WetGain[i];
 
     /* Update filter coefficients. */
-    cw = cos(2.0*M_PI * LOWPASSFREQCUTOFF / Frequency);
-
-    ALSource->Params.iirFilter.coeff = lpCoeffCalc(DryGainHF, cw);
+    Params->iirCoeff = lpCoeffCalc(DryGainHF, batch->LowpassCw);
     for(i = 0;i < NumSends;i++)
     {
-        ALfloat a = lpCoeffCalc(WetGainHF[i]*WetGainHF[i], cw);
-        ALSource->Params.Send[i].iirFilter.coeff = a;
+        ALfloat a = lpCoeffCalc(WetGainHF[i]*WetGainHF[i], batch->LowpassCw);
+        Params->Send[i].iirCoeff = a;
     }
 }
 
+ALvoid CalcSourceParamsBatch(ALsource *const*sources, ALsourceParams *const*params,
+                             ALuint count, const ALCcontext *ALContext)
+{
+    const ALCdevice *Device = ALContext->Device;
+    SourceBatch batch;
+    ALuint i;
+
+    while(count > 0)
+    {
+        const ALuint todo = minu(count, SOURCE_BATCH_SIZE);
+
+        for(i = 0;i < todo;i++)
+        {
+            const ALsource *ALSource = sources[i];
+
+            batch.PosX[i] = ALSource->Props.vPosition[0];
+            batch.PosY[i] = ALSource->Props.vPosition[1];
+            batch.PosZ[i] = ALSource->Props.vPosition[2];
+            batch.DirX[i] = ALSource->Props.vOrientation[0];
+            batch.DirY[i] = ALSource->Props.vOrientation[1];
+            batch.DirZ[i] = ALSource->Props.vOrientation[2];
+            batch.VelX[i] = ALSource->Props.vVelocity[0];
+            batch.VelY[i] = ALSource->Props.vVelocity[1];
+            batch.VelZ[i] = ALSource->Props.vVelocity[2];
+            batch.Relative[i] = (ALSource->Props.bHeadRelative != AL_FALSE);
+            if(!batch.Relative[i])
+            {
+                // Translate Listener to origin (convert to head relative)
+                batch.PosX[i] -= ALContext->Listener.Position[0];
+                batch.PosY[i] -= ALContext->Listener.Position[1];
+                batch.PosZ[i] -= ALContext->Listener.Position[2];
+            }
+            batch.DopplerFactor[i] = ALContext->DopplerFactor *
+                                     ALSource->Props.DopplerFactor;
+        }
+        batch.LowpassCw = cos(2.0*M_PI * LOWPASSFREQCUTOFF / Device->Frequency);
+
+        CalcBatchGeometry(&batch, todo, ALContext);
+        for(i = 0;i < todo;i++)
+            CalcBatchSourceParams(sources[i], params[i], ALContext, &batch, i);
+
+        sources += todo;
+        params += todo;
+        count -= todo;
+    }
+}
 
-static __inline ALfloat aluF2F(ALfloat val)
-{ return val; }
-static __inline ALshort aluF2S(ALfloat val)
+ALvoid CalcSourceParams(ALsource *ALSource, ALsourceParams *Params, const ALCcontext *ALContext)
 {
-    if(val > 1.0f) return 32767;
-    if(val < -1.0f) return -32768;
-    return (ALint)(val*32767.0f);
+    CalcSourceParamsBatch(&ALSource, &Params, 1, ALContext);
 }
-static __inline ALushort aluF2US(ALfloat val)
-{ return aluF2S(val)+32768; }
-static __inline ALbyte aluF2B(ALfloat val)
-{ return aluF2S(val)>>8; }
-static __inline ALubyte aluF2UB(ALfloat val)
-{ return aluF2US(val)>>8; }
 
-#define DECL_TEMPLATE(T, N, func)                                             \
-static void Write_##T##_##N(ALCdevice *device, T *RESTRICT buffer,            \
-                            ALuint SamplesToDo)                               \
-{                                                                             \
-    ALfloat (*RESTRICT DryBuffer)[MAXCHANNELS] = device->DryBuffer;           \
-    const enum Channel *ChanMap = device->DevChannels;                        \
-    ALuint i, j;                                                              \
-                                                                              \
-    for(i = 0;i < SamplesToDo;i++)                                            \
-    {                                                                         \
-        for(j = 0;j < N;j++)                                                  \
-            *(buffer++) = func(DryBuffer[i][ChanMap[j]]);                     \
-    }                                                                         \
+/* Applies pending property changes to the context's active sources, removing
+ * those that stopped playing, and recalculates the mixing parameters of those
+ * that need it (or all of them, with UpdateAll). Sources with spatial
+ * parameters are gathered up to be calculated in batches. */
+ALvoid aluUpdateSources(ALCcontext *ALContext, ALboolean UpdateAll)
+{
+    ALsource *batch[SOURCE_BATCH_SIZE];
+    ALsourceParams *params[SOURCE_BATCH_SIZE];
+    ALsource **src, **src_end;
+    ALuint count = 0;
+
+    src = ALContext->ActiveSources;
+    src_end = src + ALContext->ActiveSourceCount;
+    while(src != src_end)
+    {
+        ALboolean NewProps;
+
+        if((*src)->state != AL_PLAYING)
+        {
+            --(ALContext->ActiveSourceCount);
+            *src = *(--src_end);
+            continue;
+        }
+
+        NewProps = ApplySourceProps(*src, ALContext);
+        if(ExchangeInt(&(*src)->NeedsUpdate, AL_FALSE) || NewProps || UpdateAll)
+        {
+            if((*src)->Update != CalcSourceParams)
+                ALsource_Update(*src, (*src)->Params, ALContext);
+            else
+            {
+                batch[count] = *src;
+                params[count] = (*src)->Params;
+                if(++count == SOURCE_BATCH_SIZE)
+                {
+                    CalcSourceParamsBatch(batch, params, count, ALContext);
+                    count = 0;
+                }
+            }
+        }
+        src++;
+    }
+    if(count > 0)
+        CalcSourceParamsBatch(batch, params, count, ALContext);
 }
 
-DECL_TEMPLATE(ALfloat, 1, aluF2F)
-DECL_TEMPLATE(ALfloat, 4, aluF2F)
-DECL_TEMPLATE(ALfloat, 6, aluF2F)
-DECL_TEMPLATE(ALfloat, 7, aluF2F)
-DECL_TEMPLATE(ALfloat, 8, aluF2F)
-
-DECL_TEMPLATE(ALushort, 1, aluF2US)
-DECL_TEMPLATE(ALushort, 4, aluF2US)
-DECL_TEMPLATE(ALushort, 6, aluF2US)
-DECL_TEMPLATE(ALushort, 7, aluF2US)
-DECL_TEMPLATE(ALushort, 8, aluF2US)
-
-DECL_TEMPLATE(ALshort, 1, aluF2S)
-DECL_TEMPLATE(ALshort, 4, aluF2S)
-DECL_TEMPLATE(ALshort, 6, aluF2S)
-DECL_TEMPLATE(ALshort, 7, aluF2S)
-DECL_TEMPLATE(ALshort, 8, aluF2S)
-
-DECL_TEMPLATE(ALubyte, 1, aluF2UB)
-DECL_TEMPLATE(ALubyte, 4, aluF2UB)
-DECL_TEMPLATE(ALubyte, 6, aluF2UB)
-DECL_TEMPLATE(ALubyte, 7, aluF2UB)
-DECL_TEMPLATE(ALubyte, 8, aluF2UB)
-
-DECL_TEMPLATE(ALbyte, 1, aluF2B)
-DECL_TEMPLATE(ALbyte, 4, aluF2B)
-DECL_TEMPLATE(ALbyte, 6, aluF2B)
-DECL_TEMPLATE(ALbyte, 7, aluF2B)
-DECL_TEMPLATE(ALbyte, 8, aluF2B)
+/* With DEVICE_APP_SOURCE_UPDATES, the mixer leaves source parameters alone.
+ * The app's thread calculates them instead, when it commits its changes with
+ * alcProcessContext or alProcessUpdatesSOFT, and when it starts a source. They
+ * go into a new container that's handed to the mixer to swap in at its next
+ * update, so neither thread waits on the other. These must be called with the
+ * context's PropLock held. */
+static ALvoid CommitSourceParams(ALsource *Source, ALCcontext *Context)
+{
+    ALsourceParams *params;
 
-#undef DECL_TEMPLATE
+    if((params=GetSourceCommitParams(Source, Context)) != NULL)
+    {
+        ALsource_Update(Source, params, Context);
+        UpdateSourceParams(Source, params, Context);
+    }
+    else
+    {
+        /* Without a container, wait for the mixer and update its own */
+        LockContext(Context);
+        ApplySourceParams(Source, Context);
+        ALsource_Update(Source, Source->Params, Context);
+        UnlockContext(Context);
+    }
+}
+
+ALvoid aluCommitSourceUpdate(ALsource *Source, ALCcontext *Context)
+{
+    ALCdevice *Device = Context->Device;
+
+    if(!(Device->Flags&DEVICE_APP_SOURCE_UPDATES))
+        return;
+
+    EnterCriticalSection(&Device->ParamsLock);
+    ApplySourceProps(Source, Context);
+    Source->NeedsUpdate = AL_FALSE;
+    CommitSourceParams(Source, Context);
+    LeaveCriticalSection(&Device->ParamsLock);
+}
+
+ALvoid aluCommitUpdates(ALCcontext *Context)
+{
+    ALCdevice *Device = Context->Device;
+    ALsource *batch[SOURCE_BATCH_SIZE];
+    ALsourceParams *params[SOURCE_BATCH_SIZE];
+    ALboolean UpdateAll;
+    ALuint count = 0;
+    ALsizei pos;
+    ALuint i;
+
+    if(!(Device->Flags&DEVICE_APP_SOURCE_UPDATES) || Context->DeferUpdates)
+        return;
+
+    UpdateAll = ExchangeInt(&Context->UpdateSources, AL_FALSE);
+
+    EnterCriticalSection(&Device->ParamsLock);
+    LockUIntMapRead(&Context->SourceMap);
+    for(pos = 0;pos < Context->SourceMap.size;pos++)
+    {
+        ALsource *Source = Context->SourceMap.array[pos].value;
+        ALenum state = GetSourceState(Source);
+        ALboolean NewProps;
+
+        /* Stopped sources get theirs when they start again */
+        if(state != AL_PLAYING && state != AL_PAUSED)
+            continue;
+
+        NewProps = ApplySourceProps(Source, Context);
+        if(!ExchangeInt(&Source->NeedsUpdate, AL_FALSE) && !NewProps && !UpdateAll)
+            continue;
+
+        if(Source->Update != CalcSourceParams ||
+           (params[count]=GetSourceCommitParams(Source, Context)) == NULL)
+        {
+            CommitSourceParams(Source, Context);
+            continue;
+        }
+        batch[count] = Source;
+        if(++count == SOURCE_BATCH_SIZE)
+        {
+            CalcSourceParamsBatch(batch, params, count, Context);
+            for(i = 0;i < count;i++)
+                UpdateSourceParams(batch[i], params[i], Context);
+            count = 0;
+        }
+    }
+    if(count > 0)
+    {
+        CalcSourceParamsBatch(batch, params, count, Context);
+        for(i = 0;i < count;i++)
+            UpdateSourceParams(batch[i], params[i], Context);
+    }
+    UnlockUIntMapRead(&Context->SourceMap);
+    LeaveCriticalSection(&Device->ParamsLock);
+}
+
+
+static void Convert_ALfloat(ALfloat *RESTRICT dst, const ALfloat *RESTRICT src,
+                            ALuint count)
+{ memcpy(dst, src, count*sizeof(ALfloat)); }
+
+/* Output frames are interleaved in blocks from the output buffer's channel
+ * rows into a temporary buffer, then converted to the output type in one go by
+ * the selected conversion function. */
+#define WRITE_BLOCK_SIZE 256
 
 #define DECL_TEMPLATE(T, N, func)                                             \
 static void Write_##T##_##N(ALCdevice *device, T *RESTRICT buffer,            \
                             ALuint SamplesToDo)                               \
 {                                                                             \
-    ALfloat (*RESTRICT DryBuffer)[MAXCHANNELS] = device->DryBuffer;           \
-    const enum Channel *ChanMap = device->DevChannels;                        \
-    ALuint i, j;                                                              \
+    ALfloat (*RESTRICT OutBuffer)[BUFFERSIZE] = device->OutBuffer;            \
+    ALfloat samples[WRITE_BLOCK_SIZE*N];                                      \
+    ALuint base, todo, i, j;                                                  \
                                                                               \
-    if(device->Bs2b)                                                          \
+    for(base = 0;base < SamplesToDo;base += todo)                             \
     {                                                                         \
-        for(i = 0;i < SamplesToDo;i++)                                        \
+        todo = minu(SamplesToDo-base, WRITE_BLOCK_SIZE);                      \
+        for(j = 0;j < N;j++)                                                  \
         {                                                                     \
-            float samples[2];                                                 \
-            samples[0] = DryBuffer[i][ChanMap[0]];                            \
-            samples[1] = DryBuffer[i][ChanMap[1]];                            \
-            bs2b_cross_feed(device->Bs2b, samples);                           \
-            *(buffer++) = func(samples[0]);                                   \
-            *(buffer++) = func(samples[1]);                                   \
+            const ALfloat *RESTRICT src = &OutBuffer[j][base];                \
+            for(i = 0;i < todo;i++)                                           \
+                samples[i*N + j] = src[i];                                    \
         }                                                                     \
-    }                                                                         \
-    else                                                                      \
-    {                                                                         \
-        for(i = 0;i < SamplesToDo;i++)                                        \
+        if(N == 2 && device->Bs2b)                                            \
         {                                                                     \
-            for(j = 0;j < N;j++)                                              \
-                *(buffer++) = func(DryBuffer[i][ChanMap[j]]);                 \
+            for(i = 0;i < todo;i++)                                           \
+                bs2b_cross_feed(device->Bs2b, &samples[i*N]);                 \
         }                                                                     \
+        func(buffer, samples, todo*N);                                        \
+        buffer += todo*N;                                                     \
     }                                                                         \
 }
 
-DECL_TEMPLATE(ALfloat, 2, aluF2F)
-DECL_TEMPLATE(ALushort, 2, aluF2US)
-DECL_TEMPLATE(ALshort, 2, aluF2S)
-DECL_TEMPLATE(ALubyte, 2, aluF2UB)
-DECL_TEMPLATE(ALbyte, 2, aluF2B)
+DECL_TEMPLATE(ALfloat, 1, Convert_ALfloat)
+DECL_TEMPLATE(ALfloat, 2, Convert_ALfloat)
+DECL_TEMPLATE(ALfloat, 4, Convert_ALfloat)
+DECL_TEMPLATE(ALfloat, 6, Convert_ALfloat)
+DECL_TEMPLATE(ALfloat, 7, Convert_ALfloat)
+DECL_TEMPLATE(ALfloat, 8, Convert_ALfloat)
+
+DECL_TEMPLATE(ALushort, 1, CPUMixers.ConvertUShort)
+DECL_TEMPLATE(ALushort, 2, CPUMixers.ConvertUShort)
+DECL_TEMPLATE(ALushort, 4, CPUMixers.ConvertUShort)
+DECL_TEMPLATE(ALushort, 6, CPUMixers.ConvertUShort)
+DECL_TEMPLATE(ALushort, 7, CPUMixers.ConvertUShort)
+DECL_TEMPLATE(ALushort, 8, CPUMixers.ConvertUShort)
+
+DECL_TEMPLATE(ALshort, 1, CPUMixers.ConvertShort)
+DECL_TEMPLATE(ALshort, 2, CPUMixers.ConvertShort)
+DECL_TEMPLATE(ALshort, 4, CPUMixers.ConvertShort)
+DECL_TEMPLATE(ALshort, 6, CPUMixers.ConvertShort)
+DECL_TEMPLATE(ALshort, 7, CPUMixers.ConvertShort)
+DECL_TEMPLATE(ALshort, 8, CPUMixers.ConvertShort)
+
+DECL_TEMPLATE(ALubyte, 1, CPUMixers.ConvertUByte)
+DECL_TEMPLATE(ALubyte, 2, CPUMixers.ConvertUByte)
+DECL_TEMPLATE(ALubyte, 4, CPUMixers.ConvertUByte)
+DECL_TEMPLATE(ALubyte, 6, CPUMixers.ConvertUByte)
+DECL_TEMPLATE(ALubyte, 7, CPUMixers.ConvertUByte)
+DECL_TEMPLATE(ALubyte, 8, CPUMixers.ConvertUByte)
+
+DECL_TEMPLATE(ALbyte, 1, CPUMixers.ConvertByte)
+DECL_TEMPLATE(ALbyte, 2, CPUMixers.ConvertByte)
+DECL_TEMPLATE(ALbyte, 4, CPUMixers.ConvertByte)
+DECL_TEMPLATE(ALbyte, 6, CPUMixers.ConvertByte)
+DECL_TEMPLATE(ALbyte, 7, CPUMixers.ConvertByte)
+DECL_TEMPLATE(ALbyte, 8, CPUMixers.ConvertByte)
 
 #undef DECL_TEMPLATE
 
@@ -922,42 +1233,73 @@ DECL_TEMPLATE(ALbyte)
 
 #undef DECL_TEMPLATE
 
+static void WriteSilence(ALCdevice *device, ALvoid *buffer, ALuint SamplesToDo)
+{
+    ALuint count = SamplesToDo * ChannelsFromDevFmt(device->FmtChans);
+    ALuint i;
+
+    switch(device->FmtType)
+    {
+        case DevFmtUByte:
+            memset(buffer, 0x80, count);
+            break;
+        case DevFmtUShort:
+            for(i = 0;i < count;i++)
+                ((ALushort*)buffer)[i] = 0x8000;
+            break;
+        case DevFmtByte:
+        case DevFmtShort:
+        case DevFmtFloat:
+            memset(buffer, 0, count*BytesFromDevFmt(device->FmtType));
+            break;
+    }
+}
+
 ALvoid aluMixData(ALCdevice *device, ALvoid *buffer, ALsizei size)
 {
     ALuint SamplesToDo;
     ALeffectslot **slot, **slot_end;
     ALsource **src, **src_end;
+    MixBuffers DryMix;
     ALCcontext *ctx;
-    int fpuState;
     ALuint i, c;
 
-#if defined(HAVE_FESETROUND)
-    fpuState = fegetround();
-    fesetround(FE_TOWARDZERO);
-#elif defined(HAVE__CONTROLFP)
-    fpuState = _controlfp(0, 0);
-    (void)_controlfp(_RC_CHOP, _MCW_RC);
-#else
-    (void)fpuState;
-#endif
-
     while(size > 0)
     {
         /* Setup variables */
         SamplesToDo = minu(size, BUFFERSIZE);
 
-        /* Clear mixing buffer */
-        memset(device->DryBuffer, 0, SamplesToDo*MAXCHANNELS*sizeof(ALfloat));
-
         LockDevice(device);
+        if(!device->OutBuffer)
+        {
+            /* Nothing to mix into until the device has been set up */
+            UnlockDevice(device);
+            if(buffer)
+                WriteSilence(device, buffer, size);
+            break;
+        }
+
+        /* Clear mixing buffers */
+        for(c = 0;c < device->NumDryChannels;c++)
+            memset(device->DryBuffer[c], 0, SamplesToDo*sizeof(ALfloat));
+        if(device->OutBuffer != device->DryBuffer)
+        {
+            for(c = 0;c < ChannelsFromDevFmt(device->FmtChans);c++)
+                memset(device->OutBuffer[c], 0, SamplesToDo*sizeof(ALfloat));
+        }
+
+        DryMix.DryBuffer = device->DryBuffer;
+        DryMix.ClickRemoval = device->ClickRemoval;
+        DryMix.PendingClicks = device->PendingClicks;
+
         ctx = device->ContextList;
         while(ctx)
         {
             ALenum DeferUpdates = ctx->DeferUpdates;
-            ALenum UpdateSources = AL_FALSE;
 
-            if(!DeferUpdates)
-                UpdateSources = ExchangeInt(&ctx->UpdateSources, AL_FALSE);
+            ApplySourceCmds(ctx);
+            if(!DeferUpdates && !(device->Flags&DEVICE_APP_SOURCE_UPDATES))
+                aluUpdateSources(ctx, ExchangeInt(&ctx->UpdateSources, AL_FALSE));
 
             src = ctx->ActiveSources;
             src_end = src + ctx->ActiveSourceCount;
@@ -969,24 +1311,31 @@ ALvoid aluMixData(ALCdevice *device, ALvoid *buffer, ALsizei size)
                     *src = *(--src_end);
                     continue;
                 }
+                if((device->Flags&DEVICE_APP_SOURCE_UPDATES))
+                    ApplySourceParams(*src, ctx);
 
-                if(!DeferUpdates && (ExchangeInt(&(*src)->NeedsUpdate, AL_FALSE) ||
-                                     UpdateSources))
-                    ALsource_Update(*src, ctx);
-
-                MixSource(*src, device, SamplesToDo);
+                if(!device->MixThreads)
+                    MixSource(*src, device, &DryMix, SamplesToDo);
                 src++;
             }
+            if(device->MixThreads)
+                aluMixThreadSources(device, ctx, SamplesToDo);
 
             /* effect slot processing */
             slot = ctx->ActiveEffectSlots;
             slot_end = slot + ctx->ActiveEffectSlotCount;
             while(slot != slot_end)
             {
-                for(i = 0;i < SamplesToDo;i++)
+                if((*slot)->ClickRemoval[0] != 0.0f)
                 {
-                    (*slot)->WetBuffer[i] += (*slot)->ClickRemoval[0];
-                    (*slot)->ClickRemoval[0] -= (*slot)->ClickRemoval[0] / 256.0f;
+                    for(i = 0;i < SamplesToDo;i++)
+                    {
+                        (*slot)->WetBuffer[i] += (*slot)->ClickRemoval[0];
+                        (*slot)->ClickRemoval[0] -= (*slot)->ClickRemoval[0] / 256.0f;
+                    }
+                    if(aluFabs((*slot)->ClickRemoval[0]) < GAIN_SILENCE_THRESHOLD)
+                        (*slot)->ClickRemoval[0] = 0.0f;
+                    (*slot)->WetMixed = AL_TRUE;
                 }
                 for(i = 0;i < 1;i++)
                 {
@@ -997,63 +1346,43 @@ ALvoid aluMixData(ALCdevice *device, ALvoid *buffer, ALsizei size)
                 if(!DeferUpdates && ExchangeInt(&(*slot)->NeedsUpdate, AL_FALSE))
                     ALEffect_Update((*slot)->EffectState, ctx, *slot);
 
-                ALEffect_Process((*slot)->EffectState, *slot, SamplesToDo,
-                                 (*slot)->WetBuffer, device->DryBuffer);
+                /* Nothing was mixed in and the effect has no audible tail left,
+                 * so the slot can sleep until a source sends to it again. */
+                if((*slot)->WetMixed || !ALEffect_IsSilent((*slot)->EffectState))
+                    ALEffect_Process((*slot)->EffectState, *slot, SamplesToDo,
+                                     (*slot)->WetBuffer, device->OutBuffer,
+                                     ChannelsFromDevFmt(device->FmtChans));
 
-                for(i = 0;i < SamplesToDo;i++)
-                    (*slot)->WetBuffer[i] = 0.0f;
+                if((*slot)->WetMixed)
+                {
+                    memset((*slot)->WetBuffer, 0, SamplesToDo*sizeof(ALfloat));
+                    (*slot)->WetMixed = AL_FALSE;
+                }
 
                 slot++;
             }
 
             ctx = ctx->next;
         }
-        UnlockDevice(device);
 
         //Post processing loop
-        if(device->FmtChans == DevFmtMono)
-        {
-            for(i = 0;i < SamplesToDo;i++)
-            {
-                device->DryBuffer[i][FRONT_CENTER] += device->ClickRemoval[FRONT_CENTER];
-                device->ClickRemoval[FRONT_CENTER] -= device->ClickRemoval[FRONT_CENTER] / 256.0f;
-            }
-            device->ClickRemoval[FRONT_CENTER] += device->PendingClicks[FRONT_CENTER];
-            device->PendingClicks[FRONT_CENTER] = 0.0f;
-        }
-        else if(device->FmtChans == DevFmtStereo)
-        {
-            /* Assumes the first two channels are FRONT_LEFT and FRONT_RIGHT */
-            for(i = 0;i < SamplesToDo;i++)
-            {
-                for(c = 0;c < 2;c++)
-                {
-                    device->DryBuffer[i][c] += device->ClickRemoval[c];
-                    device->ClickRemoval[c] -= device->ClickRemoval[c] / 256.0f;
-                }
-            }
-            for(c = 0;c < 2;c++)
-            {
-                device->ClickRemoval[c] += device->PendingClicks[c];
-                device->PendingClicks[c] = 0.0f;
-            }
-        }
-        else
+        for(c = 0;c < device->NumDryChannels;c++)
         {
+            ALfloat *RESTRICT DryBuffer = device->DryBuffer[c];
+            ALfloat offset = device->ClickRemoval[c];
+
             for(i = 0;i < SamplesToDo;i++)
             {
-                for(c = 0;c < MAXCHANNELS;c++)
-                {
-                    device->DryBuffer[i][c] += device->ClickRemoval[c];
-                    device->ClickRemoval[c] -= device->ClickRemoval[c] / 256.0f;
-                }
-            }
-            for(c = 0;c < MAXCHANNELS;c++)
-            {
-                device->ClickRemoval[c] += device->PendingClicks[c];
-                device->PendingClicks[c] = 0.0f;
+                DryBuffer[i] += offset;
+                offset -= offset / 256.0f;
             }
+            device->ClickRemoval[c] = offset + device->PendingClicks[c];
+            device->PendingClicks[c] = 0.0f;
         }
+        if(device->AmbiOrder)
+            aluAmbiDecode(device, SamplesToDo);
+        if((device->Flags&DEVICE_USE_LIMITER))
+            aluApplyLimiter(device, SamplesToDo);
 
         if(buffer)
         {
@@ -1076,15 +1405,12 @@ ALvoid aluMixData(ALCdevice *device, ALvoid *buffer, ALsizei size)
                     break;
             }
         }
+        /* The mixing buffers may be reallocated when the device is reset, so
+         * the device stays locked until its output is written. */
+        UnlockDevice(device);
 
         size -= SamplesToDo;
     }
-
-#if defined(HAVE_FESETROUND)
-    fesetround(fpuState);
-#elif defined(HAVE__CONTROLFP)
-    _controlfp(fpuState, _MCW_RC);
-#endif
 }
 
 
@@ -1099,6 +1425,7 @@ ALvoid aluHandleDisconnect(ALCdevice *device)
         ALsource *source;
         ALsizei pos;
 
+        ApplySourceCmds(Context);
         LockUIntMapRead(&Context->SourceMap);
         for(pos = 0;pos < Context->SourceMap.size;pos++)
         {
@@ -33,6 +33,7 @@ typedef struct ALdedicatedState {
     // Must be first in all effects!
     ALeffectState state;
 
+    // Gain for each output channel
     ALfloat gains[MAXCHANNELS];
 } ALdedicatedState;
 
@@ -54,6 +55,7 @@ static ALvoid DedicatedUpdate(ALeffectState *effect, ALCcontext *Context, const
 {
     ALdedicatedState *state = (ALdedicatedState*)effect;
     ALCdevice *device = Context->Device;
+    ALfloat chanGains[MAXCHANNELS];
     const ALfloat *SpeakerGain;
     ALfloat Gain;
     ALint pos;
@@ -61,7 +63,7 @@ static ALvoid DedicatedUpdate(ALeffectState *effect, ALCcontext *Context, const
 
     Gain = Slot->Gain * Slot->effect.Params.Dedicated.Gain;
     for(s = 0;s < MAXCHANNELS;s++)
-        state->gains[s] = 0.0f;
+        chanGains[s] = 0.0f;
 
     if(Slot->effect.type == AL_EFFECT_DEDICATED_DIALOGUE)
     {
@@ -69,29 +71,39 @@ static ALvoid DedicatedUpdate(ALeffectState *effect, ALCcontext *Context, const
         SpeakerGain = device->PanningLUT[pos];
 
         for(s = 0;s < MAXCHANNELS;s++)
-            state->gains[s] = SpeakerGain[s] * Gain;
+            chanGains[s] = SpeakerGain[s] * Gain;
     }
     else if(Slot->effect.type == AL_EFFECT_DEDICATED_LOW_FREQUENCY_EFFECT)
-        state->gains[LFE] = Gain;
+        chanGains[LFE] = Gain;
+
+    for(s = 0;s < MAXCHANNELS;s++)
+        state->gains[s] = 0.0f;
+    for(s = 0;s < (ALsizei)ChannelsFromDevFmt(device->FmtChans);s++)
+        state->gains[s] = chanGains[device->DevChannels[s]];
 }
 
-static ALvoid DedicatedProcess(ALeffectState *effect, const ALeffectslot *Slot, ALuint SamplesToDo, const ALfloat *SamplesIn, ALfloat (*SamplesOut)[MAXCHANNELS])
+static ALvoid DedicatedProcess(ALeffectState *effect, const ALeffectslot *Slot, ALuint SamplesToDo, const ALfloat *SamplesIn, ALfloat (*SamplesOut)[BUFFERSIZE], ALuint NumChannels)
 {
     ALdedicatedState *state = (ALdedicatedState*)effect;
     const ALfloat *gains = state->gains;
     ALuint i, s;
     (void)Slot;
 
-    for(i = 0;i < SamplesToDo;i++)
+    for(s = 0;s < NumChannels;s++)
     {
-        ALfloat sample;
+        const ALfloat gain = gains[s];
 
-        sample = SamplesIn[i];
-        for(s = 0;s < MAXCHANNELS;s++)
-            SamplesOut[i][s] = sample * gains[s];
+        for(i = 0;i < SamplesToDo;i++)
+            SamplesOut[s][i] += SamplesIn[i] * gain;
     }
 }
 
+static ALboolean DedicatedIsSilent(ALeffectState *effect)
+{
+    return AL_TRUE;
+    (void)effect;
+}
+
 ALeffectState *DedicatedCreate(void)
 {
     ALdedicatedState *state;
@@ -105,6 +117,7 @@ ALeffectState *DedicatedCreate(void)
     state->state.DeviceUpdate = DedicatedDeviceUpdate;
     state->state.Update = DedicatedUpdate;
     state->state.Process = DedicatedProcess;
+    state->state.IsSilent = DedicatedIsSilent;
 
     for(s = 0;s < MAXCHANNELS;s++)
         state->gains[s] = 0.0f;
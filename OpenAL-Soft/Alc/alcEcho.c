@@ -49,10 +49,18 @@ typedef struct ALechoState {
 
     ALfloat FeedGain;
 
+    // Gain for each output channel, and which side's signal (0 for left, 1
+    // for right, -1 for none) it gets
     ALfloat Gain[MAXCHANNELS];
+    ALint   Side[MAXCHANNELS];
 
     FILTER iirFilter;
     ALfloat history[2];
+
+    // How many samples of silent input have been processed, and whether the
+    // feedback has since decayed to silence
+    ALuint QuietSamples;
+    ALboolean Silent;
 } ALechoState;
 
 static ALvoid EchoDestroy(ALeffectState *effect)
@@ -89,6 +97,8 @@ static ALboolean EchoDeviceUpdate(ALeffectState *effect, ALCdevice *Device)
     }
     for(i = 0;i < state->BufferLength;i++)
         state->SampleBuffer[i] = 0.0f;
+    state->QuietSamples = state->BufferLength;
+    state->Silent = AL_TRUE;
 
     return AL_TRUE;
 }
@@ -98,6 +108,7 @@ static ALvoid EchoUpdate(ALeffectState *effect, ALCcontext *Context, const ALeff
     ALechoState *state = (ALechoState*)effect;
     ALCdevice *Device = Context->Device;
     ALuint frequency = Device->Frequency;
+    ALfloat chanGain[MAXCHANNELS];
     ALfloat lrpan, cw, g, gain;
     ALuint i;
 
@@ -117,51 +128,108 @@ static ALvoid EchoUpdate(ALeffectState *effect, ALCcontext *Context, const ALeff
 
     gain = Slot->Gain;
     for(i = 0;i < MAXCHANNELS;i++)
-        state->Gain[i] = 0.0f;
+        chanGain[i] = 0.0f;
     for(i = 0;i < Device->NumChan;i++)
     {
         enum Channel chan = Device->Speaker2Chan[i];
-        state->Gain[chan] = gain;
+        chanGain[chan] = gain;
+    }
+
+    for(i = 0;i < MAXCHANNELS;i++)
+    {
+        state->Gain[i] = 0.0f;
+        state->Side[i] = -1;
+    }
+    for(i = 0;i < ChannelsFromDevFmt(Device->FmtChans);i++)
+    {
+        enum Channel chan = Device->DevChannels[i];
+        switch(chan)
+        {
+            case FRONT_LEFT: case SIDE_LEFT: case BACK_LEFT:
+                state->Side[i] = 0;
+                break;
+            case FRONT_RIGHT: case SIDE_RIGHT: case BACK_RIGHT:
+                state->Side[i] = 1;
+                break;
+            default:
+                continue;
+        }
+        state->Gain[i] = chanGain[chan];
     }
 }
 
-static ALvoid EchoProcess(ALeffectState *effect, const ALeffectslot *Slot, ALuint SamplesToDo, const ALfloat *SamplesIn, ALfloat (*SamplesOut)[MAXCHANNELS])
+static ALvoid EchoProcess(ALeffectState *effect, const ALeffectslot *Slot, ALuint SamplesToDo, const ALfloat *SamplesIn, ALfloat (*SamplesOut)[BUFFERSIZE], ALuint NumChannels)
 {
     ALechoState *state = (ALechoState*)effect;
     const ALuint mask = state->BufferLength-1;
     const ALuint tap1 = state->Tap[0].delay;
     const ALuint tap2 = state->Tap[1].delay;
     ALuint offset = state->Offset;
-    ALfloat samp[2], smp;
-    ALuint i;
+    ALfloat samp[64][2], smp;
+    ALuint base, todo, i, c;
     (void)Slot;
 
-    for(i = 0;i < SamplesToDo;i++,offset++)
+    if(!IsSilentBuffer(SamplesIn, SamplesToDo))
+        state->QuietSamples = 0;
+    else if(state->QuietSamples < state->BufferLength)
+        state->QuietSamples += SamplesToDo;
+    state->Silent = AL_FALSE;
+
+    for(base = 0;base < SamplesToDo;base += todo)
     {
-        // Sample first tap
-        smp = state->SampleBuffer[(offset-tap1) & mask];
-        samp[0] = smp * state->GainL;
-        samp[1] = smp * state->GainR;
-        // Sample second tap. Reverse LR panning
-        smp = state->SampleBuffer[(offset-tap2) & mask];
-        samp[0] += smp * state->GainR;
-        samp[1] += smp * state->GainL;
-
-        // Apply damping and feedback gain to the second tap, and mix in the
-        // new sample
-        smp = lpFilter2P(&state->iirFilter, 0, smp+SamplesIn[i]);
-        state->SampleBuffer[offset&mask] = smp * state->FeedGain;
-
-        SamplesOut[i][FRONT_LEFT]  += state->Gain[FRONT_LEFT]  * samp[0];
-        SamplesOut[i][FRONT_RIGHT] += state->Gain[FRONT_RIGHT] * samp[1];
-        SamplesOut[i][SIDE_LEFT]   += state->Gain[SIDE_LEFT]   * samp[0];
-        SamplesOut[i][SIDE_RIGHT]  += state->Gain[SIDE_RIGHT]  * samp[1];
-        SamplesOut[i][BACK_LEFT]   += state->Gain[BACK_LEFT]   * samp[0];
-        SamplesOut[i][BACK_RIGHT]  += state->Gain[BACK_RIGHT]  * samp[1];
+        todo = minu(SamplesToDo-base, 64);
+
+        for(i = 0;i < todo;i++,offset++)
+        {
+            // Sample first tap
+            smp = state->SampleBuffer[(offset-tap1) & mask];
+            samp[i][0] = smp * state->GainL;
+            samp[i][1] = smp * state->GainR;
+            // Sample second tap. Reverse LR panning
+            smp = state->SampleBuffer[(offset-tap2) & mask];
+            samp[i][0] += smp * state->GainR;
+            samp[i][1] += smp * state->GainL;
+
+            // Apply damping and feedback gain to the second tap, and mix in
+            // the new sample
+            smp = lpFilter2P(&state->iirFilter, 0, smp+SamplesIn[base+i]);
+            state->SampleBuffer[offset&mask] = smp * state->FeedGain;
+        }
+
+        for(c = 0;c < NumChannels;c++)
+        {
+            const ALint side = state->Side[c];
+            const ALfloat gain = state->Gain[c];
+
+            if(side < 0)
+                continue;
+            for(i = 0;i < todo;i++)
+                SamplesOut[c][base+i] += gain * samp[i][side];
+        }
     }
     state->Offset = offset;
 }
 
+static ALboolean EchoIsSilent(ALeffectState *effect)
+{
+    ALechoState *state = (ALechoState*)effect;
+
+    if(!state->Silent)
+    {
+        // Once a full buffer's worth of silent input has gone through, only
+        // the feedback remains. Check whether it's still audible.
+        if(state->QuietSamples < state->BufferLength)
+            return AL_FALSE;
+        if(!IsSilentBuffer(state->SampleBuffer, state->BufferLength))
+        {
+            state->QuietSamples = 0;
+            return AL_FALSE;
+        }
+        state->Silent = AL_TRUE;
+    }
+    return AL_TRUE;
+}
+
 ALeffectState *EchoCreate(void)
 {
     ALechoState *state;
@@ -174,9 +242,12 @@ ALeffectState *EchoCreate(void)
     state->state.DeviceUpdate = EchoDeviceUpdate;
     state->state.Update = EchoUpdate;
     state->state.Process = EchoProcess;
+    state->state.IsSilent = EchoIsSilent;
 
     state->BufferLength = 0;
     state->SampleBuffer = NULL;
+    state->QuietSamples = 0;
+    state->Silent = AL_TRUE;
 
     state->Tap[0].delay = 0;
     state->Tap[1].delay = 0;
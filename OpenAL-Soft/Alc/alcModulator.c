@@ -43,7 +43,10 @@ typedef struct ALmodulatorState {
     ALuint index;
     ALuint step;
 
+    // Gain for each output channel, and whether it gets the signal at all
+    // (the LFE doesn't)
     ALfloat Gain[MAXCHANNELS];
+    ALboolean Mix[MAXCHANNELS];
 
     FILTER iirFilter;
     ALfloat history[1];
@@ -83,31 +86,38 @@ static __inline ALfloat hpFilter1P(FILTER *iir, ALuint offset, ALfloat input)
 
 #define DECL_TEMPLATE(func)                                                   \
 static void Process##func(ALmodulatorState *state, ALuint SamplesToDo,        \
-  const ALfloat *SamplesIn, ALfloat (*SamplesOut)[MAXCHANNELS])               \
+  const ALfloat *SamplesIn, ALfloat (*SamplesOut)[BUFFERSIZE],                \
+  ALuint NumChannels)                                                         \
 {                                                                             \
     const ALuint step = state->step;                                          \
     ALuint index = state->index;                                              \
-    ALfloat samp;                                                             \
-    ALuint i;                                                                 \
+    ALfloat samp[64];                                                         \
+    ALuint base, todo, i, c;                                                  \
                                                                               \
-    for(i = 0;i < SamplesToDo;i++)                                            \
+    for(base = 0;base < SamplesToDo;base += todo)                             \
     {                                                                         \
-        samp = SamplesIn[i];                                                  \
+        todo = minu(SamplesToDo-base, 64);                                    \
                                                                               \
-        index += step;                                                        \
-        index &= WAVEFORM_FRACMASK;                                           \
-        samp *= func(index);                                                  \
+        for(i = 0;i < todo;i++)                                               \
+        {                                                                     \
+            samp[i] = SamplesIn[base+i];                                      \
                                                                               \
-        samp = hpFilter1P(&state->iirFilter, 0, samp);                        \
+            index += step;                                                    \
+            index &= WAVEFORM_FRACMASK;                                       \
+            samp[i] *= func(index);                                           \
                                                                               \
-        SamplesOut[i][FRONT_LEFT]   += state->Gain[FRONT_LEFT]   * samp;      \
-        SamplesOut[i][FRONT_RIGHT]  += state->Gain[FRONT_RIGHT]  * samp;      \
-        SamplesOut[i][FRONT_CENTER] += state->Gain[FRONT_CENTER] * samp;      \
-        SamplesOut[i][SIDE_LEFT]    += state->Gain[SIDE_LEFT]    * samp;      \
-        SamplesOut[i][SIDE_RIGHT]   += state->Gain[SIDE_RIGHT]   * samp;      \
-        SamplesOut[i][BACK_LEFT]    += state->Gain[BACK_LEFT]    * samp;      \
-        SamplesOut[i][BACK_RIGHT]   += state->Gain[BACK_RIGHT]   * samp;      \
-        SamplesOut[i][BACK_CENTER]  += state->Gain[BACK_CENTER]  * samp;      \
+            samp[i] = hpFilter1P(&state->iirFilter, 0, samp[i]);              \
+        }                                                                     \
+                                                                              \
+        for(c = 0;c < NumChannels;c++)                                        \
+        {                                                                     \
+            const ALfloat gain = state->Gain[c];                              \
+                                                                              \
+            if(!state->Mix[c])                                                \
+                continue;                                                     \
+            for(i = 0;i < todo;i++)                                           \
+                SamplesOut[c][base+i] += gain * samp[i];                      \
+        }                                                                     \
     }                                                                         \
     state->index = index;                                                     \
 }
@@ -136,6 +146,7 @@ static ALvoid ModulatorUpdate(ALeffectState *effect, ALCcontext *Context, const
 {
     ALmodulatorState *state = (ALmodulatorState*)effect;
     ALCdevice *Device = Context->Device;
+    ALfloat chanGain[MAXCHANNELS];
     ALfloat gain, cw, a = 0.0f;
     ALuint index;
 
@@ -158,15 +169,27 @@ static ALvoid ModulatorUpdate(ALeffectState *effect, ALCcontext *Context, const
 
     gain = Slot->Gain;
     for(index = 0;index < MAXCHANNELS;index++)
-        state->Gain[index] = 0.0f;
+        chanGain[index] = 0.0f;
     for(index = 0;index < Device->NumChan;index++)
     {
         enum Channel chan = Device->Speaker2Chan[index];
-        state->Gain[chan] = gain;
+        chanGain[chan] = gain;
+    }
+
+    for(index = 0;index < MAXCHANNELS;index++)
+    {
+        state->Gain[index] = 0.0f;
+        state->Mix[index] = AL_FALSE;
+    }
+    for(index = 0;index < ChannelsFromDevFmt(Device->FmtChans);index++)
+    {
+        enum Channel chan = Device->DevChannels[index];
+        state->Gain[index] = chanGain[chan];
+        state->Mix[index] = (chan != LFE);
     }
 }
 
-static ALvoid ModulatorProcess(ALeffectState *effect, const ALeffectslot *Slot, ALuint SamplesToDo, const ALfloat *SamplesIn, ALfloat (*SamplesOut)[MAXCHANNELS])
+static ALvoid ModulatorProcess(ALeffectState *effect, const ALeffectslot *Slot, ALuint SamplesToDo, const ALfloat *SamplesIn, ALfloat (*SamplesOut)[BUFFERSIZE], ALuint NumChannels)
 {
     ALmodulatorState *state = (ALmodulatorState*)effect;
     (void)Slot;
@@ -174,19 +197,26 @@ static ALvoid ModulatorProcess(ALeffectState *effect, const ALeffectslot *Slot,
     switch(state->Waveform)
     {
         case SINUSOID:
-            ProcessSin(state, SamplesToDo, SamplesIn, SamplesOut);
+            ProcessSin(state, SamplesToDo, SamplesIn, SamplesOut, NumChannels);
             break;
 
         case SAWTOOTH:
-            ProcessSaw(state, SamplesToDo, SamplesIn, SamplesOut);
+            ProcessSaw(state, SamplesToDo, SamplesIn, SamplesOut, NumChannels);
             break;
 
         case SQUARE:
-            ProcessSquare(state, SamplesToDo, SamplesIn, SamplesOut);
+            ProcessSquare(state, SamplesToDo, SamplesIn, SamplesOut, NumChannels);
             break;
     }
 }
 
+static ALboolean ModulatorIsSilent(ALeffectState *effect)
+{
+    // The ring modulator has no tail of its own
+    return AL_TRUE;
+    (void)effect;
+}
+
 ALeffectState *ModulatorCreate(void)
 {
     ALmodulatorState *state;
@@ -199,6 +229,7 @@ ALeffectState *ModulatorCreate(void)
     state->state.DeviceUpdate = ModulatorDeviceUpdate;
     state->state.Update = ModulatorUpdate;
     state->state.Process = ModulatorProcess;
+    state->state.IsSilent = ModulatorIsSilent;
 
     state->index = 0.0f;
     state->step = 1.0f;
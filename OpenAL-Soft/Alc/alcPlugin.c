@@ -0,0 +1,190 @@
+/**
+ * OpenAL cross platform audio library
+ * Copyright (C) 2012 by authors.
+ * This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Library General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ *  License along with this library; if not, write to the
+ *  Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ *  Boston, MA  02111-1307, USA.
+ * Or go to http://www.gnu.org/copyleft/lgpl.html
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+
+#include "alMain.h"
+#include "alAuxEffectSlot.h"
+#include "alError.h"
+#include "alu.h"
+
+
+#if BUFFERSIZE > ALSOFT_EFFECT_MAX_SAMPLES
+#error "Effect plugins can't process a full mixing buffer"
+#endif
+
+/* Wraps an effect from a plugin module. The plugin only sees its own state
+ * and property block, and processes to one or two private output buffers,
+ * which get mixed to the device channels here. */
+typedef struct ALpluginState {
+    // Must be first in all effects!
+    ALeffectState state;
+
+    const ALeffectPluginSOFT *Plugin;
+    ALvoid *Handle;
+
+    ALuint Frequency;
+
+    // Gain of each plugin output on each output channel
+    ALfloat Gain[2][MAXCHANNELS];
+
+    ALfloat Buffer[2][BUFFERSIZE];
+} ALpluginState;
+
+static ALvoid PluginDestroy(ALeffectState *effect)
+{
+    ALpluginState *state = (ALpluginState*)effect;
+    if(state)
+    {
+        if(state->Handle)
+            state->Plugin->Destroy(state->Handle);
+        state->Handle = NULL;
+        free(state);
+    }
+}
+
+static ALboolean PluginDeviceUpdate(ALeffectState *effect, ALCdevice *Device)
+{
+    ALpluginState *state = (ALpluginState*)effect;
+
+    state->Frequency = Device->Frequency;
+    return state->Plugin->DeviceUpdate(state->Handle, state->Frequency);
+}
+
+static ALvoid PluginUpdate(ALeffectState *effect, ALCcontext *Context, const ALeffectslot *Slot)
+{
+    ALpluginState *state = (ALpluginState*)effect;
+    ALCdevice *Device = Context->Device;
+    ALfloat chanGain[MAXCHANNELS];
+    const ALfloat *SpeakerGain;
+    ALfloat gain;
+    ALuint i, o;
+    ALint pos;
+
+    state->Plugin->Update(state->Handle, Slot->effect.Params.Plugin,
+                          state->Frequency);
+
+    /* A single output goes to every speaker. With two, they're panned hard
+     * left and right, so layouts without a left/right pair still get both. */
+    gain = Slot->Gain;
+    for(o = 0;o < 2;o++)
+    {
+        for(i = 0;i < MAXCHANNELS;i++)
+            chanGain[i] = 0.0f;
+
+        if(state->Plugin->NumOutputs == 1)
+        {
+            if(o == 0)
+            {
+                for(i = 0;i < Device->NumChan;i++)
+                    chanGain[Device->Speaker2Chan[i]] = gain;
+            }
+        }
+        else
+        {
+            pos = aluCart2LUTpos(0.0f, (o == 0) ? -1.0f : 1.0f);
+            SpeakerGain = Device->PanningLUT[pos];
+            for(i = 0;i < Device->NumChan;i++)
+            {
+                enum Channel chan = Device->Speaker2Chan[i];
+                chanGain[chan] = SpeakerGain[chan] * gain;
+            }
+        }
+
+        for(i = 0;i < MAXCHANNELS;i++)
+            state->Gain[o][i] = 0.0f;
+        for(i = 0;i < ChannelsFromDevFmt(Device->FmtChans);i++)
+            state->Gain[o][i] = chanGain[Device->DevChannels[i]];
+    }
+}
+
+static ALvoid PluginProcess(ALeffectState *effect, const ALeffectslot *Slot, ALuint SamplesToDo, const ALfloat *SamplesIn, ALfloat (*SamplesOut)[BUFFERSIZE], ALuint NumChannels)
+{
+    ALpluginState *state = (ALpluginState*)effect;
+    ALfloat *outputs[2];
+    ALuint i, c;
+    (void)Slot;
+
+    outputs[0] = state->Buffer[0];
+    outputs[1] = state->Buffer[1];
+    state->Plugin->Process(state->Handle, SamplesToDo, SamplesIn, outputs);
+
+    for(c = 0;c < NumChannels;c++)
+    {
+        const ALfloat gain0 = state->Gain[0][c];
+        const ALfloat gain1 = state->Gain[1][c];
+
+        if(gain0 != 0.0f)
+        {
+            for(i = 0;i < SamplesToDo;i++)
+                SamplesOut[c][i] += gain0 * state->Buffer[0][i];
+        }
+        if(gain1 != 0.0f)
+        {
+            for(i = 0;i < SamplesToDo;i++)
+                SamplesOut[c][i] += gain1 * state->Buffer[1][i];
+        }
+    }
+}
+
+static ALboolean PluginIsSilent(ALeffectState *effect)
+{
+    ALpluginState *state = (ALpluginState*)effect;
+
+    // Plugins that can't tell are always processed
+    if(!state->Plugin->IsSilent)
+        return AL_FALSE;
+    return state->Plugin->IsSilent(state->Handle);
+}
+
+ALeffectState *PluginCreate(const ALeffectPluginSOFT *plugin)
+{
+    ALpluginState *state;
+    ALuint i;
+
+    state = malloc(sizeof(*state));
+    if(!state)
+        return NULL;
+
+    state->state.Destroy = PluginDestroy;
+    state->state.DeviceUpdate = PluginDeviceUpdate;
+    state->state.Update = PluginUpdate;
+    state->state.Process = PluginProcess;
+    state->state.IsSilent = PluginIsSilent;
+
+    state->Plugin = plugin;
+    state->Handle = plugin->Create();
+    if(!state->Handle)
+    {
+        free(state);
+        return NULL;
+    }
+
+    state->Frequency = 0;
+    for(i = 0;i < MAXCHANNELS;i++)
+    {
+        state->Gain[0][i] = 0.0f;
+        state->Gain[1][i] = 0.0f;
+    }
+
+    return &state->state;
+}
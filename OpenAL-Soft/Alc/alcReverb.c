@@ -22,6 +22,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 
 #include "AL/al.h"
@@ -32,6 +33,10 @@
 #include "alError.h"
 #include "alu.h"
 
+// The most samples processed at once.  Each stage of the reverb runs over a
+// whole block before the next one starts.
+#define REVERB_BLOCK_SIZE 64
+
 typedef struct DelayLine
 {
     // The delay lines use sample lengths that are powers of 2 to allow the
@@ -76,7 +81,7 @@ typedef struct ALverbState {
         DelayLine Delay[4];
         ALuint    Offset[4];
         // The gain for each output channel based on 3D panning (only for the
-        // EAX path).
+        // EAX path), in device channel order.
         ALfloat   PanGain[MAXCHANNELS];
     } Early;
     // Decorrelator delay line.
@@ -106,7 +111,7 @@ typedef struct ALverbState {
         ALfloat   LpCoeff[4];
         ALfloat   LpSample[4];
         // The gain for each output channel based on 3D panning (only for the
-        // EAX path).
+        // EAX path), in device channel order.
         ALfloat   PanGain[MAXCHANNELS];
     } Late;
     struct {
@@ -129,6 +134,18 @@ typedef struct ALverbState {
     } Echo;
     // The current read offset for all delay lines.
     ALuint Offset;
+    // The number of samples to process at once.  A block can't be longer
+    // than the shortest feed-back delay, so each one only reads what earlier
+    // blocks wrote to the feed-back lines.
+    ALuint BlockSize;
+
+    // How many samples of silent input have been processed, and whether the
+    // reverb has since decayed to silence.
+    ALuint QuietSamples;
+    ALboolean Silent;
+
+    // Which of the 4 reverb outputs each output channel gets (-1 for none).
+    ALint OutIndex[MAXCHANNELS];
 
     // The gain for each output channel (non-EAX path only; aliased from
     // Late.PanGain)
@@ -200,173 +217,213 @@ static __inline ALfloat DelayLineOut(DelayLine *Delay, ALuint offset)
     return Delay->Line[offset&Delay->Mask];
 }
 
-static __inline ALvoid DelayLineIn(DelayLine *Delay, ALuint offset, ALfloat in)
+// Reads a run of samples from a delay line, starting at the given offset.
+// The run is split where it wraps around the end of the line, leaving plain
+// copies.
+static __inline ALvoid DelayLineOutSpan(DelayLine *Delay, ALuint offset, ALfloat *RESTRICT out, ALuint todo)
 {
-    Delay->Line[offset&Delay->Mask] = in;
-}
+    while(todo > 0)
+    {
+        ALuint pos = offset&Delay->Mask;
+        ALuint count = minu(todo, Delay->Mask+1 - pos);
 
-// Attenuated delay line output routine.
-static __inline ALfloat AttenuatedDelayLineOut(DelayLine *Delay, ALuint offset, ALfloat coeff)
-{
-    return coeff * Delay->Line[offset&Delay->Mask];
+        memcpy(out, &Delay->Line[pos], count*sizeof(ALfloat));
+        out += count;
+        offset += count;
+        todo -= count;
+    }
 }
 
-// Basic attenuated all-pass input/output routine.
-static __inline ALfloat AllpassInOut(DelayLine *Delay, ALuint outOffset, ALuint inOffset, ALfloat in, ALfloat feedCoeff, ALfloat coeff)
+// Writes a run of samples to a delay line, starting at the given offset.
+static __inline ALvoid DelayLineInSpan(DelayLine *Delay, ALuint offset, const ALfloat *RESTRICT in, ALuint todo)
 {
-    ALfloat out, feed;
-
-    out = DelayLineOut(Delay, outOffset);
-    feed = feedCoeff * in;
-    DelayLineIn(Delay, inOffset, (feedCoeff * (out - feed)) + in);
+    while(todo > 0)
+    {
+        ALuint pos = offset&Delay->Mask;
+        ALuint count = minu(todo, Delay->Mask+1 - pos);
 
-    // The time-based attenuation is only applied to the delay output to
-    // keep it from affecting the feed-back path (which is already controlled
-    // by the all-pass feed coefficient).
-    return (coeff * out) - feed;
+        memcpy(&Delay->Line[pos], in, count*sizeof(ALfloat));
+        in += count;
+        offset += count;
+        todo -= count;
+    }
 }
 
-// Given an input sample, this function produces modulation for the late
-// reverb.
-static __inline ALfloat EAXModulation(ALverbState *State, ALfloat in)
+// Given a block of input samples, this function applies the modulation for
+// the late reverb in place.
+static ALvoid EAXModulation(ALverbState *State, ALuint todo, ALfloat *RESTRICT data)
 {
-    ALfloat sinus, frac;
-    ALuint offset;
+    ALfloat sinus, frac, c, s, t;
+    ALfloat stepCos, stepSin;
+    ALfloat filter, depth, coeff;
+    ALuint offset, i;
     ALfloat out0, out1;
 
+    // Feed the delay line with the whole block first.  Every read is at least
+    // one sample behind the one being written, and the line has room for a
+    // block past its deepest read.
+    DelayLineInSpan(&State->Mod.Delay, State->Offset, data, todo);
+
     // Calculate the sinus rythm (dependent on modulation time and the
     // sampling rate).  The center of the sinus is moved to reduce the delay
-    // of the effect when the time or depth are low.
-    sinus = 1.0f - cos(2.0f * M_PI * State->Mod.Index / State->Mod.Range);
-
-    // The depth determines the range over which to read the input samples
-    // from, so it must be filtered to reduce the distortion caused by even
-    // small parameter changes.
-    State->Mod.Filter = lerp(State->Mod.Filter, State->Mod.Depth,
-                             State->Mod.Coeff);
-
-    // Calculate the read offset and fraction between it and the next sample.
-    frac   = (1.0f + (State->Mod.Filter * sinus));
-    offset = (ALuint)frac;
-    frac  -= offset;
-
-    // Get the two samples crossed by the offset, and feed the delay line
-    // with the next input sample.
-    out0 = DelayLineOut(&State->Mod.Delay, State->Offset - offset);
-    out1 = DelayLineOut(&State->Mod.Delay, State->Offset - offset - 1);
-    DelayLineIn(&State->Mod.Delay, State->Offset, in);
+    // of the effect when the time or depth are low.  The cosine is found for
+    // the start of the block, and rotated by one step of the index for each
+    // sample after it.
+    c = cos(2.0f * M_PI * State->Mod.Index / State->Mod.Range);
+    s = sin(2.0f * M_PI * State->Mod.Index / State->Mod.Range);
+    stepCos = cos(2.0f * M_PI / State->Mod.Range);
+    stepSin = sin(2.0f * M_PI / State->Mod.Range);
+
+    filter = State->Mod.Filter;
+    depth = State->Mod.Depth;
+    coeff = State->Mod.Coeff;
+    for(i = 0;i < todo;i++)
+    {
+        sinus = 1.0f - c;
+        t = c*stepCos - s*stepSin;
+        s = s*stepCos + c*stepSin;
+        c = t;
+
+        // The depth determines the range over which to read the input
+        // samples from, so it must be filtered to reduce the distortion
+        // caused by even small parameter changes.
+        filter = lerp(filter, depth, coeff);
+
+        // Calculate the read offset and fraction between it and the next
+        // sample.
+        frac   = (1.0f + (filter * sinus));
+        offset = (ALuint)frac;
+        frac  -= offset;
+
+        // Get the two samples crossed by the offset.  The output is obtained
+        // by linearly interpolating them.
+        out0 = DelayLineOut(&State->Mod.Delay, State->Offset+i - offset);
+        out1 = DelayLineOut(&State->Mod.Delay, State->Offset+i - offset - 1);
+        data[i] = lerp(out0, out1, frac);
+    }
+    State->Mod.Filter = filter;
 
     // Step the modulation index forward, keeping it bound to its range.
-    State->Mod.Index = (State->Mod.Index + 1) % State->Mod.Range;
-
-    // The output is obtained by linearly interpolating the two samples that
-    // were acquired above.
-    return lerp(out0, out1, frac);
+    State->Mod.Index = (State->Mod.Index + todo) % State->Mod.Range;
 }
 
-// Delay line output routine for early reflections.
-static __inline ALfloat EarlyDelayLineOut(ALverbState *State, ALuint index)
+// Given a block of input samples, this function produces four-channel output
+// for the early reflections.
+static ALvoid EarlyReflection(ALverbState *State, ALuint todo, const ALfloat *RESTRICT in, ALfloat (*RESTRICT out)[REVERB_BLOCK_SIZE])
 {
-    return AttenuatedDelayLineOut(&State->Early.Delay[index],
-                                  State->Offset - State->Early.Offset[index],
-                                  State->Early.Coeff[index]);
-}
+    ALfloat d[4][REVERB_BLOCK_SIZE], v;
+    ALuint i, j;
 
-// Given an input sample, this function produces four-channel output for the
-// early reflections.
-static __inline ALvoid EarlyReflection(ALverbState *State, ALfloat in, ALfloat *out)
-{
-    ALfloat d[4], v, f[4];
-
-    // Obtain the decayed results of each early delay line.
-    d[0] = EarlyDelayLineOut(State, 0);
-    d[1] = EarlyDelayLineOut(State, 1);
-    d[2] = EarlyDelayLineOut(State, 2);
-    d[3] = EarlyDelayLineOut(State, 3);
-
-    /* The following uses a lossless scattering junction from waveguide
-     * theory.  It actually amounts to a householder mixing matrix, which
-     * will produce a maximally diffuse response, and means this can probably
-     * be considered a simple feed-back delay network (FDN).
-     *          N
-     *         ---
-     *         \
-     * v = 2/N /   d_i
-     *         ---
-     *         i=1
-     */
-    v = (d[0] + d[1] + d[2] + d[3]) * 0.5f;
-    // The junction is loaded with the input here.
-    v += in;
-
-    // Calculate the feed values for the delay lines.
-    f[0] = v - d[0];
-    f[1] = v - d[1];
-    f[2] = v - d[2];
-    f[3] = v - d[3];
-
-    // Re-feed the delay lines.
-    DelayLineIn(&State->Early.Delay[0], State->Offset, f[0]);
-    DelayLineIn(&State->Early.Delay[1], State->Offset, f[1]);
-    DelayLineIn(&State->Early.Delay[2], State->Offset, f[2]);
-    DelayLineIn(&State->Early.Delay[3], State->Offset, f[3]);
-
-    // Output the results of the junction for all four channels.
-    out[0] = State->Early.Gain * f[0];
-    out[1] = State->Early.Gain * f[1];
-    out[2] = State->Early.Gain * f[2];
-    out[3] = State->Early.Gain * f[3];
-}
+    // Obtain the decayed results of each early delay line.  The block is no
+    // longer than the shortest line, so it only reads what previous blocks
+    // wrote.
+    for(j = 0;j < 4;j++)
+    {
+        DelayLineOutSpan(&State->Early.Delay[j],
+                         State->Offset - State->Early.Offset[j], d[j], todo);
+        for(i = 0;i < todo;i++)
+            d[j][i] *= State->Early.Coeff[j];
+    }
 
-// All-pass input/output routine for late reverb.
-static __inline ALfloat LateAllPassInOut(ALverbState *State, ALuint index, ALfloat in)
-{
-    return AllpassInOut(&State->Late.ApDelay[index],
-                        State->Offset - State->Late.ApOffset[index],
-                        State->Offset, in, State->Late.ApFeedCoeff,
-                        State->Late.ApCoeff[index]);
-}
+    for(i = 0;i < todo;i++)
+    {
+        /* The following uses a lossless scattering junction from waveguide
+         * theory.  It actually amounts to a householder mixing matrix, which
+         * will produce a maximally diffuse response, and means this can
+         * probably be considered a simple feed-back delay network (FDN).
+         *          N
+         *         ---
+         *         \
+         * v = 2/N /   d_i
+         *         ---
+         *         i=1
+         */
+        v = (d[0][i] + d[1][i] + d[2][i] + d[3][i]) * 0.5f;
+        // The junction is loaded with the input here.
+        v += in[i];
+
+        // Calculate the feed values for the delay lines.
+        d[0][i] = v - d[0][i];
+        d[1][i] = v - d[1][i];
+        d[2][i] = v - d[2][i];
+        d[3][i] = v - d[3][i];
+    }
 
-// Delay line output routine for late reverb.
-static __inline ALfloat LateDelayLineOut(ALverbState *State, ALuint index)
-{
-    return AttenuatedDelayLineOut(&State->Late.Delay[index],
-                                  State->Offset - State->Late.Offset[index],
-                                  State->Late.Coeff[index]);
-}
+    for(j = 0;j < 4;j++)
+    {
+        // Re-feed the delay lines.
+        DelayLineInSpan(&State->Early.Delay[j], State->Offset, d[j], todo);
 
-// Low-pass filter input/output routine for late reverb.
-static __inline ALfloat LateLowPassInOut(ALverbState *State, ALuint index, ALfloat in)
-{
-    in = lerp(in, State->Late.LpSample[index], State->Late.LpCoeff[index]);
-    State->Late.LpSample[index] = in;
-    return in;
+        // Output the results of the junction for all four channels.
+        for(i = 0;i < todo;i++)
+            out[j][i] = State->Early.Gain * d[j][i];
+    }
 }
 
-// Given four decorrelated input samples, this function produces four-channel
-// output for the late reverb.
-static __inline ALvoid LateReverb(ALverbState *State, ALfloat *in, ALfloat *out)
+// Given four decorrelated blocks of input samples, this function produces
+// four-channel output for the late reverb.
+static ALvoid LateReverb(ALverbState *State, ALuint todo, ALfloat (*RESTRICT in)[REVERB_BLOCK_SIZE], ALfloat (*RESTRICT out)[REVERB_BLOCK_SIZE])
 {
-    ALfloat d[4], f[4];
+    // This is where the feed-back cycles from line 0 to 1 to 3 to 2 and back
+    // to 0.
+    static const ALuint LineMap[4] = { 2, 0, 3, 1 };
+    ALfloat d[4][REVERB_BLOCK_SIZE], ap[REVERB_BLOCK_SIZE];
+    ALfloat lpSample[4], lpCoeff[4];
+    ALfloat feed, o;
+    ALuint i, j, line;
 
     // Obtain the decayed results of the cyclical delay lines, and add the
-    // corresponding input channels.  Then pass the results through the
-    // low-pass filters.
+    // corresponding input channels.  As with the early lines, the block is
+    // no longer than the shortest line.
+    for(j = 0;j < 4;j++)
+    {
+        line = LineMap[j];
+        DelayLineOutSpan(&State->Late.Delay[line],
+                         State->Offset - State->Late.Offset[line], d[j], todo);
+        for(i = 0;i < todo;i++)
+            d[j][i] = in[line][i] + State->Late.Coeff[line]*d[j][i];
+
+        lpSample[j] = State->Late.LpSample[line];
+        lpCoeff[j] = State->Late.LpCoeff[line];
+    }
 
-    // This is where the feed-back cycles from line 0 to 1 to 3 to 2 and back
-    // to 0.
-    d[0] = LateLowPassInOut(State, 2, in[2] + LateDelayLineOut(State, 2));
-    d[1] = LateLowPassInOut(State, 0, in[0] + LateDelayLineOut(State, 0));
-    d[2] = LateLowPassInOut(State, 3, in[3] + LateDelayLineOut(State, 3));
-    d[3] = LateLowPassInOut(State, 1, in[1] + LateDelayLineOut(State, 1));
+    // Then pass the results through the low-pass filters.  This is the only
+    // part that depends on the previous sample, so the four lines are run
+    // side by side.
+    for(i = 0;i < todo;i++)
+    {
+        for(j = 0;j < 4;j++)
+        {
+            lpSample[j] = lerp(d[j][i], lpSample[j], lpCoeff[j]);
+            d[j][i] = lpSample[j];
+        }
+    }
+    for(j = 0;j < 4;j++)
+        State->Late.LpSample[LineMap[j]] = lpSample[j];
 
     // To help increase diffusion, run each line through an all-pass filter.
     // When there is no diffusion, the shortest all-pass filter will feed the
     // shortest delay line.
-    d[0] = LateAllPassInOut(State, 0, d[0]);
-    d[1] = LateAllPassInOut(State, 1, d[1]);
-    d[2] = LateAllPassInOut(State, 2, d[2]);
-    d[3] = LateAllPassInOut(State, 3, d[3]);
+    for(j = 0;j < 4;j++)
+    {
+        const ALfloat feedCoeff = State->Late.ApFeedCoeff;
+        const ALfloat coeff = State->Late.ApCoeff[j];
+
+        DelayLineOutSpan(&State->Late.ApDelay[j],
+                         State->Offset - State->Late.ApOffset[j], ap, todo);
+        for(i = 0;i < todo;i++)
+        {
+            o = ap[i];
+            feed = feedCoeff * d[j][i];
+            ap[i] = (feedCoeff * (o - feed)) + d[j][i];
+
+            // The time-based attenuation is only applied to the delay output
+            // to keep it from affecting the feed-back path (which is already
+            // controlled by the all-pass feed coefficient).
+            d[j][i] = (coeff * o) - feed;
+        }
+        DelayLineInSpan(&State->Late.ApDelay[j], State->Offset, ap, todo);
+    }
 
     /* Late reverb is done with a modified feed-back delay network (FDN)
      * topology.  Four input lines are each fed through their own all-pass
@@ -395,206 +452,254 @@ static __inline ALvoid LateReverb(ALverbState *State, ALfloat *in, ALfloat *out)
      * the cyclical delay line coefficients.  Thus only the y coefficient is
      * applied when mixing, and is modified to be:  y / x.
      */
-    f[0] = d[0] + (State->Late.MixCoeff * (         d[1] + -d[2] + d[3]));
-    f[1] = d[1] + (State->Late.MixCoeff * (-d[0]         +  d[2] + d[3]));
-    f[2] = d[2] + (State->Late.MixCoeff * ( d[0] + -d[1]         + d[3]));
-    f[3] = d[3] + (State->Late.MixCoeff * (-d[0] + -d[1] + -d[2]       ));
-
-    // Output the results of the matrix for all four channels, attenuated by
-    // the late reverb gain (which is attenuated by the 'x' mix coefficient).
-    out[0] = State->Late.Gain * f[0];
-    out[1] = State->Late.Gain * f[1];
-    out[2] = State->Late.Gain * f[2];
-    out[3] = State->Late.Gain * f[3];
-
-    // Re-feed the cyclical delay lines.
-    DelayLineIn(&State->Late.Delay[0], State->Offset, f[0]);
-    DelayLineIn(&State->Late.Delay[1], State->Offset, f[1]);
-    DelayLineIn(&State->Late.Delay[2], State->Offset, f[2]);
-    DelayLineIn(&State->Late.Delay[3], State->Offset, f[3]);
+    for(i = 0;i < todo;i++)
+    {
+        out[0][i] = d[0][i] + (State->Late.MixCoeff * (            d[1][i] + -d[2][i] + d[3][i]));
+        out[1][i] = d[1][i] + (State->Late.MixCoeff * (-d[0][i]            +  d[2][i] + d[3][i]));
+        out[2][i] = d[2][i] + (State->Late.MixCoeff * ( d[0][i] + -d[1][i]            + d[3][i]));
+        out[3][i] = d[3][i] + (State->Late.MixCoeff * (-d[0][i] + -d[1][i] + -d[2][i]           ));
+    }
+
+    for(j = 0;j < 4;j++)
+    {
+        // Re-feed the cyclical delay lines.
+        DelayLineInSpan(&State->Late.Delay[j], State->Offset, out[j], todo);
+
+        // Output the results of the matrix for all four channels, attenuated
+        // by the late reverb gain (which is attenuated by the 'x' mix
+        // coefficient).
+        for(i = 0;i < todo;i++)
+            out[j][i] *= State->Late.Gain;
+    }
 }
 
-// Given an input sample, this function mixes echo into the four-channel late
-// reverb.
-static __inline ALvoid EAXEcho(ALverbState *State, ALfloat in, ALfloat *late)
+// Given a block of input samples, this function mixes echo into the four-
+// channel late reverb.
+static ALvoid EAXEcho(ALverbState *State, ALuint todo, const ALfloat *RESTRICT in, ALfloat (*RESTRICT late)[REVERB_BLOCK_SIZE])
 {
-    ALfloat out, feed;
+    ALfloat echo[REVERB_BLOCK_SIZE], ap[REVERB_BLOCK_SIZE];
+    ALfloat lpSample, feed, o;
+    ALuint i, j;
 
-    // Get the latest attenuated echo sample for output.
-    feed = AttenuatedDelayLineOut(&State->Echo.Delay,
-                                  State->Offset - State->Echo.Offset,
-                                  State->Echo.Coeff);
+    // Get the latest attenuated echo samples for output.  The echo and
+    // all-pass lines are both longer than a block.
+    DelayLineOutSpan(&State->Echo.Delay, State->Offset - State->Echo.Offset,
+                     echo, todo);
+    for(i = 0;i < todo;i++)
+        echo[i] *= State->Echo.Coeff;
 
     // Mix the output into the late reverb channels.
-    out = State->Echo.MixCoeff[0] * feed;
-    late[0] = (State->Echo.MixCoeff[1] * late[0]) + out;
-    late[1] = (State->Echo.MixCoeff[1] * late[1]) + out;
-    late[2] = (State->Echo.MixCoeff[1] * late[2]) + out;
-    late[3] = (State->Echo.MixCoeff[1] * late[3]) + out;
+    for(j = 0;j < 4;j++)
+    {
+        for(i = 0;i < todo;i++)
+            late[j][i] = (State->Echo.MixCoeff[1] * late[j][i]) +
+                         (State->Echo.MixCoeff[0] * echo[i]);
+    }
 
+    DelayLineOutSpan(&State->Echo.ApDelay, State->Offset - State->Echo.ApOffset,
+                     ap, todo);
     // Mix the energy-attenuated input with the output and pass it through
     // the echo low-pass filter.
-    feed += State->Echo.DensityGain * in;
-    feed = lerp(feed, State->Echo.LpSample, State->Echo.LpCoeff);
-    State->Echo.LpSample = feed;
+    for(i = 0;i < todo;i++)
+        echo[i] += State->Echo.DensityGain * in[i];
+    lpSample = State->Echo.LpSample;
+    for(i = 0;i < todo;i++)
+    {
+        lpSample = lerp(echo[i], lpSample, State->Echo.LpCoeff);
+        echo[i] = lpSample;
+    }
+    State->Echo.LpSample = lpSample;
 
     // Then the echo all-pass filter.
-    feed = AllpassInOut(&State->Echo.ApDelay,
-                        State->Offset - State->Echo.ApOffset,
-                        State->Offset, feed, State->Echo.ApFeedCoeff,
-                        State->Echo.ApCoeff);
+    for(i = 0;i < todo;i++)
+    {
+        o = ap[i];
+        feed = State->Echo.ApFeedCoeff * echo[i];
+        ap[i] = (State->Echo.ApFeedCoeff * (o - feed)) + echo[i];
+        echo[i] = (State->Echo.ApCoeff * o) - feed;
+    }
 
-    // Feed the delay with the mixed and filtered sample.
-    DelayLineIn(&State->Echo.Delay, State->Offset, feed);
+    // Feed the delays with the mixed and filtered samples.
+    DelayLineInSpan(&State->Echo.ApDelay, State->Offset, ap, todo);
+    DelayLineInSpan(&State->Echo.Delay, State->Offset, echo, todo);
 }
 
-// Perform the non-EAX reverb pass on a given input sample, resulting in
+// Perform the non-EAX reverb pass on a block of input samples, resulting in
 // four-channel output.
-static __inline ALvoid VerbPass(ALverbState *State, ALfloat in, ALfloat *early, ALfloat *late)
+static ALvoid VerbPass(ALverbState *State, ALuint todo, const ALfloat *RESTRICT input, ALfloat (*RESTRICT early)[REVERB_BLOCK_SIZE], ALfloat (*RESTRICT late)[REVERB_BLOCK_SIZE])
 {
-    ALfloat feed, taps[4];
+    ALfloat in[REVERB_BLOCK_SIZE], taps[4][REVERB_BLOCK_SIZE];
+    ALuint i;
 
-    // Low-pass filter the incoming sample.
-    in = lpFilter2P(&State->LpFilter, 0, in);
+    // Low-pass filter the incoming samples.
+    for(i = 0;i < todo;i++)
+        in[i] = lpFilter2P(&State->LpFilter, 0, input[i]);
 
     // Feed the initial delay line.
-    DelayLineIn(&State->Delay, State->Offset, in);
+    DelayLineInSpan(&State->Delay, State->Offset, in, todo);
 
-    // Calculate the early reflection from the first delay tap.
-    in = DelayLineOut(&State->Delay, State->Offset - State->DelayTap[0]);
-    EarlyReflection(State, in, early);
+    // Calculate the early reflections from the first delay tap.
+    DelayLineOutSpan(&State->Delay, State->Offset - State->DelayTap[0], in, todo);
+    EarlyReflection(State, todo, in, early);
 
     // Feed the decorrelator from the energy-attenuated output of the second
     // delay tap.
-    in = DelayLineOut(&State->Delay, State->Offset - State->DelayTap[1]);
-    feed = in * State->Late.DensityGain;
-    DelayLineIn(&State->Decorrelator, State->Offset, feed);
+    DelayLineOutSpan(&State->Delay, State->Offset - State->DelayTap[1], in, todo);
+    for(i = 0;i < todo;i++)
+        taps[0][i] = in[i] * State->Late.DensityGain;
+    DelayLineInSpan(&State->Decorrelator, State->Offset, taps[0], todo);
 
     // Calculate the late reverb from the decorrelator taps.
-    taps[0] = feed;
-    taps[1] = DelayLineOut(&State->Decorrelator, State->Offset - State->DecoTap[0]);
-    taps[2] = DelayLineOut(&State->Decorrelator, State->Offset - State->DecoTap[1]);
-    taps[3] = DelayLineOut(&State->Decorrelator, State->Offset - State->DecoTap[2]);
-    LateReverb(State, taps, late);
-
-    // Step all delays forward one sample.
-    State->Offset++;
+    for(i = 0;i < 3;i++)
+        DelayLineOutSpan(&State->Decorrelator, State->Offset - State->DecoTap[i],
+                         taps[i+1], todo);
+    LateReverb(State, todo, taps, late);
+
+    // Step all delays forward.
+    State->Offset += todo;
 }
 
-// Perform the EAX reverb pass on a given input sample, resulting in four-
+// Perform the EAX reverb pass on a block of input samples, resulting in four-
 // channel output.
-static __inline ALvoid EAXVerbPass(ALverbState *State, ALfloat in, ALfloat *early, ALfloat *late)
+static ALvoid EAXVerbPass(ALverbState *State, ALuint todo, const ALfloat *RESTRICT input, ALfloat (*RESTRICT early)[REVERB_BLOCK_SIZE], ALfloat (*RESTRICT late)[REVERB_BLOCK_SIZE])
 {
-    ALfloat feed, taps[4];
+    ALfloat in[REVERB_BLOCK_SIZE], taps[4][REVERB_BLOCK_SIZE];
+    ALuint i;
 
-    // Low-pass filter the incoming sample.
-    in = lpFilter2P(&State->LpFilter, 0, in);
+    // Low-pass filter the incoming samples.
+    for(i = 0;i < todo;i++)
+        in[i] = lpFilter2P(&State->LpFilter, 0, input[i]);
 
     // Perform any modulation on the input.
-    in = EAXModulation(State, in);
+    EAXModulation(State, todo, in);
 
     // Feed the initial delay line.
-    DelayLineIn(&State->Delay, State->Offset, in);
+    DelayLineInSpan(&State->Delay, State->Offset, in, todo);
 
-    // Calculate the early reflection from the first delay tap.
-    in = DelayLineOut(&State->Delay, State->Offset - State->DelayTap[0]);
-    EarlyReflection(State, in, early);
+    // Calculate the early reflections from the first delay tap.
+    DelayLineOutSpan(&State->Delay, State->Offset - State->DelayTap[0], in, todo);
+    EarlyReflection(State, todo, in, early);
 
     // Feed the decorrelator from the energy-attenuated output of the second
     // delay tap.
-    in = DelayLineOut(&State->Delay, State->Offset - State->DelayTap[1]);
-    feed = in * State->Late.DensityGain;
-    DelayLineIn(&State->Decorrelator, State->Offset, feed);
+    DelayLineOutSpan(&State->Delay, State->Offset - State->DelayTap[1], in, todo);
+    for(i = 0;i < todo;i++)
+        taps[0][i] = in[i] * State->Late.DensityGain;
+    DelayLineInSpan(&State->Decorrelator, State->Offset, taps[0], todo);
 
     // Calculate the late reverb from the decorrelator taps.
-    taps[0] = feed;
-    taps[1] = DelayLineOut(&State->Decorrelator, State->Offset - State->DecoTap[0]);
-    taps[2] = DelayLineOut(&State->Decorrelator, State->Offset - State->DecoTap[1]);
-    taps[3] = DelayLineOut(&State->Decorrelator, State->Offset - State->DecoTap[2]);
-    LateReverb(State, taps, late);
+    for(i = 0;i < 3;i++)
+        DelayLineOutSpan(&State->Decorrelator, State->Offset - State->DecoTap[i],
+                         taps[i+1], todo);
+    LateReverb(State, todo, taps, late);
 
     // Calculate and mix in any echo.
-    EAXEcho(State, in, late);
+    EAXEcho(State, todo, in, late);
 
-    // Step all delays forward one sample.
-    State->Offset++;
+    // Step all delays forward.
+    State->Offset += todo;
+}
+
+// Tracks how long the input has been silent for, so the reverb's tail can be
+// checked for silence once it's had time to run through all the delay lines.
+static __inline ALvoid UpdateQuietSamples(ALverbState *State, ALuint SamplesToDo, const ALfloat *SamplesIn)
+{
+    if(!IsSilentBuffer(SamplesIn, SamplesToDo))
+        State->QuietSamples = 0;
+    else if(State->QuietSamples < State->TotalSamples)
+        State->QuietSamples += SamplesToDo;
+    State->Silent = AL_FALSE;
 }
 
 // This processes the reverb state, given the input samples and an output
 // buffer.
-static ALvoid VerbProcess(ALeffectState *effect, const ALeffectslot *Slot, ALuint SamplesToDo, const ALfloat *SamplesIn, ALfloat (*SamplesOut)[MAXCHANNELS])
+static ALvoid VerbProcess(ALeffectState *effect, const ALeffectslot *Slot, ALuint SamplesToDo, const ALfloat *SamplesIn, ALfloat (*SamplesOut)[BUFFERSIZE], ALuint NumChannels)
 {
     ALverbState *State = (ALverbState*)effect;
-    ALuint index;
-    ALfloat early[4], late[4], out[4];
+    ALfloat early[4][REVERB_BLOCK_SIZE], late[4][REVERB_BLOCK_SIZE];
     const ALfloat *panGain = State->Gain;
+    ALuint base, todo, index, c;
     (void)Slot;
 
-    for(index = 0;index < SamplesToDo;index++)
+    UpdateQuietSamples(State, SamplesToDo, SamplesIn);
+
+    for(base = 0;base < SamplesToDo;base += todo)
     {
-        // Process reverb for this sample.
-        VerbPass(State, SamplesIn[index], early, late);
-
-        // Mix early reflections and late reverb.
-        out[0] = (early[0] + late[0]);
-        out[1] = (early[1] + late[1]);
-        out[2] = (early[2] + late[2]);
-        out[3] = (early[3] + late[3]);
-
-        // Output the results.
-        SamplesOut[index][FRONT_LEFT]   += panGain[FRONT_LEFT]   * out[0];
-        SamplesOut[index][FRONT_RIGHT]  += panGain[FRONT_RIGHT]  * out[1];
-        SamplesOut[index][FRONT_CENTER] += panGain[FRONT_CENTER] * out[3];
-        SamplesOut[index][SIDE_LEFT]    += panGain[SIDE_LEFT]    * out[0];
-        SamplesOut[index][SIDE_RIGHT]   += panGain[SIDE_RIGHT]   * out[1];
-        SamplesOut[index][BACK_LEFT]    += panGain[BACK_LEFT]    * out[0];
-        SamplesOut[index][BACK_RIGHT]   += panGain[BACK_RIGHT]   * out[1];
-        SamplesOut[index][BACK_CENTER]  += panGain[BACK_CENTER]  * out[2];
+        todo = minu(SamplesToDo-base, State->BlockSize);
+
+        // Process reverb for these samples.
+        VerbPass(State, todo, &SamplesIn[base], early, late);
+
+        // Mix early reflections and late reverb, and output the results.
+        for(c = 0;c < NumChannels;c++)
+        {
+            const ALint idx = State->OutIndex[c];
+            const ALfloat gain = panGain[c];
+
+            if(idx < 0)
+                continue;
+            for(index = 0;index < todo;index++)
+                SamplesOut[c][base+index] += gain * (early[idx][index] +
+                                                     late[idx][index]);
+        }
     }
 }
 
 // This processes the EAX reverb state, given the input samples and an output
 // buffer.
-static ALvoid EAXVerbProcess(ALeffectState *effect, const ALeffectslot *Slot, ALuint SamplesToDo, const ALfloat *SamplesIn, ALfloat (*SamplesOut)[MAXCHANNELS])
+static ALvoid EAXVerbProcess(ALeffectState *effect, const ALeffectslot *Slot, ALuint SamplesToDo, const ALfloat *SamplesIn, ALfloat (*SamplesOut)[BUFFERSIZE], ALuint NumChannels)
 {
     ALverbState *State = (ALverbState*)effect;
-    ALuint index;
-    ALfloat early[4], late[4];
+    ALfloat early[4][REVERB_BLOCK_SIZE], late[4][REVERB_BLOCK_SIZE];
+    ALuint base, todo, index, c;
     (void)Slot;
 
-    for(index = 0;index < SamplesToDo;index++)
+    UpdateQuietSamples(State, SamplesToDo, SamplesIn);
+
+    for(base = 0;base < SamplesToDo;base += todo)
     {
-        // Process reverb for this sample.
-        EAXVerbPass(State, SamplesIn[index], early, late);
+        todo = minu(SamplesToDo-base, State->BlockSize);
+
+        // Process reverb for these samples.
+        EAXVerbPass(State, todo, &SamplesIn[base], early, late);
 
         // Unfortunately, while the number and configuration of gains for
         // panning adjust according to MAXCHANNELS, the output from the
         // reverb engine is not so scalable.
-        SamplesOut[index][FRONT_LEFT] +=
-           (State->Early.PanGain[FRONT_LEFT]*early[0] +
-            State->Late.PanGain[FRONT_LEFT]*late[0]);
-        SamplesOut[index][FRONT_RIGHT] +=
-           (State->Early.PanGain[FRONT_RIGHT]*early[1] +
-            State->Late.PanGain[FRONT_RIGHT]*late[1]);
-        SamplesOut[index][FRONT_CENTER] +=
-           (State->Early.PanGain[FRONT_CENTER]*early[3] +
-            State->Late.PanGain[FRONT_CENTER]*late[3]);
-        SamplesOut[index][SIDE_LEFT] +=
-           (State->Early.PanGain[SIDE_LEFT]*early[0] +
-            State->Late.PanGain[SIDE_LEFT]*late[0]);
-        SamplesOut[index][SIDE_RIGHT] +=
-           (State->Early.PanGain[SIDE_RIGHT]*early[1] +
-            State->Late.PanGain[SIDE_RIGHT]*late[1]);
-        SamplesOut[index][BACK_LEFT] +=
-           (State->Early.PanGain[BACK_LEFT]*early[0] +
-            State->Late.PanGain[BACK_LEFT]*late[0]);
-        SamplesOut[index][BACK_RIGHT] +=
-           (State->Early.PanGain[BACK_RIGHT]*early[1] +
-            State->Late.PanGain[BACK_RIGHT]*late[1]);
-        SamplesOut[index][BACK_CENTER] +=
-           (State->Early.PanGain[BACK_CENTER]*early[2] +
-            State->Late.PanGain[BACK_CENTER]*late[2]);
+        for(c = 0;c < NumChannels;c++)
+        {
+            const ALint idx = State->OutIndex[c];
+            const ALfloat earlyGain = State->Early.PanGain[c];
+            const ALfloat lateGain = State->Late.PanGain[c];
+
+            if(idx < 0)
+                continue;
+            for(index = 0;index < todo;index++)
+                SamplesOut[c][base+index] +=
+                    (earlyGain*early[idx][index] + lateGain*late[idx][index]);
+        }
+    }
+}
+
+// Once the input has been silent for as long as all the delay lines together,
+// any remaining output comes from what's left circulating in the lines.  The
+// reverb is silent when none of it is audible anymore.
+static ALboolean ReverbIsSilent(ALeffectState *effect)
+{
+    ALverbState *State = (ALverbState*)effect;
+
+    if(!State->Silent)
+    {
+        if(State->QuietSamples < State->TotalSamples)
+            return AL_FALSE;
+        if(!IsSilentBuffer(State->SampleBuffer, State->TotalSamples))
+        {
+            State->QuietSamples = 0;
+            return AL_FALSE;
+        }
+        State->Silent = AL_TRUE;
     }
+    return AL_TRUE;
 }
 
 
@@ -606,13 +711,14 @@ static __inline ALvoid RealizeLineOffset(ALfloat * sampleBuffer, DelayLine *Dela
 }
 
 // Calculate the length of a delay line and store its mask and offset.
-static ALuint CalcLineLength(ALfloat length, ALintptrEXT offset, ALuint frequency, DelayLine *Delay)
+static ALuint CalcLineLength(ALfloat length, ALintptrEXT offset, ALuint frequency, ALuint extra, DelayLine *Delay)
 {
     ALuint samples;
 
-    // All line lengths are powers of 2, calculated from their lengths, with
-    // an additional sample in case of rounding errors.
-    samples = NextPowerOf2((ALuint)(length * frequency) + 1);
+    // All line lengths are powers of 2, calculated from their lengths and
+    // any extra samples needed, with an additional sample in case of rounding
+    // errors.
+    samples = NextPowerOf2((ALuint)(length * frequency) + extra + 1);
     // All lines share a single sample buffer.
     Delay->Mask = samples - 1;
     Delay->Line = (ALfloat*)offset;
@@ -631,7 +737,10 @@ static ALboolean AllocLines(ALuint frequency, ALverbState *State)
     ALfloat *newBuffer = NULL;
 
     // All delay line lengths are calculated to accomodate the full range of
-    // lengths given their respective paramters.
+    // lengths given their respective paramters.  The lines that aren't part
+    // of a feed-back loop (the modulator, initial delay, and decorrelator)
+    // get a whole block written before it's read back, so they need room for
+    // an extra block.
     totalSamples = 0;
 
     /* The modulator's line length is calculated from the maximum modulation
@@ -642,45 +751,45 @@ static ALboolean AllocLines(ALuint frequency, ALverbState *State)
     length = (AL_EAXREVERB_MAX_MODULATION_TIME*MODULATION_DEPTH_COEFF/2.0f) +
              (1.0f / frequency);
     totalSamples += CalcLineLength(length, totalSamples, frequency,
-                                   &State->Mod.Delay);
+                                   REVERB_BLOCK_SIZE, &State->Mod.Delay);
 
     // The initial delay is the sum of the reflections and late reverb
     // delays.
     length = AL_EAXREVERB_MAX_REFLECTIONS_DELAY +
              AL_EAXREVERB_MAX_LATE_REVERB_DELAY;
     totalSamples += CalcLineLength(length, totalSamples, frequency,
-                                   &State->Delay);
+                                   REVERB_BLOCK_SIZE, &State->Delay);
 
     // The early reflection lines.
     for(index = 0;index < 4;index++)
         totalSamples += CalcLineLength(EARLY_LINE_LENGTH[index], totalSamples,
-                                       frequency, &State->Early.Delay[index]);
+                                       frequency, 0, &State->Early.Delay[index]);
 
     // The decorrelator line is calculated from the lowest reverb density (a
     // parameter value of 1).
     length = (DECO_FRACTION * DECO_MULTIPLIER * DECO_MULTIPLIER) *
              LATE_LINE_LENGTH[0] * (1.0f + LATE_LINE_MULTIPLIER);
     totalSamples += CalcLineLength(length, totalSamples, frequency,
-                                   &State->Decorrelator);
+                                   REVERB_BLOCK_SIZE, &State->Decorrelator);
 
     // The late all-pass lines.
     for(index = 0;index < 4;index++)
         totalSamples += CalcLineLength(ALLPASS_LINE_LENGTH[index], totalSamples,
-                                       frequency, &State->Late.ApDelay[index]);
+                                       frequency, 0, &State->Late.ApDelay[index]);
 
     // The late delay lines are calculated from the lowest reverb density.
     for(index = 0;index < 4;index++)
     {
         length = LATE_LINE_LENGTH[index] * (1.0f + LATE_LINE_MULTIPLIER);
-        totalSamples += CalcLineLength(length, totalSamples, frequency,
+        totalSamples += CalcLineLength(length, totalSamples, frequency, 0,
                                        &State->Late.Delay[index]);
     }
 
     // The echo all-pass and delay lines.
     totalSamples += CalcLineLength(ECHO_ALLPASS_LENGTH, totalSamples,
-                                   frequency, &State->Echo.ApDelay);
+                                   frequency, 0, &State->Echo.ApDelay);
     totalSamples += CalcLineLength(AL_EAXREVERB_MAX_ECHO_TIME, totalSamples,
-                                   frequency, &State->Echo.Delay);
+                                   frequency, 0, &State->Echo.Delay);
 
     if(totalSamples != State->TotalSamples)
     {
@@ -708,6 +817,8 @@ static ALboolean AllocLines(ALuint frequency, ALverbState *State)
     // Clear the sample buffer.
     for(index = 0;index < State->TotalSamples;index++)
         State->SampleBuffer[index] = 0.0f;
+    State->QuietSamples = State->TotalSamples;
+    State->Silent = AL_TRUE;
 
     return AL_TRUE;
 }
@@ -1023,12 +1134,24 @@ static ALvoid UpdateEchoLine(ALfloat reverbGain, ALfloat lateGain, ALfloat echoT
 }
 
 // Update the early and late 3D panning gains.
+// Rearranges gains given per channel into device channel order.
+static ALvoid SetChannelGains(const ALCdevice *Device, const ALfloat *ChanGain, ALfloat *OutGain)
+{
+    ALuint index;
+
+    for(index = 0;index < MAXCHANNELS;index++)
+        OutGain[index] = 0.0f;
+    for(index = 0;index < ChannelsFromDevFmt(Device->FmtChans);index++)
+        OutGain[index] = ChanGain[Device->DevChannels[index]];
+}
+
 static ALvoid Update3DPanning(const ALCdevice *Device, const ALfloat *ReflectionsPan, const ALfloat *LateReverbPan, ALfloat Gain, ALverbState *State)
 {
     ALfloat earlyPan[3] = { ReflectionsPan[0], ReflectionsPan[1],
                             ReflectionsPan[2] };
     ALfloat latePan[3] = { LateReverbPan[0], LateReverbPan[1],
                            LateReverbPan[2] };
+    ALfloat chanGain[MAXCHANNELS];
     const ALfloat *speakerGain;
     ALfloat ambientGain;
     ALfloat dirGain;
@@ -1071,12 +1194,13 @@ static ALvoid Update3DPanning(const ALCdevice *Device, const ALfloat *Reflection
     dirGain = aluSqrt((earlyPan[0] * earlyPan[0]) + (earlyPan[2] * earlyPan[2]));
 
     for(index = 0;index < MAXCHANNELS;index++)
-        State->Early.PanGain[index] = 0.0f;
+        chanGain[index] = 0.0f;
     for(index = 0;index < Device->NumChan;index++)
     {
         enum Channel chan = Device->Speaker2Chan[index];
-        State->Early.PanGain[chan] = lerp(ambientGain, speakerGain[chan], dirGain) * Gain;
+        chanGain[chan] = lerp(ambientGain, speakerGain[chan], dirGain) * Gain;
     }
+    SetChannelGains(Device, chanGain, State->Early.PanGain);
 
 
     pos = aluCart2LUTpos(latePan[2], latePan[0]);
@@ -1084,11 +1208,45 @@ static ALvoid Update3DPanning(const ALCdevice *Device, const ALfloat *Reflection
     dirGain = aluSqrt((latePan[0] * latePan[0]) + (latePan[2] * latePan[2]));
 
     for(index = 0;index < MAXCHANNELS;index++)
-         State->Late.PanGain[index] = 0.0f;
+        chanGain[index] = 0.0f;
     for(index = 0;index < Device->NumChan;index++)
     {
         enum Channel chan = Device->Speaker2Chan[index];
-        State->Late.PanGain[chan] = lerp(ambientGain, speakerGain[chan], dirGain) * Gain;
+        chanGain[chan] = lerp(ambientGain, speakerGain[chan], dirGain) * Gain;
+    }
+    SetChannelGains(Device, chanGain, State->Late.PanGain);
+}
+
+// Maps each output channel to the reverb output it gets.
+static ALvoid UpdateOutIndex(const ALCdevice *Device, ALverbState *State)
+{
+    ALuint index;
+
+    for(index = 0;index < MAXCHANNELS;index++)
+        State->OutIndex[index] = -1;
+    for(index = 0;index < ChannelsFromDevFmt(Device->FmtChans);index++)
+    {
+        switch(Device->DevChannels[index])
+        {
+            case FRONT_LEFT:
+            case SIDE_LEFT:
+            case BACK_LEFT:
+                State->OutIndex[index] = 0;
+                break;
+            case FRONT_RIGHT:
+            case SIDE_RIGHT:
+            case BACK_RIGHT:
+                State->OutIndex[index] = 1;
+                break;
+            case BACK_CENTER:
+                State->OutIndex[index] = 2;
+                break;
+            case FRONT_CENTER:
+                State->OutIndex[index] = 3;
+                break;
+            default:
+                break;
+        }
     }
 }
 
@@ -1100,6 +1258,7 @@ static ALvoid ReverbUpdate(ALeffectState *effect, ALCcontext *Context, const ALe
     ALuint frequency = Context->Device->Frequency;
     ALboolean isEAX = AL_FALSE;
     ALfloat cw, x, y, hfRatio;
+    ALuint index;
 
     if(Slot->effect.type == AL_EFFECT_EAXREVERB && !EmulateEAXReverb)
     {
@@ -1172,19 +1331,38 @@ static ALvoid ReverbUpdate(ALeffectState *effect, ALCcontext *Context, const ALe
     else
     {
         ALCdevice *Device = Context->Device;
+        ALfloat chanGain[MAXCHANNELS];
         ALfloat gain = Slot->Gain;
-        ALuint index;
 
         /* Update channel gains */
         gain *= aluSqrt(2.0f/Device->NumChan) * ReverbBoost;
         for(index = 0;index < MAXCHANNELS;index++)
-             State->Gain[index] = 0.0f;
+             chanGain[index] = 0.0f;
         for(index = 0;index < Device->NumChan;index++)
         {
             enum Channel chan = Device->Speaker2Chan[index];
-            State->Gain[chan] = gain;
+            chanGain[chan] = gain;
         }
+        SetChannelGains(Device, chanGain, State->Gain);
+    }
+
+    // Update which reverb output goes to each output channel.
+    UpdateOutIndex(Context->Device, State);
+
+    // Limit the block size to the shortest feed-back delay.
+    State->BlockSize = REVERB_BLOCK_SIZE;
+    for(index = 0;index < 4;index++)
+    {
+        State->BlockSize = minu(State->BlockSize, State->Early.Offset[index]);
+        State->BlockSize = minu(State->BlockSize, State->Late.ApOffset[index]);
+        State->BlockSize = minu(State->BlockSize, State->Late.Offset[index]);
+    }
+    if(isEAX)
+    {
+        State->BlockSize = minu(State->BlockSize, State->Echo.Offset);
+        State->BlockSize = minu(State->BlockSize, State->Echo.ApOffset);
     }
+    State->BlockSize = maxu(State->BlockSize, 1);
 }
 
 // This destroys the reverb state.  It should be called only when the effect
@@ -1215,9 +1393,12 @@ ALeffectState *ReverbCreate(void)
     State->state.DeviceUpdate = ReverbDeviceUpdate;
     State->state.Update = ReverbUpdate;
     State->state.Process = VerbProcess;
+    State->state.IsSilent = ReverbIsSilent;
 
     State->TotalSamples = 0;
     State->SampleBuffer = NULL;
+    State->QuietSamples = 0;
+    State->Silent = AL_TRUE;
 
     State->LpFilter.coeff = 0.0f;
     State->LpFilter.history[0] = 0.0f;
@@ -1275,6 +1456,7 @@ ALeffectState *ReverbCreate(void)
     {
         State->Early.PanGain[index] = 0.0f;
         State->Late.PanGain[index] = 0.0f;
+        State->OutIndex[index] = -1;
     }
 
     State->Echo.DensityGain = 0.0f;
@@ -1293,6 +1475,7 @@ ALeffectState *ReverbCreate(void)
     State->Echo.MixCoeff[1] = 0.0f;
 
     State->Offset = 0;
+    State->BlockSize = 1;
 
     State->Gain = State->Late.PanGain;
 
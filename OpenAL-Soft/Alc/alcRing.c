@@ -24,104 +24,170 @@
 #include <stdlib.h>
 
 #include "alMain.h"
+#include "alu.h"
 
 
+/* The read and write positions are only ever changed by the reader and the
+ * writer, respectively. Each side reads the other's position, then accesses
+ * the frames it covers, with a memory fence between so the frames are never
+ * touched before the position says they're ready. The buffer holds a power-
+ * of-two number of frames so the positions can wrap with a mask, and one frame
+ * is always left unused so a full buffer can be told apart from an empty one.
+ */
 struct RingBuffer {
     ALubyte *mem;
 
     ALsizei frame_size;
-    ALsizei length;
-    ALint read_pos;
-    ALint write_pos;
-
-    CRITICAL_SECTION cs;
+    ALuint size_mask;
+    volatile ALuint read_pos;
+    volatile ALuint write_pos;
 };
 
 
 RingBuffer *CreateRingBuffer(ALsizei frame_size, ALsizei length)
 {
-    RingBuffer *ring = calloc(1, sizeof(*ring) + ((length+1) * frame_size));
+    ALuint size = NextPowerOf2(length+1);
+    RingBuffer *ring;
+
+    ring = calloc(1, sizeof(*ring) + ((size_t)size * frame_size));
     if(ring)
     {
         ring->mem = (ALubyte*)(ring+1);
 
         ring->frame_size = frame_size;
-        ring->length = length+1;
+        ring->size_mask = size-1;
         ring->read_pos = 0;
         ring->write_pos = 0;
-
-        InitializeCriticalSection(&ring->cs);
     }
     return ring;
 }
 
 void DestroyRingBuffer(RingBuffer *ring)
 {
-    if(ring)
+    free(ring);
+}
+
+/* Returns the number of frames available to read. */
+ALsizei RingBufferSize(RingBuffer *ring)
+{
+    ALuint w = ring->write_pos;
+    ALuint r = ring->read_pos;
+    return (w-r) & ring->size_mask;
+}
+
+/* Returns the number of frames that can be written. */
+ALsizei RingBufferSpace(RingBuffer *ring)
+{
+    ALuint w = ring->write_pos;
+    ALuint r = ring->read_pos;
+    return (r-w-1) & ring->size_mask;
+}
+
+
+void GetRingBufferReadVector(RingBuffer *ring, RingBufferVector vec[2])
+{
+    ALuint r = ring->read_pos;
+    ALuint avail = (ring->write_pos-r) & ring->size_mask;
+    ALuint remain = ring->size_mask+1 - r;
+
+    MemoryFence();
+
+    vec[0].buf = ring->mem + r*ring->frame_size;
+    if(avail > remain)
     {
-        DeleteCriticalSection(&ring->cs);
-        free(ring);
+        vec[0].len = remain;
+        vec[1].buf = ring->mem;
+        vec[1].len = avail - remain;
+    }
+    else
+    {
+        vec[0].len = avail;
+        vec[1].buf = NULL;
+        vec[1].len = 0;
     }
 }
 
-ALsizei RingBufferSize(RingBuffer *ring)
+void GetRingBufferWriteVector(RingBuffer *ring, RingBufferVector vec[2])
 {
-    ALsizei s;
+    ALuint w = ring->write_pos;
+    ALuint space = (ring->read_pos-w-1) & ring->size_mask;
+    ALuint remain = ring->size_mask+1 - w;
 
-    EnterCriticalSection(&ring->cs);
-    s = (ring->write_pos-ring->read_pos+ring->length) % ring->length;
-    LeaveCriticalSection(&ring->cs);
+    MemoryFence();
 
-    return s;
+    vec[0].buf = ring->mem + w*ring->frame_size;
+    if(space > remain)
+    {
+        vec[0].len = remain;
+        vec[1].buf = ring->mem;
+        vec[1].len = space - remain;
+    }
+    else
+    {
+        vec[0].len = space;
+        vec[1].buf = NULL;
+        vec[1].len = 0;
+    }
 }
 
-void WriteRingBuffer(RingBuffer *ring, const ALubyte *data, ALsizei len)
+/* Marks len frames as read, which must be no more than the read vector
+ * holds. */
+void AdvanceRingBufferRead(RingBuffer *ring, ALsizei len)
 {
-    int remain;
+    MemoryFence();
+    ring->read_pos = (ring->read_pos+len) & ring->size_mask;
+}
 
-    EnterCriticalSection(&ring->cs);
+/* Marks len frames as written, which must be no more than the write vector
+ * holds. */
+void AdvanceRingBufferWrite(RingBuffer *ring, ALsizei len)
+{
+    MemoryFence();
+    ring->write_pos = (ring->write_pos+len) & ring->size_mask;
+}
 
-    remain = (ring->read_pos-ring->write_pos-1+ring->length) % ring->length;
-    if(remain < len) len = remain;
 
-    if(len > 0)
+/* Writes up to len frames, dropping any that don't fit. */
+void WriteRingBuffer(RingBuffer *ring, const ALubyte *data, ALsizei len)
+{
+    RingBufferVector vec[2];
+    ALsizei todo;
+
+    GetRingBufferWriteVector(ring, vec);
+
+    todo = mini(len, vec[0].len);
+    memcpy(vec[0].buf, data, todo*ring->frame_size);
+    len -= todo;
+    if(len > 0 && vec[1].len > 0)
     {
-        remain = ring->length - ring->write_pos;
-        if(remain < len)
-        {
-            memcpy(ring->mem+(ring->write_pos*ring->frame_size), data,
-                   remain*ring->frame_size);
-            memcpy(ring->mem, data+(remain*ring->frame_size),
-                   (len-remain)*ring->frame_size);
-        }
-        else
-            memcpy(ring->mem+(ring->write_pos*ring->frame_size), data,
-                   len*ring->frame_size);
-
-        ring->write_pos += len;
-        ring->write_pos %= ring->length;
+        data += todo*ring->frame_size;
+        len = mini(len, vec[1].len);
+        memcpy(vec[1].buf, data, len*ring->frame_size);
+        todo += len;
     }
 
-    LeaveCriticalSection(&ring->cs);
+    AdvanceRingBufferWrite(ring, todo);
 }
 
+/* Reads up to len frames. Callers are expected to check there's enough
+ * available first. */
 void ReadRingBuffer(RingBuffer *ring, ALubyte *data, ALsizei len)
 {
-    int remain;
+    RingBufferVector vec[2];
+    ALsizei todo;
 
-    EnterCriticalSection(&ring->cs);
+    GetRingBufferReadVector(ring, vec);
 
-    remain = ring->length - ring->read_pos;
-    if(remain < len)
+    todo = mini(len, vec[0].len);
+    memcpy(data, vec[0].buf, todo*ring->frame_size);
+    len -= todo;
+    if(len > 0 && vec[1].len > 0)
     {
-        memcpy(data, ring->mem+(ring->read_pos*ring->frame_size), remain*ring->frame_size);
-        memcpy(data+(remain*ring->frame_size), ring->mem, (len-remain)*ring->frame_size);
+        data += todo*ring->frame_size;
+        len = mini(len, vec[1].len);
+        memcpy(data, vec[1].buf, len*ring->frame_size);
+        todo += len;
     }
-    else
-        memcpy(data, ring->mem+(ring->read_pos*ring->frame_size), len*ring->frame_size);
-
-    ring->read_pos += len;
-    ring->read_pos %= ring->length;
 
-    LeaveCriticalSection(&ring->cs);
+    AdvanceRingBufferRead(ring, todo);
 }
@@ -78,6 +78,26 @@ ALuint StopThread(ALvoid *thread)
     return (ALuint)ret;
 }
 
+ALvoid *CreateSemaphoreAL(void)
+{
+    return CreateSemaphore(NULL, 0, 0x7fffffff, NULL);
+}
+
+ALvoid DestroySemaphoreAL(ALvoid *sem)
+{
+    CloseHandle(sem);
+}
+
+ALvoid PostSemaphoreAL(ALvoid *sem)
+{
+    ReleaseSemaphore(sem, 1, NULL);
+}
+
+ALvoid WaitSemaphoreAL(ALvoid *sem)
+{
+    WaitForSingleObject(sem, INFINITE);
+}
+
 #else
 
 #include <pthread.h>
@@ -125,4 +145,62 @@ ALuint StopThread(ALvoid *thread)
     return ret;
 }
 
+
+typedef struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    ALuint count;
+} SemaphoreInfo;
+
+ALvoid *CreateSemaphoreAL(void)
+{
+    SemaphoreInfo *inf = malloc(sizeof(SemaphoreInfo));
+    if(!inf) return NULL;
+
+    if(pthread_mutex_init(&inf->mutex, NULL) != 0)
+    {
+        free(inf);
+        return NULL;
+    }
+    if(pthread_cond_init(&inf->cond, NULL) != 0)
+    {
+        pthread_mutex_destroy(&inf->mutex);
+        free(inf);
+        return NULL;
+    }
+    inf->count = 0;
+
+    return inf;
+}
+
+ALvoid DestroySemaphoreAL(ALvoid *sem)
+{
+    SemaphoreInfo *inf = sem;
+
+    pthread_cond_destroy(&inf->cond);
+    pthread_mutex_destroy(&inf->mutex);
+    free(inf);
+}
+
+ALvoid PostSemaphoreAL(ALvoid *sem)
+{
+    SemaphoreInfo *inf = sem;
+
+    pthread_mutex_lock(&inf->mutex);
+    inf->count++;
+    pthread_cond_signal(&inf->cond);
+    pthread_mutex_unlock(&inf->mutex);
+}
+
+ALvoid WaitSemaphoreAL(ALvoid *sem)
+{
+    SemaphoreInfo *inf = sem;
+
+    pthread_mutex_lock(&inf->mutex);
+    while(inf->count == 0)
+        pthread_cond_wait(&inf->cond, &inf->mutex);
+    inf->count--;
+    pthread_mutex_unlock(&inf->mutex);
+}
+
 #endif
@@ -0,0 +1,405 @@
+/**
+ * OpenAL cross platform audio library
+ * Copyright (C) 2012 by authors.
+ * This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Library General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ *  License along with this library; if not, write to the
+ *  Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ *  Boston, MA  02111-1307, USA.
+ * Or go to http://www.gnu.org/copyleft/lgpl.html
+ */
+
+#include "config.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "alMain.h"
+#include "alSource.h"
+#include "alu.h"
+#include "mixer_defs.h"
+
+
+/* When the device has an ambisonic order set, sources are encoded into an
+ * ambisonic bus instead of being panned to the output channels. Each source
+ * channel then only needs (order+1)^2 gains, and the bus is decoded once per
+ * update, either for the speakers or to stereo through a fixed set of HRTF
+ * filters. The bus uses ACN channel order with N3D normalization, and replaces
+ * the device's dry buffer, so the source mixers, mixing threads, and click
+ * removal work on it unchanged. Effects still write to the output channels.
+ */
+
+/* The HRTF filters for the bus channels cover an HRIR, plus the most delay
+ * between the HRIRs they're made from. */
+#define AMBI_HRTF_LENGTH  (HRIR_LENGTH+SRC_HISTORY_LENGTH)
+
+/* The HRTF filters are applied in blocks of this many samples, to keep the
+ * output in cache while each tap is added. */
+#define AMBI_BLOCK_SIZE   256
+
+/* Rings of equal area and segments per ring, for sampling the sphere when
+ * fitting the speaker decoder to the panning table, and when levelling the
+ * HRTF filters (which needs an HRIR for each direction). */
+#define AMBI_RINGS     32
+#define AMBI_SEGMENTS  64
+#define AMBI_HRTF_RINGS     8
+#define AMBI_HRTF_SEGMENTS  16
+
+struct AmbiDecoder {
+    /* Output channel gains for each bus channel, in DevChannels order, when
+     * decoding for speakers */
+    ALfloat Matrix[MAX_AMBI_CHANNELS][MAXCHANNELS];
+
+    /* Left and right ear filters for each bus channel, and how many taps they
+     * have. IrSize is 0 when decoding for speakers. */
+    ALfloat Coeffs[MAX_AMBI_CHANNELS][AMBI_HRTF_LENGTH][2];
+    ALuint IrSize;
+
+    /* Each bus channel's samples for the filters, following the last
+     * AMBI_HRTF_LENGTH samples of the previous update */
+    ALfloat Input[MAX_AMBI_CHANNELS][AMBI_HRTF_LENGTH+BUFFERSIZE];
+};
+
+/* The vertices of a dodecahedron, used as virtual speakers for HRTF decoding.
+ * They're spread evenly enough to decode second-order exactly. */
+static const ALfloat VirtualSpeakers[20][3] = {
+    {  0.577350f,  0.577350f,  0.577350f }, {  0.577350f,  0.577350f, -0.577350f },
+    {  0.577350f, -0.577350f,  0.577350f }, {  0.577350f, -0.577350f, -0.577350f },
+    { -0.577350f,  0.577350f,  0.577350f }, { -0.577350f,  0.577350f, -0.577350f },
+    { -0.577350f, -0.577350f,  0.577350f }, { -0.577350f, -0.577350f, -0.577350f },
+    {  0.000000f,  0.356822f,  0.934172f }, {  0.000000f,  0.356822f, -0.934172f },
+    {  0.000000f, -0.356822f,  0.934172f }, {  0.000000f, -0.356822f, -0.934172f },
+    {  0.356822f,  0.934172f,  0.000000f }, {  0.356822f, -0.934172f,  0.000000f },
+    { -0.356822f,  0.934172f,  0.000000f }, { -0.356822f, -0.934172f,  0.000000f },
+    {  0.934172f,  0.000000f,  0.356822f }, {  0.934172f,  0.000000f, -0.356822f },
+    { -0.934172f,  0.000000f,  0.356822f }, { -0.934172f,  0.000000f, -0.356822f },
+};
+
+
+/* Calculates the bus gains to encode a source from the given direction with.
+ * The direction is a normalized vector in listener space, with -Z in front.
+ * DirGain scales the directional components, from 0 for no direction to 1 for
+ * a point source. */
+ALvoid aluCalcAmbiCoeffs(const ALCdevice *device, const ALfloat dir[3],
+                         ALfloat DirGain, ALfloat coeffs[MAXCHANNELS])
+{
+    const ALfloat x = dir[0], y = dir[1], z = dir[2];
+    ALuint i;
+
+    for(i = 0;i < MAXCHANNELS;i++)
+        coeffs[i] = 0.0f;
+
+    /* Zeroth order */
+    coeffs[0] = 1.0f;
+    if(device->AmbiOrder < 1)
+        return;
+    /* First order (Y, Z, X). The bus is right-handed with +X in front, +Y to
+     * the left, and +Z up. */
+    coeffs[1] = 1.732050808f * -x * DirGain;
+    coeffs[2] = 1.732050808f *  y * DirGain;
+    coeffs[3] = 1.732050808f * -z * DirGain;
+    if(device->AmbiOrder < 2)
+        return;
+    /* Second order (V, T, R, S, U) */
+    coeffs[4] = 3.872983346f * x * z * DirGain;
+    coeffs[5] = 3.872983346f * -x * y * DirGain;
+    coeffs[6] = 1.118033989f * (3.0f*y*y - 1.0f) * DirGain;
+    coeffs[7] = 3.872983346f * -z * y * DirGain;
+    coeffs[8] = 1.936491673f * (z*z - x*x) * DirGain;
+}
+
+
+/* Gets the direction at the middle of the given segment of a ring, with the
+ * rings splitting the sphere into equal areas. */
+static ALvoid GetSphereDir(ALuint ring, ALuint rings, ALuint seg, ALuint segs,
+                           ALfloat dir[3])
+{
+    ALfloat elev = (ring+0.5f)*(2.0f/rings) - 1.0f;
+    ALfloat radius = aluSqrt(1.0f - elev*elev);
+    ALdouble angle = (seg+0.5)*(2.0*M_PI/segs);
+
+    dir[0] = radius * sin(angle);
+    dir[1] = elev;
+    dir[2] = radius * -cos(angle);
+}
+
+/* Gets the output channel gains the panning table gives a source from the
+ * given direction, the same way CalcSourceParams pans. */
+static ALvoid CalcPanningGains(const ALCdevice *device, const ALfloat dir[3],
+                               ALfloat gains[MAXCHANNELS])
+{
+    const ALfloat *SpeakerGain;
+    ALfloat DirGain, AmbientGain;
+    ALuint i;
+
+    SpeakerGain = device->PanningLUT[aluCart2LUTpos(-dir[2], dir[0])];
+    DirGain = aluSqrt(dir[0]*dir[0] + dir[2]*dir[2]);
+    AmbientGain = aluSqrt(1.0/device->NumChan);
+
+    for(i = 0;i < MAXCHANNELS;i++)
+        gains[i] = 0.0f;
+    for(i = 0;i < device->NumChan;i++)
+    {
+        enum Channel chan = device->Speaker2Chan[i];
+        gains[chan] = lerp(AmbientGain, SpeakerGain[chan], DirGain);
+    }
+}
+
+/* Fits the speaker decoder to the panning table, by projecting each speaker's
+ * panning gains onto the bus channels over the whole sphere. The result is
+ * scaled so the decoded output has as much energy overall as panning would. */
+static ALvoid InitSpeakerDecoder(const ALCdevice *device, struct AmbiDecoder *dec)
+{
+    const ALuint NumAmbi = device->NumDryChannels;
+    ALfloat Decoder[MAX_AMBI_CHANNELS][MAXCHANNELS];
+    ALfloat coeffs[MAXCHANNELS], gains[MAXCHANNELS];
+    ALdouble PanEnergy, DecEnergy;
+    ALfloat dir[3], scale;
+    ALuint pass, r, s, i, k;
+
+    for(k = 0;k < MAX_AMBI_CHANNELS;k++)
+    {
+        for(i = 0;i < MAXCHANNELS;i++)
+            Decoder[k][i] = 0.0f;
+    }
+
+    PanEnergy = DecEnergy = 0.0;
+    for(pass = 0;pass < 2;pass++)
+    {
+        for(r = 0;r < AMBI_RINGS;r++)
+        {
+            for(s = 0;s < AMBI_SEGMENTS;s++)
+            {
+                GetSphereDir(r, AMBI_RINGS, s, AMBI_SEGMENTS, dir);
+                aluCalcAmbiCoeffs(device, dir, 1.0f, coeffs);
+
+                if(pass == 0)
+                {
+                    CalcPanningGains(device, dir, gains);
+                    for(i = 0;i < device->NumChan;i++)
+                    {
+                        enum Channel chan = device->Speaker2Chan[i];
+                        PanEnergy += gains[chan]*gains[chan];
+                        for(k = 0;k < NumAmbi;k++)
+                            Decoder[k][chan] += gains[chan]*coeffs[k];
+                    }
+                }
+                else
+                {
+                    for(i = 0;i < device->NumChan;i++)
+                    {
+                        enum Channel chan = device->Speaker2Chan[i];
+                        ALfloat gain = 0.0f;
+                        for(k = 0;k < NumAmbi;k++)
+                            gain += Decoder[k][chan]*coeffs[k];
+                        DecEnergy += gain*gain;
+                    }
+                }
+            }
+        }
+
+        if(pass == 0)
+        {
+            for(k = 0;k < NumAmbi;k++)
+            {
+                for(i = 0;i < MAXCHANNELS;i++)
+                    Decoder[k][i] /= AMBI_RINGS*AMBI_SEGMENTS;
+            }
+        }
+    }
+
+    scale = (DecEnergy > 0.0) ? aluSqrt(PanEnergy/DecEnergy) : 0.0f;
+    for(k = 0;k < MAX_AMBI_CHANNELS;k++)
+    {
+        for(i = 0;i < MAXCHANNELS;i++)
+            dec->Matrix[k][i] = 0.0f;
+        if(k >= NumAmbi)
+            continue;
+        for(i = 0;i < ChannelsFromDevFmt(device->FmtChans);i++)
+            dec->Matrix[k][i] = Decoder[k][device->DevChannels[i]] * scale;
+    }
+    dec->IrSize = 0;
+}
+
+/* Makes the stereo filters for each bus channel, by decoding it to the
+ * virtual speakers and summing their HRIRs. The HRIRs are offset by their
+ * delays, less the smallest one. The filters are then scaled so sources come
+ * out with as much energy overall as they would with their own HRTF, since
+ * the summed HRIRs partly cancel at higher frequencies. */
+static ALvoid InitHrtfDecoder(ALCdevice *device, struct AmbiDecoder *dec)
+{
+    const ALuint NumSpeakers = sizeof(VirtualSpeakers)/sizeof(VirtualSpeakers[0]);
+    const ALuint NumAmbi = device->NumDryChannels;
+    const ALuint IrSize = GetHrtfIrSize(device->Hrtf);
+    ALfloat hrir[HRIR_LENGTH][2];
+    ALfloat coeffs[MAXCHANNELS];
+    ALdouble HrirEnergy, DecEnergy;
+    ALuint delays[2], minDelay;
+    ALfloat dir[3], scale;
+    ALuint r, s, e, i, k;
+
+    minDelay = ~0u;
+    for(s = 0;s < NumSpeakers;s++)
+    {
+        const ALfloat *spkr = VirtualSpeakers[s];
+        GetLerpedHrtfCoeffs(device->HrtfCache, asin(spkr[1]), atan2(spkr[0], -spkr[2]),
+                            1.0f, hrir, delays);
+        minDelay = minu(minDelay, minu(delays[0]>>16, delays[1]>>16));
+    }
+
+    memset(dec->Coeffs, 0, sizeof(dec->Coeffs));
+    dec->IrSize = 0;
+    for(s = 0;s < NumSpeakers;s++)
+    {
+        const ALfloat *spkr = VirtualSpeakers[s];
+        GetLerpedHrtfCoeffs(device->HrtfCache, asin(spkr[1]), atan2(spkr[0], -spkr[2]),
+                            1.0f, hrir, delays);
+        aluCalcAmbiCoeffs(device, spkr, 1.0f, coeffs);
+
+        for(e = 0;e < 2;e++)
+        {
+            ALuint offset = (delays[e]>>16) - minDelay;
+            for(k = 0;k < NumAmbi;k++)
+            {
+                ALfloat gain = coeffs[k] / NumSpeakers;
+                for(i = 0;i < IrSize;i++)
+                    dec->Coeffs[k][offset+i][e] += hrir[i][e] * gain;
+            }
+            dec->IrSize = maxu(dec->IrSize, offset+IrSize);
+        }
+    }
+
+    /* Drop any trailing taps that ended up silent */
+    while(dec->IrSize > 1)
+    {
+        i = dec->IrSize-1;
+        for(k = 0;k < NumAmbi;k++)
+        {
+            if(dec->Coeffs[k][i][0] != 0.0f || dec->Coeffs[k][i][1] != 0.0f)
+                break;
+        }
+        if(k < NumAmbi)
+            break;
+        dec->IrSize--;
+    }
+
+    HrirEnergy = DecEnergy = 0.0;
+    for(r = 0;r < AMBI_HRTF_RINGS;r++)
+    {
+        for(s = 0;s < AMBI_HRTF_SEGMENTS;s++)
+        {
+            GetSphereDir(r, AMBI_HRTF_RINGS, s, AMBI_HRTF_SEGMENTS, dir);
+            GetLerpedHrtfCoeffs(device->HrtfCache, asin(dir[1]), atan2(dir[0], -dir[2]),
+                                1.0f, hrir, delays);
+            aluCalcAmbiCoeffs(device, dir, 1.0f, coeffs);
+
+            for(i = 0;i < IrSize;i++)
+                HrirEnergy += hrir[i][0]*hrir[i][0] + hrir[i][1]*hrir[i][1];
+            for(i = 0;i < dec->IrSize;i++)
+            {
+                for(e = 0;e < 2;e++)
+                {
+                    ALfloat val = 0.0f;
+                    for(k = 0;k < NumAmbi;k++)
+                        val += dec->Coeffs[k][i][e] * coeffs[k];
+                    DecEnergy += val*val;
+                }
+            }
+        }
+    }
+
+    scale = (DecEnergy > 0.0) ? aluSqrt(HrirEnergy/DecEnergy) : 0.0f;
+    for(k = 0;k < NumAmbi;k++)
+    {
+        for(i = 0;i < dec->IrSize;i++)
+        {
+            dec->Coeffs[k][i][0] *= scale;
+            dec->Coeffs[k][i][1] *= scale;
+        }
+    }
+
+    for(k = 0;k < MAX_AMBI_CHANNELS;k++)
+    {
+        for(i = 0;i < AMBI_HRTF_LENGTH;i++)
+            dec->Input[k][i] = 0.0f;
+    }
+}
+
+
+struct AmbiDecoder *aluCreateAmbiDecoder(void)
+{
+    struct AmbiDecoder *dec = al_malloc(16, sizeof(*dec));
+    if(dec)
+        memset(dec, 0, sizeof(*dec));
+    return dec;
+}
+
+ALvoid aluDestroyAmbiDecoder(struct AmbiDecoder *dec)
+{
+    al_free(dec);
+}
+
+/* Sets up the device's decoder for its output, after the panning table and
+ * HRTF have been. */
+ALvoid aluInitAmbiDecoder(ALCdevice *device)
+{
+    if((device->Flags&DEVICE_USE_HRTF))
+    {
+        InitHrtfDecoder(device, device->AmbiDecoder);
+        TRACE("Decoding order %u ambisonics with %u-tap HRTF filters\n",
+              device->AmbiOrder, device->AmbiDecoder->IrSize);
+    }
+    else
+    {
+        InitSpeakerDecoder(device, device->AmbiDecoder);
+        TRACE("Decoding order %u ambisonics to %s\n", device->AmbiOrder,
+              DevFmtChannelsString(device->FmtChans));
+    }
+}
+
+/* Decodes the ambisonic bus in the dry buffer, adding it to the output. */
+ALvoid aluAmbiDecode(ALCdevice *device, ALuint SamplesToDo)
+{
+    struct AmbiDecoder *dec = device->AmbiDecoder;
+    const ALuint NumAmbi = device->NumDryChannels;
+    ALuint base, todo, i, k;
+
+    if(dec->IrSize == 0)
+    {
+        const ALuint NumOut = ChannelsFromDevFmt(device->FmtChans);
+        for(k = 0;k < NumAmbi;k++)
+            CPUMixers.MixDirect(device->OutBuffer, device->DryBuffer[k],
+                                dec->Matrix[k], NumOut, 0, SamplesToDo);
+        return;
+    }
+
+    for(k = 0;k < NumAmbi;k++)
+        memcpy(&dec->Input[k][AMBI_HRTF_LENGTH], device->DryBuffer[k],
+               SamplesToDo*sizeof(ALfloat));
+
+    for(base = 0;base < SamplesToDo;base += todo)
+    {
+        todo = minu(SamplesToDo-base, AMBI_BLOCK_SIZE);
+        for(k = 0;k < NumAmbi;k++)
+        {
+            const ALfloat *input = &dec->Input[k][AMBI_HRTF_LENGTH+base];
+            for(i = 0;i < dec->IrSize;i++)
+                CPUMixers.MixDirect(device->OutBuffer, input-i,
+                                    dec->Coeffs[k][i], 2, base, todo);
+        }
+    }
+
+    for(k = 0;k < NumAmbi;k++)
+        memmove(dec->Input[k], &dec->Input[k][SamplesToDo],
+                AMBI_HRTF_LENGTH*sizeof(ALfloat));
+}
@@ -898,13 +898,6 @@ static ALCenum alsa_open_capture(ALCdevice *pDevice, const ALCchar *deviceName)
         goto error;
     }
 
-    if((i=snd_pcm_hw_params_get_period_size(p, &bufferSizeInFrames, NULL)) < 0)
-    {
-        ERR("get size failed: %s\n", snd_strerror(i));
-        snd_pcm_hw_params_free(p);
-        goto error;
-    }
-
     snd_pcm_hw_params_free(p);
 
     frameSize = FrameSizeFromDevFmt(pDevice->FmtChans, pDevice->FmtType);
@@ -916,21 +909,12 @@ static ALCenum alsa_open_capture(ALCdevice *pDevice, const ALCchar *deviceName)
         goto error;
     }
 
-    data->size = snd_pcm_frames_to_bytes(data->pcmHandle, bufferSizeInFrames);
-    data->buffer = malloc(data->size);
-    if(!data->buffer)
-    {
-        ERR("buffer malloc failed\n");
-        goto error;
-    }
-
     pDevice->szDeviceName = strdup(deviceName);
 
     pDevice->ExtraData = data;
     return ALC_NO_ERROR;
 
 error:
-    free(data->buffer);
     DestroyRingBuffer(data->ring);
     snd_pcm_close(data->pcmHandle);
     free(data);
@@ -946,7 +930,6 @@ static void alsa_close_capture(ALCdevice *pDevice)
     snd_pcm_close(data->pcmHandle);
     DestroyRingBuffer(data->ring);
 
-    free(data->buffer);
     free(data);
     pDevice->ExtraData = NULL;
 }
@@ -998,12 +981,19 @@ static ALCuint alsa_available_samples(ALCdevice *Device)
     }
     while(avail > 0)
     {
+        RingBufferVector vec[2];
         snd_pcm_sframes_t amt;
 
-        amt = snd_pcm_bytes_to_frames(data->pcmHandle, data->size);
+        /* Read straight into the ring buffer. If it's full, leave the rest
+         * with the device until some is read out. */
+        GetRingBufferWriteVector(data->ring, vec);
+        if(vec[0].len == 0)
+            break;
+
+        amt = vec[0].len;
         if(avail < amt) amt = avail;
 
-        amt = snd_pcm_readi(data->pcmHandle, data->buffer, amt);
+        amt = snd_pcm_readi(data->pcmHandle, vec[0].buf, amt);
         if(amt < 0)
         {
             ERR("read error: %s\n", snd_strerror(amt));
@@ -1027,7 +1017,7 @@ static ALCuint alsa_available_samples(ALCdevice *Device)
             continue;
         }
 
-        WriteRingBuffer(data->ring, data->buffer, amt);
+        AdvanceRingBufferWrite(data->ring, amt);
         avail -= amt;
     }
 
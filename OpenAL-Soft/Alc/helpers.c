@@ -21,9 +21,24 @@
 #include "config.h"
 
 #include <stdlib.h>
+#ifdef HAVE_MALLOC_H
+#include <malloc.h>
+#endif
 #ifdef HAVE_DLFCN_H
 #include <dlfcn.h>
 #endif
+#ifdef HAVE_CPUID_H
+#include <cpuid.h>
+#endif
+#ifdef HAVE_INTRIN_H
+#include <intrin.h>
+#endif
+#ifdef HAVE_LINUX_FUTEX_H
+#include <limits.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#endif
 
 #if defined(HAVE_GUIDDEF_H) || defined(HAVE_INITGUID_H)
 #define INITGUID
@@ -48,6 +63,111 @@ DEFINE_GUID(IID_IAudioRenderClient,   0xf294acfc, 0x3146, 0x4483, 0xa7,0xbf, 0xa
 
 #include "alMain.h"
 
+
+ALuint CPUCapFlags = 0;
+
+/* CPUID bits for the extensions we can use */
+#define CPUID1_EDX_SSE2     (1<<26)
+#define CPUID1_ECX_SSE4_1   (1<<19)
+#define CPUID1_ECX_OSXSAVE  (1<<27)
+#define CPUID1_ECX_AVX      (1<<28)
+#define CPUID7_EBX_AVX2     (1<<5)
+
+#if defined(HAVE_CPUID_H) && (defined(__i386__) || defined(__x86_64__))
+static void get_cpuid(unsigned int func, unsigned int regs[4])
+{
+    __cpuid_count(func, 0, regs[0], regs[1], regs[2], regs[3]);
+}
+
+static unsigned int get_xcr0(void)
+{
+    unsigned int eax, edx;
+    __asm__ __volatile__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return eax;
+}
+#define HAVE_CPUID_FUNC
+#elif defined(HAVE_CPUID_INTRINSIC)
+static void get_cpuid(unsigned int func, unsigned int regs[4])
+{
+    int cpuinf[4];
+    __cpuidex(cpuinf, func, 0);
+    regs[0] = cpuinf[0];
+    regs[1] = cpuinf[1];
+    regs[2] = cpuinf[2];
+    regs[3] = cpuinf[3];
+}
+
+static unsigned int get_xcr0(void)
+{
+    return (unsigned int)_xgetbv(0);
+}
+#define HAVE_CPUID_FUNC
+#endif
+
+void FillCPUCaps(ALuint capfilter)
+{
+    ALuint caps = 0;
+
+#ifdef HAVE_CPUID_FUNC
+    unsigned int regs[4];
+    unsigned int maxfunc;
+
+    get_cpuid(0, regs);
+    maxfunc = regs[0];
+    if(maxfunc >= 1)
+    {
+        get_cpuid(1, regs);
+        if((regs[3]&CPUID1_EDX_SSE2))
+            caps |= CPU_CAP_SSE2;
+        if((regs[2]&CPUID1_ECX_SSE4_1))
+            caps |= CPU_CAP_SSE4_1;
+
+        /* AVX registers are only usable if the OS saves their state (XCR0
+         * bits 1 and 2) */
+        if((regs[2]&CPUID1_ECX_OSXSAVE) && (regs[2]&CPUID1_ECX_AVX) &&
+           (get_xcr0()&0x6) == 0x6 && maxfunc >= 7)
+        {
+            get_cpuid(7, regs);
+            if((regs[1]&CPUID7_EBX_AVX2))
+                caps |= CPU_CAP_AVX2;
+        }
+    }
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON) || defined(__aarch64__)
+    /* The compiler was told it can use NEON anywhere */
+    caps |= CPU_CAP_NEON;
+#elif defined(__arm__) && defined(__linux__)
+    FILE *file = fopen("/proc/cpuinfo", "rt");
+    if(!file)
+        ERR("Failed to open /proc/cpuinfo, cannot check for NEON support\n");
+    else
+    {
+        char buf[1024];
+        while(fgets(buf, sizeof(buf), file) != NULL)
+        {
+            if(strncmp(buf, "Features", 8) != 0)
+                continue;
+            if(strstr(buf, " neon") != NULL)
+                caps |= CPU_CAP_NEON;
+            break;
+        }
+        fclose(file);
+    }
+#endif
+
+    TRACE("Got caps:%s%s%s%s%s\n", ((caps&CPU_CAP_SSE2)?" SSE2":""),
+          ((caps&CPU_CAP_SSE4_1)?" SSE4.1":""), ((caps&CPU_CAP_AVX2)?" AVX2":""),
+          ((caps&CPU_CAP_NEON)?" NEON":""), ((!caps)?" (none)":""));
+    /* The later extensions' methods build on SSE2, so they go with it */
+    if(!(capfilter&CPU_CAP_SSE2))
+        capfilter &= ~(CPU_CAP_SSE4_1|CPU_CAP_AVX2);
+    caps &= capfilter;
+    TRACE("Using caps:%s%s%s%s%s\n", ((caps&CPU_CAP_SSE2)?" SSE2":""),
+          ((caps&CPU_CAP_SSE4_1)?" SSE4.1":""), ((caps&CPU_CAP_AVX2)?" AVX2":""),
+          ((caps&CPU_CAP_NEON)?" NEON":""), ((!caps)?" (none)":""));
+    CPUCapFlags = caps;
+}
+
+
 #ifdef _WIN32
 void pthread_once(pthread_once_t *once, void (*callback)(void))
 {
@@ -227,6 +347,48 @@ void al_print(const char *func, const char *fmt, ...)
 }
 
 
+void *al_malloc(size_t alignment, size_t size)
+{
+#if defined(HAVE_POSIX_MEMALIGN)
+    void *ret;
+    if(posix_memalign(&ret, alignment, size) == 0)
+        return ret;
+    return NULL;
+#elif defined(HAVE__ALIGNED_MALLOC)
+    return _aligned_malloc(size, alignment);
+#else
+    /* Over-allocate and store the offset back to the real allocation in the
+     * padding just before the returned pointer. */
+    char *ret = malloc(size+alignment);
+    if(ret != NULL)
+    {
+        *(ret++) = 0x00;
+        while(((size_t)ret&(alignment-1)) != 0)
+            *(ret++) = 0x55;
+    }
+    return ret;
+#endif
+}
+
+void al_free(void *ptr)
+{
+#if defined(HAVE_POSIX_MEMALIGN)
+    free(ptr);
+#elif defined(HAVE__ALIGNED_MALLOC)
+    _aligned_free(ptr);
+#else
+    if(ptr != NULL)
+    {
+        char *finder = ptr;
+        do {
+            --finder;
+        } while(*finder == 0x55);
+        free(finder);
+    }
+#endif
+}
+
+
 void SetRTPriority(void)
 {
     ALboolean failed = AL_FALSE;
@@ -252,59 +414,133 @@ void SetRTPriority(void)
 }
 
 
-static void Lock(volatile ALenum *l)
+/* How many times to retry a contended lock before going to sleep */
+#define RWLOCK_SPIN_COUNT 100
+
+static __inline void CPUPause(void)
+{
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+    __asm__ __volatile__("pause");
+#elif defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+    YieldProcessor();
+#endif
+}
+
+/* Sleeps until the lock's sequence count changes from seq, or returns right
+ * away if it already has. */
+static void WaitRWLock(RWLock *lock, RefCount seq)
 {
-    while(ExchangeInt(l, AL_TRUE) == AL_TRUE)
+    IncrementRef(&lock->sleepers);
+    IncrementRef(&lock->sleeps);
+#ifdef HAVE_LINUX_FUTEX_H
+    syscall(SYS_futex, &lock->seq, FUTEX_WAIT_PRIVATE, seq, NULL, NULL, 0);
+#else
+    if(lock->seq == seq)
         Sleep(0);
+#endif
+    DecrementRef(&lock->sleepers);
 }
 
-static void Unlock(volatile ALenum *l)
+/* Lets sleeping threads check the lock again */
+static void WakeRWLock(RWLock *lock)
 {
-    ExchangeInt(l, AL_FALSE);
+    IncrementRef(&lock->seq);
+#ifdef HAVE_LINUX_FUTEX_H
+    if(lock->sleepers > 0)
+        syscall(SYS_futex, &lock->seq, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+#endif
 }
 
 void RWLockInit(RWLock *lock)
 {
-    lock->read_count = 0;
-    lock->write_count = 0;
-    lock->read_lock = AL_FALSE;
-    lock->read_entry_lock = AL_FALSE;
-    lock->write_lock = AL_FALSE;
+    lock->state = 0;
+    lock->writers = 0;
+    lock->seq = 0;
+    lock->sleepers = 0;
+    lock->read_waits = 0;
+    lock->write_waits = 0;
+    lock->sleeps = 0;
 }
 
 void ReadLock(RWLock *lock)
 {
-    Lock(&lock->read_entry_lock);
-    Lock(&lock->read_lock);
-    if(IncrementRef(&lock->read_count) == 1)
-        Lock(&lock->write_lock);
-    Unlock(&lock->read_lock);
-    Unlock(&lock->read_entry_lock);
+    ALuint spins = 0;
+    RefCount seq;
+    int state;
+
+    while(1)
+    {
+        /* Get the sequence count before checking the lock, so a release after
+         * the check will stop the wait */
+        seq = lock->seq;
+        if(lock->writers == 0)
+        {
+            state = lock->state;
+            if(state >= 0)
+            {
+                if(CompExchangeInt(&lock->state, state, state+1))
+                    break;
+                /* Lost a race with another reader, so just try again */
+                continue;
+            }
+        }
+
+        if(spins++ == 0)
+            IncrementRef(&lock->read_waits);
+        if(spins < RWLOCK_SPIN_COUNT)
+            CPUPause();
+        else
+            WaitRWLock(lock, seq);
+    }
 }
 
 void ReadUnlock(RWLock *lock)
 {
-    if(DecrementRef(&lock->read_count) == 0)
-        Unlock(&lock->write_lock);
+    /* The last reader out lets a waiting writer in */
+    if(DecrementRef((volatile RefCount*)&lock->state) == 0 && lock->writers > 0)
+        WakeRWLock(lock);
 }
 
 void WriteLock(RWLock *lock)
 {
-    if(IncrementRef(&lock->write_count) == 1)
-        Lock(&lock->read_lock);
-     Lock(&lock->write_lock);
+    ALuint spins = 0;
+    RefCount seq;
+
+    IncrementRef(&lock->writers);
+    while(1)
+    {
+        seq = lock->seq;
+        if(CompExchangeInt(&lock->state, 0, -1))
+            break;
+
+        if(spins++ == 0)
+            IncrementRef(&lock->write_waits);
+        if(spins < RWLOCK_SPIN_COUNT)
+            CPUPause();
+        else
+            WaitRWLock(lock, seq);
+    }
 }
 
 void WriteUnlock(RWLock *lock)
 {
-    Unlock(&lock->write_lock);
-    if(DecrementRef(&lock->write_count) == 0)
-        Unlock(&lock->read_lock);
+    ExchangeInt(&lock->state, 0);
+    DecrementRef(&lock->writers);
+    WakeRWLock(lock);
+}
+
+void RWLockTraceStats(const RWLock *lock, const char *name)
+{
+    if(lock->read_waits || lock->write_waits)
+        TRACE("%s lock: %u contended reads, %u contended writes, %u sleeps\n",
+              name, (ALuint)lock->read_waits, (ALuint)lock->write_waits,
+              (ALuint)lock->sleeps);
 }
 
 
 void InitUIntMap(UIntMap *map, ALsizei limit)
 {
+    map->blocks = NULL;
     map->array = NULL;
     map->size = 0;
     map->maxsize = 0;
@@ -314,7 +550,17 @@ void InitUIntMap(UIntMap *map, ALsizei limit)
 
 void ResetUIntMap(UIntMap *map)
 {
+    ALuint i;
+
+    RWLockTraceStats(&map->lock, "Map");
     WriteLock(&map->lock);
+    if(map->blocks)
+    {
+        for(i = 0;i < UINTMAP_MAX_BLOCKS;i++)
+            free(map->blocks[i]);
+        free((void*)map->blocks);
+    }
+    map->blocks = NULL;
     free(map->array);
     map->array = NULL;
     map->size = 0;
@@ -322,60 +568,119 @@ void ResetUIntMap(UIntMap *map)
     WriteUnlock(&map->lock);
 }
 
+/* Returns the entry for the given key's index, or NULL if its block doesn't
+ * exist and create is false. Must be called with the write lock held if
+ * creating. */
+static UIntMapEntry *GetUIntMapEntry(UIntMap *map, ALuint key, ALboolean create)
+{
+    UIntMapEntry *volatile *blocks = map->blocks;
+    ALuint idx = key & NAME_INDEX_MASK;
+    UIntMapEntry *block;
+
+    if(!blocks)
+    {
+        if(!create)
+            return NULL;
+        blocks = calloc(UINTMAP_MAX_BLOCKS, sizeof(blocks[0]));
+        if(!blocks)
+            return NULL;
+        ExchangePtr((void**)&map->blocks, (void*)blocks);
+    }
+
+    block = blocks[idx>>UINTMAP_BLOCK_BITS];
+    if(!block)
+    {
+        if(!create)
+            return NULL;
+        block = calloc(UINTMAP_BLOCK_SIZE, sizeof(block[0]));
+        if(!block)
+            return NULL;
+        ExchangePtr((void**)&blocks[idx>>UINTMAP_BLOCK_BITS], block);
+    }
+
+    return &block[idx&UINTMAP_BLOCK_MASK];
+}
+
+/* Removes an entry that's in use, moving the last one in the array into its
+ * place. Must be called with the write lock held. */
+static ALvoid *ClearUIntMapEntry(UIntMap *map, UIntMapEntry *entry)
+{
+    ALvoid *ptr = ExchangePtr((void**)&entry->value, NULL);
+    ALsizei pos = entry->pos;
+
+    map->size--;
+    if(pos < map->size)
+    {
+        UIntMapEntry *last = GetUIntMapEntry(map, map->array[map->size].key, AL_FALSE);
+        map->array[pos] = map->array[map->size];
+        last->pos = pos;
+    }
+    return ptr;
+}
+
 ALenum InsertUIntMapEntry(UIntMap *map, ALuint key, ALvoid *value)
 {
-    ALsizei pos = 0;
+    UIntMapEntry *entry;
 
     WriteLock(&map->lock);
-    if(map->size == map->limit)
+    entry = GetUIntMapEntry(map, key, AL_TRUE);
+    if(!entry)
     {
         WriteUnlock(&map->lock);
         return AL_OUT_OF_MEMORY;
     }
 
-    if(map->size > 0)
+    if(entry->value)
     {
-        ALsizei low = 0;
-        ALsizei high = map->size - 1;
-        while(low < high)
+        /* Replace the existing entry. A NULL value removes it. */
+        if(!value)
+            ClearUIntMapEntry(map, entry);
+        else
         {
-            ALsizei mid = low + (high-low)/2;
-            if(map->array[mid].key < key)
-                low = mid + 1;
-            else
-                high = mid;
+            entry->key = key;
+            ExchangePtr((void**)&entry->value, value);
+            map->array[entry->pos].key = key;
+            map->array[entry->pos].value = value;
         }
-        if(map->array[low].key < key)
-            low++;
-        pos = low;
+        WriteUnlock(&map->lock);
+        return AL_NO_ERROR;
+    }
+    if(!value)
+    {
+        WriteUnlock(&map->lock);
+        return AL_NO_ERROR;
     }
 
-    if(pos == map->size || map->array[pos].key != key)
+    if(map->size == map->limit)
     {
-        if(map->size == map->maxsize)
-        {
-            ALvoid *temp = NULL;
-            ALsizei newsize;
+        WriteUnlock(&map->lock);
+        return AL_OUT_OF_MEMORY;
+    }
+    if(map->size == map->maxsize)
+    {
+        ALvoid *temp = NULL;
+        ALsizei newsize;
 
-            newsize = (map->maxsize ? (map->maxsize<<1) : 4);
-            if(newsize >= map->maxsize)
-                temp = realloc(map->array, newsize*sizeof(map->array[0]));
-            if(!temp)
-            {
-                WriteUnlock(&map->lock);
-                return AL_OUT_OF_MEMORY;
-            }
-            map->array = temp;
-            map->maxsize = newsize;
+        newsize = (map->maxsize ? (map->maxsize<<1) : 4);
+        if(newsize >= map->maxsize)
+            temp = realloc(map->array, newsize*sizeof(map->array[0]));
+        if(!temp)
+        {
+            WriteUnlock(&map->lock);
+            return AL_OUT_OF_MEMORY;
         }
-
-        map->size++;
-        if(pos < map->size-1)
-            memmove(&map->array[pos+1], &map->array[pos],
-                    (map->size-1-pos)*sizeof(map->array[0]));
+        map->array = temp;
+        map->maxsize = newsize;
     }
-    map->array[pos].key = key;
-    map->array[pos].value = value;
+
+    entry->pos = map->size++;
+    map->array[entry->pos].key = key;
+    map->array[entry->pos].value = value;
+
+    /* Set the key before the value, so a lookup that sees the new value
+     * can't match it with the old key. */
+    entry->key = key;
+    ExchangePtr((void**)&entry->value, value);
     WriteUnlock(&map->lock);
 
     return AL_NO_ERROR;
@@ -383,78 +688,34 @@ ALenum InsertUIntMapEntry(UIntMap *map, ALuint key, ALvoid *value)
 
 void RemoveUIntMapKey(UIntMap *map, ALuint key)
 {
-    WriteLock(&map->lock);
-    if(map->size > 0)
-    {
-        ALsizei low = 0;
-        ALsizei high = map->size - 1;
-        while(low < high)
-        {
-            ALsizei mid = low + (high-low)/2;
-            if(map->array[mid].key < key)
-                low = mid + 1;
-            else
-                high = mid;
-        }
-        if(map->array[low].key == key)
-        {
-            if(low < map->size-1)
-                memmove(&map->array[low], &map->array[low+1],
-                        (map->size-1-low)*sizeof(map->array[0]));
-            map->size--;
-        }
-    }
-    WriteUnlock(&map->lock);
+    PopUIntMapValue(map, key);
 }
 
 ALvoid *LookupUIntMapKey(UIntMap *map, ALuint key)
 {
-    ALvoid *ptr = NULL;
-    ReadLock(&map->lock);
-    if(map->size > 0)
-    {
-        ALsizei low = 0;
-        ALsizei high = map->size - 1;
-        while(low < high)
-        {
-            ALsizei mid = low + (high-low)/2;
-            if(map->array[mid].key < key)
-                low = mid + 1;
-            else
-                high = mid;
-        }
-        if(map->array[low].key == key)
-            ptr = map->array[low].value;
-    }
-    ReadUnlock(&map->lock);
+    UIntMapEntry *entry;
+    ALvoid *ptr;
+
+    entry = GetUIntMapEntry(map, key, AL_FALSE);
+    if(!entry)
+        return NULL;
+
+    /* Read the value before the key, the opposite order they're set in */
+    ptr = entry->value;
+    if(entry->key != key)
+        return NULL;
     return ptr;
 }
 
 ALvoid *PopUIntMapValue(UIntMap *map, ALuint key)
 {
+    UIntMapEntry *entry;
     ALvoid *ptr = NULL;
+
     WriteLock(&map->lock);
-    if(map->size > 0)
-    {
-        ALsizei low = 0;
-        ALsizei high = map->size - 1;
-        while(low < high)
-        {
-            ALsizei mid = low + (high-low)/2;
-            if(map->array[mid].key < key)
-                low = mid + 1;
-            else
-                high = mid;
-        }
-        if(map->array[low].key == key)
-        {
-            ptr = map->array[low].value;
-            if(low < map->size-1)
-                memmove(&map->array[low], &map->array[low+1],
-                        (map->size-1-low)*sizeof(map->array[0]));
-            map->size--;
-        }
-    }
+    entry = GetUIntMapEntry(map, key, AL_FALSE);
+    if(entry && entry->value && entry->key == key)
+        ptr = ClearUIntMapEntry(map, entry);
     WriteUnlock(&map->lock);
     return ptr;
 }
@@ -20,63 +20,164 @@
 
 #include "config.h"
 
+#include <stdlib.h>
+
 #include "AL/al.h"
 #include "AL/alc.h"
 #include "alMain.h"
 #include "alSource.h"
 
 /* External HRTF file format (LE byte order):
+ *
+ * ALchar   magic[8] = "MinPHR01";
+ * ALuint   sampleRate;
+ *
+ * ALubyte  hrirSize;  // Counted in samples, 8 to 128 in steps of 8
+ * ALubyte  evCount;   // 5 to 128
+ *
+ * ALubyte  azCount[evCount]; // Each between 1 and 128
+ *
+ * ALshort  coefficients[hrirCount][hrirSize];
+ * ALubyte  delays[hrirCount]; // Each between 0 and 63
+ *
+ * The elevations are evenly spaced from -90 (below) to +90 (above) degrees,
+ * and each elevation's azimuths are evenly spaced clockwise from the front,
+ * so hrirCount is the sum of the azimuth counts. The older MinPHR00 format
+ * is also accepted:
  *
  * ALchar   magic[8] = "MinPHR00";
  * ALuint   sampleRate;
  *
- * ALushort hrirCount; // Required value: 828
- * ALushort hrirSize;  // Required value: 32
- * ALubyte  evCount;   // Required value: 19
+ * ALushort hrirCount;
+ * ALushort hrirSize;
+ * ALubyte  evCount;
  *
- * ALushort evOffset[evCount]; // Required values:
- *   { 0, 1, 13, 37, 73, 118, 174, 234, 306, 378, 450, 522, 594, 654, 710, 755, 791, 815, 827 }
+ * ALushort evOffset[evCount]; // Index of each elevation's first HRIR
  *
- * ALushort coefficients[hrirCount][hrirSize];
- * ALubyte  delays[hrirCount]; // Element values must not exceed 127
+ * ALshort  coefficients[hrirCount][hrirSize];
+ * ALubyte  delays[hrirCount];
  */
 
-static const ALchar magicMarker[8] = "MinPHR00";
+static const ALchar magicMarker00[8] = "MinPHR00";
+static const ALchar magicMarker01[8] = "MinPHR01";
+
+/* HRIR sizes need to be a multiple of MOD_IR_SIZE, as the mixers handle
+ * taps in pairs */
+#define MIN_IR_SIZE  (8)
+#define MOD_IR_SIZE  (8)
 
-#define HRIR_COUNT 828
-#define ELEV_COUNT 19
+#define MIN_RATE     (8000)
+#define MAX_RATE     (192000)
 
-static const ALushort evOffset[ELEV_COUNT] = { 0, 1, 13, 37, 73, 118, 174, 234, 306, 378, 450, 522, 594, 654, 710, 755, 791, 815, 827 };
-static const ALubyte azCount[ELEV_COUNT] = { 1, 12, 24, 36, 45, 56, 60, 72, 72, 72, 72, 72, 60, 56, 45, 36, 24, 12, 1 };
+#define MIN_EV_COUNT (5)
+#define MAX_EV_COUNT (128)
 
-static struct Hrtf {
+#define MIN_AZ_COUNT (1)
+#define MAX_AZ_COUNT (128)
+
+/* Number of sinc zero crossings on either side of the filter used to
+ * resample HRIRs */
+#define HRIR_RESAMPLE_ZEROS 8
+
+struct Hrtf {
     ALuint sampleRate;
-    ALshort coeffs[HRIR_COUNT][HRIR_LENGTH];
-    ALubyte delays[HRIR_COUNT];
-} Hrtf = {
-    44100,
+    ALuint irSize;
+    ALubyte evCount;
+
+    ALubyte *azCount;
+    ALushort *evOffset;
+    ALshort *coeffs;
+    ALubyte *delays;
+
+    struct Hrtf *next;
+};
+
+/* The built-in data set */
+#define DEFAULT_IR_SIZE  32
+#define DEFAULT_IR_COUNT 828
+#define DEFAULT_EV_COUNT 19
+
+static ALubyte defaultAzCount[DEFAULT_EV_COUNT] = { 1, 12, 24, 36, 45, 56, 60, 72, 72, 72, 72, 72, 60, 56, 45, 36, 24, 12, 1 };
+static ALushort defaultEvOffset[DEFAULT_EV_COUNT] = { 0, 1, 13, 37, 73, 118, 174, 234, 306, 378, 450, 522, 594, 654, 710, 755, 791, 815, 827 };
+
+static struct {
+    ALshort coeffs[DEFAULT_IR_COUNT][DEFAULT_IR_SIZE];
+    ALubyte delays[DEFAULT_IR_COUNT];
+} DefaultHrtfData = {
 #include "hrtf_tables.inc"
 };
 
+static struct Hrtf DefaultHrtf = {
+    44100, DEFAULT_IR_SIZE, DEFAULT_EV_COUNT,
+    defaultAzCount, defaultEvOffset,
+    &DefaultHrtfData.coeffs[0][0], DefaultHrtfData.delays,
+    NULL
+};
+
+/* The data set every device uses, either the built-in one or one loaded from
+ * the hrtf_tables file */
+static struct Hrtf *LoadedHrtf = &DefaultHrtf;
+
+/* Tables resampled from LoadedHrtf for devices running at other rates. These
+ * are only made when a device is reset, which happens with the device list
+ * locked. */
+static struct Hrtf *ResampledHrtfs = NULL;
+
+/* Directions are quantized to a third of a degree or so for looking up
+ * interpolated HRIRs in a device's cache, well under what the data sets
+ * resolve. Elevations are counted from -90 to +90 degrees inclusive, and
+ * azimuths clockwise from the front. */
+#define CACHE_EV_STEPS  (512)
+#define CACHE_AZ_BITS   (10)
+#define CACHE_AZ_STEPS  (1<<CACHE_AZ_BITS)
+
+#define HRTF_CACHE_SIZE    (256)
+#define HRTF_BUCKET_BITS   (8)
+#define HRTF_CACHE_NONE    HRTF_CACHE_SIZE
+
+typedef struct HrtfCacheEntry {
+    ALuint key;
+    ALuint delays[2];
+    // Neighbors in the order of use, most recent first
+    ALuint prev, next;
+    // Next entry in the same hash bucket
+    ALuint chain;
+    // Unattenuated coefficients, normalized to +/-1
+    ALfloat (*coeffs)[2];
+} HrtfCacheEntry;
+
+/* The interpolated HRIRs a device used most recently. It's only used for
+ * calculating source parameters, with the device locked, or with its
+ * ParamsLock held when the app's thread calculates them. */
+struct HrtfCache {
+    const struct Hrtf *hrtf;
+    ALuint hits, misses;
+
+    ALuint count;
+    ALuint first, last;
+    ALuint buckets[1<<HRTF_BUCKET_BITS];
+    HrtfCacheEntry entries[HRTF_CACHE_SIZE];
+};
+
 // Calculate the elevation indices given the polar elevation in radians.
-// This will return two indices between 0 and (ELEV_COUNT-1) and an
+// This will return two indices between 0 and (evCount-1) and an
 // interpolation factor between 0.0 and 1.0.
-static void CalcEvIndices(ALfloat ev, ALuint *evidx, ALfloat *evmu)
+static void CalcEvIndices(ALuint evCount, ALfloat ev, ALuint *evidx, ALfloat *evmu)
 {
-    ev = (M_PI/2.0f + ev) * (ELEV_COUNT-1) / M_PI;
+    ev = (M_PI/2.0f + ev) * (evCount-1) / M_PI;
     evidx[0] = (ALuint)ev;
-    evidx[1] = minu(evidx[0] + 1, ELEV_COUNT-1);
+    evidx[1] = minu(evidx[0] + 1, evCount-1);
     *evmu = ev - evidx[0];
 }
 
 // Calculate the azimuth indices given the polar azimuth in radians.  This
-// will return two indices between 0 and (azCount [ei] - 1) and an
-// interpolation factor between 0.0 and 1.0.
-static void CalcAzIndices(ALuint evidx, ALfloat az, ALuint *azidx, ALfloat *azmu)
+// will return two indices between 0 and (azCount-1) and an interpolation
+// factor between 0.0 and 1.0.
+static void CalcAzIndices(ALuint azCount, ALfloat az, ALuint *azidx, ALfloat *azmu)
 {
-    az = (M_PI*2.0f + az) * azCount[evidx] / (M_PI*2.0f);
-    azidx[0] = (ALuint)az % azCount[evidx];
-    azidx[1] = (azidx[0] + 1) % azCount[evidx];
+    az = (M_PI*2.0f + az) * azCount / (M_PI*2.0f);
+    azidx[0] = (ALuint)az % azCount;
+    azidx[1] = (azidx[0] + 1) % azCount;
     *azmu = az - floor(az);
 }
 
@@ -112,11 +213,10 @@ ALfloat CalcHrtfDelta(ALfloat oldGain, ALfloat newGain, const ALfloat olddir[3],
     return clampf(angleChange*2.0f, gainChange*2.0f, 1.0f);
 }
 
-// Calculates static HRIR coefficients and delays for the given polar
-// elevation and azimuth in radians.  Linear interpolation is used to
-// increase the apparent resolution of the HRIR dataset.  The coefficients
-// are also normalized and attenuated by the specified gain.
-void GetLerpedHrtfCoeffs(ALfloat elevation, ALfloat azimuth, ALfloat gain, ALfloat (*coeffs)[2], ALuint *delays)
+// Calculates the HRIR coefficients and delays for the given polar elevation
+// and azimuth in radians.  Linear interpolation is used to increase the
+// apparent resolution of the HRIR dataset.
+static void CalcLerpedHrir(const struct Hrtf *Hrtf, ALfloat elevation, ALfloat azimuth, ALfloat (*coeffs)[2], ALuint *delays)
 {
     ALuint evidx[2], azidx[2];
     ALfloat mu[3];
@@ -124,127 +224,189 @@ void GetLerpedHrtfCoeffs(ALfloat elevation, ALfloat azimuth, ALfloat gain, ALflo
     ALuint i;
 
     // Claculate elevation indices and interpolation factor.
-    CalcEvIndices(elevation, evidx, &mu[2]);
+    CalcEvIndices(Hrtf->evCount, elevation, evidx, &mu[2]);
 
     // Calculate azimuth indices and interpolation factor for the first
     // elevation.
-    CalcAzIndices(evidx[0], azimuth, azidx, &mu[0]);
+    CalcAzIndices(Hrtf->azCount[evidx[0]], azimuth, azidx, &mu[0]);
 
     // Calculate the first set of linear HRIR indices for left and right
     // channels.
-    lidx[0] = evOffset[evidx[0]] + azidx[0];
-    lidx[1] = evOffset[evidx[0]] + azidx[1];
-    ridx[0] = evOffset[evidx[0]] + ((azCount[evidx[0]]-azidx[0]) % azCount[evidx[0]]);
-    ridx[1] = evOffset[evidx[0]] + ((azCount[evidx[0]]-azidx[1]) % azCount[evidx[0]]);
+    lidx[0] = Hrtf->evOffset[evidx[0]] + azidx[0];
+    lidx[1] = Hrtf->evOffset[evidx[0]] + azidx[1];
+    ridx[0] = Hrtf->evOffset[evidx[0]] + ((Hrtf->azCount[evidx[0]]-azidx[0]) % Hrtf->azCount[evidx[0]]);
+    ridx[1] = Hrtf->evOffset[evidx[0]] + ((Hrtf->azCount[evidx[0]]-azidx[1]) % Hrtf->azCount[evidx[0]]);
 
     // Calculate azimuth indices and interpolation factor for the second
     // elevation.
-    CalcAzIndices(evidx[1], azimuth, azidx, &mu[1]);
+    CalcAzIndices(Hrtf->azCount[evidx[1]], azimuth, azidx, &mu[1]);
 
     // Calculate the second set of linear HRIR indices for left and right
     // channels.
-    lidx[2] = evOffset[evidx[1]] + azidx[0];
-    lidx[3] = evOffset[evidx[1]] + azidx[1];
-    ridx[2] = evOffset[evidx[1]] + ((azCount[evidx[1]]-azidx[0]) % azCount[evidx[1]]);
-    ridx[3] = evOffset[evidx[1]] + ((azCount[evidx[1]]-azidx[1]) % azCount[evidx[1]]);
-
-    // Calculate the normalized and attenuated HRIR coefficients using linear
-    // interpolation when there is enough gain to warrant it.  Zero the
-    // coefficients if gain is too low.
+    lidx[2] = Hrtf->evOffset[evidx[1]] + azidx[0];
+    lidx[3] = Hrtf->evOffset[evidx[1]] + azidx[1];
+    ridx[2] = Hrtf->evOffset[evidx[1]] + ((Hrtf->azCount[evidx[1]]-azidx[0]) % Hrtf->azCount[evidx[1]]);
+    ridx[3] = Hrtf->evOffset[evidx[1]] + ((Hrtf->azCount[evidx[1]]-azidx[1]) % Hrtf->azCount[evidx[1]]);
+
+    // Calculate the normalized HRIR coefficients using linear interpolation.
+    for(i = 0;i < Hrtf->irSize;i++)
+    {
+        coeffs[i][0] = lerp(lerp(Hrtf->coeffs[lidx[0]*Hrtf->irSize + i], Hrtf->coeffs[lidx[1]*Hrtf->irSize + i], mu[0]),
+                            lerp(Hrtf->coeffs[lidx[2]*Hrtf->irSize + i], Hrtf->coeffs[lidx[3]*Hrtf->irSize + i], mu[1]),
+                            mu[2]) * (1.0/32767.0);
+        coeffs[i][1] = lerp(lerp(Hrtf->coeffs[ridx[0]*Hrtf->irSize + i], Hrtf->coeffs[ridx[1]*Hrtf->irSize + i], mu[0]),
+                            lerp(Hrtf->coeffs[ridx[2]*Hrtf->irSize + i], Hrtf->coeffs[ridx[3]*Hrtf->irSize + i], mu[1]),
+                            mu[2]) * (1.0/32767.0);
+    }
+
+    // Calculate the HRIR delays using linear interpolation.
+    delays[0] = (ALuint)(lerp(lerp(Hrtf->delays[lidx[0]], Hrtf->delays[lidx[1]], mu[0]),
+                              lerp(Hrtf->delays[lidx[2]], Hrtf->delays[lidx[3]], mu[1]),
+                              mu[2]) * 65536.0f);
+    delays[1] = (ALuint)(lerp(lerp(Hrtf->delays[ridx[0]], Hrtf->delays[ridx[1]], mu[0]),
+                              lerp(Hrtf->delays[ridx[2]], Hrtf->delays[ridx[3]], mu[1]),
+                              mu[2]) * 65536.0f);
+}
+
+// Finds the interpolated HRIR for the given polar elevation and azimuth in
+// radians, once quantized, calculating it in place of the least recently
+// used one if it's not in the cache.
+static const HrtfCacheEntry *GetCachedHrir(struct HrtfCache *Cache, ALfloat elevation, ALfloat azimuth)
+{
+    HrtfCacheEntry *entry;
+    ALuint key, bucket, idx, *link;
+    ALint ev, az;
+
+    ev = (ALint)floor((elevation + M_PI/2.0) * (CACHE_EV_STEPS/M_PI) + 0.5);
+    az = (ALint)floor(azimuth * (CACHE_AZ_STEPS/(M_PI*2.0)) + 0.5);
+    key = ((ALuint)clampi(ev, 0, CACHE_EV_STEPS) << CACHE_AZ_BITS) |
+          ((ALuint)az & (CACHE_AZ_STEPS-1));
+    bucket = (key*2654435761u) >> (32-HRTF_BUCKET_BITS);
+
+    idx = Cache->buckets[bucket];
+    while(idx != HRTF_CACHE_NONE && Cache->entries[idx].key != key)
+        idx = Cache->entries[idx].chain;
+
+    if(idx != HRTF_CACHE_NONE)
+    {
+        Cache->hits++;
+        entry = &Cache->entries[idx];
+        if(Cache->first == idx)
+            return entry;
+
+        // Move it to the front of the use order
+        Cache->entries[entry->prev].next = entry->next;
+        if(entry->next != HRTF_CACHE_NONE)
+            Cache->entries[entry->next].prev = entry->prev;
+        else
+            Cache->last = entry->prev;
+    }
+    else
+    {
+        Cache->misses++;
+        if(Cache->count < HRTF_CACHE_SIZE)
+            idx = Cache->count++;
+        else
+        {
+            // Take over the least recently used entry, first removing it
+            // from its bucket and the use order
+            idx = Cache->last;
+            entry = &Cache->entries[idx];
+            link = &Cache->buckets[(entry->key*2654435761u) >> (32-HRTF_BUCKET_BITS)];
+            while(*link != idx)
+                link = &Cache->entries[*link].chain;
+            *link = entry->chain;
+
+            Cache->last = entry->prev;
+            if(Cache->first == idx)
+                Cache->first = HRTF_CACHE_NONE;
+            else
+                Cache->entries[Cache->last].next = HRTF_CACHE_NONE;
+        }
+
+        entry = &Cache->entries[idx];
+        entry->key = key;
+        entry->chain = Cache->buckets[bucket];
+        Cache->buckets[bucket] = idx;
+
+        CalcLerpedHrir(Cache->hrtf, (ALfloat)(ev*M_PI/CACHE_EV_STEPS - M_PI/2.0),
+                       (ALfloat)(az*(M_PI*2.0)/CACHE_AZ_STEPS),
+                       entry->coeffs, entry->delays);
+        if(Cache->first == HRTF_CACHE_NONE)
+            Cache->last = idx;
+    }
+
+    entry->prev = HRTF_CACHE_NONE;
+    entry->next = Cache->first;
+    if(Cache->first != HRTF_CACHE_NONE)
+        Cache->entries[Cache->first].prev = idx;
+    Cache->first = idx;
+
+    return entry;
+}
+
+// Calculates static HRIR coefficients and delays for the given polar
+// elevation and azimuth in radians.  The coefficients are also attenuated by
+// the specified gain.
+void GetLerpedHrtfCoeffs(struct HrtfCache *Cache, ALfloat elevation, ALfloat azimuth, ALfloat gain, ALfloat (*coeffs)[2], ALuint *delays)
+{
+    const HrtfCacheEntry *hrir = GetCachedHrir(Cache, elevation, azimuth);
+    const ALuint irSize = Cache->hrtf->irSize;
+    ALuint i;
+
+    // Attenuate the HRIR coefficients when there is enough gain to warrant
+    // it.  Zero the coefficients if gain is too low.
     if(gain > 0.0001f)
     {
-        ALdouble scale = gain * (1.0/32767.0);
-        for(i = 0;i < HRIR_LENGTH;i++)
+        for(i = 0;i < irSize;i++)
         {
-            coeffs[i][0] = lerp(lerp(Hrtf.coeffs[lidx[0]][i], Hrtf.coeffs[lidx[1]][i], mu[0]),
-                                lerp(Hrtf.coeffs[lidx[2]][i], Hrtf.coeffs[lidx[3]][i], mu[1]),
-                                mu[2]) * scale;
-            coeffs[i][1] = lerp(lerp(Hrtf.coeffs[ridx[0]][i], Hrtf.coeffs[ridx[1]][i], mu[0]),
-                                lerp(Hrtf.coeffs[ridx[2]][i], Hrtf.coeffs[ridx[3]][i], mu[1]),
-                                mu[2]) * scale;
+            coeffs[i][0] = hrir->coeffs[i][0] * gain;
+            coeffs[i][1] = hrir->coeffs[i][1] * gain;
         }
     }
     else
     {
-        for(i = 0;i < HRIR_LENGTH;i++)
+        for(i = 0;i < irSize;i++)
         {
             coeffs[i][0] = 0.0f;
             coeffs[i][1] = 0.0f;
         }
     }
 
-    // Calculate the HRIR delays using linear interpolation.
-    delays[0] = (ALuint)(lerp(lerp(Hrtf.delays[lidx[0]], Hrtf.delays[lidx[1]], mu[0]),
-                              lerp(Hrtf.delays[lidx[2]], Hrtf.delays[lidx[3]], mu[1]),
-                              mu[2]) * 65536.0f);
-    delays[1] = (ALuint)(lerp(lerp(Hrtf.delays[ridx[0]], Hrtf.delays[ridx[1]], mu[0]),
-                              lerp(Hrtf.delays[ridx[2]], Hrtf.delays[ridx[3]], mu[1]),
-                              mu[2]) * 65536.0f);
+    delays[0] = hrir->delays[0];
+    delays[1] = hrir->delays[1];
 }
 
 // Calculates the moving HRIR target coefficients, target delays, and
 // stepping values for the given polar elevation and azimuth in radians.
-// Linear interpolation is used to increase the apparent resolution of the
-// HRIR dataset.  The coefficients are also normalized and attenuated by the
-// specified gain.  Stepping resolution and count is determined using the
-// given delta factor between 0.0 and 1.0.
-ALuint GetMovingHrtfCoeffs(ALfloat elevation, ALfloat azimuth, ALfloat gain, ALfloat delta, ALint counter, ALfloat (*coeffs)[2], ALuint *delays, ALfloat (*coeffStep)[2], ALint *delayStep)
+// The coefficients are also attenuated by the specified gain.  Stepping
+// resolution and count is determined using the given delta factor between
+// 0.0 and 1.0.
+ALuint GetMovingHrtfCoeffs(struct HrtfCache *Cache, ALfloat elevation, ALfloat azimuth, ALfloat gain, ALfloat delta, ALint counter, ALfloat (*coeffs)[2], ALuint *delays, ALfloat (*coeffStep)[2], ALint *delayStep)
 {
-    ALuint evidx[2], azidx[2];
-    ALuint lidx[4], ridx[4];
+    const HrtfCacheEntry *hrir = GetCachedHrir(Cache, elevation, azimuth);
+    const ALuint irSize = Cache->hrtf->irSize;
     ALfloat left, right;
-    ALfloat mu[3];
     ALfloat step;
     ALuint i;
 
-    // Claculate elevation indices and interpolation factor.
-    CalcEvIndices(elevation, evidx, &mu[2]);
-
-    // Calculate azimuth indices and interpolation factor for the first
-    // elevation.
-    CalcAzIndices(evidx[0], azimuth, azidx, &mu[0]);
-
-    // Calculate the first set of linear HRIR indices for left and right
-    // channels.
-    lidx[0] = evOffset[evidx[0]] + azidx[0];
-    lidx[1] = evOffset[evidx[0]] + azidx[1];
-    ridx[0] = evOffset[evidx[0]] + ((azCount[evidx[0]]-azidx[0]) % azCount[evidx[0]]);
-    ridx[1] = evOffset[evidx[0]] + ((azCount[evidx[0]]-azidx[1]) % azCount[evidx[0]]);
-
-    // Calculate azimuth indices and interpolation factor for the second
-    // elevation.
-    CalcAzIndices(evidx[1], azimuth, azidx, &mu[1]);
-
-    // Calculate the second set of linear HRIR indices for left and right
-    // channels.
-    lidx[2] = evOffset[evidx[1]] + azidx[0];
-    lidx[3] = evOffset[evidx[1]] + azidx[1];
-    ridx[2] = evOffset[evidx[1]] + ((azCount[evidx[1]]-azidx[0]) % azCount[evidx[1]]);
-    ridx[3] = evOffset[evidx[1]] + ((azCount[evidx[1]]-azidx[1]) % azCount[evidx[1]]);
-
     // Calculate the stepping parameters.
-    delta = maxf(floor(delta*(Hrtf.sampleRate*0.015f) + 0.5), 1.0f);
+    delta = maxf(floor(delta*(Cache->hrtf->sampleRate*0.015f) + 0.5), 1.0f);
     step = 1.0f / delta;
 
-    // Calculate the normalized and attenuated target HRIR coefficients using
-    // linear interpolation when there is enough gain to warrant it.  Zero
-    // the target coefficients if gain is too low.  Then calculate the
-    // coefficient stepping values using the target and previous running
-    // coefficients.
+    // Calculate the attenuated target HRIR coefficients when there is enough
+    // gain to warrant it.  Zero the target coefficients if gain is too low.
+    // Then calculate the coefficient stepping values using the target and
+    // previous running coefficients.
     if(gain > 0.0001f)
     {
-        ALdouble scale = gain * (1.0/32767.0);
-        for(i = 0;i < HRIR_LENGTH;i++)
+        for(i = 0;i < irSize;i++)
         {
             left = coeffs[i][0] - (coeffStep[i][0] * counter);
             right = coeffs[i][1] - (coeffStep[i][1] * counter);
 
-            coeffs[i][0] = lerp(lerp(Hrtf.coeffs[lidx[0]][i], Hrtf.coeffs[lidx[1]][i], mu[0]),
-                                lerp(Hrtf.coeffs[lidx[2]][i], Hrtf.coeffs[lidx[3]][i], mu[1]),
-                                mu[2]) * scale;
-            coeffs[i][1] = lerp(lerp(Hrtf.coeffs[ridx[0]][i], Hrtf.coeffs[ridx[1]][i], mu[0]),
-                                lerp(Hrtf.coeffs[ridx[2]][i], Hrtf.coeffs[ridx[3]][i], mu[1]),
-                                mu[2]) * scale;
+            coeffs[i][0] = hrir->coeffs[i][0] * gain;
+            coeffs[i][1] = hrir->coeffs[i][1] * gain;
 
             coeffStep[i][0] = step * (coeffs[i][0] - left);
             coeffStep[i][1] = step * (coeffs[i][1] - right);
@@ -252,7 +414,7 @@ ALuint GetMovingHrtfCoeffs(ALfloat elevation, ALfloat azimuth, ALfloat gain, ALf
     }
     else
     {
-        for(i = 0;i < HRIR_LENGTH;i++)
+        for(i = 0;i < irSize;i++)
         {
             left = coeffs[i][0] - (coeffStep[i][0] * counter);
             right = coeffs[i][1] - (coeffStep[i][1] * counter);
@@ -265,18 +427,13 @@ ALuint GetMovingHrtfCoeffs(ALfloat elevation, ALfloat azimuth, ALfloat gain, ALf
         }
     }
 
-    // Calculate the HRIR delays using linear interpolation.  Then calculate
-    // the delay stepping values using the target and previous running
-    // delays.
+    // Calculate the HRIR delay stepping values using the target and previous
+    // running delays.
     left = delays[0] - (delayStep[0] * counter);
     right = delays[1] - (delayStep[1] * counter);
 
-    delays[0] = (ALuint)(lerp(lerp(Hrtf.delays[lidx[0]], Hrtf.delays[lidx[1]], mu[0]),
-                              lerp(Hrtf.delays[lidx[2]], Hrtf.delays[lidx[3]], mu[1]),
-                              mu[2]) * 65536.0f);
-    delays[1] = (ALuint)(lerp(lerp(Hrtf.delays[ridx[0]], Hrtf.delays[ridx[1]], mu[0]),
-                              lerp(Hrtf.delays[ridx[2]], Hrtf.delays[ridx[3]], mu[1]),
-                              mu[2]) * 65536.0f);
+    delays[0] = hrir->delays[0];
+    delays[1] = hrir->delays[1];
 
     delayStep[0] = (ALint)(step * (delays[0] - left));
     delayStep[1] = (ALint)(step * (delays[1] - right));
@@ -287,126 +444,453 @@ ALuint GetMovingHrtfCoeffs(ALfloat elevation, ALfloat azimuth, ALfloat gain, ALf
     return (ALuint)delta;
 }
 
-ALCboolean IsHrtfCompatible(ALCdevice *device)
+/* Allocates a data set with room for the coefficients and delays of the
+ * given layout, and fills in the layout. */
+static struct Hrtf *CreateHrtf(ALuint rate, ALuint irSize, ALubyte evCount, const ALubyte *azCount)
 {
-    if(device->FmtChans == DevFmtStereo && device->Frequency == Hrtf.sampleRate)
-        return ALC_TRUE;
-    ERR("format: %s %uhz (needed: %s %uhz)\n",
-        DevFmtChannelsString(device->FmtChans), device->Frequency,
-        DevFmtChannelsString(DevFmtStereo), Hrtf.sampleRate);
-    return ALC_FALSE;
+    struct Hrtf *Hrtf;
+    size_t total;
+    ALuint irCount;
+    ALuint i;
+
+    irCount = 0;
+    for(i = 0;i < evCount;i++)
+        irCount += azCount[i];
+
+    total  = sizeof(struct Hrtf);
+    total += sizeof(Hrtf->evOffset[0])*evCount;
+    total += sizeof(Hrtf->coeffs[0])*irSize*irCount;
+    total += sizeof(Hrtf->azCount[0])*evCount;
+    total += sizeof(Hrtf->delays[0])*irCount;
+
+    Hrtf = malloc(total);
+    if(!Hrtf)
+        return NULL;
+
+    Hrtf->sampleRate = rate;
+    Hrtf->irSize = irSize;
+    Hrtf->evCount = evCount;
+    Hrtf->evOffset = (ALushort*)(Hrtf+1);
+    Hrtf->coeffs = (ALshort*)(Hrtf->evOffset + evCount);
+    Hrtf->azCount = (ALubyte*)(Hrtf->coeffs + irSize*irCount);
+    Hrtf->delays = Hrtf->azCount + evCount;
+    Hrtf->next = NULL;
+
+    irCount = 0;
+    for(i = 0;i < evCount;i++)
+    {
+        Hrtf->azCount[i] = azCount[i];
+        Hrtf->evOffset[i] = irCount;
+        irCount += azCount[i];
+    }
+
+    return Hrtf;
 }
 
-void InitHrtf(void)
+static ALuint GetHrirCount(const struct Hrtf *Hrtf)
 {
-    const char *fname;
-    FILE *f = NULL;
+    return Hrtf->evOffset[Hrtf->evCount-1] + Hrtf->azCount[Hrtf->evCount-1];
+}
 
-    fname = GetConfigValue(NULL, "hrtf_tables", "");
-    if(fname[0] != '\0')
+static ALdouble Sinc(ALdouble x)
+{
+    if(fabs(x) < 1e-9)
+        return 1.0;
+    return sin(M_PI*x) / (M_PI*x);
+}
+
+// Blackman window, for x between -1 and +1.
+static ALdouble Blackman(ALdouble x)
+{
+    return 0.42 + 0.5*cos(M_PI*x) + 0.08*cos(2.0*M_PI*x);
+}
+
+// Resamples the HRIRs to the given rate using a windowed sinc filter that
+// cuts off at the lower of the two Nyquist frequencies. Only the response
+// from the first sample on is kept, so the new HRIRs stay causal with their
+// energy up front, like the minimum-phase originals, and keep the same
+// duration, up to HRIR_LENGTH samples. The delays are scaled to the new rate.
+static struct Hrtf *ResampleHrtf(const struct Hrtf *src, ALuint rate)
+{
+    const ALuint maxDelay = SRC_HISTORY_LENGTH-1;
+    const ALuint srcIrSize = src->irSize;
+    const ALuint irCount = GetHrirCount(src);
+    const ALdouble step = (ALdouble)src->sampleRate / rate;
+    const ALdouble scale = (rate < src->sampleRate) ? 1.0/step : 1.0;
+    ALuint clipped = 0;
+    struct Hrtf *Hrtf;
+    ALuint irSize;
+    ALuint i, j, k;
+
+    irSize = (ALuint)ceil((ALdouble)srcIrSize / step);
+    irSize = (irSize+MOD_IR_SIZE-1) / MOD_IR_SIZE * MOD_IR_SIZE;
+    irSize = minu(maxu(irSize, MIN_IR_SIZE), HRIR_LENGTH);
+
+    Hrtf = CreateHrtf(rate, irSize, src->evCount, src->azCount);
+    if(!Hrtf)
+        return NULL;
+
+    for(i = 0;i < irCount;i++)
+    {
+        const ALshort *coeffs = &src->coeffs[i*srcIrSize];
+        ALdouble delay;
+
+        for(j = 0;j < irSize;j++)
+        {
+            ALdouble sum = 0.0;
+            for(k = 0;k < srcIrSize;k++)
+            {
+                ALdouble x = (j*step - k) * scale;
+                if(fabs(x) < HRIR_RESAMPLE_ZEROS)
+                    sum += coeffs[k] * Sinc(x) *
+                           Blackman(x / HRIR_RESAMPLE_ZEROS);
+            }
+            // Scale to keep the same frequency response with the new number
+            // of samples per second.
+            sum *= scale * step;
+            Hrtf->coeffs[i*irSize + j] = (ALshort)clampf(floor(sum + 0.5), -32768.0f, 32767.0f);
+        }
+
+        delay = floor(src->delays[i]/step + 0.5);
+        if(delay > maxDelay)
+        {
+            delay = maxDelay;
+            clipped++;
+        }
+        Hrtf->delays[i] = (ALubyte)delay;
+    }
+    if(clipped > 0)
+        WARN("%u HRIR delays clipped to %u at %uhz\n", clipped, maxDelay, rate);
+
+    return Hrtf;
+}
+
+const struct Hrtf *GetHrtf(ALCdevice *device)
+{
+    struct Hrtf *Hrtf;
+
+    if(device->FmtChans != DevFmtStereo)
     {
-        f = fopen(fname, "rb");
-        if(f == NULL)
-            ERR("Could not open %s\n", fname);
+        ERR("Incompatible format: %s (needed: %s)\n",
+            DevFmtChannelsString(device->FmtChans),
+            DevFmtChannelsString(DevFmtStereo));
+        return NULL;
     }
-    if(f != NULL)
+
+    if(device->Frequency == LoadedHrtf->sampleRate)
+        return LoadedHrtf;
+
+    for(Hrtf = ResampledHrtfs;Hrtf;Hrtf = Hrtf->next)
     {
-        const ALubyte maxDelay = SRC_HISTORY_LENGTH-1;
-        ALboolean failed = AL_FALSE;
-        struct Hrtf newdata;
-        ALchar magic[9];
-        ALsizei i, j;
+        if(Hrtf->sampleRate == device->Frequency)
+            return Hrtf;
+    }
 
-        if(fread(magic, 1, sizeof(magicMarker), f) != sizeof(magicMarker))
+    Hrtf = ResampleHrtf(LoadedHrtf, device->Frequency);
+    if(!Hrtf)
+    {
+        ERR("Failed to resample HRTF to %uhz\n", device->Frequency);
+        return NULL;
+    }
+    TRACE("Resampled HRTF from %uhz to %uhz\n", LoadedHrtf->sampleRate,
+          device->Frequency);
+
+    Hrtf->next = ResampledHrtfs;
+    ResampledHrtfs = Hrtf;
+    return Hrtf;
+}
+
+struct HrtfCache *CreateHrtfCache(const struct Hrtf *Hrtf)
+{
+    struct HrtfCache *Cache;
+    ALfloat (*coeffs)[2];
+    ALuint i;
+
+    Cache = malloc(sizeof(*Cache) +
+                   sizeof(coeffs[0])*Hrtf->irSize*HRTF_CACHE_SIZE);
+    if(!Cache)
+        return NULL;
+
+    Cache->hrtf = Hrtf;
+    Cache->hits = 0;
+    Cache->misses = 0;
+    Cache->count = 0;
+    Cache->first = HRTF_CACHE_NONE;
+    Cache->last = HRTF_CACHE_NONE;
+    for(i = 0;i < (1<<HRTF_BUCKET_BITS);i++)
+        Cache->buckets[i] = HRTF_CACHE_NONE;
+
+    coeffs = (ALfloat(*)[2])(Cache+1);
+    for(i = 0;i < HRTF_CACHE_SIZE;i++)
+        Cache->entries[i].coeffs = coeffs + Hrtf->irSize*i;
+    return Cache;
+}
+
+void DestroyHrtfCache(struct HrtfCache *Cache)
+{
+    if(!Cache)
+        return;
+    TRACE("HRTF cache: %u hits, %u misses\n", Cache->hits, Cache->misses);
+    free(Cache);
+}
+
+void GetHrtfCacheStats(const struct HrtfCache *Cache, ALuint *hits, ALuint *misses)
+{
+    *hits = Cache->hits;
+    *misses = Cache->misses;
+}
+
+ALuint GetHrtfIrSize(const struct Hrtf *Hrtf)
+{
+    return Hrtf->irSize;
+}
+
+
+static ALuint ReadLE(const ALubyte *data, ALuint bytes)
+{
+    ALuint val = 0;
+    while(bytes > 0)
+    {
+        bytes--;
+        val = (val<<8) | data[bytes];
+    }
+    return val;
+}
+
+/* Reads the coefficients and delays that follow the layout in both formats,
+ * and makes the data set. */
+static struct Hrtf *LoadHrirs(ALuint rate, ALuint irSize, ALubyte evCount, const ALubyte *azCount, const ALubyte *data, size_t size)
+{
+    const ALubyte maxDelay = SRC_HISTORY_LENGTH-1;
+    ALboolean failed = AL_FALSE;
+    struct Hrtf *Hrtf;
+    ALuint irCount;
+    ALuint i;
+
+    if(rate < MIN_RATE || rate > MAX_RATE)
+    {
+        ERR("Unsupported sample rate: rate=%d (%d to %d)\n",
+            rate, MIN_RATE, MAX_RATE);
+        return NULL;
+    }
+    if(irSize < MIN_IR_SIZE || irSize > HRIR_LENGTH || (irSize%MOD_IR_SIZE))
+    {
+        ERR("Unsupported HRIR size: irSize=%d (%d to %d by %d)\n",
+            irSize, MIN_IR_SIZE, HRIR_LENGTH, MOD_IR_SIZE);
+        return NULL;
+    }
+    for(i = 0;i < evCount;i++)
+    {
+        if(azCount[i] < MIN_AZ_COUNT || azCount[i] > MAX_AZ_COUNT)
         {
-            ERR("Failed to read magic marker\n");
-            failed = AL_TRUE;
+            ERR("Unsupported azimuth count: azCount[%d]=%d (%d to %d)\n",
+                i, azCount[i], MIN_AZ_COUNT, MAX_AZ_COUNT);
+            return NULL;
         }
-        else if(memcmp(magic, magicMarker, sizeof(magicMarker)) != 0)
+    }
+
+    Hrtf = CreateHrtf(rate, irSize, evCount, azCount);
+    if(!Hrtf)
+    {
+        ERR("Out of memory\n");
+        return NULL;
+    }
+
+    irCount = GetHrirCount(Hrtf);
+    if(size < irCount*irSize*2 + irCount)
+    {
+        ERR("Premature end of data\n");
+        free(Hrtf);
+        return NULL;
+    }
+
+    for(i = 0;i < irCount*irSize;i++)
+    {
+        Hrtf->coeffs[i] = (ALshort)ReadLE(data, 2);
+        data += 2;
+    }
+    for(i = 0;i < irCount;i++)
+    {
+        Hrtf->delays[i] = *(data++);
+        if(Hrtf->delays[i] > maxDelay)
         {
-            magic[8] = 0;
-            ERR("Invalid magic marker: \"%s\"\n", magic);
+            ERR("Invalid delays[%d]: %d (%d)\n", i, Hrtf->delays[i], maxDelay);
             failed = AL_TRUE;
         }
+    }
+
+    if(failed)
+    {
+        free(Hrtf);
+        return NULL;
+    }
+    return Hrtf;
+}
+
+static struct Hrtf *LoadHrtf00(const ALubyte *data, size_t size)
+{
+    ALubyte azCount[MAX_EV_COUNT];
+    ALuint rate, irCount, irSize;
+    ALubyte evCount;
+    ALuint i;
+
+    if(size < 9)
+    {
+        ERR("Premature end of data\n");
+        return NULL;
+    }
+    rate = ReadLE(data, 4);
+    irCount = ReadLE(data+4, 2);
+    irSize = ReadLE(data+6, 2);
+    evCount = data[8];
+    data += 9;
+    size -= 9;
+
+    if(evCount < MIN_EV_COUNT || evCount > MAX_EV_COUNT)
+    {
+        ERR("Unsupported elevation count: evCount=%d (%d to %d)\n",
+            evCount, MIN_EV_COUNT, MAX_EV_COUNT);
+        return NULL;
+    }
+    if(size < (size_t)evCount*2)
+    {
+        ERR("Premature end of data\n");
+        return NULL;
+    }
+
+    // This format gives the index of each elevation's first HRIR, so turn
+    // them into azimuth counts.
+    for(i = 0;i < evCount;i++)
+    {
+        ALuint offset = ReadLE(data + i*2, 2);
+        ALuint next = (i+1 < evCount) ? ReadLE(data + i*2 + 2, 2) : irCount;
 
-        if(!failed)
+        if((i == 0 && offset != 0) || next <= offset || next-offset > MAX_AZ_COUNT)
         {
-            ALushort hrirCount, hrirSize;
-            ALubyte  evCount;
+            ERR("Invalid evOffset[%d]: %d\n", i, offset);
+            return NULL;
+        }
+        azCount[i] = next - offset;
+    }
+    data += evCount*2;
+    size -= evCount*2;
+
+    return LoadHrirs(rate, irSize, evCount, azCount, data, size);
+}
 
-            newdata.sampleRate  = fgetc(f);
-            newdata.sampleRate |= fgetc(f)<<8;
-            newdata.sampleRate |= fgetc(f)<<16;
-            newdata.sampleRate |= fgetc(f)<<24;
+static struct Hrtf *LoadHrtf01(const ALubyte *data, size_t size)
+{
+    ALuint rate, irSize;
+    ALubyte evCount;
 
-            hrirCount  = fgetc(f);
-            hrirCount |= fgetc(f)<<8;
+    if(size < 6)
+    {
+        ERR("Premature end of data\n");
+        return NULL;
+    }
+    rate = ReadLE(data, 4);
+    irSize = data[4];
+    evCount = data[5];
+    data += 6;
+    size -= 6;
+
+    if(evCount < MIN_EV_COUNT || evCount > MAX_EV_COUNT)
+    {
+        ERR("Unsupported elevation count: evCount=%d (%d to %d)\n",
+            evCount, MIN_EV_COUNT, MAX_EV_COUNT);
+        return NULL;
+    }
+    if(size < evCount)
+    {
+        ERR("Premature end of data\n");
+        return NULL;
+    }
 
-            hrirSize  = fgetc(f);
-            hrirSize |= fgetc(f)<<8;
+    return LoadHrirs(rate, irSize, evCount, data, data+evCount, size-evCount);
+}
 
-            evCount = fgetc(f);
+/* Loads a data set file. The file is read in one go, then parsed from
+ * memory. */
+static struct Hrtf *LoadHrtf(const char *fname)
+{
+    struct Hrtf *Hrtf = NULL;
+    ALubyte *data = NULL;
+    long size;
+    FILE *f;
 
-            if(hrirCount != HRIR_COUNT || hrirSize != HRIR_LENGTH || evCount != ELEV_COUNT)
-            {
-                ERR("Unsupported value: hrirCount=%d (%d), hrirSize=%d (%d), evCount=%d (%d)\n",
-                    hrirCount, HRIR_COUNT, hrirSize, HRIR_LENGTH, evCount, ELEV_COUNT);
-                failed = AL_TRUE;
-            }
-        }
+    f = fopen(fname, "rb");
+    if(f == NULL)
+    {
+        ERR("Could not open %s\n", fname);
+        return NULL;
+    }
 
-        if(!failed)
+    if(fseek(f, 0, SEEK_END) == 0 && (size=ftell(f)) > 0 &&
+       fseek(f, 0, SEEK_SET) == 0)
+    {
+        data = malloc(size);
+        if(data && fread(data, 1, size, f) != (size_t)size)
         {
-            for(i = 0;i < HRIR_COUNT;i++)
-            {
-                ALushort offset;
-                offset  = fgetc(f);
-                offset |= fgetc(f)<<8;
-                if(offset != evOffset[i])
-                {
-                    ERR("Unsupported evOffset[%d] value: %d (%d)\n", i, offset, evOffset[i]);
-                    failed = AL_TRUE;
-                }
-            }
+            ERR("Failed to read %s\n", fname);
+            free(data);
+            data = NULL;
         }
+    }
+    else
+        ERR("Failed to get the size of %s\n", fname);
+    fclose(f);
 
-        if(!failed)
-        {
-            for(i = 0;i < HRIR_COUNT;i++)
-            {
-                for(j = 0;j < HRIR_LENGTH;j++)
-                {
-                    ALshort coeff;
-                    coeff  = fgetc(f);
-                    coeff |= fgetc(f)<<8;
-                    newdata.coeffs[i][j] = coeff;
-                }
-            }
-            for(i = 0;i < HRIR_COUNT;i++)
-            {
-                ALubyte delay;
-                delay = fgetc(f);
-                newdata.delays[i] = delay;
-                if(delay > maxDelay)
-                {
-                    ERR("Invalid delay[%d]: %d (%d)\n", i, delay, maxDelay);
-                    failed = AL_TRUE;
-                }
-            }
+    if(!data)
+        return NULL;
 
-            if(feof(f))
-            {
-                ERR("Premature end of data\n");
-                failed = AL_TRUE;
-            }
-        }
+    if(size < (long)sizeof(magicMarker01))
+        ERR("Failed to read magic marker\n");
+    else if(memcmp(data, magicMarker01, sizeof(magicMarker01)) == 0)
+    {
+        TRACE("Detected data set format v1\n");
+        Hrtf = LoadHrtf01(data+sizeof(magicMarker01), size-sizeof(magicMarker01));
+    }
+    else if(memcmp(data, magicMarker00, sizeof(magicMarker00)) == 0)
+    {
+        TRACE("Detected data set format v0\n");
+        Hrtf = LoadHrtf00(data+sizeof(magicMarker00), size-sizeof(magicMarker00));
+    }
+    else
+        ERR("Invalid magic marker: \"%.8s\"\n", (const char*)data);
+
+    free(data);
+    return Hrtf;
+}
 
-        fclose(f);
-        f = NULL;
+void InitHrtf(void)
+{
+    const char *fname;
 
-        if(!failed)
-            Hrtf = newdata;
+    fname = GetConfigValue(NULL, "hrtf_tables", "");
+    if(fname[0] != '\0')
+    {
+        struct Hrtf *Hrtf = LoadHrtf(fname);
+        if(Hrtf)
+        {
+            TRACE("Loaded %s: %uhz, %u HRIRs of %u samples, %u elevations\n",
+                  fname, Hrtf->sampleRate, GetHrirCount(Hrtf), Hrtf->irSize,
+                  Hrtf->evCount);
+            LoadedHrtf = Hrtf;
+        }
         else
             ERR("Failed to load %s\n", fname);
     }
 }
+
+void FreeHrtf(void)
+{
+    while(ResampledHrtfs)
+    {
+        struct Hrtf *next = ResampledHrtfs->next;
+        free(ResampledHrtfs);
+        ResampledHrtfs = next;
+    }
+    if(LoadedHrtf != &DefaultHrtf)
+        free(LoadedHrtf);
+    LoadedHrtf = &DefaultHrtf;
+}
@@ -0,0 +1,270 @@
+/**
+ * OpenAL cross platform audio library
+ * Copyright (C) 2012 by authors.
+ * This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Library General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ *  License along with this library; if not, write to the
+ *  Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ *  Boston, MA  02111-1307, USA.
+ * Or go to http://www.gnu.org/copyleft/lgpl.html
+ */
+
+#include "config.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "alMain.h"
+#include "alu.h"
+
+
+/* A look-ahead peak limiter for the device output, applied just before the
+ * samples are converted to the output format. The output is delayed by
+ * LookAhead frames, so the gain can be brought down ahead of a peak instead
+ * of clipping it.
+ *
+ * For each frame, the gain needed to bring the loudest channel down to the
+ * threshold is held at its lowest over the next LookAhead frames, allowed to
+ * rise back toward unity no faster than the release, and then averaged over
+ * LookAhead+1 frames. Every value in the average is at or below what a peak
+ * at the end of it needs, so the peak can't go over, while the average ramps
+ * the gain down smoothly over the look-ahead.
+ *
+ * The per-channel work (finding the peaks and scaling the delayed samples) is
+ * done in plain loops over the whole update, leaving only the gain envelope
+ * to be worked out a frame at a time. While nothing has come near the
+ * threshold, the samples are only delayed.
+ */
+
+/* The gains held over the look-ahead window are kept in a ring, which needs
+ * to fit LIMITER_MAX_LOOKAHEAD+1 entries */
+#define HOLD_RING_SIZE  2048
+#define HOLD_RING_MASK  (HOLD_RING_SIZE-1)
+
+struct Limiter {
+    // Linear threshold, release coefficient, and delay in frames
+    ALfloat Threshold;
+    ALfloat ReleaseCoeff;
+    ALuint  LookAhead;
+    ALuint  NumChannels;
+
+    // The loudest sample of each frame, and then the gain for each frame
+    ALfloat Gains[BUFFERSIZE];
+
+    // The needed gains still in the look-ahead window, increasing from Head,
+    // along with the frame they were needed by
+    ALfloat HoldGain[HOLD_RING_SIZE];
+    ALuint  HoldTime[HOLD_RING_SIZE];
+    ALuint  HoldHead, HoldTail;
+    ALuint  Time;
+
+    // The last released gain, and the released gains being averaged
+    ALfloat Release;
+    ALfloat Window[LIMITER_MAX_LOOKAHEAD+1];
+    ALuint  WindowPos;
+    ALdouble WindowSum;
+
+    // The lowest gain applied in the last update
+    volatile ALfloat LastGain;
+
+    // The last LookAhead frames of each channel, and room to line them up
+    // with an update's samples
+    ALfloat History[MAXCHANNELS][LIMITER_MAX_LOOKAHEAD];
+    ALfloat Delayed[LIMITER_MAX_LOOKAHEAD+BUFFERSIZE];
+};
+
+
+struct Limiter *aluCreateLimiter(void)
+{
+    struct Limiter *limiter = al_malloc(16, sizeof(*limiter));
+    if(limiter)
+        memset(limiter, 0, sizeof(*limiter));
+    return limiter;
+}
+
+ALvoid aluDestroyLimiter(struct Limiter *limiter)
+{
+    al_free(limiter);
+}
+
+/* Sets up the device's limiter for its output channels and frequency, and
+ * clears its history. */
+ALvoid aluInitLimiter(ALCdevice *device)
+{
+    struct Limiter *limiter = device->Limiter;
+    ALfloat release;
+    ALuint c, i;
+
+    release = device->LimiterRelease * 0.001f * device->Frequency;
+
+    limiter->Threshold = aluPow(10.0f, device->LimiterThreshold / 20.0f);
+    limiter->ReleaseCoeff = 1.0f - (ALfloat)exp(-1.0 / maxf(release, 1.0f));
+    limiter->LookAhead = device->LimiterLookAhead;
+    limiter->NumChannels = ChannelsFromDevFmt(device->FmtChans);
+
+    limiter->HoldHead = 0;
+    limiter->HoldTail = 1;
+    limiter->HoldGain[0] = 1.0f;
+    limiter->HoldTime[0] = 0;
+    limiter->Time = 0;
+
+    limiter->Release = 1.0f;
+    for(i = 0;i <= limiter->LookAhead;i++)
+        limiter->Window[i] = 1.0f;
+    limiter->WindowPos = 0;
+    limiter->WindowSum = limiter->LookAhead+1;
+
+    limiter->LastGain = 1.0f;
+
+    for(c = 0;c < MAXCHANNELS;c++)
+    {
+        for(i = 0;i < LIMITER_MAX_LOOKAHEAD;i++)
+            limiter->History[c][i] = 0.0f;
+    }
+
+    TRACE("Limiting output to %.2fdB, %.1fms release, %u frame look-ahead\n",
+          device->LimiterThreshold, device->LimiterRelease, limiter->LookAhead);
+}
+
+static ALvoid CalcGains(struct Limiter *limiter, ALuint SamplesToDo)
+{
+    const ALuint WindowSize = limiter->LookAhead+1;
+    const ALfloat ReleaseCoeff = limiter->ReleaseCoeff;
+    ALfloat *RESTRICT Gains = limiter->Gains;
+    ALuint head = limiter->HoldHead;
+    ALuint tail = limiter->HoldTail;
+    ALuint time = limiter->Time;
+    ALuint pos = limiter->WindowPos;
+    ALdouble sum = limiter->WindowSum;
+    ALfloat release = limiter->Release;
+    ALfloat lowest = 1.0f;
+    ALuint i;
+
+    for(i = 0;i < SamplesToDo;i++)
+    {
+        ALfloat gain = Gains[i];
+
+        // Drop held gains that are no lower than this one, then those that
+        // have left the window. The lowest one left is needed for the whole
+        // window.
+        while(tail != head && limiter->HoldGain[(tail-1)&HOLD_RING_MASK] >= gain)
+            tail--;
+        limiter->HoldGain[tail&HOLD_RING_MASK] = gain;
+        limiter->HoldTime[tail&HOLD_RING_MASK] = time;
+        tail++;
+        while(time - limiter->HoldTime[head&HOLD_RING_MASK] >= WindowSize)
+            head++;
+        time++;
+
+        release += (1.0f-release) * ReleaseCoeff;
+        if(release >= 1.0f-GAIN_SILENCE_THRESHOLD)
+            release = 1.0f;
+        release = minf(release, limiter->HoldGain[head&HOLD_RING_MASK]);
+
+        sum += release - limiter->Window[pos];
+        limiter->Window[pos] = release;
+        if(++pos == WindowSize)
+            pos = 0;
+
+        gain = (ALfloat)(sum / WindowSize);
+        lowest = minf(lowest, gain);
+        Gains[i] = gain;
+    }
+
+    limiter->HoldHead = head;
+    limiter->HoldTail = tail;
+    limiter->Time = time;
+    limiter->WindowPos = pos;
+    limiter->WindowSum = sum;
+    limiter->Release = release;
+    limiter->LastGain = lowest;
+}
+
+ALvoid aluApplyLimiter(ALCdevice *device, ALuint SamplesToDo)
+{
+    struct Limiter *limiter = device->Limiter;
+    const ALuint NumChannels = limiter->NumChannels;
+    const ALuint LookAhead = limiter->LookAhead;
+    const ALfloat Threshold = limiter->Threshold;
+    ALfloat *RESTRICT Gains = limiter->Gains;
+    ALfloat *RESTRICT Delayed = limiter->Delayed;
+    ALfloat peak;
+    ALuint c, i;
+
+    for(i = 0;i < SamplesToDo;i++)
+        Gains[i] = 0.0f;
+    for(c = 0;c < NumChannels;c++)
+    {
+        const ALfloat *RESTRICT input = device->OutBuffer[c];
+        for(i = 0;i < SamplesToDo;i++)
+            Gains[i] = maxf(Gains[i], aluFabs(input[i]));
+    }
+
+    peak = 0.0f;
+    for(i = 0;i < SamplesToDo;i++)
+        peak = maxf(peak, Gains[i]);
+
+    if(peak <= Threshold && limiter->Release == 1.0f &&
+       limiter->WindowSum == LookAhead+1 &&
+       limiter->HoldGain[limiter->HoldHead&HOLD_RING_MASK] == 1.0f)
+    {
+        /* Nothing in the window needs limiting, so the gain stays at unity
+         * and only the last frame has to be held. */
+        limiter->HoldHead = limiter->Time + SamplesToDo - 1;
+        limiter->HoldTail = limiter->HoldHead + 1;
+        limiter->HoldGain[limiter->HoldHead&HOLD_RING_MASK] = 1.0f;
+        limiter->HoldTime[limiter->HoldHead&HOLD_RING_MASK] = limiter->HoldHead;
+        limiter->Time += SamplesToDo;
+        limiter->LastGain = 1.0f;
+
+        if(LookAhead == 0)
+            return;
+        for(c = 0;c < NumChannels;c++)
+        {
+            ALfloat *RESTRICT output = device->OutBuffer[c];
+
+            memcpy(Delayed, limiter->History[c], LookAhead*sizeof(ALfloat));
+            memcpy(&Delayed[LookAhead], output, SamplesToDo*sizeof(ALfloat));
+            memcpy(output, Delayed, SamplesToDo*sizeof(ALfloat));
+            memcpy(limiter->History[c], &Delayed[SamplesToDo],
+                   LookAhead*sizeof(ALfloat));
+        }
+        return;
+    }
+
+    for(i = 0;i < SamplesToDo;i++)
+        Gains[i] = Threshold / maxf(Gains[i], Threshold);
+    CalcGains(limiter, SamplesToDo);
+
+    for(c = 0;c < NumChannels;c++)
+    {
+        ALfloat *RESTRICT output = device->OutBuffer[c];
+
+        memcpy(Delayed, limiter->History[c], LookAhead*sizeof(ALfloat));
+        memcpy(&Delayed[LookAhead], output, SamplesToDo*sizeof(ALfloat));
+        for(i = 0;i < SamplesToDo;i++)
+            output[i] = Delayed[i] * Gains[i];
+        memcpy(limiter->History[c], &Delayed[SamplesToDo],
+               LookAhead*sizeof(ALfloat));
+    }
+}
+
+/* Returns how far the limiter brought the output down in the last update, in
+ * millibels. */
+ALint aluGetLimiterReduction(const ALCdevice *device)
+{
+    ALfloat gain = device->Limiter->LastGain;
+    if(!(gain < 1.0f))
+        return 0;
+    return (ALint)(-2000.0*log10(maxf(gain, 0.00001f)) + 0.5);
+}
@@ -35,31 +35,53 @@
 #include "alAuxEffectSlot.h"
 #include "alu.h"
 #include "bs2b.h"
+#include "mixer_defs.h"
 
 
-static __inline ALdouble point32(const ALfloat *vals, ALint step, ALint frac)
-{ return vals[0]; (void)step; (void)frac; }
-static __inline ALdouble lerp32(const ALfloat *vals, ALint step, ALint frac)
-{ return lerp(vals[0], vals[step], frac * (1.0/FRACTIONONE)); }
-static __inline ALdouble cubic32(const ALfloat *vals, ALint step, ALint frac)
-{ return cubic(vals[-step], vals[0], vals[step], vals[step+step],
-               frac * (1.0/FRACTIONONE)); }
+/* Catmull-Rom spline coefficients for the cubic resampler, for each of
+ * CUBIC_PHASES+1 evenly spaced fractions between two samples. */
+ALfloat CubicLUT[CUBIC_PHASES+1][4];
+
+static ALvoid InitCubicLUT(void)
+{
+    ALuint i;
+
+    for(i = 0;i <= CUBIC_PHASES;i++)
+    {
+        ALdouble mu = (ALdouble)i / CUBIC_PHASES;
+        ALdouble mu2 = mu*mu, mu3 = mu2*mu;
+
+        CubicLUT[i][0] = (ALfloat)(-0.5*mu3 +       mu2 + -0.5*mu);
+        CubicLUT[i][1] = (ALfloat)( 1.5*mu3 + -2.5*mu2            + 1.0);
+        CubicLUT[i][2] = (ALfloat)(-1.5*mu3 +  2.0*mu2 +  0.5*mu);
+        CubicLUT[i][3] = (ALfloat)( 0.5*mu3 + -0.5*mu2);
+    }
+}
+
+static __inline ALfloat cubic(ALfloat val0, ALfloat val1, ALfloat val2,
+                              ALfloat val3, ALint frac)
+{
+    const ALfloat *coeffs = CubicLUT[(frac + (1<<(CUBIC_FRAC_BITS-1))) >>
+                                     CUBIC_FRAC_BITS];
+    return coeffs[0]*val0 + coeffs[1]*val1 + coeffs[2]*val2 + coeffs[3]*val3;
+}
 
-static __inline ALdouble point16(const ALshort *vals, ALint step, ALint frac)
-{ return vals[0] * (1.0/32767.0); (void)step; (void)frac; }
-static __inline ALdouble lerp16(const ALshort *vals, ALint step, ALint frac)
-{ return lerp(vals[0], vals[step], frac * (1.0/FRACTIONONE)) * (1.0/32767.0); }
-static __inline ALdouble cubic16(const ALshort *vals, ALint step, ALint frac)
+
+static __inline ALfloat point16(const ALshort *vals, ALint step, ALint frac)
+{ return vals[0] * (1.0f/32767.0f); (void)step; (void)frac; }
+static __inline ALfloat lerp16(const ALshort *vals, ALint step, ALint frac)
+{ return lerpf(vals[0], vals[step], frac * (1.0f/FRACTIONONE)) * (1.0f/32767.0f); }
+static __inline ALfloat cubic16(const ALshort *vals, ALint step, ALint frac)
 { return cubic(vals[-step], vals[0], vals[step], vals[step+step],
-               frac * (1.0/FRACTIONONE)) * (1.0/32767.0); }
+               frac) * (1.0f/32767.0f); }
 
-static __inline ALdouble point8(const ALbyte *vals, ALint step, ALint frac)
-{ return vals[0] * (1.0/127.0); (void)step; (void)frac; }
-static __inline ALdouble lerp8(const ALbyte *vals, ALint step, ALint frac)
-{ return lerp(vals[0], vals[step], frac * (1.0/FRACTIONONE)) * (1.0/127.0); }
-static __inline ALdouble cubic8(const ALbyte *vals, ALint step, ALint frac)
+static __inline ALfloat point8(const ALbyte *vals, ALint step, ALint frac)
+{ return vals[0] * (1.0f/127.0f); (void)step; (void)frac; }
+static __inline ALfloat lerp8(const ALbyte *vals, ALint step, ALint frac)
+{ return lerpf(vals[0], vals[step], frac * (1.0f/FRACTIONONE)) * (1.0f/127.0f); }
+static __inline ALfloat cubic8(const ALbyte *vals, ALint step, ALint frac)
 { return cubic(vals[-step], vals[0], vals[step], vals[step+step],
-               frac * (1.0/FRACTIONONE)) * (1.0/127.0); }
+               frac) * (1.0f/127.0f); }
 
 #ifdef __GNUC__
 #define LIKELY(x) __builtin_expect(!!(x), 1)
@@ -69,255 +91,471 @@ static __inline ALdouble cubic8(const ALbyte *vals, ALint step, ALint frac)
 #define UNLIKELY(x) (x)
 #endif
 
-#if defined(__ARM_NEON__) && defined(HAVE_ARM_NEON_H)
-#include <arm_neon.h>
 
-static __inline void ApplyCoeffs(ALuint Offset, ALfloat (*RESTRICT Values)[2],
-                                 ALfloat (*RESTRICT Coeffs)[2],
-                                 ALfloat left, ALfloat right)
+/* The sinc resampler's filters, for SINC_SCALES cutoff frequencies evenly
+ * spaced from SINC_MIN_SCALE to 1 (the source's Nyquist frequency). Each phase
+ * holds SINC_POINTS coefficients followed by the differences to the next
+ * phase's. */
+#define SINC_SCALES     16
+#define SINC_MIN_SCALE  0.25
+/* Kaiser window beta, for around 60dB of stop-band attenuation */
+#define SINC_BETA       5.65
+
+static ALfloat SincTable[SINC_SCALES][SINC_PHASES][2][SINC_POINTS];
+
+static ALdouble BesselI0(ALdouble x)
 {
-    ALuint c;
-    float32x4_t leftright4;
+    ALdouble term = 1.0, sum = 1.0;
+    ALdouble x2 = x*x * 0.25;
+    ALuint k = 1;
+
+    do {
+        term *= x2 / ((ALdouble)k*k);
+        sum += term;
+        k++;
+    } while(term > sum*1e-15);
+    return sum;
+}
+
+/* Windowed sinc at x samples from the center, with its cutoff scaled by
+ * scale. */
+static ALdouble SincKernel(ALdouble x, ALdouble scale)
+{
+    ALdouble t = x / (SINC_POINTS/2);
+    ALdouble w;
+
+    if(!(t > -1.0 && t < 1.0))
+        return 0.0;
+    w = BesselI0(SINC_BETA*sqrt(1.0 - t*t)) / BesselI0(SINC_BETA);
+
+    x *= scale;
+    if(fabs(x) < 1e-9)
+        return scale * w;
+    return scale * w * sin(M_PI*x) / (M_PI*x);
+}
+
+static ALvoid InitSincTables(void)
+{
+    ALdouble coeffs[SINC_PHASES+1][SINC_POINTS];
+    ALdouble scale, sum;
+    ALuint si, p, j;
+
+    for(si = 0;si < SINC_SCALES;si++)
     {
-        float32x2_t leftright2 = vdup_n_f32(0.0);
-        leftright2 = vset_lane_f32(left, leftright2, 0);
-        leftright2 = vset_lane_f32(right, leftright2, 1);
-        leftright4 = vcombine_f32(leftright2, leftright2);
+        scale = SINC_MIN_SCALE + (1.0-SINC_MIN_SCALE)*si/(SINC_SCALES-1);
+        for(p = 0;p <= SINC_PHASES;p++)
+        {
+            sum = 0.0;
+            for(j = 0;j < SINC_POINTS;j++)
+            {
+                coeffs[p][j] = SincKernel((ALdouble)j - SINC_PRE_POINTS -
+                                          (ALdouble)p/SINC_PHASES, scale);
+                sum += coeffs[p][j];
+            }
+            /* Keep unity gain at DC for every phase */
+            for(j = 0;j < SINC_POINTS;j++)
+                coeffs[p][j] /= sum;
+        }
+        for(p = 0;p < SINC_PHASES;p++)
+        {
+            for(j = 0;j < SINC_POINTS;j++)
+            {
+                SincTable[si][p][0][j] = (ALfloat)coeffs[p][j];
+                SincTable[si][p][1][j] = (ALfloat)(coeffs[p+1][j] - coeffs[p][j]);
+            }
+        }
     }
-    for(c = 0;c < HRIR_LENGTH;c += 2)
+}
+
+/* Selects the filter for the given step. Stepping faster than one sample per
+ * output lowers the cutoff to the output's Nyquist frequency, to keep higher
+ * frequencies from aliasing. */
+static __inline const ALfloat *GetSincFilter(ALuint increment)
+{
+    ALuint si = SINC_SCALES-1;
+
+    if(increment > FRACTIONONE)
     {
-        const ALuint o0 = (Offset+c)&HRIR_MASK;
-        const ALuint o1 = (o0+1)&HRIR_MASK;
-        float32x4_t vals = vcombine_f32(vld1_f32((float32_t*)&Values[o0][0]),
-                                        vld1_f32((float32_t*)&Values[o1][0]));
-        float32x4_t coefs = vld1q_f32((float32_t*)&Coeffs[c][0]);
+        ALfloat scale = (ALfloat)FRACTIONONE / increment;
+        if(scale <= SINC_MIN_SCALE)
+            si = 0;
+        else
+            si = (ALuint)((scale-SINC_MIN_SCALE) *
+                          ((SINC_SCALES-1) / (1.0-SINC_MIN_SCALE)) + 0.5);
+    }
+    return &SincTable[si][0][0][0];
+}
+
 
-        vals = vmlaq_f32(vals, coefs, leftright4);
+/* The transform used for the HRTF tail, covering the previous and current
+ * input blocks. */
+#define HRTF_FFT_SIZE  (HRTF_BLOCK_SIZE*2)
+
+/* Twiddle factors for each pass of the transform. The pass between transforms
+ * of length n and n*2 uses the n factors starting at index n-1. */
+static ALfloat HrtfTwiddleReal[HRTF_FFT_SIZE-1];
+static ALfloat HrtfTwiddleImag[HRTF_FFT_SIZE-1];
+static ALubyte HrtfBitReverse[HRTF_FFT_SIZE];
+
+static ALvoid InitHrtfFFT(void)
+{
+    ALuint i, j, b, n;
 
-        vst1_f32((float32_t*)&Values[o0][0], vget_low_f32(vals));
-        vst1_f32((float32_t*)&Values[o1][0], vget_high_f32(vals));
+    for(n = 1;n < HRTF_FFT_SIZE;n <<= 1)
+    {
+        for(i = 0;i < n;i++)
+        {
+            HrtfTwiddleReal[n-1 + i] = (ALfloat)cos(M_PI * i / n);
+            HrtfTwiddleImag[n-1 + i] = (ALfloat)-sin(M_PI * i / n);
+        }
+    }
+    for(i = 0;i < HRTF_FFT_SIZE;i++)
+    {
+        j = 0;
+        for(b = 0;b <= HRTF_BLOCK_BITS;b++)
+            j |= ((i>>b)&1) << (HRTF_BLOCK_BITS-b);
+        HrtfBitReverse[i] = j;
     }
 }
 
-#else
+/* One pass of a decimation-in-frequency transform, splitting each length
+ * n*2 transform into two of length n. */
+static __inline void HrtfFFTPassDIF(ALfloat *RESTRICT re, ALfloat *RESTRICT im,
+                                    const ALuint n)
+{
+    const ALfloat *RESTRICT wr = &HrtfTwiddleReal[n-1];
+    const ALfloat *RESTRICT wi = &HrtfTwiddleImag[n-1];
+    ALuint i, k;
 
-static __inline void ApplyCoeffs(ALuint Offset, ALfloat (*RESTRICT Values)[2],
-                                 ALfloat (*RESTRICT Coeffs)[2],
-                                 ALfloat left, ALfloat right)
+    for(i = 0;i < HRTF_FFT_SIZE;i += n*2)
+    {
+        ALfloat *RESTRICT ar = &re[i], *RESTRICT ai = &im[i];
+        ALfloat *RESTRICT br = &re[i+n], *RESTRICT bi = &im[i+n];
+        for(k = 0;k < n;k++)
+        {
+            const ALfloat dr = ar[k] - br[k];
+            const ALfloat di = ai[k] - bi[k];
+            ar[k] += br[k];
+            ai[k] += bi[k];
+            br[k] = dr*wr[k] - di*wi[k];
+            bi[k] = dr*wi[k] + di*wr[k];
+        }
+    }
+}
+
+/* One pass of a decimation-in-time transform, combining pairs of length n
+ * transforms. */
+static __inline void HrtfFFTPassDIT(ALfloat *RESTRICT re, ALfloat *RESTRICT im,
+                                    const ALuint n)
 {
-    ALuint c;
-    for(c = 0;c < HRIR_LENGTH;c++)
+    const ALfloat *RESTRICT wr = &HrtfTwiddleReal[n-1];
+    const ALfloat *RESTRICT wi = &HrtfTwiddleImag[n-1];
+    ALuint i, k;
+
+    for(i = 0;i < HRTF_FFT_SIZE;i += n*2)
     {
-        const ALuint off = (Offset+c)&HRIR_MASK;
-        Values[off][0] += Coeffs[c][0] * left;
-        Values[off][1] += Coeffs[c][1] * right;
+        ALfloat *RESTRICT ar = &re[i], *RESTRICT ai = &im[i];
+        ALfloat *RESTRICT br = &re[i+n], *RESTRICT bi = &im[i+n];
+        for(k = 0;k < n;k++)
+        {
+            const ALfloat tr = br[k]*wr[k] - bi[k]*wi[k];
+            const ALfloat ti = br[k]*wi[k] + bi[k]*wr[k];
+            br[k] = ar[k] - tr;
+            bi[k] = ai[k] - ti;
+            ar[k] += tr;
+            ai[k] += ti;
+        }
     }
 }
 
+/* The passes are spelled out so each gets a fixed length, which lets the
+ * compiler vectorize them. */
+#if HRTF_FFT_SIZE != 64
+#error "HrtfFFT and HrtfIFFT need updating for the new transform size"
 #endif
 
+/* Forward transform, which leaves the bins in bit-reversed order. */
+static void HrtfFFT(ALfloat *RESTRICT re, ALfloat *RESTRICT im)
+{
+    HrtfFFTPassDIF(re, im, 32);
+    HrtfFFTPassDIF(re, im, 16);
+    HrtfFFTPassDIF(re, im, 8);
+    HrtfFFTPassDIF(re, im, 4);
+    HrtfFFTPassDIF(re, im, 2);
+    HrtfFFTPassDIF(re, im, 1);
+}
+
+/* Unscaled inverse transform, taking the bins in bit-reversed order. Swapping
+ * the real and imaginary parts turns it into a forward transform. */
+static void HrtfIFFT(ALfloat *RESTRICT re, ALfloat *RESTRICT im)
+{
+    HrtfFFTPassDIT(im, re, 1);
+    HrtfFFTPassDIT(im, re, 2);
+    HrtfFFTPassDIT(im, re, 4);
+    HrtfFFTPassDIT(im, re, 8);
+    HrtfFFTPassDIT(im, re, 16);
+    HrtfFFTPassDIT(im, re, 32);
+}
+
+/* Transforms the left and right ear signals at once, packed as the real and
+ * imaginary parts, then separates out the lower half of each one's
+ * spectrum. */
+static void HrtfSplitFFT(ALfloat *RESTRICT re, ALfloat *RESTRICT im,
+                         ALfloat (*RESTRICT out)[2][HRTF_BLOCK_SIZE+1],
+                         ALfloat scale)
+{
+    ALuint k, a, b;
+
+    HrtfFFT(re, im);
+    scale *= 0.5f;
+    for(k = 0;k <= HRTF_BLOCK_SIZE;k++)
+    {
+        a = HrtfBitReverse[k];
+        b = HrtfBitReverse[(HRTF_FFT_SIZE-k) & (HRTF_FFT_SIZE-1)];
+        out[0][0][k] = (re[a] + re[b]) * scale;
+        out[0][1][k] = (im[a] - im[b]) * scale;
+        out[1][0][k] = (im[a] + im[b]) * scale;
+        out[1][1][k] = (re[b] - re[a]) * scale;
+    }
+}
+
+/* Multiplies the stored input spectra with a tail filter, and brings the
+ * result back to the time domain. Only the last block of the transform is
+ * valid output. */
+static void HrtfApplyTail(const HrtfConvState *Conv,
+                          ALfloat (*RESTRICT Filter)[2][2][HRTF_BLOCK_SIZE+1],
+                          ALuint NumParts, ALfloat *RESTRICT re,
+                          ALfloat *RESTRICT im)
+{
+    ALfloat acc[2][2][HRTF_BLOCK_SIZE+1];
+    ALuint e, k, p, s;
+
+    memset(acc, 0, sizeof(acc));
+    s = Conv->SpectraPos;
+    for(p = 0;p < NumParts;p++)
+    {
+        for(e = 0;e < 2;e++)
+        {
+            const ALfloat *RESTRICT xr = Conv->Spectra[s][e][0];
+            const ALfloat *RESTRICT xi = Conv->Spectra[s][e][1];
+            const ALfloat *RESTRICT hr = Filter[p][e][0];
+            const ALfloat *RESTRICT hi = Filter[p][e][1];
+            for(k = 0;k <= HRTF_BLOCK_SIZE;k++)
+            {
+                acc[e][0][k] += xr[k]*hr[k] - xi[k]*hi[k];
+                acc[e][1][k] += xr[k]*hi[k] + xi[k]*hr[k];
+            }
+        }
+        if(++s == HRTF_MAX_PARTS)
+            s = 0;
+    }
+
+    /* Both outputs are real, so pack them back together as left + i*right,
+     * with the upper half from the conjugates */
+    for(k = 0;k <= HRTF_BLOCK_SIZE;k++)
+    {
+        const ALuint a = HrtfBitReverse[k];
+        re[a] = acc[0][0][k] - acc[1][1][k];
+        im[a] = acc[0][1][k] + acc[1][0][k];
+    }
+    for(k = 1;k < HRTF_BLOCK_SIZE;k++)
+    {
+        const ALuint b = HrtfBitReverse[HRTF_FFT_SIZE-k];
+        re[b] = acc[0][0][k] + acc[1][1][k];
+        im[b] = acc[1][0][k] - acc[0][1][k];
+    }
+    HrtfIFFT(re, im);
+}
+
+/* Called when an input block is complete, to get the tail's output for the
+ * next one. Counter is how many steps the coefficients have left to go, so a
+ * moving source crossfades from the tail filter at the start of the block to
+ * the one at its end. */
+static void HrtfConvProcess(HrtfConvState *Conv, ALuint IrSize,
+                            ALfloat (*RESTRICT TargetCoeffs)[2],
+                            ALfloat (*RESTRICT CoeffStep)[2], ALint Counter)
+{
+    const ALuint NumParts = (IrSize-1) >> HRTF_BLOCK_BITS;
+    const ALuint TailSize = IrSize - HRTF_BLOCK_SIZE;
+    const ALint EndCounter = maxi(Counter-HRTF_BLOCK_SIZE, 0);
+    ALfloat re[HRTF_FFT_SIZE], im[HRTF_FFT_SIZE];
+    ALfloat fre[HRTF_FFT_SIZE], fim[HRTF_FFT_SIZE];
+    ALboolean fade;
+    ALuint i, c, p;
+
+    for(i = 0;i < HRTF_FFT_SIZE;i++)
+    {
+        re[i] = Conv->Input[i][0];
+        im[i] = Conv->Input[i][1];
+    }
+    if(Conv->SpectraPos == 0)
+        Conv->SpectraPos = HRTF_MAX_PARTS;
+    Conv->SpectraPos--;
+    HrtfSplitFFT(re, im, Conv->Spectra[Conv->SpectraPos], 1.0f);
+    memcpy(Conv->Input[0], Conv->Input[HRTF_BLOCK_SIZE],
+           HRTF_BLOCK_SIZE*sizeof(Conv->Input[0]));
+
+    HrtfApplyTail(Conv, Conv->Filter, NumParts, re, im);
+    if(Conv->NumParts == NumParts && EndCounter == 0 &&
+       memcmp(TargetCoeffs[HRTF_BLOCK_SIZE], Conv->Coeffs,
+              TailSize*sizeof(Conv->Coeffs[0])) == 0)
+    {
+        for(i = 0;i < HRTF_BLOCK_SIZE;i++)
+        {
+            Conv->Output[i][0] = re[HRTF_BLOCK_SIZE+i];
+            Conv->Output[i][1] = im[HRTF_BLOCK_SIZE+i];
+        }
+        return;
+    }
+
+    /* The filter changed, so make the new one and fade over to it, unless the
+     * old one was for a different length. The inverse transform's scaling is
+     * applied here. */
+    fade = (Conv->NumParts == NumParts);
+    for(c = 0;c < TailSize;c++)
+    {
+        Conv->Coeffs[c][0] = TargetCoeffs[HRTF_BLOCK_SIZE+c][0] -
+                             CoeffStep[HRTF_BLOCK_SIZE+c][0]*EndCounter;
+        Conv->Coeffs[c][1] = TargetCoeffs[HRTF_BLOCK_SIZE+c][1] -
+                             CoeffStep[HRTF_BLOCK_SIZE+c][1]*EndCounter;
+    }
+    for(;c < NumParts*HRTF_BLOCK_SIZE;c++)
+        Conv->Coeffs[c][0] = Conv->Coeffs[c][1] = 0.0f;
+    for(p = 0;p < NumParts;p++)
+    {
+        for(i = 0;i < HRTF_BLOCK_SIZE;i++)
+        {
+            fre[i] = Conv->Coeffs[p*HRTF_BLOCK_SIZE + i][0];
+            fim[i] = Conv->Coeffs[p*HRTF_BLOCK_SIZE + i][1];
+        }
+        for(;i < HRTF_FFT_SIZE;i++)
+            fre[i] = fim[i] = 0.0f;
+        HrtfSplitFFT(fre, fim, Conv->Filter[p], 1.0f/HRTF_FFT_SIZE);
+    }
+    Conv->NumParts = NumParts;
+    HrtfApplyTail(Conv, Conv->Filter, NumParts, fre, fim);
+
+    for(i = 0;i < HRTF_BLOCK_SIZE;i++)
+    {
+        const ALfloat mu = (fade ? (ALfloat)i / HRTF_BLOCK_SIZE : 1.0f);
+        Conv->Output[i][0] = lerpf(re[HRTF_BLOCK_SIZE+i],
+                                   fre[HRTF_BLOCK_SIZE+i], mu);
+        Conv->Output[i][1] = lerpf(im[HRTF_BLOCK_SIZE+i],
+                                   fim[HRTF_BLOCK_SIZE+i], mu);
+    }
+}
+
+/* Feeds the tail the ear inputs for Count samples of constant delays, straight
+ * from the history and the new data, before the kernel overwrites the history
+ * with them. Its output gets added to the dry buffer. */
+static void HrtfConvMix(HrtfConvState *Conv, ALuint IrSize,
+                        ALfloat (*RESTRICT TargetCoeffs)[2],
+                        ALfloat (*RESTRICT CoeffStep)[2],
+                        const ALfloat *RESTRICT History,
+                        const ALfloat *RESTRICT data, ALuint Offset,
+                        const ALuint *Delay,
+                        ALfloat (*RESTRICT DryBuffer)[BUFFERSIZE],
+                        ALuint OutPos, ALuint Count)
+{
+    ALuint pos = Conv->Pos;
+    ALuint i, e;
+
+    for(e = 0;e < 2;e++)
+    {
+        ALfloat (*RESTRICT Input)[2] = &Conv->Input[HRTF_BLOCK_SIZE+pos];
+        for(i = 0;i < Count && i < Delay[e];i++)
+            Input[i][e] = History[(Offset+i-Delay[e])&SRC_HISTORY_MASK];
+        for(;i < Count;i++)
+            Input[i][e] = data[i-Delay[e]];
+        for(i = 0;i < Count;i++)
+            DryBuffer[e][OutPos+i] += Conv->Output[pos+i][e];
+    }
+
+    Conv->Pos = pos + Count;
+    if(Conv->Pos == HRTF_BLOCK_SIZE)
+    {
+        HrtfConvProcess(Conv, IrSize, TargetCoeffs, CoeffStep, 0);
+        Conv->Pos = 0;
+    }
+}
+
+
+MixerFuncs CPUMixers;
+
+ALvoid aluInitMixers(void)
+{
+    InitCubicLUT();
+    InitSincTables();
+    InitHrtfFFT();
+
+    CPUMixers.MixDirect = MixDirect_C;
+    CPUMixers.MixSend = MixSend_C;
+    CPUMixers.MixHrtf = MixDirect_Hrtf_C;
+    CPUMixers.ResamplePoint = Resample_point32_C;
+    CPUMixers.ResampleLerp = Resample_lerp32_C;
+    CPUMixers.ResampleCubic = Resample_cubic32_C;
+    CPUMixers.ResampleSinc = Resample_sinc_C;
+    CPUMixers.ConvertByte = Convert_ALbyte_C;
+    CPUMixers.ConvertUByte = Convert_ALubyte_C;
+    CPUMixers.ConvertShort = Convert_ALshort_C;
+    CPUMixers.ConvertUShort = Convert_ALushort_C;
+
+#ifdef HAVE_SSE2
+    if((CPUCapFlags&CPU_CAP_SSE2))
+    {
+        CPUMixers.MixDirect = MixDirect_SSE2;
+        CPUMixers.MixSend = MixSend_SSE2;
+        CPUMixers.MixHrtf = MixDirect_Hrtf_SSE2;
+        CPUMixers.ResampleSinc = Resample_sinc_SSE2;
+        CPUMixers.ConvertByte = Convert_ALbyte_SSE2;
+        CPUMixers.ConvertUByte = Convert_ALubyte_SSE2;
+        CPUMixers.ConvertShort = Convert_ALshort_SSE2;
+        CPUMixers.ConvertUShort = Convert_ALushort_SSE2;
+    }
+#endif
+#ifdef HAVE_SSE4_1
+    if((CPUCapFlags&CPU_CAP_SSE4_1))
+    {
+        CPUMixers.ResamplePoint = Resample_point32_SSE4_1;
+        CPUMixers.ResampleLerp = Resample_lerp32_SSE4_1;
+        CPUMixers.ResampleCubic = Resample_cubic32_SSE4_1;
+    }
+#endif
+#ifdef HAVE_AVX2
+    if((CPUCapFlags&CPU_CAP_AVX2))
+    {
+        CPUMixers.MixDirect = MixDirect_AVX2;
+        CPUMixers.MixSend = MixSend_AVX2;
+        CPUMixers.ResamplePoint = Resample_point32_AVX2;
+        CPUMixers.ResampleLerp = Resample_lerp32_AVX2;
+        CPUMixers.ResampleCubic = Resample_cubic32_AVX2;
+    }
+#endif
+#ifdef HAVE_NEON
+    if((CPUCapFlags&CPU_CAP_NEON))
+        CPUMixers.MixHrtf = MixDirect_Hrtf_NEON;
+#endif
+}
+
+
 #define DECL_TEMPLATE(T, sampler)                                             \
-static void Mix_Hrtf_##T##_##sampler(ALsource *Source, ALCdevice *Device,     \
-  const ALvoid *srcdata, ALuint *DataPosInt, ALuint *DataPosFrac,             \
-  ALuint OutPos, ALuint SamplesToDo, ALuint BufferSize)                       \
+static void Resample_##T##_##sampler(const T *RESTRICT data,                  \
+  ALuint NumChannels, ALuint frac, ALuint increment,                          \
+  ALfloat *RESTRICT OutBuffer, ALuint BufferSize)                             \
 {                                                                             \
-    const ALuint NumChannels = Source->NumChannels;                           \
-    const T *RESTRICT data = srcdata;                                         \
-    const ALint *RESTRICT DelayStep = Source->Params.HrtfDelayStep;           \
-    ALfloat (*RESTRICT DryBuffer)[MAXCHANNELS];                               \
-    ALfloat *RESTRICT ClickRemoval, *RESTRICT PendingClicks;                  \
-    ALfloat (*RESTRICT CoeffStep)[2] = Source->Params.HrtfCoeffStep;          \
-    ALuint pos, frac;                                                         \
-    FILTER *DryFilter;                                                        \
-    ALuint BufferIdx;                                                         \
-    ALuint increment;                                                         \
-    ALuint i, out, c;                                                         \
-    ALfloat value;                                                            \
-                                                                              \
-    increment = Source->Params.Step;                                          \
-                                                                              \
-    DryBuffer = Device->DryBuffer;                                            \
-    ClickRemoval = Device->ClickRemoval;                                      \
-    PendingClicks = Device->PendingClicks;                                    \
-    DryFilter = &Source->Params.iirFilter;                                    \
-                                                                              \
-    pos = 0;                                                                  \
-    frac = *DataPosFrac;                                                      \
-                                                                              \
-    for(i = 0;i < NumChannels;i++)                                            \
-    {                                                                         \
-        ALfloat (*RESTRICT TargetCoeffs)[2] = Source->Params.HrtfCoeffs[i];   \
-        ALuint *RESTRICT TargetDelay = Source->Params.HrtfDelay[i];           \
-        ALfloat *RESTRICT History = Source->HrtfHistory[i];                   \
-        ALfloat (*RESTRICT Values)[2] = Source->HrtfValues[i];                \
-        ALint Counter = maxu(Source->HrtfCounter, OutPos) - OutPos;           \
-        ALuint Offset = Source->HrtfOffset + OutPos;                          \
-        ALfloat Coeffs[HRIR_LENGTH][2];                                       \
-        ALuint Delay[2];                                                      \
-        ALfloat left, right;                                                  \
-                                                                              \
-        pos = 0;                                                              \
-        frac = *DataPosFrac;                                                  \
-                                                                              \
-        for(c = 0;c < HRIR_LENGTH;c++)                                        \
-        {                                                                     \
-            Coeffs[c][0] = TargetCoeffs[c][0] - (CoeffStep[c][0]*Counter);    \
-            Coeffs[c][1] = TargetCoeffs[c][1] - (CoeffStep[c][1]*Counter);    \
-        }                                                                     \
-                                                                              \
-        Delay[0] = TargetDelay[0] - (DelayStep[0]*Counter) + 32768;           \
-        Delay[1] = TargetDelay[1] - (DelayStep[1]*Counter) + 32768;           \
-                                                                              \
-        if(LIKELY(OutPos == 0))                                               \
-        {                                                                     \
-            value = sampler(data + pos*NumChannels + i, NumChannels, frac);   \
-            value = lpFilter2PC(DryFilter, i, value);                         \
+    ALuint pos = 0;                                                           \
+    ALuint i;                                                                 \
                                                                               \
-            History[Offset&SRC_HISTORY_MASK] = value;                         \
-            left = History[(Offset-(Delay[0]>>16))&SRC_HISTORY_MASK];         \
-            right = History[(Offset-(Delay[1]>>16))&SRC_HISTORY_MASK];        \
-                                                                              \
-            ClickRemoval[FRONT_LEFT]  -= Values[(Offset+1)&HRIR_MASK][0] +    \
-                                         Coeffs[0][0] * left;                 \
-            ClickRemoval[FRONT_RIGHT] -= Values[(Offset+1)&HRIR_MASK][1] +    \
-                                         Coeffs[0][1] * right;                \
-        }                                                                     \
-        for(BufferIdx = 0;BufferIdx < BufferSize && Counter > 0;BufferIdx++)  \
-        {                                                                     \
-            value = sampler(data + pos*NumChannels + i, NumChannels, frac);   \
-            value = lpFilter2P(DryFilter, i, value);                          \
-                                                                              \
-            History[Offset&SRC_HISTORY_MASK] = value;                         \
-            left = History[(Offset-(Delay[0]>>16))&SRC_HISTORY_MASK];         \
-            right = History[(Offset-(Delay[1]>>16))&SRC_HISTORY_MASK];        \
-                                                                              \
-            Delay[0] += DelayStep[0];                                         \
-            Delay[1] += DelayStep[1];                                         \
-                                                                              \
-            Values[Offset&HRIR_MASK][0] = 0.0f;                               \
-            Values[Offset&HRIR_MASK][1] = 0.0f;                               \
-            Offset++;                                                         \
-                                                                              \
-            for(c = 0;c < HRIR_LENGTH;c++)                                    \
-            {                                                                 \
-                const ALuint off = (Offset+c)&HRIR_MASK;                      \
-                Values[off][0] += Coeffs[c][0] * left;                        \
-                Values[off][1] += Coeffs[c][1] * right;                       \
-                Coeffs[c][0] += CoeffStep[c][0];                              \
-                Coeffs[c][1] += CoeffStep[c][1];                              \
-            }                                                                 \
-                                                                              \
-            DryBuffer[OutPos][FRONT_LEFT]  += Values[Offset&HRIR_MASK][0];    \
-            DryBuffer[OutPos][FRONT_RIGHT] += Values[Offset&HRIR_MASK][1];    \
-                                                                              \
-            frac += increment;                                                \
-            pos  += frac>>FRACTIONBITS;                                       \
-            frac &= FRACTIONMASK;                                             \
-            OutPos++;                                                         \
-            Counter--;                                                        \
-        }                                                                     \
-                                                                              \
-        Delay[0] >>= 16;                                                      \
-        Delay[1] >>= 16;                                                      \
-        for(;BufferIdx < BufferSize;BufferIdx++)                              \
-        {                                                                     \
-            value = sampler(data + pos*NumChannels + i, NumChannels, frac);   \
-            value = lpFilter2P(DryFilter, i, value);                          \
-                                                                              \
-            History[Offset&SRC_HISTORY_MASK] = value;                         \
-            left = History[(Offset-Delay[0])&SRC_HISTORY_MASK];               \
-            right = History[(Offset-Delay[1])&SRC_HISTORY_MASK];              \
-                                                                              \
-            Values[Offset&HRIR_MASK][0] = 0.0f;                               \
-            Values[Offset&HRIR_MASK][1] = 0.0f;                               \
-            Offset++;                                                         \
-                                                                              \
-            ApplyCoeffs(Offset, Values, Coeffs, left, right);                 \
-            DryBuffer[OutPos][FRONT_LEFT]  += Values[Offset&HRIR_MASK][0];    \
-            DryBuffer[OutPos][FRONT_RIGHT] += Values[Offset&HRIR_MASK][1];    \
-                                                                              \
-            frac += increment;                                                \
-            pos  += frac>>FRACTIONBITS;                                       \
-            frac &= FRACTIONMASK;                                             \
-            OutPos++;                                                         \
-        }                                                                     \
-        if(LIKELY(OutPos == SamplesToDo))                                     \
-        {                                                                     \
-            value = sampler(data + pos*NumChannels + i, NumChannels, frac);   \
-            value = lpFilter2PC(DryFilter, i, value);                         \
-                                                                              \
-            History[Offset&SRC_HISTORY_MASK] = value;                         \
-            left = History[(Offset-Delay[0])&SRC_HISTORY_MASK];               \
-            right = History[(Offset-Delay[1])&SRC_HISTORY_MASK];              \
-                                                                              \
-            PendingClicks[FRONT_LEFT]  += Values[(Offset+1)&HRIR_MASK][0] +   \
-                                          Coeffs[0][0] * left;                \
-            PendingClicks[FRONT_RIGHT] += Values[(Offset+1)&HRIR_MASK][1] +   \
-                                          Coeffs[0][1] * right;               \
-        }                                                                     \
-        OutPos -= BufferSize;                                                 \
-    }                                                                         \
-                                                                              \
-    for(out = 0;out < Device->NumAuxSends;out++)                              \
+    for(i = 0;i < BufferSize;i++)                                             \
     {                                                                         \
-        ALeffectslot *Slot = Source->Params.Send[out].Slot;                   \
-        ALfloat  WetSend;                                                     \
-        ALfloat *RESTRICT WetBuffer;                                          \
-        ALfloat *RESTRICT WetClickRemoval;                                    \
-        ALfloat *RESTRICT WetPendingClicks;                                   \
-        FILTER  *WetFilter;                                                   \
-                                                                              \
-        if(!Slot || Slot->effect.type == AL_EFFECT_NULL)                      \
-            continue;                                                         \
-                                                                              \
-        WetBuffer = Slot->WetBuffer;                                          \
-        WetClickRemoval = Slot->ClickRemoval;                                 \
-        WetPendingClicks = Slot->PendingClicks;                               \
-        WetFilter = &Source->Params.Send[out].iirFilter;                      \
-        WetSend = Source->Params.Send[out].WetGain;                           \
-                                                                              \
-        for(i = 0;i < NumChannels;i++)                                        \
-        {                                                                     \
-            pos = 0;                                                          \
-            frac = *DataPosFrac;                                              \
-                                                                              \
-            if(LIKELY(OutPos == 0))                                           \
-            {                                                                 \
-                value = sampler(data + pos*NumChannels + i, NumChannels,frac);\
-                value = lpFilter1PC(WetFilter, i, value);                     \
-                                                                              \
-                WetClickRemoval[0] -= value * WetSend;                        \
-            }                                                                 \
-            for(BufferIdx = 0;BufferIdx < BufferSize;BufferIdx++)             \
-            {                                                                 \
-                value = sampler(data + pos*NumChannels + i, NumChannels,frac);\
-                value = lpFilter1P(WetFilter, i, value);                      \
+        OutBuffer[i] = sampler(data + pos*NumChannels, NumChannels, frac);    \
                                                                               \
-                WetBuffer[OutPos] += value * WetSend;                         \
-                                                                              \
-                frac += increment;                                            \
-                pos  += frac>>FRACTIONBITS;                                   \
-                frac &= FRACTIONMASK;                                         \
-                OutPos++;                                                     \
-            }                                                                 \
-            if(LIKELY(OutPos == SamplesToDo))                                 \
-            {                                                                 \
-                value = sampler(data + pos*NumChannels + i, NumChannels,frac);\
-                value = lpFilter1PC(WetFilter, i, value);                     \
-                                                                              \
-                WetPendingClicks[0] += value * WetSend;                       \
-            }                                                                 \
-            OutPos -= BufferSize;                                             \
-        }                                                                     \
+        frac += increment;                                                    \
+        pos  += frac>>FRACTIONBITS;                                           \
+        frac &= FRACTIONMASK;                                                 \
     }                                                                         \
-    *DataPosInt += pos;                                                       \
-    *DataPosFrac = frac;                                                      \
 }
 
-DECL_TEMPLATE(ALfloat, point32)
-DECL_TEMPLATE(ALfloat, lerp32)
-DECL_TEMPLATE(ALfloat, cubic32)
-
 DECL_TEMPLATE(ALshort, point16)
 DECL_TEMPLATE(ALshort, lerp16)
 DECL_TEMPLATE(ALshort, cubic16)
@@ -328,130 +566,404 @@ DECL_TEMPLATE(ALbyte, cubic8)
 
 #undef DECL_TEMPLATE
 
+/* Float samples go straight to the selected resampling kernels */
+#define DECL_TEMPLATE(sampler, func)                                          \
+static __inline void Resample_ALfloat_##sampler(const ALfloat *RESTRICT data, \
+  ALuint NumChannels, ALuint frac, ALuint increment,                          \
+  ALfloat *RESTRICT OutBuffer, ALuint BufferSize)                             \
+{                                                                             \
+    CPUMixers.func(data, NumChannels, frac, increment, OutBuffer,           \
+                   BufferSize);                                               \
+}
 
-#define DECL_TEMPLATE(T, sampler)                                             \
-static void Mix_##T##_##sampler(ALsource *Source, ALCdevice *Device,          \
-  const ALvoid *srcdata, ALuint *DataPosInt, ALuint *DataPosFrac,             \
-  ALuint OutPos, ALuint SamplesToDo, ALuint BufferSize)                       \
+DECL_TEMPLATE(point32, ResamplePoint)
+DECL_TEMPLATE(lerp32, ResampleLerp)
+DECL_TEMPLATE(cubic32, ResampleCubic)
+
+#undef DECL_TEMPLATE
+
+/* The sinc resampler converts the frames it reads into a float buffer for the
+ * filter kernel, a piece at a time so any step fits. When stepping over more
+ * frames than the filter reads, each sample's frames are converted on their
+ * own instead. */
+#define SINC_SRC_SIZE  1024
+
+#define DECL_TEMPLATE(T, sampler, scale)                                      \
+static void Resample_##T##_##sampler(const T *RESTRICT data,                  \
+  ALuint NumChannels, ALuint frac, ALuint increment,                          \
+  ALfloat *RESTRICT OutBuffer, ALuint BufferSize)                             \
 {                                                                             \
-    const ALuint NumChannels = Source->NumChannels;                           \
-    const T *RESTRICT data = srcdata;                                         \
-    ALfloat (*DryBuffer)[MAXCHANNELS];                                        \
-    ALfloat *ClickRemoval, *PendingClicks;                                    \
-    ALuint pos, frac;                                                         \
-    ALfloat DrySend[MAXCHANNELS][MAXCHANNELS];                                \
-    FILTER *DryFilter;                                                        \
-    ALuint BufferIdx;                                                         \
-    ALuint increment;                                                         \
-    ALuint i, out, c;                                                         \
-    ALfloat value;                                                            \
-                                                                              \
-    increment = Source->Params.Step;                                          \
+    const ALfloat *filter = GetSincFilter(increment);                         \
+    ALfloat SrcData[SINC_SRC_SIZE];                                           \
+    ALuint todo, count, i;                                                    \
+    ALuint64 pos;                                                             \
                                                                               \
-    DryBuffer = Device->DryBuffer;                                            \
-    ClickRemoval = Device->ClickRemoval;                                      \
-    PendingClicks = Device->PendingClicks;                                    \
-    DryFilter = &Source->Params.iirFilter;                                    \
-    for(i = 0;i < NumChannels;i++)                                            \
+    data -= SINC_PRE_POINTS*NumChannels;                                      \
+    while(BufferSize > 0)                                                     \
     {                                                                         \
-        for(c = 0;c < MAXCHANNELS;c++)                                        \
-            DrySend[i][c] = Source->Params.DryGains[i][c];                    \
-    }                                                                         \
-                                                                              \
-    pos = 0;                                                                  \
-    frac = *DataPosFrac;                                                      \
-                                                                              \
-    for(i = 0;i < NumChannels;i++)                                            \
-    {                                                                         \
-        pos = 0;                                                              \
-        frac = *DataPosFrac;                                                  \
-                                                                              \
-        if(OutPos == 0)                                                       \
+        if(increment > (SINC_POINTS<<FRACTIONBITS))                           \
+            todo = 1;                                                         \
+        else                                                                  \
         {                                                                     \
-            value = sampler(data + pos*NumChannels + i, NumChannels, frac);   \
-                                                                              \
-            value = lpFilter2PC(DryFilter, i, value);                         \
-            for(c = 0;c < MAXCHANNELS;c++)                                    \
-                ClickRemoval[c] -= value*DrySend[i][c];                       \
+            pos  = (ALuint64)(SINC_SRC_SIZE-SINC_POINTS) << FRACTIONBITS;     \
+            todo = (ALuint)minu64((pos-frac)/increment + 1, BufferSize);      \
         }                                                                     \
-        for(BufferIdx = 0;BufferIdx < BufferSize;BufferIdx++)                 \
-        {                                                                     \
-            value = sampler(data + pos*NumChannels + i, NumChannels, frac);   \
-                                                                              \
-            value = lpFilter2P(DryFilter, i, value);                          \
-            for(c = 0;c < MAXCHANNELS;c++)                                    \
-                DryBuffer[OutPos][c] += value*DrySend[i][c];                  \
                                                                               \
-            frac += increment;                                                \
-            pos  += frac>>FRACTIONBITS;                                       \
-            frac &= FRACTIONMASK;                                             \
-            OutPos++;                                                         \
-        }                                                                     \
-        if(OutPos == SamplesToDo)                                             \
-        {                                                                     \
-            value = sampler(data + pos*NumChannels + i, NumChannels, frac);   \
+        pos   = (ALuint64)increment*(todo-1) + frac;                          \
+        count = (ALuint)(pos>>FRACTIONBITS) + SINC_POINTS;                    \
+        for(i = 0;i < count;i++)                                              \
+            SrcData[i] = data[i*NumChannels] * scale;                         \
+        CPUMixers.ResampleSinc(SrcData, frac, increment, filter, OutBuffer,   \
+                               todo);                                         \
+        OutBuffer  += todo;                                                   \
+        BufferSize -= todo;                                                   \
                                                                               \
-            value = lpFilter2PC(DryFilter, i, value);                         \
-            for(c = 0;c < MAXCHANNELS;c++)                                    \
-                PendingClicks[c] += value*DrySend[i][c];                      \
-        }                                                                     \
-        OutPos -= BufferSize;                                                 \
+        pos  += increment;                                                    \
+        data += (pos>>FRACTIONBITS)*NumChannels;                              \
+        frac  = (ALuint)pos & FRACTIONMASK;                                   \
     }                                                                         \
+}
+
+DECL_TEMPLATE(ALfloat, sinc32, 1.0f)
+DECL_TEMPLATE(ALshort, sinc16, (1.0f/32767.0f))
+DECL_TEMPLATE(ALbyte, sinc8, (1.0f/127.0f))
+
+#undef DECL_TEMPLATE
+
+
+static void MixSends(ALsource *Source, ALCdevice *Device, ALuint chan,
+                     const ALfloat *RESTRICT data, ALfloat *RESTRICT temp,
+                     ALuint OutPos, ALuint SamplesToDo, ALuint BufferSize)
+{
+    ALuint out, pos;
+    ALfloat value;
+
+    for(out = 0;out < Device->NumAuxSends;out++)
+    {
+        ALeffectslot *Slot = Source->Params->Send[out].Slot;
+        ALfloat *RESTRICT WetBuffer;
+        ALfloat *RESTRICT ClickRemoval, *RESTRICT PendingClicks;
+        ALfloat  WetSend;
+        FILTER  *WetFilter;
+
+        if(!Slot || Slot->effect.type == AL_EFFECT_NULL)
+            continue;
+
+        WetBuffer = Slot->WetBuffer;
+        ClickRemoval = Slot->ClickRemoval;
+        PendingClicks = Slot->PendingClicks;
+        Slot->WetMixed = AL_TRUE;
+
+        WetFilter = &Source->SendFilter[out].iirFilter;
+        WetFilter->coeff = Source->Params->Send[out].iirCoeff;
+        WetSend = Source->Params->Send[out].WetGain;
+
+        if(LIKELY(OutPos == 0))
+        {
+            value = lpFilter1PC(WetFilter, chan, data[0]);
+            ClickRemoval[0] -= value * WetSend;
+        }
+        for(pos = 0;pos < BufferSize;pos++)
+            temp[pos] = lpFilter1P(WetFilter, chan, data[pos]);
+        CPUMixers.MixSend(WetBuffer, temp, WetSend, OutPos, BufferSize);
+        if(LIKELY(OutPos+BufferSize == SamplesToDo))
+        {
+            value = lpFilter1PC(WetFilter, chan, data[BufferSize]);
+            PendingClicks[0] += value * WetSend;
+        }
+    }
+}
+
+
+/* Filters a resampled source channel for the dry path. The filtered values of
+ * the first sample and of the one past the end are also kept when the update
+ * starts or ends here, for click removal. */
+static void FilterDry(ALsource *Source, ALuint chan,
+                      const ALfloat *RESTRICT data, ALfloat *RESTRICT out,
+                      ALfloat *RESTRICT Clicks, ALuint OutPos,
+                      ALuint SamplesToDo, ALuint BufferSize)
+{
+    FILTER *DryFilter = &Source->iirFilter;
+    ALuint j;
+
+    DryFilter->coeff = Source->Params->iirCoeff;
+
+    if(OutPos == 0)
+        Clicks[0] = lpFilter2PC(DryFilter, chan, data[0]);
+    for(j = 0;j < BufferSize;j++)
+        out[j] = lpFilter2P(DryFilter, chan, data[j]);
+    if(OutPos+BufferSize == SamplesToDo)
+        Clicks[1] = lpFilter2PC(DryFilter, chan, data[BufferSize]);
+}
+
+
+/* Mixes a resampled and filtered source channel into the dry buffer with its
+ * HRIRs, and into the auxiliary sends. FilteredData is overwritten by the
+ * sends. */
+static void MixChannelHrtf(ALsource *Source, ALCdevice *Device,
+                           MixBuffers *Target, ALuint i,
+                           const ALfloat *RESTRICT ResampledData,
+                           ALfloat *RESTRICT FilteredData,
+                           const ALfloat *RESTRICT Clicks, ALuint OutPos,
+                           ALuint SamplesToDo, ALuint BufferSize)
+{
+    const ALuint NumChannels = Source->NumChannels;
+    const ALint *RESTRICT DelayStep = Source->Params->HrtfDelayStep;
+    const ALuint IrSize = GetHrtfIrSize(Device->Hrtf);
+    ALfloat (*RESTRICT DryBuffer)[BUFFERSIZE] = Target->DryBuffer;
+    ALfloat *RESTRICT ClickRemoval = Target->ClickRemoval;
+    ALfloat *RESTRICT PendingClicks = Target->PendingClicks;
+    ALfloat (*RESTRICT CoeffStep)[2] = Source->Params->HrtfCoeffStep;
+    ALfloat (*RESTRICT TargetCoeffs)[2] = &Source->Params->HrtfCoeffs[i*IrSize];
+    ALuint *RESTRICT TargetDelay = Source->Params->HrtfDelay[i];
+    ALfloat *RESTRICT History = Source->HrtfHistory[i];
+    const ALuint ValuesMask = Source->HrtfValuesMask;
+    ALfloat (*RESTRICT Values)[2] = &Source->HrtfValues[i*(ValuesMask+1)];
+    ALint Counter = maxu(Source->Params->HrtfCounter, OutPos) - OutPos;
+    ALuint Offset = Source->HrtfOffset + OutPos;
+    HrtfConvState *Conv = NULL;
+    ALuint HeadSize = IrSize;
+    ALfloat Coeffs[HRIR_LENGTH][2];
+    ALuint Delay[2];
+    ALfloat left, right;
+    ALuint j, c;
+
+    /* With a long HRIR, only its head is applied here. The rest is left to
+     * the source's convolvers, if it has them. */
+    if(IrSize > HRTF_CONV_MIN_IRSIZE && Source->HrtfConvChannels >= NumChannels)
+    {
+        Conv = &Source->HrtfConv[i];
+        HeadSize = HRTF_BLOCK_SIZE;
+    }
+
+    for(c = 0;c < HeadSize;c++)
+    {
+        Coeffs[c][0] = TargetCoeffs[c][0] - (CoeffStep[c][0]*Counter);
+        Coeffs[c][1] = TargetCoeffs[c][1] - (CoeffStep[c][1]*Counter);
+    }
+
+    Delay[0] = TargetDelay[0] - (DelayStep[0]*Counter) + 32768;
+    Delay[1] = TargetDelay[1] - (DelayStep[1]*Counter) + 32768;
+
+    if(LIKELY(OutPos == 0))
+    {
+        History[Offset&SRC_HISTORY_MASK] = Clicks[0];
+        left = History[(Offset-(Delay[0]>>16))&SRC_HISTORY_MASK];
+        right = History[(Offset-(Delay[1]>>16))&SRC_HISTORY_MASK];
+
+        ClickRemoval[0] -= Values[(Offset+1)&ValuesMask][0] +
+                           Coeffs[0][0] * left;
+        ClickRemoval[1] -= Values[(Offset+1)&ValuesMask][1] +
+                           Coeffs[0][1] * right;
+        if(Conv)
+        {
+            ClickRemoval[0] -= Conv->Output[Conv->Pos][0];
+            ClickRemoval[1] -= Conv->Output[Conv->Pos][1];
+        }
+    }
+
+    for(j = 0;j < BufferSize && Counter > 0;j++)
+    {
+        History[Offset&SRC_HISTORY_MASK] = FilteredData[j];
+        left = History[(Offset-(Delay[0]>>16))&SRC_HISTORY_MASK];
+        right = History[(Offset-(Delay[1]>>16))&SRC_HISTORY_MASK];
+
+        Delay[0] += DelayStep[0];
+        Delay[1] += DelayStep[1];
+
+        Values[Offset&ValuesMask][0] = 0.0f;
+        Values[Offset&ValuesMask][1] = 0.0f;
+        Offset++;
+
+        for(c = 0;c < HeadSize;c++)
+        {
+            const ALuint off = (Offset+c)&ValuesMask;
+            Values[off][0] += Coeffs[c][0] * left;
+            Values[off][1] += Coeffs[c][1] * right;
+            Coeffs[c][0] += CoeffStep[c][0];
+            Coeffs[c][1] += CoeffStep[c][1];
+        }
+
+        DryBuffer[0][OutPos] += Values[Offset&ValuesMask][0];
+        DryBuffer[1][OutPos] += Values[Offset&ValuesMask][1];
+
+        if(Conv)
+        {
+            Conv->Input[HRTF_BLOCK_SIZE+Conv->Pos][0] = left;
+            Conv->Input[HRTF_BLOCK_SIZE+Conv->Pos][1] = right;
+            DryBuffer[0][OutPos] += Conv->Output[Conv->Pos][0];
+            DryBuffer[1][OutPos] += Conv->Output[Conv->Pos][1];
+            if(++Conv->Pos == HRTF_BLOCK_SIZE)
+            {
+                HrtfConvProcess(Conv, IrSize, TargetCoeffs, CoeffStep,
+                                Counter-1);
+                Conv->Pos = 0;
+            }
+        }
+
+        OutPos++;
+        Counter--;
+    }
+
+    Delay[0] >>= 16;
+    Delay[1] >>= 16;
+    if(!Conv)
+    {
+        CPUMixers.MixHrtf(DryBuffer, FilteredData+j, History, Values,
+                          ValuesMask, Offset, Delay, Coeffs, IrSize, OutPos,
+                          BufferSize-j);
+        Offset += BufferSize-j;
+        OutPos += BufferSize-j;
+    }
+    else while(j < BufferSize)
+    {
+        /* Stop at each block end, for the tail to process it */
+        const ALuint todo = minu(BufferSize-j, HRTF_BLOCK_SIZE-Conv->Pos);
+        HrtfConvMix(Conv, IrSize, TargetCoeffs, CoeffStep, History,
+                    FilteredData+j, Offset, Delay, DryBuffer, OutPos, todo);
+        CPUMixers.MixHrtf(DryBuffer, FilteredData+j, History, Values,
+                          ValuesMask, Offset, Delay, Coeffs, HeadSize, OutPos,
+                          todo);
+        Offset += todo;
+        OutPos += todo;
+        j += todo;
+    }
+
+    if(LIKELY(OutPos == SamplesToDo))
+    {
+        History[Offset&SRC_HISTORY_MASK] = Clicks[1];
+        left = History[(Offset-Delay[0])&SRC_HISTORY_MASK];
+        right = History[(Offset-Delay[1])&SRC_HISTORY_MASK];
+
+        PendingClicks[0] += Values[(Offset+1)&ValuesMask][0] +
+                            Coeffs[0][0] * left;
+        PendingClicks[1] += Values[(Offset+1)&ValuesMask][1] +
+                            Coeffs[0][1] * right;
+        if(Conv)
+        {
+            PendingClicks[0] += Conv->Output[Conv->Pos][0];
+            PendingClicks[1] += Conv->Output[Conv->Pos][1];
+        }
+    }
+    OutPos -= BufferSize;
+
+    MixSends(Source, Device, i, ResampledData, FilteredData, OutPos,
+             SamplesToDo, BufferSize);
+}
+
+/* Mixes a resampled and filtered source channel into the dry buffer with its
+ * channel gains, and into the auxiliary sends. FilteredData is overwritten by
+ * the sends. */
+static void MixChannel(ALsource *Source, ALCdevice *Device, MixBuffers *Target,
+                       ALuint i, const ALfloat *RESTRICT ResampledData,
+                       ALfloat *RESTRICT FilteredData,
+                       const ALfloat *RESTRICT Clicks, ALuint OutPos,
+                       ALuint SamplesToDo, ALuint BufferSize)
+{
+    const ALuint NumDryChannels = Device->NumDryChannels;
+    /* The ambisonic bus's channels are the DryGains columns themselves */
+    const enum Channel *ChanMap = (Device->AmbiOrder ? NULL :
+                                   Device->DevChannels);
+    ALfloat *ClickRemoval = Target->ClickRemoval;
+    ALfloat *PendingClicks = Target->PendingClicks;
+    ALfloat DrySend[MAXCHANNELS] = { 0.0f };
+    ALuint c;
+
+    for(c = 0;c < NumDryChannels;c++)
+    {
+        ALuint chan = (ChanMap ? (ALuint)ChanMap[c] : c);
+        DrySend[c] = Source->Params->DryGains[i][chan];
+    }
+
+    if(OutPos == 0)
+    {
+        for(c = 0;c < NumDryChannels;c++)
+            ClickRemoval[c] -= Clicks[0]*DrySend[c];
+    }
+    CPUMixers.MixDirect(Target->DryBuffer, FilteredData, DrySend,
+                        NumDryChannels, OutPos, BufferSize);
+    if(OutPos+BufferSize == SamplesToDo)
+    {
+        for(c = 0;c < NumDryChannels;c++)
+            PendingClicks[c] += Clicks[1]*DrySend[c];
+    }
+
+    MixSends(Source, Device, i, ResampledData, FilteredData, OutPos,
+             SamplesToDo, BufferSize);
+}
+
+
+/* Each source channel is resampled once into a temporary buffer, which then
+ * gets filtered and handed to the mixing kernels for the dry path and each
+ * auxiliary send. One extra sample is resampled past the end of the buffer to
+ * get the value needed for click removal when the mix ends here.
+ *
+ * Without a target, the channels are only resampled and filtered into the
+ * source's MixTemp, to be mixed later by MixSourceTemp. */
+#define DECL_TEMPLATE(T, sampler)                                             \
+static void MixChannels_##T##_##sampler(ALsource *Source,                     \
+  ALCdevice *Device, MixBuffers *Target, const ALvoid *srcdata, ALuint frac,  \
+  ALuint increment, ALuint OutPos, ALuint SamplesToDo, ALuint BufferSize,     \
+  ALboolean Hrtf)                                                             \
+{                                                                             \
+    const ALuint NumChannels = Source->NumChannels;                           \
+    const T *RESTRICT data = srcdata;                                         \
+    SourceMixTemp *Temp = (Target ? NULL : Source->MixTemp);                  \
+    ALfloat ResampledData[BUFFERSIZE+1];                                      \
+    ALfloat FilteredData[BUFFERSIZE];                                         \
+    ALfloat Clicks[2];                                                        \
+    ALuint i;                                                                 \
                                                                               \
-    for(out = 0;out < Device->NumAuxSends;out++)                              \
+    for(i = 0;i < NumChannels;i++)                                            \
     {                                                                         \
-        ALeffectslot *Slot = Source->Params.Send[out].Slot;                   \
-        ALfloat  WetSend;                                                     \
-        ALfloat *WetBuffer;                                                   \
-        ALfloat *WetClickRemoval;                                             \
-        ALfloat *WetPendingClicks;                                            \
-        FILTER  *WetFilter;                                                   \
-                                                                              \
-        if(!Slot || Slot->effect.type == AL_EFFECT_NULL)                      \
-            continue;                                                         \
-                                                                              \
-        WetBuffer = Slot->WetBuffer;                                          \
-        WetClickRemoval = Slot->ClickRemoval;                                 \
-        WetPendingClicks = Slot->PendingClicks;                               \
-        WetFilter = &Source->Params.Send[out].iirFilter;                      \
-        WetSend = Source->Params.Send[out].WetGain;                           \
-                                                                              \
-        for(i = 0;i < NumChannels;i++)                                        \
+        if(Temp)                                                              \
         {                                                                     \
-            pos = 0;                                                          \
-            frac = *DataPosFrac;                                              \
-                                                                              \
-            if(OutPos == 0)                                                   \
-            {                                                                 \
-                value = sampler(data + pos*NumChannels + i, NumChannels,frac);\
+            SourceMixChannel *Chan = &Temp->Channels[i];                      \
+            Resample_##T##_##sampler(data + i, NumChannels, frac, increment,  \
+                                     Chan->Resampled+OutPos, BufferSize+1);   \
+            FilterDry(Source, i, Chan->Resampled+OutPos,                      \
+                      Chan->Filtered+OutPos, Chan->Clicks, OutPos,            \
+                      SamplesToDo, BufferSize);                               \
+            continue;                                                         \
+        }                                                                     \
                                                                               \
-                value = lpFilter1PC(WetFilter, i, value);                     \
-                WetClickRemoval[0] -= value * WetSend;                        \
-            }                                                                 \
-            for(BufferIdx = 0;BufferIdx < BufferSize;BufferIdx++)             \
-            {                                                                 \
-                value = sampler(data + pos*NumChannels + i, NumChannels,frac);\
+        Resample_##T##_##sampler(data + i, NumChannels, frac, increment,      \
+                                 ResampledData, BufferSize+1);                \
+        FilterDry(Source, i, ResampledData, FilteredData, Clicks, OutPos,     \
+                  SamplesToDo, BufferSize);                                   \
+        if(Hrtf)                                                              \
+            MixChannelHrtf(Source, Device, Target, i, ResampledData,          \
+                           FilteredData, Clicks, OutPos, SamplesToDo,         \
+                           BufferSize);                                       \
+        else                                                                  \
+            MixChannel(Source, Device, Target, i, ResampledData,              \
+                       FilteredData, Clicks, OutPos, SamplesToDo,             \
+                       BufferSize);                                           \
+    }                                                                         \
                                                                               \
-                value = lpFilter1P(WetFilter, i, value);                      \
-                WetBuffer[OutPos] += value * WetSend;                         \
+    if(Temp)                                                                  \
+    {                                                                         \
+        Temp->SegmentSize[Temp->NumSegments++] = BufferSize;                  \
+        Temp->Hrtf = Hrtf;                                                    \
+    }                                                                         \
+}                                                                             \
                                                                               \
-                frac += increment;                                            \
-                pos  += frac>>FRACTIONBITS;                                   \
-                frac &= FRACTIONMASK;                                         \
-                OutPos++;                                                     \
-            }                                                                 \
-            if(OutPos == SamplesToDo)                                         \
-            {                                                                 \
-                value = sampler(data + pos*NumChannels + i, NumChannels,frac);\
+static void Mix_Hrtf_##T##_##sampler(ALsource *Source, ALCdevice *Device,     \
+  MixBuffers *Target, const ALvoid *srcdata, ALuint frac, ALuint increment,   \
+  ALuint OutPos, ALuint SamplesToDo, ALuint BufferSize)                       \
+{                                                                             \
+    MixChannels_##T##_##sampler(Source, Device, Target, srcdata, frac,        \
+                                increment, OutPos, SamplesToDo, BufferSize,   \
+                                AL_TRUE);                                     \
+}                                                                             \
                                                                               \
-                value = lpFilter1PC(WetFilter, i, value);                     \
-                WetPendingClicks[0] += value * WetSend;                       \
-            }                                                                 \
-            OutPos -= BufferSize;                                             \
-        }                                                                     \
-    }                                                                         \
-    *DataPosInt += pos;                                                       \
-    *DataPosFrac = frac;                                                      \
+static void Mix_##T##_##sampler(ALsource *Source, ALCdevice *Device,          \
+  MixBuffers *Target, const ALvoid *srcdata, ALuint frac, ALuint increment,   \
+  ALuint OutPos, ALuint SamplesToDo, ALuint BufferSize)                       \
+{                                                                             \
+    MixChannels_##T##_##sampler(Source, Device, Target, srcdata, frac,        \
+                                increment, OutPos, SamplesToDo, BufferSize,   \
+                                AL_FALSE);                                    \
 }
 
 DECL_TEMPLATE(ALfloat, point32)
@@ -466,6 +978,10 @@ DECL_TEMPLATE(ALbyte, point8)
 DECL_TEMPLATE(ALbyte, lerp8)
 DECL_TEMPLATE(ALbyte, cubic8)
 
+DECL_TEMPLATE(ALfloat, sinc32)
+DECL_TEMPLATE(ALshort, sinc16)
+DECL_TEMPLATE(ALbyte, sinc8)
+
 #undef DECL_TEMPLATE
 
 
@@ -487,6 +1003,7 @@ static MixerFunc Select_##sampler(enum FmtType FmtType)                       \
 DECL_TEMPLATE(point)
 DECL_TEMPLATE(lerp)
 DECL_TEMPLATE(cubic)
+DECL_TEMPLATE(sinc)
 
 #undef DECL_TEMPLATE
 
@@ -500,6 +1017,8 @@ MixerFunc SelectMixer(ALbuffer *Buffer, enum Resampler Resampler)
             return Select_lerp(Buffer->FmtType);
         case CUBIC_RESAMPLER:
             return Select_cubic(Buffer->FmtType);
+        case SINC_RESAMPLER:
+            return Select_sinc(Buffer->FmtType);
         case RESAMPLER_MIN:
         case RESAMPLER_MAX:
             break;
@@ -525,6 +1044,7 @@ static MixerFunc Select_Hrtf_##sampler(enum FmtType FmtType)                  \
 DECL_TEMPLATE(point)
 DECL_TEMPLATE(lerp)
 DECL_TEMPLATE(cubic)
+DECL_TEMPLATE(sinc)
 
 #undef DECL_TEMPLATE
 
@@ -538,6 +1058,8 @@ MixerFunc SelectHrtfMixer(ALbuffer *Buffer, enum Resampler Resampler)
             return Select_Hrtf_lerp(Buffer->FmtType);
         case CUBIC_RESAMPLER:
             return Select_Hrtf_cubic(Buffer->FmtType);
+        case SINC_RESAMPLER:
+            return Select_Hrtf_sinc(Buffer->FmtType);
         case RESAMPLER_MIN:
         case RESAMPLER_MAX:
             break;
@@ -546,7 +1068,236 @@ MixerFunc SelectHrtfMixer(ALbuffer *Buffer, enum Resampler Resampler)
 }
 
 
-ALvoid MixSource(ALsource *Source, ALCdevice *Device, ALuint SamplesToDo)
+/* Returns how many samples can be mixed from the given number of source
+ * frames, which include the resampler's padding. Enough is kept back for the
+ * extra sample used for click removal. */
+static __inline ALuint SamplesForFrames(ALint64 frames, ALuint padding,
+                                        ALuint frac, ALuint increment)
+{
+    frames -= padding;
+    frames <<= FRACTIONBITS;
+    frames -= increment;
+    frames -= frac;
+    if(frames <= 0)
+        return 0;
+    frames = (frames+(increment-1)) / increment;
+    return (ALuint)((frames < BUFFERSIZE) ? frames : BUFFERSIZE);
+}
+
+/* Copies size bytes of a buffer's samples, starting at byte offset pos.
+ * Compressed buffers are decoded, using the source's decode cache. */
+static __inline ALvoid CopyBufferData(ALubyte *dst, ALsource *Source,
+                                      const ALbuffer *ALBuffer, ALuint pos,
+                                      ALuint size, ALuint FrameSize)
+{
+    if(!ALBuffer->Compressed)
+        memcpy(dst, &((const ALubyte*)ALBuffer->data)[pos], size);
+    else
+        DecodeBufferFrames(ALBuffer, pos/FrameSize, size/FrameSize,
+                           (ALshort*)dst, &Source->DecodeCache);
+}
+
+/* Fills SrcData with BufferSize bytes of a static source's buffer, starting
+ * BufferPrePadding frames before DataPosInt. Anything outside the buffer is
+ * silence, unless looping, in which case the loop section repeats. */
+static ALvoid FillStaticData(ALubyte *SrcData, ALuint BufferSize,
+                             ALsource *Source, const ALbuffer *ALBuffer,
+                             ALuint DataPosInt, ALboolean Looping,
+                             ALuint BufferPrePadding, ALuint FrameSize)
+{
+    ALuint SrcDataSize = 0;
+    ALuint DataSize;
+    ALuint pos;
+
+    if(Looping == AL_FALSE)
+    {
+        if(DataPosInt >= BufferPrePadding)
+            pos = (DataPosInt-BufferPrePadding)*FrameSize;
+        else
+        {
+            DataSize = (BufferPrePadding-DataPosInt)*FrameSize;
+            DataSize = minu(BufferSize, DataSize);
+
+            memset(&SrcData[SrcDataSize], 0, DataSize);
+            SrcDataSize += DataSize;
+            BufferSize -= DataSize;
+
+            pos = 0;
+        }
+
+        /* Copy what's left to play in the source buffer, and clear the
+         * rest of the temp buffer */
+        DataSize = ((pos < (ALuint)ALBuffer->size) ? ALBuffer->size-pos : 0);
+        DataSize = minu(BufferSize, DataSize);
+
+        CopyBufferData(&SrcData[SrcDataSize], Source, ALBuffer, pos, DataSize,
+                       FrameSize);
+        SrcDataSize += DataSize;
+        BufferSize -= DataSize;
+
+        memset(&SrcData[SrcDataSize], 0, BufferSize);
+    }
+    else
+    {
+        ALuint LoopStart = ALBuffer->LoopStart;
+        ALuint LoopEnd   = ALBuffer->LoopEnd;
+
+        if(DataPosInt >= LoopStart)
+        {
+            pos = DataPosInt-LoopStart;
+            while(pos < BufferPrePadding)
+                pos += LoopEnd-LoopStart;
+            pos -= BufferPrePadding;
+            pos += LoopStart;
+            pos *= FrameSize;
+        }
+        else if(DataPosInt >= BufferPrePadding)
+            pos = (DataPosInt-BufferPrePadding)*FrameSize;
+        else
+        {
+            DataSize = (BufferPrePadding-DataPosInt)*FrameSize;
+            DataSize = minu(BufferSize, DataSize);
+
+            memset(&SrcData[SrcDataSize], 0, DataSize);
+            SrcDataSize += DataSize;
+            BufferSize -= DataSize;
+
+            pos = 0;
+        }
+
+        /* Copy what's left of this loop iteration, then copy repeats
+         * of the loop section */
+        DataSize = LoopEnd*FrameSize - pos;
+        DataSize = minu(BufferSize, DataSize);
+
+        CopyBufferData(&SrcData[SrcDataSize], Source, ALBuffer, pos, DataSize,
+                       FrameSize);
+        SrcDataSize += DataSize;
+        BufferSize -= DataSize;
+
+        DataSize = (LoopEnd-LoopStart) * FrameSize;
+        while(BufferSize > 0)
+        {
+            DataSize = minu(BufferSize, DataSize);
+
+            CopyBufferData(&SrcData[SrcDataSize], Source, ALBuffer,
+                           LoopStart*FrameSize, DataSize, FrameSize);
+            SrcDataSize += DataSize;
+            BufferSize -= DataSize;
+        }
+    }
+}
+
+/* Fills SrcData with BufferSize bytes from a streaming source's queue,
+ * starting BufferPrePadding frames before DataPosInt in the given queue
+ * item. Anything before the start or past the end of the queue is silence,
+ * unless looping, in which case it wraps around. */
+static ALvoid FillQueuedData(ALubyte *SrcData, ALuint BufferSize,
+                             ALsource *Source,
+                             ALbufferlistitem *BufferListItem,
+                             ALuint DataPosInt, ALboolean Looping,
+                             ALuint BufferPrePadding, ALuint FrameSize)
+{
+    /* Crawl the buffer queue to fill in the temp buffer */
+    ALbufferlistitem *BufferListIter = BufferListItem;
+    ALuint SrcDataSize = 0;
+    ALuint pos;
+
+    if(DataPosInt >= BufferPrePadding)
+        pos = (DataPosInt-BufferPrePadding)*FrameSize;
+    else
+    {
+        pos = (BufferPrePadding-DataPosInt)*FrameSize;
+        while(pos > 0)
+        {
+            if(!BufferListIter->prev && !Looping)
+            {
+                ALuint DataSize = minu(BufferSize, pos);
+
+                memset(&SrcData[SrcDataSize], 0, DataSize);
+                SrcDataSize += DataSize;
+                BufferSize -= DataSize;
+
+                pos = 0;
+                break;
+            }
+
+            if(BufferListIter->prev)
+                BufferListIter = BufferListIter->prev;
+            else
+            {
+                while(BufferListIter->next)
+                    BufferListIter = BufferListIter->next;
+            }
+
+            if(BufferListIter->buffer)
+            {
+                if((ALuint)BufferListIter->buffer->size > pos)
+                {
+                    pos = BufferListIter->buffer->size - pos;
+                    break;
+                }
+                pos -= BufferListIter->buffer->size;
+            }
+        }
+    }
+
+    while(BufferListIter && BufferSize > 0)
+    {
+        const ALbuffer *ALBuffer;
+        if((ALBuffer=BufferListIter->buffer) != NULL)
+        {
+            ALuint DataSize = ALBuffer->size;
+
+            /* Skip the data already played */
+            if(DataSize <= pos)
+                pos -= DataSize;
+            else
+            {
+                DataSize -= pos;
+
+                DataSize = minu(BufferSize, DataSize);
+                CopyBufferData(&SrcData[SrcDataSize], Source, ALBuffer, pos,
+                               DataSize, FrameSize);
+                pos -= pos;
+                SrcDataSize += DataSize;
+                BufferSize -= DataSize;
+            }
+        }
+        BufferListIter = BufferListIter->next;
+        if(!BufferListIter && Looping)
+            BufferListIter = Source->queue;
+        else if(!BufferListIter)
+        {
+            memset(&SrcData[SrcDataSize], 0, BufferSize);
+            SrcDataSize += BufferSize;
+            BufferSize -= BufferSize;
+        }
+    }
+}
+
+/* Moves the source's HRTF state past the samples just mixed */
+static void UpdateHrtfState(ALsource *Source, ALuint OutPos)
+{
+    Source->HrtfOffset += OutPos;
+    if(Source->state == AL_PLAYING)
+    {
+        Source->Params->HrtfCounter = maxu(Source->Params->HrtfCounter, OutPos) - OutPos;
+        Source->HrtfMoving  = AL_TRUE;
+    }
+    else
+    {
+        Source->Params->HrtfCounter = 0;
+        Source->HrtfMoving  = AL_FALSE;
+    }
+}
+
+/* Mixes a source into the target buffers. Without a target, the source is
+ * only resampled and filtered into its MixTemp, which MixSourceTemp mixes
+ * later on. This touches nothing but the source itself, so it can be done
+ * for different sources at once. */
+ALvoid MixSource(ALsource *Source, ALCdevice *Device, MixBuffers *Target,
+                 ALuint SamplesToDo)
 {
     ALbufferlistitem *BufferListItem;
     ALuint DataPosInt, DataPosFrac;
@@ -558,6 +1309,7 @@ ALvoid MixSource(ALsource *Source, ALCdevice *Device, ALuint SamplesToDo)
     ALuint OutPos;
     ALuint FrameSize;
     ALint64 DataSize64;
+    ALuint64 pos;
     ALuint i;
 
     /* Get source info */
@@ -566,8 +1318,8 @@ ALvoid MixSource(ALsource *Source, ALCdevice *Device, ALuint SamplesToDo)
     DataPosInt    = Source->position;
     DataPosFrac   = Source->position_fraction;
     Looping       = Source->bLooping;
-    increment     = Source->Params.Step;
-    Resampler     = Source->Resampler;
+    increment     = Source->Params->Step;
+    Resampler     = Source->Params->Resampler;
     FrameSize     = Source->NumChannels * Source->SampleSize;
 
     /* Get current buffer queue item */
@@ -575,208 +1327,149 @@ ALvoid MixSource(ALsource *Source, ALCdevice *Device, ALuint SamplesToDo)
     for(i = 0;i < BuffersPlayed;i++)
         BufferListItem = BufferListItem->next;
 
+    if(!Target)
+        Source->MixTemp->NumSegments = 0;
+
     OutPos = 0;
     do {
         const ALuint BufferPrePadding = ResamplerPrePadding[Resampler];
         const ALuint BufferPadding = ResamplerPadding[Resampler];
+        const ALbuffer *ALBuffer = BufferListItem->buffer;
         ALubyte StackData[STACK_DATA_SIZE];
-        ALubyte *SrcData = StackData;
-        ALuint SrcDataSize = 0;
-        ALuint BufferSize;
-
-        /* Figure out how many buffer bytes will be needed */
+        const ALubyte *SrcData = StackData;
+        const ALint64 StackFrames = STACK_DATA_SIZE / FrameSize;
+        ALint64 BufferFrames = 0;
+        ALboolean UseBuffer = AL_FALSE;
+        ALuint SrcIncrement = increment;
+        ALuint DataStart = 0;
+        ALuint DataEnd = 0;
+        ALuint BufferSize = 0;
+
+        /* Figure out how many buffer frames will be needed */
         DataSize64  = SamplesToDo-OutPos+1;
         DataSize64 *= increment;
         DataSize64 += DataPosFrac+FRACTIONMASK;
         DataSize64 >>= FRACTIONBITS;
         DataSize64 += BufferPadding+BufferPrePadding;
-        DataSize64 *= FrameSize;
-
-        BufferSize = ((DataSize64 > STACK_DATA_SIZE) ? STACK_DATA_SIZE : DataSize64);
-        BufferSize -= BufferSize%FrameSize;
 
-        if(Source->lSourceType == AL_STATIC)
+        if(ALBuffer)
         {
-            const ALbuffer *ALBuffer = Source->queue->buffer;
-            const ALubyte *Data = ALBuffer->data;
-            ALuint DataSize;
-            ALuint pos;
-
-            /* If current pos is beyond the loop range, do not loop */
-            if(Looping == AL_FALSE || DataPosInt >= (ALuint)ALBuffer->LoopEnd)
+            DataEnd = ALBuffer->size / FrameSize;
+            if(Source->lSourceType == AL_STATIC)
             {
-                Looping = AL_FALSE;
-
-                if(DataPosInt >= BufferPrePadding)
-                    pos = (DataPosInt-BufferPrePadding)*FrameSize;
+                /* If current pos is beyond the loop range, do not loop */
+                if(Looping == AL_FALSE || DataPosInt >= (ALuint)ALBuffer->LoopEnd)
+                    Looping = AL_FALSE;
                 else
                 {
-                    DataSize = (BufferPrePadding-DataPosInt)*FrameSize;
-                    DataSize = minu(BufferSize, DataSize);
-
-                    memset(&SrcData[SrcDataSize], 0, DataSize);
-                    SrcDataSize += DataSize;
-                    BufferSize -= DataSize;
-
-                    pos = 0;
+                    if(DataPosInt >= (ALuint)ALBuffer->LoopStart)
+                        DataStart = ALBuffer->LoopStart;
+                    DataEnd = ALBuffer->LoopEnd;
                 }
-
-                /* Copy what's left to play in the source buffer, and clear the
-                 * rest of the temp buffer */
-                DataSize = ALBuffer->size - pos;
-                DataSize = minu(BufferSize, DataSize);
-
-                memcpy(&SrcData[SrcDataSize], &Data[pos], DataSize);
-                SrcDataSize += DataSize;
-                BufferSize -= DataSize;
-
-                memset(&SrcData[SrcDataSize], 0, BufferSize);
-                SrcDataSize += BufferSize;
-                BufferSize -= BufferSize;
             }
-            else
-            {
-                ALuint LoopStart = ALBuffer->LoopStart;
-                ALuint LoopEnd   = ALBuffer->LoopEnd;
-
-                if(DataPosInt >= LoopStart)
-                {
-                    pos = DataPosInt-LoopStart;
-                    while(pos < BufferPrePadding)
-                        pos += LoopEnd-LoopStart;
-                    pos -= BufferPrePadding;
-                    pos += LoopStart;
-                    pos *= FrameSize;
-                }
-                else if(DataPosInt >= BufferPrePadding)
-                    pos = (DataPosInt-BufferPrePadding)*FrameSize;
-                else
-                {
-                    DataSize = (BufferPrePadding-DataPosInt)*FrameSize;
-                    DataSize = minu(BufferSize, DataSize);
 
-                    memset(&SrcData[SrcDataSize], 0, DataSize);
-                    SrcDataSize += DataSize;
-                    BufferSize -= DataSize;
-
-                    pos = 0;
-                }
-
-                /* Copy what's left of this loop iteration, then copy repeats
-                 * of the loop section */
-                DataSize = LoopEnd*FrameSize - pos;
-                DataSize = minu(BufferSize, DataSize);
-
-                memcpy(&SrcData[SrcDataSize], &Data[pos], DataSize);
-                SrcDataSize += DataSize;
-                BufferSize -= DataSize;
+            /* The current buffer can be mixed from directly for as long as it
+             * has the samples needed, padding included, without reaching an
+             * edge or the loop point. Compressed buffers always need to be
+             * decoded to a copy. */
+            if(!ALBuffer->Compressed && DataPosInt >= DataStart+BufferPrePadding)
+                BufferFrames = (ALint64)DataEnd - (DataPosInt-BufferPrePadding);
+        }
 
-                DataSize = (LoopEnd-LoopStart) * FrameSize;
-                while(BufferSize > 0)
-                {
-                    DataSize = minu(BufferSize, DataSize);
+        /* Prefer doing the rest of the update in one go, straight from the
+         * buffer or else from a copy. If neither can hold it all, mix as much
+         * as one of them can hold. */
+        if(BufferFrames >= DataSize64)
+            UseBuffer = AL_TRUE;
+        else if(StackFrames < DataSize64)
+        {
+            BufferSize = SamplesForFrames(BufferFrames, BufferPadding+BufferPrePadding,
+                                          DataPosFrac, increment);
+            UseBuffer = (BufferSize > 0);
+        }
 
-                    memcpy(&SrcData[SrcDataSize], &Data[LoopStart*FrameSize], DataSize);
-                    SrcDataSize += DataSize;
-                    BufferSize -= DataSize;
-                }
-            }
+        if(UseBuffer)
+        {
+            BufferSize = SamplesForFrames(mini64(BufferFrames, DataSize64),
+                                          BufferPadding+BufferPrePadding,
+                                          DataPosFrac, increment);
+            SrcData  = ALBuffer->data;
+            SrcData += (DataPosInt-BufferPrePadding)*FrameSize;
         }
         else
         {
-            /* Crawl the buffer queue to fill in the temp buffer */
-            ALbufferlistitem *BufferListIter = BufferListItem;
-            ALuint pos;
-
-            if(DataPosInt >= BufferPrePadding)
-                pos = (DataPosInt-BufferPrePadding)*FrameSize;
-            else
+            /* Copy what's needed into a temporary buffer, with padding and
+             * loop repeats filled in. */
+            ALint64 SrcFrames = mini64(StackFrames, DataSize64);
+            BufferSize = SamplesForFrames(SrcFrames, BufferPadding+BufferPrePadding,
+                                          DataPosFrac, increment);
+            if(BufferSize > 0)
             {
-                pos = (BufferPrePadding-DataPosInt)*FrameSize;
-                while(pos > 0)
-                {
-                    if(!BufferListIter->prev && !Looping)
-                    {
-                        ALuint DataSize = minu(BufferSize, pos);
-
-                        memset(&SrcData[SrcDataSize], 0, DataSize);
-                        SrcDataSize += DataSize;
-                        BufferSize -= DataSize;
-
-                        pos = 0;
-                        break;
-                    }
-
-                    if(BufferListIter->prev)
-                        BufferListIter = BufferListIter->prev;
-                    else
-                    {
-                        while(BufferListIter->next)
-                            BufferListIter = BufferListIter->next;
-                    }
-
-                    if(BufferListIter->buffer)
-                    {
-                        if((ALuint)BufferListIter->buffer->size > pos)
-                        {
-                            pos = BufferListIter->buffer->size - pos;
-                            break;
-                        }
-                        pos -= BufferListIter->buffer->size;
-                    }
-                }
+                if(Source->lSourceType == AL_STATIC)
+                    FillStaticData(StackData, (ALuint)SrcFrames*FrameSize,
+                                   Source, ALBuffer, DataPosInt, Looping,
+                                   BufferPrePadding, FrameSize);
+                else
+                    FillQueuedData(StackData, (ALuint)SrcFrames*FrameSize,
+                                   Source, BufferListItem, DataPosInt, Looping,
+                                   BufferPrePadding, FrameSize);
             }
-
-            while(BufferListIter && BufferSize > 0)
+            else
             {
-                const ALbuffer *ALBuffer;
-                if((ALBuffer=BufferListIter->buffer) != NULL)
+                /* The step is too large for the temporary buffer to hold the
+                 * frames between two samples. Mix one sample at a time, only
+                 * copying the frames the resampler reads for it and for the
+                 * following sample, and step from one set to the other. */
+                const ALuint SetSize = BufferPrePadding+1+BufferPadding;
+                ALuint NextPosInt, NextPosFrac;
+
+                pos = (ALuint64)increment + DataPosFrac;
+                NextPosInt = DataPosInt + (ALuint)(pos>>FRACTIONBITS);
+                NextPosFrac = (ALuint)(pos&FRACTIONMASK);
+
+                if(Source->lSourceType == AL_STATIC)
                 {
-                    const ALubyte *Data = ALBuffer->data;
-                    ALuint DataSize = ALBuffer->size;
-
-                    /* Skip the data already played */
-                    if(DataSize <= pos)
-                        pos -= DataSize;
-                    else
+                    if(Looping && NextPosInt >= (ALuint)ALBuffer->LoopEnd)
                     {
-                        Data += pos;
-                        DataSize -= pos;
-                        pos -= pos;
-
-                        DataSize = minu(BufferSize, DataSize);
-                        memcpy(&SrcData[SrcDataSize], Data, DataSize);
-                        SrcDataSize += DataSize;
-                        BufferSize -= DataSize;
+                        ALuint LoopStart = ALBuffer->LoopStart;
+                        ALuint LoopEnd = ALBuffer->LoopEnd;
+                        NextPosInt = ((NextPosInt-LoopStart)%(LoopEnd-LoopStart)) + LoopStart;
                     }
+                    FillStaticData(StackData, SetSize*FrameSize, Source,
+                                   ALBuffer, DataPosInt, Looping,
+                                   BufferPrePadding, FrameSize);
+                    FillStaticData(StackData + SetSize*FrameSize,
+                                   SetSize*FrameSize, Source, ALBuffer,
+                                   NextPosInt, Looping, BufferPrePadding,
+                                   FrameSize);
                 }
-                BufferListIter = BufferListIter->next;
-                if(!BufferListIter && Looping)
-                    BufferListIter = Source->queue;
-                else if(!BufferListIter)
+                else
                 {
-                    memset(&SrcData[SrcDataSize], 0, BufferSize);
-                    SrcDataSize += BufferSize;
-                    BufferSize -= BufferSize;
+                    FillQueuedData(StackData, SetSize*FrameSize, Source,
+                                   BufferListItem, DataPosInt, Looping,
+                                   BufferPrePadding, FrameSize);
+                    FillQueuedData(StackData + SetSize*FrameSize,
+                                   SetSize*FrameSize, Source, BufferListItem,
+                                   NextPosInt, Looping, BufferPrePadding,
+                                   FrameSize);
                 }
+
+                SrcIncrement = (SetSize<<FRACTIONBITS) + NextPosFrac - DataPosFrac;
+                BufferSize = 1;
             }
         }
-
-        /* Figure out how many samples we can mix. */
-        DataSize64  = SrcDataSize / FrameSize;
-        DataSize64 -= BufferPadding+BufferPrePadding;
-        DataSize64 <<= FRACTIONBITS;
-        DataSize64 -= increment;
-        DataSize64 -= DataPosFrac;
-
-        BufferSize = (ALuint)((DataSize64+(increment-1)) / increment);
-        BufferSize = minu(BufferSize, (SamplesToDo-OutPos));
+        BufferSize = minu(BufferSize, SamplesToDo-OutPos);
 
         SrcData += BufferPrePadding*FrameSize;
-        Source->Params.DoMix(Source, Device, SrcData, &DataPosInt, &DataPosFrac,
+        Source->Params->DoMix(Source, Device, Target, SrcData,
+                             DataPosFrac, SrcIncrement,
                              OutPos, SamplesToDo, BufferSize);
         OutPos += BufferSize;
 
+        pos = (ALuint64)increment*BufferSize + DataPosFrac;
+        DataPosInt += (ALuint)(pos>>FRACTIONBITS);
+        DataPosFrac = (ALuint)(pos&FRACTIONMASK);
+
         /* Handle looping sources */
         while(1)
         {
@@ -816,9 +1509,11 @@ ALvoid MixSource(ALsource *Source, ALCdevice *Device, ALuint SamplesToDo)
             }
             else
             {
+                /* Only count the buffers that were played. The app may be
+                 * adding more to the queue right now. */
                 State = AL_STOPPED;
                 BufferListItem = Source->queue;
-                BuffersPlayed = Source->BuffersInQueue;
+                BuffersPlayed++;
                 DataPosInt = 0;
                 DataPosFrac = 0;
                 break;
@@ -833,15 +1528,39 @@ ALvoid MixSource(ALsource *Source, ALCdevice *Device, ALuint SamplesToDo)
     Source->BuffersPlayed     = BuffersPlayed;
     Source->position          = DataPosInt;
     Source->position_fraction = DataPosFrac;
-    Source->HrtfOffset       += OutPos;
-    if(State == AL_PLAYING)
-    {
-        Source->HrtfCounter = maxu(Source->HrtfCounter, OutPos) - OutPos;
-        Source->HrtfMoving  = AL_TRUE;
-    }
-    else
+    /* The HRTF state is still needed to mix what was left in the MixTemp */
+    if(Target)
+        UpdateHrtfState(Source, OutPos);
+}
+
+/* Mixes the samples a target-less MixSource left in the source's MixTemp into
+ * the target buffers, the same way MixSource would have. */
+ALvoid MixSourceTemp(ALsource *Source, ALCdevice *Device, MixBuffers *Target,
+                     ALuint SamplesToDo)
+{
+    SourceMixTemp *Temp = Source->MixTemp;
+    ALuint OutPos = 0;
+    ALuint i, s;
+
+    for(s = 0;s < Temp->NumSegments;s++)
     {
-        Source->HrtfCounter = 0;
-        Source->HrtfMoving  = AL_FALSE;
+        const ALuint BufferSize = Temp->SegmentSize[s];
+
+        for(i = 0;i < Source->NumChannels;i++)
+        {
+            SourceMixChannel *Chan = &Temp->Channels[i];
+
+            if(Temp->Hrtf)
+                MixChannelHrtf(Source, Device, Target, i,
+                               Chan->Resampled+OutPos, Chan->Filtered+OutPos,
+                               Chan->Clicks, OutPos, SamplesToDo, BufferSize);
+            else
+                MixChannel(Source, Device, Target, i,
+                           Chan->Resampled+OutPos, Chan->Filtered+OutPos,
+                           Chan->Clicks, OutPos, SamplesToDo, BufferSize);
+        }
+        OutPos += BufferSize;
     }
+
+    UpdateHrtfState(Source, OutPos);
 }
@@ -0,0 +1,175 @@
+/**
+ * OpenAL cross platform audio library
+ * Copyright (C) 1999-2007 by authors.
+ * This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Library General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ *  License along with this library; if not, write to the
+ *  Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ *  Boston, MA  02111-1307, USA.
+ * Or go to http://www.gnu.org/copyleft/lgpl.html
+ */
+
+#include "config.h"
+
+#include <immintrin.h>
+
+#include "alMain.h"
+#include "alu.h"
+#include "mixer_defs.h"
+
+
+/* Multiplies and adds are kept separate (no FMA) so the results match the
+ * other mixers exactly. */
+void MixDirect_AVX2(ALfloat (*RESTRICT DryBuffer)[BUFFERSIZE],
+                    const ALfloat *RESTRICT data, const ALfloat *RESTRICT DrySend,
+                    ALuint NumChannels, ALuint OutPos, ALuint BufferSize)
+{
+    ALuint pos, c;
+
+    for(c = 0;c < NumChannels;c++)
+    {
+        ALfloat *RESTRICT out = &DryBuffer[c][OutPos];
+        const ALfloat gain = DrySend[c];
+        const __m256 gain8 = _mm256_set1_ps(gain);
+
+        for(pos = 0;BufferSize-pos > 7;pos += 8)
+        {
+            __m256 dry = _mm256_loadu_ps(&out[pos]);
+            dry = _mm256_add_ps(dry, _mm256_mul_ps(_mm256_loadu_ps(&data[pos]), gain8));
+            _mm256_storeu_ps(&out[pos], dry);
+        }
+        for(;pos < BufferSize;pos++)
+            out[pos] += data[pos]*gain;
+    }
+}
+
+void MixSend_AVX2(ALfloat *RESTRICT WetBuffer, const ALfloat *RESTRICT data,
+                  ALfloat WetSend, ALuint OutPos, ALuint BufferSize)
+{
+    ALfloat *RESTRICT out = &WetBuffer[OutPos];
+    const __m256 gain = _mm256_set1_ps(WetSend);
+    ALuint pos;
+
+    for(pos = 0;BufferSize-pos > 7;pos += 8)
+    {
+        __m256 wet = _mm256_loadu_ps(&out[pos]);
+        wet = _mm256_add_ps(wet, _mm256_mul_ps(_mm256_loadu_ps(&data[pos]), gain));
+        _mm256_storeu_ps(&out[pos], wet);
+    }
+    for(;pos < BufferSize;pos++)
+        out[pos] += data[pos] * WetSend;
+}
+
+
+/* Eight output samples are worked out at once, stepping the fraction in
+ * vectors and gathering the frames and cubic coefficients they need. Steps
+ * too large for that are done a sample at a time. */
+#define DECL_TEMPLATE(sampler, vecfunc, func)                                 \
+void Resample_##sampler##_AVX2(const ALfloat *RESTRICT data,                  \
+  ALuint NumChannels, ALuint frac, ALuint increment,                          \
+  ALfloat *RESTRICT dst, ALuint dstlen)                                       \
+{                                                                             \
+    const __m256i increment8 = _mm256_mullo_epi32(                            \
+        _mm256_set1_epi32(increment),                                         \
+        _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));                           \
+    const __m256i stride8 = _mm256_set1_epi32(NumChannels);                   \
+    const __m256i fracMask8 = _mm256_set1_epi32(FRACTIONMASK);                \
+    const ALint step = NumChannels;                                           \
+    ALuint pos = 0;                                                           \
+    ALuint i = 0;                                                             \
+                                                                              \
+    if(increment <= RESAMPLE_VEC_MAX_STEP)                                    \
+    {                                                                         \
+        for(;dstlen-i > 7;i += 8)                                             \
+        {                                                                     \
+            const __m256i frac8 = _mm256_add_epi32(_mm256_set1_epi32(frac),   \
+                                                   increment8);               \
+            const __m256i pos8 = _mm256_mullo_epi32(stride8,                  \
+                _mm256_add_epi32(_mm256_set1_epi32(pos),                      \
+                                 _mm256_srli_epi32(frac8, FRACTIONBITS)));    \
+                                                                              \
+            _mm256_storeu_ps(&dst[i], vecfunc(data, pos8, stride8,            \
+                                   _mm256_and_si256(frac8, fracMask8)));      \
+                                                                              \
+            frac += increment*8;                                              \
+            pos  += frac>>FRACTIONBITS;                                       \
+            frac &= FRACTIONMASK;                                             \
+        }                                                                     \
+    }                                                                         \
+    for(;i < dstlen;i++)                                                      \
+    {                                                                         \
+        dst[i] = func(data + pos*NumChannels, step, frac);                    \
+                                                                              \
+        frac += increment;                                                    \
+        pos  += frac>>FRACTIONBITS;                                           \
+        frac &= FRACTIONMASK;                                                 \
+    }                                                                         \
+}
+
+static __inline __m256 point8(const ALfloat *RESTRICT data, __m256i pos8,
+                              __m256i stride8, __m256i frac8)
+{
+    (void)stride8; (void)frac8;
+    return _mm256_i32gather_ps(data, pos8, 4);
+}
+static __inline ALfloat point1(const ALfloat *vals, ALint step, ALuint frac)
+{ return vals[0]; (void)step; (void)frac; }
+
+static __inline __m256 lerp8(const ALfloat *RESTRICT data, __m256i pos8,
+                             __m256i stride8, __m256i frac8)
+{
+    const __m256 mu8 = _mm256_mul_ps(_mm256_cvtepi32_ps(frac8),
+                                     _mm256_set1_ps(1.0f/FRACTIONONE));
+    const __m256 val0 = _mm256_i32gather_ps(data, pos8, 4);
+    const __m256 val1 = _mm256_i32gather_ps(data,
+                                            _mm256_add_epi32(pos8, stride8), 4);
+    return _mm256_add_ps(val0, _mm256_mul_ps(_mm256_sub_ps(val1, val0), mu8));
+}
+static __inline ALfloat lerp1(const ALfloat *vals, ALint step, ALuint frac)
+{ return lerpf(vals[0], vals[step], frac * (1.0f/FRACTIONONE)); }
+
+static __inline __m256 cubic8(const ALfloat *RESTRICT data, __m256i pos8,
+                              __m256i stride8, __m256i frac8)
+{
+    const ALfloat *lut = &CubicLUT[0][0];
+    const __m256i idx8 = _mm256_slli_epi32(_mm256_srli_epi32(
+        _mm256_add_epi32(frac8, _mm256_set1_epi32(1<<(CUBIC_FRAC_BITS-1))),
+        CUBIC_FRAC_BITS), 2);
+    const __m256i prev8 = _mm256_sub_epi32(pos8, stride8);
+    const __m256i next8 = _mm256_add_epi32(pos8, stride8);
+    const __m256i next28 = _mm256_add_epi32(next8, stride8);
+    __m256 r8;
+
+    /* Add the taps in the same order cubic1 does */
+    r8 = _mm256_mul_ps(_mm256_i32gather_ps(lut, idx8, 4),
+                       _mm256_i32gather_ps(data, prev8, 4));
+    r8 = _mm256_add_ps(r8, _mm256_mul_ps(_mm256_i32gather_ps(lut+1, idx8, 4),
+                                         _mm256_i32gather_ps(data, pos8, 4)));
+    r8 = _mm256_add_ps(r8, _mm256_mul_ps(_mm256_i32gather_ps(lut+2, idx8, 4),
+                                         _mm256_i32gather_ps(data, next8, 4)));
+    r8 = _mm256_add_ps(r8, _mm256_mul_ps(_mm256_i32gather_ps(lut+3, idx8, 4),
+                                         _mm256_i32gather_ps(data, next28, 4)));
+    return r8;
+}
+static __inline ALfloat cubic1(const ALfloat *vals, ALint step, ALuint frac)
+{
+    const ALfloat *coeffs = CubicLUT[(frac + (1<<(CUBIC_FRAC_BITS-1))) >>
+                                     CUBIC_FRAC_BITS];
+    return coeffs[0]*vals[-step] + coeffs[1]*vals[0] +
+           coeffs[2]*vals[step] + coeffs[3]*vals[step+step];
+}
+
+DECL_TEMPLATE(point32, point8, point1)
+DECL_TEMPLATE(lerp32, lerp8, lerp1)
+DECL_TEMPLATE(cubic32, cubic8, cubic1)
+
+#undef DECL_TEMPLATE
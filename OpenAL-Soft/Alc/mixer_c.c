@@ -0,0 +1,169 @@
+/**
+ * OpenAL cross platform audio library
+ * Copyright (C) 1999-2007 by authors.
+ * This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Library General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ *  License along with this library; if not, write to the
+ *  Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ *  Boston, MA  02111-1307, USA.
+ * Or go to http://www.gnu.org/copyleft/lgpl.html
+ */
+
+#include "config.h"
+
+#include "alMain.h"
+#include "alu.h"
+#include "mixer_defs.h"
+
+
+void MixDirect_C(ALfloat (*RESTRICT DryBuffer)[BUFFERSIZE],
+                 const ALfloat *RESTRICT data, const ALfloat *RESTRICT DrySend,
+                 ALuint NumChannels, ALuint OutPos, ALuint BufferSize)
+{
+    ALuint pos, c;
+
+    for(c = 0;c < NumChannels;c++)
+    {
+        ALfloat *RESTRICT out = &DryBuffer[c][OutPos];
+        const ALfloat gain = DrySend[c];
+
+        for(pos = 0;pos < BufferSize;pos++)
+            out[pos] += data[pos]*gain;
+    }
+}
+
+void MixSend_C(ALfloat *RESTRICT WetBuffer, const ALfloat *RESTRICT data,
+               ALfloat WetSend, ALuint OutPos, ALuint BufferSize)
+{
+    ALuint pos;
+
+    for(pos = 0;pos < BufferSize;pos++)
+        WetBuffer[OutPos+pos] += data[pos] * WetSend;
+}
+
+
+void Resample_point32_C(const ALfloat *RESTRICT data, ALuint NumChannels,
+                        ALuint frac, ALuint increment,
+                        ALfloat *RESTRICT dst, ALuint dstlen)
+{
+    ALuint pos = 0;
+    ALuint i;
+
+    for(i = 0;i < dstlen;i++)
+    {
+        dst[i] = data[pos*NumChannels];
+
+        frac += increment;
+        pos  += frac>>FRACTIONBITS;
+        frac &= FRACTIONMASK;
+    }
+}
+
+void Resample_lerp32_C(const ALfloat *RESTRICT data, ALuint NumChannels,
+                       ALuint frac, ALuint increment,
+                       ALfloat *RESTRICT dst, ALuint dstlen)
+{
+    ALuint pos = 0;
+    ALuint i;
+
+    for(i = 0;i < dstlen;i++)
+    {
+        const ALfloat *RESTRICT vals = data + pos*NumChannels;
+        dst[i] = lerpf(vals[0], vals[NumChannels], frac * (1.0f/FRACTIONONE));
+
+        frac += increment;
+        pos  += frac>>FRACTIONBITS;
+        frac &= FRACTIONMASK;
+    }
+}
+
+void Resample_cubic32_C(const ALfloat *RESTRICT data, ALuint NumChannels,
+                        ALuint frac, ALuint increment,
+                        ALfloat *RESTRICT dst, ALuint dstlen)
+{
+    const ALint step = NumChannels;
+    ALuint pos = 0;
+    ALuint i;
+
+    for(i = 0;i < dstlen;i++)
+    {
+        const ALfloat *RESTRICT vals = data + pos*NumChannels;
+        const ALfloat *coeffs = CubicLUT[(frac + (1<<(CUBIC_FRAC_BITS-1))) >>
+                                         CUBIC_FRAC_BITS];
+        dst[i] = coeffs[0]*vals[-step] + coeffs[1]*vals[0] +
+                 coeffs[2]*vals[step] + coeffs[3]*vals[step+step];
+
+        frac += increment;
+        pos  += frac>>FRACTIONBITS;
+        frac &= FRACTIONMASK;
+    }
+}
+
+void Resample_sinc_C(const ALfloat *RESTRICT src, ALuint frac,
+                     ALuint increment, const ALfloat *RESTRICT filter,
+                     ALfloat *RESTRICT dst, ALuint dstlen)
+{
+    ALuint pos = 0;
+    ALuint i, j;
+
+    for(i = 0;i < dstlen;i++)
+    {
+        const ALfloat *RESTRICT fil = filter + (frac>>SINC_FRAC_BITS)*SINC_POINTS*2;
+        const ALfloat *RESTRICT dlt = fil + SINC_POINTS;
+        const ALfloat pf = (frac&SINC_FRAC_MASK) * (1.0f/SINC_FRAC_ONE);
+        ALfloat r = 0.0f;
+
+        for(j = 0;j < SINC_POINTS;j++)
+            r += (fil[j] + pf*dlt[j]) * src[pos+j];
+        dst[i] = r;
+
+        frac += increment;
+        pos  += frac>>FRACTIONBITS;
+        frac &= FRACTIONMASK;
+    }
+}
+
+
+static __inline void ApplyCoeffs(ALuint Offset, ALfloat (*RESTRICT Values)[2],
+                                 ALuint ValuesMask,
+                                 ALfloat (*RESTRICT Coeffs)[2], ALuint IrSize,
+                                 ALfloat left, ALfloat right)
+{
+    ALuint c;
+    for(c = 0;c < IrSize;c++)
+    {
+        const ALuint off = (Offset+c)&ValuesMask;
+        Values[off][0] += Coeffs[c][0] * left;
+        Values[off][1] += Coeffs[c][1] * right;
+    }
+}
+
+#define SUFFIX C
+#include "mixer_inc.c"
+#undef SUFFIX
+
+
+#define DECL_TEMPLATE(T, func)                                                \
+void Convert_##T##_C(T *RESTRICT dst, const ALfloat *RESTRICT src,            \
+                     ALuint count)                                            \
+{                                                                             \
+    ALuint i;                                                                 \
+    for(i = 0;i < count;i++)                                                  \
+        dst[i] = func(src[i]);                                                \
+}
+
+DECL_TEMPLATE(ALbyte, aluF2B)
+DECL_TEMPLATE(ALubyte, aluF2UB)
+DECL_TEMPLATE(ALshort, aluF2S)
+DECL_TEMPLATE(ALushort, aluF2US)
+
+#undef DECL_TEMPLATE
@@ -0,0 +1,148 @@
+#ifndef MIXER_DEFS_H
+#define MIXER_DEFS_H
+
+#include "AL/alc.h"
+#include "AL/al.h"
+#include "alMain.h"
+#include "alu.h"
+
+/* Mixing kernels. These take a block of resampled and filtered samples for a
+ * single source channel and add them to the output buffers. The dry buffer has
+ * one row per output channel, in device channel order; the HRTF mixers write
+ * to the first two (front left and right). The sinc resampler takes float
+ * samples, starting SINC_PRE_POINTS frames before the first output sample, and
+ * a filter table from the phase tables in mixer.c. The other resamplers take
+ * float samples with NumChannels interleaved channels, and read one frame
+ * before and two after each position for the cubic one. Each set of kernels is
+ * built with the instruction set named by its suffix, and is only used when
+ * the running CPU reports support for it (see CPUCapFlags). */
+
+/* C mixers */
+void MixDirect_C(ALfloat (*RESTRICT DryBuffer)[BUFFERSIZE],
+                 const ALfloat *RESTRICT data, const ALfloat *RESTRICT DrySend,
+                 ALuint NumChannels, ALuint OutPos, ALuint BufferSize);
+void MixSend_C(ALfloat *RESTRICT WetBuffer, const ALfloat *RESTRICT data,
+               ALfloat WetSend, ALuint OutPos, ALuint BufferSize);
+void MixDirect_Hrtf_C(ALfloat (*RESTRICT DryBuffer)[BUFFERSIZE],
+                      const ALfloat *RESTRICT data, ALfloat *RESTRICT History,
+                      ALfloat (*RESTRICT Values)[2], ALuint ValuesMask,
+                      ALuint Offset, const ALuint Delay[2],
+                      ALfloat (*RESTRICT Coeffs)[2], ALuint IrSize,
+                      ALuint OutPos, ALuint BufferSize);
+
+void Resample_point32_C(const ALfloat *RESTRICT data, ALuint NumChannels,
+                        ALuint frac, ALuint increment,
+                        ALfloat *RESTRICT dst, ALuint dstlen);
+void Resample_lerp32_C(const ALfloat *RESTRICT data, ALuint NumChannels,
+                       ALuint frac, ALuint increment,
+                       ALfloat *RESTRICT dst, ALuint dstlen);
+void Resample_cubic32_C(const ALfloat *RESTRICT data, ALuint NumChannels,
+                        ALuint frac, ALuint increment,
+                        ALfloat *RESTRICT dst, ALuint dstlen);
+void Resample_sinc_C(const ALfloat *RESTRICT src, ALuint frac,
+                     ALuint increment, const ALfloat *RESTRICT filter,
+                     ALfloat *RESTRICT dst, ALuint dstlen);
+
+void Convert_ALbyte_C(ALbyte *RESTRICT dst, const ALfloat *RESTRICT src, ALuint count);
+void Convert_ALubyte_C(ALubyte *RESTRICT dst, const ALfloat *RESTRICT src, ALuint count);
+void Convert_ALshort_C(ALshort *RESTRICT dst, const ALfloat *RESTRICT src, ALuint count);
+void Convert_ALushort_C(ALushort *RESTRICT dst, const ALfloat *RESTRICT src, ALuint count);
+
+/* SSE2 mixers */
+void MixDirect_SSE2(ALfloat (*RESTRICT DryBuffer)[BUFFERSIZE],
+                    const ALfloat *RESTRICT data, const ALfloat *RESTRICT DrySend,
+                    ALuint NumChannels, ALuint OutPos, ALuint BufferSize);
+void MixSend_SSE2(ALfloat *RESTRICT WetBuffer, const ALfloat *RESTRICT data,
+                  ALfloat WetSend, ALuint OutPos, ALuint BufferSize);
+void MixDirect_Hrtf_SSE2(ALfloat (*RESTRICT DryBuffer)[BUFFERSIZE],
+                         const ALfloat *RESTRICT data, ALfloat *RESTRICT History,
+                         ALfloat (*RESTRICT Values)[2], ALuint ValuesMask,
+                         ALuint Offset, const ALuint Delay[2],
+                         ALfloat (*RESTRICT Coeffs)[2], ALuint IrSize,
+                         ALuint OutPos, ALuint BufferSize);
+
+void Resample_sinc_SSE2(const ALfloat *RESTRICT src, ALuint frac,
+                        ALuint increment, const ALfloat *RESTRICT filter,
+                        ALfloat *RESTRICT dst, ALuint dstlen);
+
+void Convert_ALbyte_SSE2(ALbyte *RESTRICT dst, const ALfloat *RESTRICT src, ALuint count);
+void Convert_ALubyte_SSE2(ALubyte *RESTRICT dst, const ALfloat *RESTRICT src, ALuint count);
+void Convert_ALshort_SSE2(ALshort *RESTRICT dst, const ALfloat *RESTRICT src, ALuint count);
+void Convert_ALushort_SSE2(ALushort *RESTRICT dst, const ALfloat *RESTRICT src, ALuint count);
+
+/* SSE4.1 mixers */
+void Resample_point32_SSE4_1(const ALfloat *RESTRICT data, ALuint NumChannels,
+                             ALuint frac, ALuint increment,
+                             ALfloat *RESTRICT dst, ALuint dstlen);
+void Resample_lerp32_SSE4_1(const ALfloat *RESTRICT data, ALuint NumChannels,
+                            ALuint frac, ALuint increment,
+                            ALfloat *RESTRICT dst, ALuint dstlen);
+void Resample_cubic32_SSE4_1(const ALfloat *RESTRICT data, ALuint NumChannels,
+                             ALuint frac, ALuint increment,
+                             ALfloat *RESTRICT dst, ALuint dstlen);
+
+/* AVX2 mixers */
+void MixDirect_AVX2(ALfloat (*RESTRICT DryBuffer)[BUFFERSIZE],
+                    const ALfloat *RESTRICT data, const ALfloat *RESTRICT DrySend,
+                    ALuint NumChannels, ALuint OutPos, ALuint BufferSize);
+void MixSend_AVX2(ALfloat *RESTRICT WetBuffer, const ALfloat *RESTRICT data,
+                  ALfloat WetSend, ALuint OutPos, ALuint BufferSize);
+void Resample_point32_AVX2(const ALfloat *RESTRICT data, ALuint NumChannels,
+                           ALuint frac, ALuint increment,
+                           ALfloat *RESTRICT dst, ALuint dstlen);
+void Resample_lerp32_AVX2(const ALfloat *RESTRICT data, ALuint NumChannels,
+                          ALuint frac, ALuint increment,
+                          ALfloat *RESTRICT dst, ALuint dstlen);
+void Resample_cubic32_AVX2(const ALfloat *RESTRICT data, ALuint NumChannels,
+                           ALuint frac, ALuint increment,
+                           ALfloat *RESTRICT dst, ALuint dstlen);
+
+/* NEON mixers */
+void MixDirect_Hrtf_NEON(ALfloat (*RESTRICT DryBuffer)[BUFFERSIZE],
+                         const ALfloat *RESTRICT data, ALfloat *RESTRICT History,
+                         ALfloat (*RESTRICT Values)[2], ALuint ValuesMask,
+                         ALuint Offset, const ALuint Delay[2],
+                         ALfloat (*RESTRICT Coeffs)[2], ALuint IrSize,
+                         ALuint OutPos, ALuint BufferSize);
+
+
+/* The kernels in use, filled in by aluInitMixers according to CPUCapFlags. */
+typedef struct MixerFuncs {
+    void (*MixDirect)(ALfloat (*RESTRICT DryBuffer)[BUFFERSIZE],
+                      const ALfloat *RESTRICT data,
+                      const ALfloat *RESTRICT DrySend, ALuint NumChannels,
+                      ALuint OutPos, ALuint BufferSize);
+    void (*MixSend)(ALfloat *RESTRICT WetBuffer, const ALfloat *RESTRICT data,
+                    ALfloat WetSend, ALuint OutPos, ALuint BufferSize);
+    void (*MixHrtf)(ALfloat (*RESTRICT DryBuffer)[BUFFERSIZE],
+                    const ALfloat *RESTRICT data, ALfloat *RESTRICT History,
+                    ALfloat (*RESTRICT Values)[2], ALuint ValuesMask,
+                    ALuint Offset, const ALuint Delay[2],
+                    ALfloat (*RESTRICT Coeffs)[2], ALuint IrSize,
+                    ALuint OutPos, ALuint BufferSize);
+
+    void (*ResamplePoint)(const ALfloat *RESTRICT data, ALuint NumChannels,
+                          ALuint frac, ALuint increment,
+                          ALfloat *RESTRICT dst, ALuint dstlen);
+    void (*ResampleLerp)(const ALfloat *RESTRICT data, ALuint NumChannels,
+                         ALuint frac, ALuint increment,
+                         ALfloat *RESTRICT dst, ALuint dstlen);
+    void (*ResampleCubic)(const ALfloat *RESTRICT data, ALuint NumChannels,
+                          ALuint frac, ALuint increment,
+                          ALfloat *RESTRICT dst, ALuint dstlen);
+    void (*ResampleSinc)(const ALfloat *RESTRICT src, ALuint frac,
+                         ALuint increment, const ALfloat *RESTRICT filter,
+                         ALfloat *RESTRICT dst, ALuint dstlen);
+
+    void (*ConvertByte)(ALbyte *RESTRICT dst, const ALfloat *RESTRICT src, ALuint count);
+    void (*ConvertUByte)(ALubyte *RESTRICT dst, const ALfloat *RESTRICT src, ALuint count);
+    void (*ConvertShort)(ALshort *RESTRICT dst, const ALfloat *RESTRICT src, ALuint count);
+    void (*ConvertUShort)(ALushort *RESTRICT dst, const ALfloat *RESTRICT src, ALuint count);
+} MixerFuncs;
+
+extern MixerFuncs CPUMixers;
+
+/* The cubic resampler's coefficients, filled in by aluInitMixers. */
+extern ALfloat CubicLUT[CUBIC_PHASES+1][4];
+
+#endif /* MIXER_DEFS_H */
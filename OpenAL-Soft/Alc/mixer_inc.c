@@ -0,0 +1,50 @@
+#include "config.h"
+
+#include "alMain.h"
+#include "alSource.h"
+#include "alu.h"
+#include "mixer_defs.h"
+
+/* Shared mixing loops. The including file defines SUFFIX and the inline
+ * helpers the loops use (ApplyCoeffs), then includes this to instantiate the
+ * kernels for its instruction set. */
+
+#define REAL_MERGE2(a,b) a##b
+#define MERGE2(a,b) REAL_MERGE2(a,b)
+
+#define MixDirect_Hrtf MERGE2(MixDirect_Hrtf_,SUFFIX)
+
+
+void MixDirect_Hrtf(ALfloat (*RESTRICT DryBuffer)[BUFFERSIZE],
+                    const ALfloat *RESTRICT data, ALfloat *RESTRICT History,
+                    ALfloat (*RESTRICT Values)[2], ALuint ValuesMask,
+                    ALuint Offset, const ALuint Delay[2],
+                    ALfloat (*RESTRICT Coeffs)[2], ALuint IrSize,
+                    ALuint OutPos, ALuint BufferSize)
+{
+    ALfloat left, right;
+    ALuint pos;
+
+    for(pos = 0;pos < BufferSize;pos++)
+    {
+        History[Offset&SRC_HISTORY_MASK] = data[pos];
+        left = History[(Offset-Delay[0])&SRC_HISTORY_MASK];
+        right = History[(Offset-Delay[1])&SRC_HISTORY_MASK];
+
+        Values[Offset&ValuesMask][0] = 0.0f;
+        Values[Offset&ValuesMask][1] = 0.0f;
+        Offset++;
+
+        ApplyCoeffs(Offset, Values, ValuesMask, Coeffs, IrSize, left, right);
+        DryBuffer[0][OutPos] += Values[Offset&ValuesMask][0];
+        DryBuffer[1][OutPos] += Values[Offset&ValuesMask][1];
+
+        OutPos++;
+    }
+}
+
+
+#undef MixDirect_Hrtf
+
+#undef MERGE2
+#undef REAL_MERGE2
@@ -0,0 +1,222 @@
+/**
+ * OpenAL cross platform audio library
+ * Copyright (C) 1999-2007 by authors.
+ * This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Library General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ *  License along with this library; if not, write to the
+ *  Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ *  Boston, MA  02111-1307, USA.
+ * Or go to http://www.gnu.org/copyleft/lgpl.html
+ */
+
+#include "config.h"
+
+#include <emmintrin.h>
+
+#include "alMain.h"
+#include "alu.h"
+#include "alSource.h"
+#include "mixer_defs.h"
+
+
+void MixDirect_SSE2(ALfloat (*RESTRICT DryBuffer)[BUFFERSIZE],
+                    const ALfloat *RESTRICT data, const ALfloat *RESTRICT DrySend,
+                    ALuint NumChannels, ALuint OutPos, ALuint BufferSize)
+{
+    ALuint pos, c;
+
+    for(c = 0;c < NumChannels;c++)
+    {
+        ALfloat *RESTRICT out = &DryBuffer[c][OutPos];
+        const ALfloat gain = DrySend[c];
+        const __m128 gain4 = _mm_set1_ps(gain);
+
+        for(pos = 0;BufferSize-pos > 3;pos += 4)
+        {
+            __m128 dry = _mm_loadu_ps(&out[pos]);
+            dry = _mm_add_ps(dry, _mm_mul_ps(_mm_loadu_ps(&data[pos]), gain4));
+            _mm_storeu_ps(&out[pos], dry);
+        }
+        for(;pos < BufferSize;pos++)
+            out[pos] += data[pos]*gain;
+    }
+}
+
+void MixSend_SSE2(ALfloat *RESTRICT WetBuffer, const ALfloat *RESTRICT data,
+                  ALfloat WetSend, ALuint OutPos, ALuint BufferSize)
+{
+    ALfloat *RESTRICT out = &WetBuffer[OutPos];
+    const __m128 gain = _mm_set1_ps(WetSend);
+    ALuint pos;
+
+    for(pos = 0;BufferSize-pos > 3;pos += 4)
+    {
+        __m128 wet = _mm_loadu_ps(&out[pos]);
+        wet = _mm_add_ps(wet, _mm_mul_ps(_mm_loadu_ps(&data[pos]), gain));
+        _mm_storeu_ps(&out[pos], wet);
+    }
+    for(;pos < BufferSize;pos++)
+        out[pos] += data[pos] * WetSend;
+}
+
+
+void Resample_sinc_SSE2(const ALfloat *RESTRICT src, ALuint frac,
+                        ALuint increment, const ALfloat *RESTRICT filter,
+                        ALfloat *RESTRICT dst, ALuint dstlen)
+{
+    ALuint pos = 0;
+    ALuint i, j;
+
+    for(i = 0;i < dstlen;i++)
+    {
+        const ALfloat *RESTRICT fil = filter + (frac>>SINC_FRAC_BITS)*SINC_POINTS*2;
+        const ALfloat *RESTRICT dlt = fil + SINC_POINTS;
+        const __m128 pf4 = _mm_set1_ps((frac&SINC_FRAC_MASK) * (1.0f/SINC_FRAC_ONE));
+        __m128 r4 = _mm_setzero_ps();
+        __m128 s4 = _mm_setzero_ps();
+
+        /* Two sums, to not wait on each add */
+        for(j = 0;j < SINC_POINTS;j += 8)
+        {
+            const __m128 f4 = _mm_add_ps(_mm_loadu_ps(&fil[j]),
+                                         _mm_mul_ps(pf4, _mm_loadu_ps(&dlt[j])));
+            const __m128 g4 = _mm_add_ps(_mm_loadu_ps(&fil[j+4]),
+                                         _mm_mul_ps(pf4, _mm_loadu_ps(&dlt[j+4])));
+            r4 = _mm_add_ps(r4, _mm_mul_ps(f4, _mm_loadu_ps(&src[pos+j])));
+            s4 = _mm_add_ps(s4, _mm_mul_ps(g4, _mm_loadu_ps(&src[pos+j+4])));
+        }
+        r4 = _mm_add_ps(r4, s4);
+        r4 = _mm_add_ps(r4, _mm_shuffle_ps(r4, r4, _MM_SHUFFLE(0, 1, 2, 3)));
+        r4 = _mm_add_ps(r4, _mm_movehl_ps(r4, r4));
+        _mm_store_ss(&dst[i], r4);
+
+        frac += increment;
+        pos  += frac>>FRACTIONBITS;
+        frac &= FRACTIONMASK;
+    }
+}
+
+
+/* Two HRIR taps fit in a vector as left/right pairs. The Values ring only
+ * keeps pairs contiguous from an even offset, so with an odd offset the first
+ * and last taps are done separately. */
+static __inline void ApplyCoeffs(ALuint Offset, ALfloat (*RESTRICT Values)[2],
+                                 ALuint ValuesMask,
+                                 ALfloat (*RESTRICT Coeffs)[2], ALuint IrSize,
+                                 ALfloat left, ALfloat right)
+{
+    const __m128 lrlr = _mm_setr_ps(left, right, left, right);
+    __m128 vals, coeffs;
+    ALuint c;
+
+    Offset &= ValuesMask;
+    c = 0;
+    if((Offset&1))
+    {
+        const ALuint o = (Offset+IrSize-1)&ValuesMask;
+
+        Values[Offset][0] += Coeffs[0][0] * left;
+        Values[Offset][1] += Coeffs[0][1] * right;
+        Values[o][0] += Coeffs[IrSize-1][0] * left;
+        Values[o][1] += Coeffs[IrSize-1][1] * right;
+        c = 1;
+    }
+    for(;c < IrSize-1;c += 2)
+    {
+        const ALuint o = (Offset+c)&ValuesMask;
+
+        coeffs = _mm_loadu_ps(&Coeffs[c][0]);
+        vals = _mm_loadu_ps(&Values[o][0]);
+        vals = _mm_add_ps(vals, _mm_mul_ps(coeffs, lrlr));
+        _mm_storeu_ps(&Values[o][0], vals);
+    }
+}
+
+#define SUFFIX SSE2
+#include "mixer_inc.c"
+#undef SUFFIX
+
+
+/* Converts four samples to 32-bit integers with the same clamping and
+ * truncation as aluF2S, sign-extended from the low 16 bits. */
+static __inline __m128i F2S4(__m128 val)
+{
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 negone = _mm_set1_ps(-1.0f);
+    const __m128i maxval = _mm_set1_epi32(32767);
+    const __m128i minval = _mm_set1_epi32(-32768);
+    __m128i gt = _mm_castps_si128(_mm_cmpgt_ps(val, one));
+    __m128i lt = _mm_castps_si128(_mm_cmplt_ps(val, negone));
+    __m128i ret;
+
+    ret = _mm_cvttps_epi32(_mm_mul_ps(val, _mm_set1_ps(32767.0f)));
+    ret = _mm_or_si128(_mm_andnot_si128(gt, ret), _mm_and_si128(gt, maxval));
+    ret = _mm_or_si128(_mm_andnot_si128(lt, ret), _mm_and_si128(lt, minval));
+    return _mm_srai_epi32(_mm_slli_epi32(ret, 16), 16);
+}
+
+static __inline __m128i F2S8(const ALfloat *RESTRICT src)
+{
+    return _mm_packs_epi32(F2S4(_mm_loadu_ps(&src[0])),
+                           F2S4(_mm_loadu_ps(&src[4])));
+}
+
+void Convert_ALshort_SSE2(ALshort *RESTRICT dst, const ALfloat *RESTRICT src, ALuint count)
+{
+    ALuint i;
+
+    for(i = 0;count-i > 7;i += 8)
+        _mm_storeu_si128((__m128i*)&dst[i], F2S8(&src[i]));
+    for(;i < count;i++)
+        dst[i] = aluF2S(src[i]);
+}
+
+void Convert_ALushort_SSE2(ALushort *RESTRICT dst, const ALfloat *RESTRICT src, ALuint count)
+{
+    const __m128i bias = _mm_set1_epi16((short)0x8000);
+    ALuint i;
+
+    for(i = 0;count-i > 7;i += 8)
+        _mm_storeu_si128((__m128i*)&dst[i], _mm_xor_si128(F2S8(&src[i]), bias));
+    for(;i < count;i++)
+        dst[i] = aluF2US(src[i]);
+}
+
+void Convert_ALbyte_SSE2(ALbyte *RESTRICT dst, const ALfloat *RESTRICT src, ALuint count)
+{
+    ALuint i;
+
+    for(i = 0;count-i > 15;i += 16)
+    {
+        __m128i lo = _mm_srai_epi16(F2S8(&src[i]), 8);
+        __m128i hi = _mm_srai_epi16(F2S8(&src[i+8]), 8);
+        _mm_storeu_si128((__m128i*)&dst[i], _mm_packs_epi16(lo, hi));
+    }
+    for(;i < count;i++)
+        dst[i] = aluF2B(src[i]);
+}
+
+void Convert_ALubyte_SSE2(ALubyte *RESTRICT dst, const ALfloat *RESTRICT src, ALuint count)
+{
+    const __m128i bias = _mm_set1_epi8((char)0x80);
+    ALuint i;
+
+    for(i = 0;count-i > 15;i += 16)
+    {
+        __m128i lo = _mm_srai_epi16(F2S8(&src[i]), 8);
+        __m128i hi = _mm_srai_epi16(F2S8(&src[i+8]), 8);
+        _mm_storeu_si128((__m128i*)&dst[i],
+                         _mm_xor_si128(_mm_packs_epi16(lo, hi), bias));
+    }
+    for(;i < count;i++)
+        dst[i] = aluF2UB(src[i]);
+}
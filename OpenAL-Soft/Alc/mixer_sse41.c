@@ -0,0 +1,134 @@
+/**
+ * OpenAL cross platform audio library
+ * Copyright (C) 1999-2007 by authors.
+ * This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Library General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ *  License along with this library; if not, write to the
+ *  Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ *  Boston, MA  02111-1307, USA.
+ * Or go to http://www.gnu.org/copyleft/lgpl.html
+ */
+
+
+#include "config.h"
+
+#include <smmintrin.h>
+
+#include "alMain.h"
+#include "alu.h"
+#include "mixer_defs.h"
+
+
+/* Four output samples are worked out at once. Their positions come from
+ * stepping the fraction in vectors, with SSE4.1's 32-bit multiply for the
+ * channel stride, and the frames they need are then picked out one by one.
+ * Steps too large for that are done a sample at a time. */
+#define DECL_TEMPLATE(sampler, vecfunc, func)                                 \
+void Resample_##sampler##_SSE4_1(const ALfloat *RESTRICT data,                \
+  ALuint NumChannels, ALuint frac, ALuint increment,                          \
+  ALfloat *RESTRICT dst, ALuint dstlen)                                       \
+{                                                                             \
+    const __m128i increment4 = _mm_mullo_epi32(_mm_set1_epi32(increment),     \
+                                               _mm_setr_epi32(0, 1, 2, 3));   \
+    const __m128i stride4 = _mm_set1_epi32(NumChannels);                      \
+    const __m128i fracMask4 = _mm_set1_epi32(FRACTIONMASK);                   \
+    const ALint step = NumChannels;                                           \
+    ALuint pos = 0;                                                           \
+    ALuint i = 0;                                                             \
+                                                                              \
+    if(increment <= RESAMPLE_VEC_MAX_STEP)                                    \
+    {                                                                         \
+        for(;dstlen-i > 3;i += 4)                                             \
+        {                                                                     \
+            const __m128i frac4 = _mm_add_epi32(_mm_set1_epi32(frac),         \
+                                                increment4);                  \
+            const __m128i pos4 = _mm_mullo_epi32(stride4,                     \
+                _mm_add_epi32(_mm_set1_epi32(pos),                            \
+                              _mm_srli_epi32(frac4, FRACTIONBITS)));          \
+            const ALfloat *RESTRICT vals[4];                                  \
+                                                                              \
+            vals[0] = data + _mm_cvtsi128_si32(pos4);                         \
+            vals[1] = data + _mm_extract_epi32(pos4, 1);                      \
+            vals[2] = data + _mm_extract_epi32(pos4, 2);                      \
+            vals[3] = data + _mm_extract_epi32(pos4, 3);                      \
+            _mm_storeu_ps(&dst[i], vecfunc(vals, step,                        \
+                                           _mm_and_si128(frac4, fracMask4))); \
+                                                                              \
+            frac += increment*4;                                              \
+            pos  += frac>>FRACTIONBITS;                                       \
+            frac &= FRACTIONMASK;                                             \
+        }                                                                     \
+    }                                                                         \
+    for(;i < dstlen;i++)                                                      \
+    {                                                                         \
+        dst[i] = func(data + pos*NumChannels, step, frac);                    \
+                                                                              \
+        frac += increment;                                                    \
+        pos  += frac>>FRACTIONBITS;                                           \
+        frac &= FRACTIONMASK;                                                 \
+    }                                                                         \
+}
+
+#define GATHER4(v, o)  _mm_setr_ps((v)[0][o], (v)[1][o], (v)[2][o], (v)[3][o])
+
+static __inline __m128 point4(const ALfloat *RESTRICT vals[4], ALint step,
+                              __m128i frac4)
+{ return GATHER4(vals, 0); (void)step; (void)frac4; }
+static __inline ALfloat point1(const ALfloat *vals, ALint step, ALuint frac)
+{ return vals[0]; (void)step; (void)frac; }
+
+static __inline __m128 lerp4(const ALfloat *RESTRICT vals[4], ALint step,
+                             __m128i frac4)
+{
+    const __m128 mu4 = _mm_mul_ps(_mm_cvtepi32_ps(frac4),
+                                  _mm_set1_ps(1.0f/FRACTIONONE));
+    const __m128 val0 = GATHER4(vals, 0);
+    const __m128 val1 = GATHER4(vals, step);
+    return _mm_add_ps(val0, _mm_mul_ps(_mm_sub_ps(val1, val0), mu4));
+}
+static __inline ALfloat lerp1(const ALfloat *vals, ALint step, ALuint frac)
+{ return lerpf(vals[0], vals[step], frac * (1.0f/FRACTIONONE)); }
+
+static __inline __m128 cubic4(const ALfloat *RESTRICT vals[4], ALint step,
+                              __m128i frac4)
+{
+    __m128i idx4 = _mm_srli_epi32(_mm_add_epi32(frac4,
+                                      _mm_set1_epi32(1<<(CUBIC_FRAC_BITS-1))),
+                                  CUBIC_FRAC_BITS);
+    __m128 c0 = _mm_loadu_ps(CubicLUT[_mm_cvtsi128_si32(idx4)]);
+    __m128 c1 = _mm_loadu_ps(CubicLUT[_mm_extract_epi32(idx4, 1)]);
+    __m128 c2 = _mm_loadu_ps(CubicLUT[_mm_extract_epi32(idx4, 2)]);
+    __m128 c3 = _mm_loadu_ps(CubicLUT[_mm_extract_epi32(idx4, 3)]);
+    __m128 r4;
+
+    /* Each lane's coefficients come in as a row; turn them into one vector
+     * per tap, and add the taps in the same order cubic1 does. */
+    _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+    r4 = _mm_mul_ps(c0, GATHER4(vals, -step));
+    r4 = _mm_add_ps(r4, _mm_mul_ps(c1, GATHER4(vals, 0)));
+    r4 = _mm_add_ps(r4, _mm_mul_ps(c2, GATHER4(vals, step)));
+    r4 = _mm_add_ps(r4, _mm_mul_ps(c3, GATHER4(vals, step+step)));
+    return r4;
+}
+static __inline ALfloat cubic1(const ALfloat *vals, ALint step, ALuint frac)
+{
+    const ALfloat *coeffs = CubicLUT[(frac + (1<<(CUBIC_FRAC_BITS-1))) >>
+                                     CUBIC_FRAC_BITS];
+    return coeffs[0]*vals[-step] + coeffs[1]*vals[0] +
+           coeffs[2]*vals[step] + coeffs[3]*vals[step+step];
+}
+
+DECL_TEMPLATE(point32, point4, point1)
+DECL_TEMPLATE(lerp32, lerp4, lerp1)
+DECL_TEMPLATE(cubic32, cubic4, cubic1)
+
+#undef DECL_TEMPLATE
@@ -0,0 +1,234 @@
+/**
+ * OpenAL cross platform audio library
+ * Copyright (C) 2012 by authors.
+ * This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Library General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ *  License along with this library; if not, write to the
+ *  Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ *  Boston, MA  02111-1307, USA.
+ * Or go to http://www.gnu.org/copyleft/lgpl.html
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+
+#include "alMain.h"
+#include "alSource.h"
+#include "alu.h"
+
+
+/* Source mixing can be split across multiple threads. The active sources of a
+ * context are divided into contiguous chunks, in list order. The device's own
+ * mixing thread mixes the first chunk straight into the device and effect slot
+ * buffers, while each extra thread only resamples and filters its chunk into
+ * the sources' MixTemp buffers. The device's thread then mixes those in, chunk
+ * by chunk as the threads finish. Everything gets added to the mix in source
+ * order, the same as when mixing on one thread, so the output is identical no
+ * matter how many threads there are.
+ */
+
+typedef struct MixThread {
+    struct MixThreadPool *Pool;
+    ALvoid *Thread;
+    ALvoid *Start;
+    ALvoid *Done;
+
+    /* The sources to mix for the current job */
+    ALsource **Sources;
+    ALuint NumSources;
+} MixThread;
+
+typedef struct MixThreadPool {
+    ALCdevice *Device;
+
+    /* The current job */
+    ALuint SamplesToDo;
+
+    MixThread *Threads;
+    ALuint NumThreads;
+
+    volatile ALboolean Quit;
+} MixThreadPool;
+
+
+/* Sources that couldn't get a MixTemp are mixed on the device's thread */
+static __inline ALboolean HasMixTemp(const ALsource *Source)
+{
+    return Source->MixTempChannels >= Source->NumChannels;
+}
+
+static ALuint MixThreadProc(ALvoid *ptr)
+{
+    MixThread *self = ptr;
+    MixThreadPool *pool = self->Pool;
+    ALuint i;
+
+    SetRTPriority();
+
+    while(1)
+    {
+        WaitSemaphoreAL(self->Start);
+        if(pool->Quit)
+            break;
+
+        for(i = 0;i < self->NumSources;i++)
+        {
+            if(HasMixTemp(self->Sources[i]))
+                MixSource(self->Sources[i], pool->Device, NULL,
+                          pool->SamplesToDo);
+        }
+
+        PostSemaphoreAL(self->Done);
+    }
+
+    return 0;
+}
+
+
+/* Mixes all of the context's active sources, which must all be playing and
+ * updated. */
+ALvoid aluMixThreadSources(ALCdevice *device, ALCcontext *context, ALuint SamplesToDo)
+{
+    MixThreadPool *pool = device->MixThreads;
+    ALsource **src = context->ActiveSources;
+    ALuint count = context->ActiveSourceCount;
+    MixBuffers DryMix;
+    ALuint chunks, end;
+    ALuint i, j;
+
+    DryMix.DryBuffer = device->DryBuffer;
+    DryMix.ClickRemoval = device->ClickRemoval;
+    DryMix.PendingClicks = device->PendingClicks;
+
+    /* Split the sources into one chunk per thread, or one per source if
+     * there's fewer sources than threads. */
+    chunks = minu(pool->NumThreads+1, count);
+    end = (chunks > 0) ? count/chunks : 0;
+
+    pool->SamplesToDo = SamplesToDo;
+    for(i = 1;i < chunks;i++)
+    {
+        MixThread *thread = &pool->Threads[i-1];
+        ALuint start = (ALuint)((ALuint64)count*i / chunks);
+
+        thread->Sources = src + start;
+        thread->NumSources = (ALuint)((ALuint64)count*(i+1) / chunks) - start;
+        PostSemaphoreAL(thread->Start);
+    }
+
+    for(i = 0;i < end;i++)
+        MixSource(src[i], device, &DryMix, SamplesToDo);
+
+    for(i = 1;i < chunks;i++)
+    {
+        MixThread *thread = &pool->Threads[i-1];
+
+        WaitSemaphoreAL(thread->Done);
+        for(j = 0;j < thread->NumSources;j++)
+        {
+            ALsource *Source = thread->Sources[j];
+
+            if(HasMixTemp(Source))
+                MixSourceTemp(Source, device, &DryMix, SamplesToDo);
+            else
+                MixSource(Source, device, &DryMix, SamplesToDo);
+        }
+    }
+}
+
+
+static ALvoid StopMixThreads(MixThreadPool *pool)
+{
+    ALuint i;
+
+    pool->Quit = AL_TRUE;
+    for(i = 0;i < pool->NumThreads;i++)
+        PostSemaphoreAL(pool->Threads[i].Start);
+    for(i = 0;i < pool->NumThreads;i++)
+    {
+        MixThread *thread = &pool->Threads[i];
+
+        StopThread(thread->Thread);
+        DestroySemaphoreAL(thread->Start);
+        DestroySemaphoreAL(thread->Done);
+    }
+    pool->NumThreads = 0;
+}
+
+/* Starts the device's extra mixing threads if it needs them. If the threads
+ * can't be started, all mixing is done on the device's thread. */
+ALboolean aluInitMixThreads(ALCdevice *device)
+{
+    MixThreadPool *pool = device->MixThreads;
+    ALuint i;
+
+    if(device->NumMixThreads <= 1 || pool)
+        return AL_TRUE;
+
+    pool = calloc(1, sizeof(*pool));
+    if(!pool)
+        return AL_FALSE;
+    pool->Device = device;
+    pool->Threads = calloc(device->NumMixThreads-1, sizeof(pool->Threads[0]));
+    if(!pool->Threads)
+    {
+        free(pool);
+        return AL_FALSE;
+    }
+
+    for(i = 0;i < device->NumMixThreads-1;i++)
+    {
+        MixThread *thread = &pool->Threads[i];
+
+        thread->Pool = pool;
+        thread->Start = CreateSemaphoreAL();
+        thread->Done = CreateSemaphoreAL();
+        if(thread->Start && thread->Done)
+            thread->Thread = StartThread(MixThreadProc, thread);
+        if(!thread->Thread)
+        {
+            if(thread->Start)
+                DestroySemaphoreAL(thread->Start);
+            if(thread->Done)
+                DestroySemaphoreAL(thread->Done);
+            break;
+        }
+        pool->NumThreads++;
+    }
+    if(pool->NumThreads < device->NumMixThreads-1)
+    {
+        StopMixThreads(pool);
+        free(pool->Threads);
+        free(pool);
+        return AL_FALSE;
+    }
+
+    TRACE("Started %u extra mixing thread%s\n", pool->NumThreads,
+          (pool->NumThreads==1)?"":"s");
+    device->MixThreads = pool;
+
+    return AL_TRUE;
+}
+
+ALvoid aluFreeMixThreads(ALCdevice *device)
+{
+    MixThreadPool *pool = device->MixThreads;
+
+    if(!pool)
+        return;
+    device->MixThreads = NULL;
+
+    StopMixThreads(pool);
+    free(pool->Threads);
+    free(pool);
+}
@@ -22,6 +22,9 @@ typedef struct ALeffectslot
     ALeffectState *EffectState;
 
     ALfloat WetBuffer[BUFFERSIZE];
+    // Set when anything was mixed into WetBuffer this update. The effect is
+    // skipped when this is unset and the effect state reports being silent.
+    ALboolean WetMixed;
 
     ALfloat ClickRemoval[1];
     ALfloat PendingClicks[1];
@@ -42,7 +45,10 @@ struct ALeffectState {
     ALvoid (*Destroy)(ALeffectState *State);
     ALboolean (*DeviceUpdate)(ALeffectState *State, ALCdevice *Device);
     ALvoid (*Update)(ALeffectState *State, ALCcontext *Context, const ALeffectslot *Slot);
-    ALvoid (*Process)(ALeffectState *State, const ALeffectslot *Slot, ALuint SamplesToDo, const ALfloat *SamplesIn, ALfloat (*SamplesOut)[MAXCHANNELS]);
+    ALvoid (*Process)(ALeffectState *State, const ALeffectslot *Slot, ALuint SamplesToDo, const ALfloat *SamplesIn, ALfloat (*SamplesOut)[BUFFERSIZE], ALuint NumChannels);
+    // Returns AL_TRUE when processing silent input would produce no audible
+    // output, i.e. any tail has decayed below GAIN_SILENCE_THRESHOLD
+    ALboolean (*IsSilent)(ALeffectState *State);
 };
 
 ALeffectState *NoneCreate(void);
@@ -50,11 +56,13 @@ ALeffectState *ReverbCreate(void);
 ALeffectState *EchoCreate(void);
 ALeffectState *ModulatorCreate(void);
 ALeffectState *DedicatedCreate(void);
+ALeffectState *PluginCreate(const ALeffectPluginSOFT *plugin);
 
 #define ALEffect_Destroy(a)         ((a)->Destroy((a)))
 #define ALEffect_DeviceUpdate(a,b)  ((a)->DeviceUpdate((a),(b)))
 #define ALEffect_Update(a,b,c)      ((a)->Update((a),(b),(c)))
-#define ALEffect_Process(a,b,c,d,e) ((a)->Process((a),(b),(c),(d),(e)))
+#define ALEffect_Process(a,b,c,d,e,f) ((a)->Process((a),(b),(c),(d),(e),(f)))
+#define ALEffect_IsSilent(a)        ((a)->IsSilent((a)))
 
 
 #ifdef __cplusplus
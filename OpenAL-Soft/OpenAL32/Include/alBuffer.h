@@ -76,6 +76,16 @@ typedef struct ALbuffer
     ALsizei          Frequency;
     enum FmtChannels FmtChannels;
     enum FmtType     FmtType;
+    /* The type the data was loaded for, which buffer queries report. This is
+     * FmtType unless 8- or 16-bit data is stored as float. */
+    enum FmtType     LoadedType;
+    /* Set when data holds the original IMA4 or mu-law samples, which the
+     * mixer decodes as it plays. size and FmtType still describe the decoded
+     * 16-bit data. */
+    ALboolean        Compressed;
+    /* Changes whenever the compressed data does, so decode caches can tell
+     * when they're stale */
+    ALuint           Serial;
 
     enum UserFmtChannels OriginalChannels;
     enum UserFmtType     OriginalType;
@@ -91,6 +101,12 @@ typedef struct ALbuffer
     ALuint buffer;
 } ALbuffer;
 
+extern ALboolean FloatBufferStorage;
+extern ALboolean CompressedBufferStorage;
+
+struct BufferDecodeCache;
+ALvoid DecodeBufferFrames(const ALbuffer *ALBuf, ALuint start, ALuint count, ALshort *dst, struct BufferDecodeCache *cache);
+
 ALvoid ReleaseALBuffers(ALCdevice *device);
 
 #ifdef __cplusplus
@@ -2,21 +2,37 @@
 #define _AL_EFFECT_H_
 
 #include "AL/al.h"
+#include "AL/efx-plugin.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-enum {
-    EAXREVERB = 0,
-    REVERB,
-    ECHO,
-    MODULATOR,
-    DEDICATED,
+struct ALeffectState;
 
-    MAX_EFFECTS
-};
-extern ALboolean DisabledEffects[MAX_EFFECTS];
+/* The effect types available to apps. The built-in effects are listed first,
+ * followed by any registered at initialization. */
+#define MAX_EFFECT_TYPES 32
+
+extern struct EffectList {
+    // Name for the excludefx config option
+    const char *name;
+    // AL_EFFECT_TYPE enum name and value
+    const char *ename;
+    ALenum val;
+
+    // Creates the effect's processing state. Types using the same function
+    // share a state implementation, which is kept when switching between
+    // them. Registered effects are instead created from their plugin
+    // description.
+    struct ALeffectState *(*Create)(void);
+    const ALeffectPluginSOFT *Plugin;
+
+    ALboolean Disabled;
+} EffectList[MAX_EFFECT_TYPES+1];
+
+const struct EffectList *LookupEffectType(ALenum type);
+ALboolean RegisterEffectPlugin(const ALeffectPluginSOFT *plugin);
 
 extern ALfloat ReverbBoost;
 extern ALboolean EmulateEAXReverb;
@@ -75,6 +91,9 @@ typedef struct ALeffect
         struct {
             ALfloat Gain;
         } Dedicated;
+
+        // Property block for registered effects, laid out by the plugin
+        ALdouble Plugin[ALSOFT_EFFECT_MAX_PROPS_SIZE/sizeof(ALdouble)];
     } Params;
 
     // Index to itself
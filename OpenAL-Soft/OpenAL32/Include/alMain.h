@@ -5,10 +5,6 @@
 #include <stdio.h>
 #include <stdarg.h>
 
-#ifdef HAVE_FENV_H
-#include <fenv.h>
-#endif
-
 #include "AL/al.h"
 #include "AL/alc.h"
 #include "AL/alext.h"
@@ -45,6 +41,25 @@ ALC_API void ALC_APIENTRY alcRenderSamplesSOFT(ALCdevice *device, ALCvoid *buffe
 #endif
 #endif
 
+#ifndef ALC_SOFTX_output_limiter
+#define ALC_SOFTX_output_limiter 1
+#define ALC_OUTPUT_LIMITER_SOFT                  0x199A
+#define ALC_OUTPUT_LIMITER_REDUCTION_SOFT        0x199B
+#define ALC_OUTPUT_LATENCY_SOFT                  0x199C
+#endif
+
+#ifndef ALC_SOFTX_float_buffer_storage
+#define ALC_SOFTX_float_buffer_storage 1
+#define ALC_FLOAT_BUFFER_EXTRA_BYTES_SOFT        0x199D
+#define ALC_FLOAT_BUFFER_PEAK_BYTES_SOFT         0x199E
+#endif
+
+#ifndef ALC_SOFTX_hrtf_cache
+#define ALC_SOFTX_hrtf_cache 1
+#define ALC_HRTF_CACHE_HITS_SOFT                 0x199F
+#define ALC_HRTF_CACHE_MISSES_SOFT               0x19A0
+#endif
+
 #ifndef AL_SOFT_buffer_samples
 #define AL_SOFT_buffer_samples 1
 /* Sample types */
@@ -247,6 +262,10 @@ static __inline ALboolean CompExchangePtr(void *volatile*ptr, void *oldval, void
 {
     return __sync_bool_compare_and_swap(ptr, oldval, newval);
 }
+static __inline void MemoryFence(void)
+{
+    __sync_synchronize();
+}
 
 #elif defined(_WIN32)
 
@@ -278,9 +297,13 @@ static __inline ALboolean CompExchangeInt(volatile int *ptr, int oldval, int new
     } u = { ptr };
     return InterlockedCompareExchange(u.l, newval, oldval) == oldval;
 }
-static __inline void *CompExchangePtr(void *volatile*ptr, void *oldval, void *newval)
+static __inline ALboolean CompExchangePtr(void *volatile*ptr, void *oldval, void *newval)
+{
+    return InterlockedCompareExchangePointer(ptr, newval, oldval) == oldval;
+}
+static __inline void MemoryFence(void)
 {
-    return InterlockedCompareExchangePointer(ptr, newval, oldval);
+    MemoryBarrier();
 }
 
 #elif defined(__APPLE__)
@@ -314,10 +337,14 @@ static __inline ALboolean CompExchangeInt(volatile int *ptr, int oldval, int new
 {
     return OSAtomicCompareAndSwap32Barrier(oldval, newval, ptr);
 }
-static __inline ALboolean CompExchangeInt(void *volatile*ptr, void *oldval, void *newval)
+static __inline ALboolean CompExchangePtr(void *volatile*ptr, void *oldval, void *newval)
 {
     return OSAtomicCompareAndSwapPtrBarrier(oldval, newval, ptr);
 }
+static __inline void MemoryFence(void)
+{
+    OSMemoryBarrier();
+}
 
 #else
 #error "No atomic functions available on this platform!"
@@ -325,12 +352,24 @@ typedef ALuint RefCount;
 #endif
 
 
+/* A reader-writer lock that prefers writers. Threads that can't get it spin
+ * for a bit, then sleep (on a futex where available) until it's released. */
 typedef struct {
-    volatile RefCount read_count;
-    volatile RefCount write_count;
-    volatile ALenum read_lock;
-    volatile ALenum read_entry_lock;
-    volatile ALenum write_lock;
+    /* Number of readers holding the lock, or -1 while a writer holds it */
+    volatile int state;
+    /* Writers holding or waiting for the lock. New readers wait while this is
+     * non-zero, so a stream of readers can't starve a writer. */
+    volatile RefCount writers;
+    /* Bumped on each release that may let a waiting thread in, and the number
+     * of threads sleeping until it changes */
+    volatile RefCount seq;
+    volatile RefCount sleepers;
+
+    /* Contention counters: lock attempts that had to wait, and of those, the
+     * ones that went to sleep */
+    volatile RefCount read_waits;
+    volatile RefCount write_waits;
+    volatile RefCount sleeps;
 } RWLock;
 
 void RWLockInit(RWLock *lock);
@@ -338,9 +377,34 @@ void ReadLock(RWLock *lock);
 void ReadUnlock(RWLock *lock);
 void WriteLock(RWLock *lock);
 void WriteUnlock(RWLock *lock);
-
-
+void RWLockTraceStats(const RWLock *lock, const char *name);
+
+
+/* Object names are made of an index in the low bits, and a generation count
+ * in the high bits that changes each time the index is reused. A name that's
+ * been deleted won't match a new object given the same index. */
+#define NAME_INDEX_BITS  20
+#define NAME_INDEX_MASK  ((1u<<NAME_INDEX_BITS)-1)
+
+#define UINTMAP_BLOCK_BITS  10
+#define UINTMAP_BLOCK_SIZE  (1u<<UINTMAP_BLOCK_BITS)
+#define UINTMAP_BLOCK_MASK  (UINTMAP_BLOCK_SIZE-1)
+#define UINTMAP_MAX_BLOCKS  (1u<<(NAME_INDEX_BITS-UINTMAP_BLOCK_BITS))
+
+typedef struct UIntMapEntry {
+    volatile ALuint key;
+    ALvoid *volatile value;
+    /* Position of this entry in the map's array */
+    ALsizei pos;
+} UIntMapEntry;
+
+/* Maps object names to objects. Entries are found directly by the index bits
+ * of the key, in blocks that are allocated as needed and never moved until
+ * the map is reset, so lookups don't take the lock. The array holds the keys
+ * and values packed together for iterating over, and along with size, may
+ * only be accessed while the lock is held. NULL values aren't stored. */
 typedef struct UIntMap {
+    UIntMapEntry *volatile *volatile blocks;
     struct {
         ALuint key;
         ALvoid *value;
@@ -383,6 +447,8 @@ extern "C" {
 
 #define LOWPASSFREQCUTOFF          (5000)
 
+#define MAX_MIX_THREADS            (16)
+
 
 // Find the next power-of-2 for non-power-of-2 numbers.
 static __inline ALuint NextPowerOf2(ALuint value)
@@ -503,14 +569,6 @@ static __inline ALuint FrameSizeFromDevFmt(enum DevFmtChannels chans,
 }
 
 
-extern const struct EffectList {
-    const char *name;
-    int type;
-    const char *ename;
-    ALenum val;
-} EffectList[];
-
-
 struct ALCdevice_struct
 {
     volatile RefCount ref;
@@ -520,6 +578,10 @@ struct ALCdevice_struct
     ALboolean    IsLoopbackDevice;
 
     CRITICAL_SECTION Mutex;
+    /* Held by app threads calculating source parameters, which use the
+     * device's panning and HRTF setup, and while that setup changes. The
+     * mixer never takes it. */
+    CRITICAL_SECTION ParamsLock;
 
     ALuint       Frequency;
     ALuint       UpdateSize;
@@ -542,6 +604,10 @@ struct ALCdevice_struct
 
     // Map of Buffers for this device
     UIntMap BufferMap;
+    /* Extra memory taken by buffers stored as float (FloatBufferStorage), and
+     * the most it has been */
+    ALuint64 FloatBufferExtra;
+    ALuint64 FloatBufferPeak;
 
     // Map of Effects for this device
     UIntMap EffectMap;
@@ -553,11 +619,35 @@ struct ALCdevice_struct
     struct bs2b *Bs2b;
     ALCint       Bs2bLevel;
 
+    // HRTF tables for the device's frequency, when DEVICE_USE_HRTF is set,
+    // and the coefficients recently interpolated from them
+    const struct Hrtf *Hrtf;
+    struct HrtfCache *HrtfCache;
+
     // Device flags
     ALuint       Flags;
 
-    // Dry path buffer mix
-    ALfloat DryBuffer[BUFFERSIZE][MAXCHANNELS];
+    // Dry path buffer mix sources are mixed into, one row of BUFFERSIZE
+    // samples per channel. These are the output channels in DevChannels
+    // order, or the ambisonic bus in ACN order when AmbiOrder is set.
+    ALfloat (*DryBuffer)[BUFFERSIZE];
+    ALuint NumDryChannels;
+
+    // Output channel mix in DevChannels order, that effects write to. The
+    // same as DryBuffer unless the ambisonic bus gets decoded into it.
+    ALfloat (*OutBuffer)[BUFFERSIZE];
+
+    // Ambisonic order of the bus sources are mixed into, or 0 for none, and
+    // the decoder for it
+    ALuint AmbiOrder;
+    struct AmbiDecoder *AmbiDecoder;
+
+    // Output limiter settings (threshold in dB, release in milliseconds, and
+    // look-ahead in frames), and the limiter when DEVICE_USE_LIMITER is set
+    ALfloat LimiterThreshold;
+    ALfloat LimiterRelease;
+    ALuint  LimiterLookAhead;
+    struct Limiter *Limiter;
 
     enum Channel DevChannels[MAXCHANNELS];
 
@@ -565,6 +655,12 @@ struct ALCdevice_struct
     ALfloat PanningLUT[LUT_NUM][MAXCHANNELS];
     ALuint  NumChan;
 
+    // Number of threads to mix sources with, including the device's own, and
+    // the extra threads when there's more than one
+    ALuint NumMixThreads;
+    struct MixThreadPool *MixThreads;
+
+    // Click removal offsets, indexed the same as the DryBuffer rows
     ALfloat ClickRemoval[MAXCHANNELS];
     ALfloat PendingClicks[MAXCHANNELS];
 
@@ -596,6 +692,10 @@ struct ALCdevice_struct
 #define DEVICE_FREQUENCY_REQUEST                 (1<<2)
 // Channel configuration was requested by the config file
 #define DEVICE_CHANNELS_REQUEST                  (1<<3)
+// Limit the output's peaks before converting it to the output format
+#define DEVICE_USE_LIMITER                       (1<<4)
+// Source parameters are calculated by the app's thread instead of the mixer
+#define DEVICE_APP_SOURCE_UPDATES                (1<<5)
 
 // Specifies if the device is currently running
 #define DEVICE_RUNNING                           (1<<31)
@@ -621,6 +721,18 @@ struct ALCcontext_struct
     volatile ALfloat flSpeedOfSound;
     volatile ALenum  DeferUpdates;
 
+    /* Serializes app threads setting and getting source properties, which is
+     * done without locking the device. The mixer never takes it. */
+    CRITICAL_SECTION PropLock;
+    /* Source property containers that are free to reuse */
+    struct ALsourceProps *volatile FreeSourceProps;
+    /* Source parameter containers that are free to reuse */
+    struct ALsourceParams *volatile FreeSourceParams;
+    /* Source commands waiting for the mixer (most recent first), and
+     * containers that are free to reuse */
+    struct ALsourceCmd *volatile PendingSourceCmds;
+    struct ALsourceCmd *volatile FreeSourceCmds;
+
     struct ALsource **ActiveSources;
     ALsizei           ActiveSourceCount;
     ALsizei           MaxActiveSources;
@@ -652,15 +764,34 @@ ALCvoid UnlockContext(ALCcontext *context);
 ALvoid *StartThread(ALuint (*func)(ALvoid*), ALvoid *ptr);
 ALuint StopThread(ALvoid *thread);
 
+ALvoid *CreateSemaphoreAL(void);
+ALvoid DestroySemaphoreAL(ALvoid *sem);
+ALvoid PostSemaphoreAL(ALvoid *sem);
+ALvoid WaitSemaphoreAL(ALvoid *sem);
+
 ALCcontext *GetLockedContext(void);
 ALCcontext *GetContextRef(void);
 
+/* A ring buffer of sample frames, safe to use without locking as long as
+ * there's only one writer thread and one reader thread. Lengths are in frames.
+ * The Get*Vector functions give the readable or writable space as up to two
+ * segments (the second is non-empty when the space wraps around), which can be
+ * accessed directly and then committed with the matching Advance* function. */
 typedef struct RingBuffer RingBuffer;
+typedef struct RingBufferVector {
+    ALubyte *buf;
+    ALsizei len;
+} RingBufferVector;
 RingBuffer *CreateRingBuffer(ALsizei frame_size, ALsizei length);
 void DestroyRingBuffer(RingBuffer *ring);
 ALsizei RingBufferSize(RingBuffer *ring);
+ALsizei RingBufferSpace(RingBuffer *ring);
 void WriteRingBuffer(RingBuffer *ring, const ALubyte *data, ALsizei len);
 void ReadRingBuffer(RingBuffer *ring, ALubyte *data, ALsizei len);
+void GetRingBufferReadVector(RingBuffer *ring, RingBufferVector vec[2]);
+void GetRingBufferWriteVector(RingBuffer *ring, RingBufferVector vec[2]);
+void AdvanceRingBufferRead(RingBuffer *ring, ALsizei len);
+void AdvanceRingBufferWrite(RingBuffer *ring, ALsizei len);
 
 void ReadALConfig(void);
 void FreeALConfig(void);
@@ -672,20 +803,36 @@ int GetConfigValueBool(const char *blockName, const char *keyName, int def);
 
 void SetRTPriority(void);
 
+void *al_malloc(size_t alignment, size_t size);
+void al_free(void *ptr);
+
+enum {
+    CPU_CAP_SSE2   = 1<<0,
+    CPU_CAP_SSE4_1 = 1<<1,
+    CPU_CAP_AVX2   = 1<<2,
+    CPU_CAP_NEON   = 1<<3
+};
+extern ALuint CPUCapFlags;
+void FillCPUCaps(ALuint capfilter);
+
 void SetDefaultChannelOrder(ALCdevice *device);
 void SetDefaultWFXChannelOrder(ALCdevice *device);
 
 const ALCchar *DevFmtTypeString(enum DevFmtType type);
 const ALCchar *DevFmtChannelsString(enum DevFmtChannels chans);
 
-#define HRIR_BITS        (5)
+#define HRIR_BITS        (7)
 #define HRIR_LENGTH      (1<<HRIR_BITS)
-#define HRIR_MASK        (HRIR_LENGTH-1)
 void InitHrtf(void);
-ALCboolean IsHrtfCompatible(ALCdevice *device);
+void FreeHrtf(void);
+const struct Hrtf *GetHrtf(ALCdevice *device);
+struct HrtfCache *CreateHrtfCache(const struct Hrtf *Hrtf);
+void DestroyHrtfCache(struct HrtfCache *Cache);
+void GetHrtfCacheStats(const struct HrtfCache *Cache, ALuint *hits, ALuint *misses);
+ALuint GetHrtfIrSize(const struct Hrtf *Hrtf);
 ALfloat CalcHrtfDelta(ALfloat oldGain, ALfloat newGain, const ALfloat olddir[3], const ALfloat newdir[3]);
-void GetLerpedHrtfCoeffs(ALfloat elevation, ALfloat azimuth, ALfloat gain, ALfloat (*coeffs)[2], ALuint *delays);
-ALuint GetMovingHrtfCoeffs(ALfloat elevation, ALfloat azimuth, ALfloat gain, ALfloat delta, ALint counter, ALfloat (*coeffs)[2], ALuint *delays, ALfloat (*coeffStep)[2], ALint *delayStep);
+void GetLerpedHrtfCoeffs(struct HrtfCache *Cache, ALfloat elevation, ALfloat azimuth, ALfloat gain, ALfloat (*coeffs)[2], ALuint *delays);
+ALuint GetMovingHrtfCoeffs(struct HrtfCache *Cache, ALfloat elevation, ALfloat azimuth, ALfloat gain, ALfloat delta, ALint counter, ALfloat (*coeffs)[2], ALuint *delays, ALfloat (*coeffStep)[2], ALint *delayStep);
 
 void al_print(const char *func, const char *fmt, ...) PRINTF_STYLE(2,3);
 #define AL_PRINT(...) al_print(__FUNCTION__, __VA_ARGS__)
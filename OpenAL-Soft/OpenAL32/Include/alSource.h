@@ -21,6 +21,61 @@ extern const ALsizei ResamplerPadding[RESAMPLER_MAX];
 extern const ALsizei ResamplerPrePadding[RESAMPLER_MAX];
 
 
+/* The last IMA4 block the mixer decoded for a source, so stepping through a
+ * compressed buffer decodes each block once */
+typedef struct BufferDecodeCache
+{
+    ALuint Serial; // Serial of the buffer the block came from, 0 for none
+    ALuint Block;
+    ALshort Samples[65*MAXCHANNELS];
+} BufferDecodeCache;
+
+
+/* A source channel resampled and filtered by one of the device's extra mixing
+ * threads, waiting to be mixed in source order by the device's own thread */
+typedef struct SourceMixChannel {
+    ALfloat Resampled[BUFFERSIZE+1];
+    ALfloat Filtered[BUFFERSIZE];
+    // Filtered values for click removal at the start and end of the update
+    ALfloat Clicks[2];
+} SourceMixChannel;
+
+typedef struct SourceMixTemp {
+    // Length of each part the update was mixed in, along the buffer queue
+    ALuint NumSegments;
+    ALuint SegmentSize[BUFFERSIZE];
+    ALboolean Hrtf;
+
+    SourceMixChannel *Channels;
+} SourceMixTemp;
+
+
+/* HRIRs longer than HRTF_CONV_MIN_IRSIZE have everything past their first
+ * HRTF_BLOCK_SIZE taps applied in the frequency domain, one block at a time.
+ * Since those taps only ever see input at least a block old, the tail adds no
+ * latency over the directly applied head. */
+#define HRTF_BLOCK_BITS       (5)
+#define HRTF_BLOCK_SIZE       (1<<HRTF_BLOCK_BITS)
+#define HRTF_MAX_PARTS        (HRIR_LENGTH/HRTF_BLOCK_SIZE - 1)
+#define HRTF_CONV_MIN_IRSIZE  (96)
+
+typedef struct HrtfConvState
+{
+    ALuint Pos; // Position in the current block
+    ALfloat Input[HRTF_BLOCK_SIZE*2][2]; // Previous and current block, per ear
+    ALfloat Output[HRTF_BLOCK_SIZE][2];  // Tail output for the current block
+
+    /* Spectra of the most recent input blocks, starting from SpectraPos, and
+     * of each partition of the tail they get multiplied with. Each holds the
+     * real and imaginary parts for each ear. */
+    ALfloat Spectra[HRTF_MAX_PARTS][2][2][HRTF_BLOCK_SIZE+1];
+    ALuint SpectraPos;
+    ALfloat Filter[HRTF_MAX_PARTS][2][2][HRTF_BLOCK_SIZE+1];
+    ALfloat Coeffs[HRIR_LENGTH-HRTF_BLOCK_SIZE][2]; // Taps Filter was made from
+    ALuint NumParts; // Partitions in Filter, 0 if it hasn't been made yet
+} HrtfConvState;
+
+
 typedef struct ALbufferlistitem
 {
     struct ALbuffer         *buffer;
@@ -28,6 +83,118 @@ typedef struct ALbufferlistitem
     struct ALbufferlistitem *prev;
 } ALbufferlistitem;
 
+/* The properties of a source that only affect its mixing parameters. When the
+ * app changes one, a copy of them all is handed to the mixer through the
+ * source's PendingProps, which the mixer picks up at its next update. This
+ * way neither side has to wait on the other for them. */
+typedef struct ALsourceProps
+{
+    ALfloat      flPitch;
+    ALfloat      flGain;
+    ALfloat      flOuterGain;
+    ALfloat      flMinGain;
+    ALfloat      flMaxGain;
+    ALfloat      flInnerAngle;
+    ALfloat      flOuterAngle;
+    ALfloat      flRefDistance;
+    ALfloat      flMaxDistance;
+    ALfloat      flRollOffFactor;
+    ALfloat      vPosition[3];
+    ALfloat      vVelocity[3];
+    ALfloat      vOrientation[3];
+    ALboolean    bHeadRelative;
+    enum DistanceModel DistanceModel;
+    ALboolean    VirtualChannels;
+
+    enum Resampler Resampler;
+
+    ALfloat DirectGain;
+    ALfloat DirectGainHF;
+
+    struct {
+        struct ALeffectslot *Slot;
+        ALfloat WetGain;
+        ALfloat WetGainHF;
+    } Send[MAX_SENDS];
+
+    ALboolean DryGainHFAuto;
+    ALboolean WetGainAuto;
+    ALboolean WetGainHFAuto;
+    ALfloat   OuterGainHF;
+
+    ALfloat AirAbsorptionFactor;
+    ALfloat RoomRolloffFactor;
+    ALfloat DopplerFactor;
+
+    // Next container in the context's free list
+    struct ALsourceProps *volatile next;
+} ALsourceProps;
+
+/* The parameters the mixer uses for a source, worked out from its properties
+ * and those of the listener, context and device. Normally the mixer works
+ * them out itself. With DEVICE_APP_SOURCE_UPDATES, the app's thread works them
+ * out into a new container when it commits its changes, and hands it to the
+ * mixer through the source's PendingParams. The mixer swaps it in and puts
+ * the old one on the context's free list, so nothing gets copied. */
+typedef struct ALsourceParams
+{
+    MixerFunc DoMix;
+
+    ALint Step;
+    enum Resampler Resampler;
+
+    ALfloat HrtfGain;
+    ALfloat HrtfDir[3];
+    /* Each channel's HRIR, one after the other, and the steps for moving one.
+     * They're stored after the container, sized for the device's HRTF, and
+     * are NULL without one. */
+    ALfloat (*HrtfCoeffs)[2];
+    ALuint HrtfDelay[MAXCHANNELS][2];
+    ALfloat (*HrtfCoeffStep)[2];
+    ALint HrtfDelayStep[2];
+    // Samples left until the HRIR reaches the coefficients above
+    ALuint HrtfCounter;
+
+    /* A mixing matrix. First subscript is the channel number of the input
+     * data (regardless of channel configuration) and the second is the
+     * channel target (eg. FRONT_LEFT) */
+    ALfloat DryGains[MAXCHANNELS][MAXCHANNELS];
+
+    // Coefficient for the source's dry filter
+    ALfloat iirCoeff;
+
+    struct {
+        struct ALeffectslot *Slot;
+        ALfloat WetGain;
+        // Coefficient for the source's filter for this send
+        ALfloat iirCoeff;
+    } Send[MAX_SENDS];
+
+    // Next container in the context's free list
+    struct ALsourceParams *volatile next;
+} ALsourceParams;
+
+/* A change to a source's play state or position. The app queues these on the
+ * context instead of changing the source's mixing state itself, and the mixer
+ * applies them in order at its next update, so playing, stopping or seeking a
+ * source never has to wait for the mixer. */
+typedef struct ALsourceCmd
+{
+    struct ALsource *Source;
+
+    // The new state, or AL_NONE to only move to the position below
+    ALenum State;
+
+    // Where in the queue to continue from, if Seek is set. Stopping a source
+    // uses BuffersPlayed for the number of buffers it had queued at the time.
+    ALboolean Seek;
+    ALuint BuffersPlayed;
+    ALuint Position;
+
+    // Next command in the context's list
+    struct ALsourceCmd *volatile next;
+} ALsourceCmd;
+
 typedef struct ALsource
 {
     ALfloat      flPitch;
@@ -52,6 +219,11 @@ typedef struct ALsource
 
     ALenum       state;
     ALenum       new_state;
+    /* The state the app last set, which is reported until the mixer has
+     * applied all the commands queued for the source */
+    ALenum       QueuedState;
+    ALuint       CmdsQueued;
+    volatile RefCount CmdsDone;
     ALuint       position;
     ALuint       position_fraction;
 
@@ -86,52 +258,72 @@ typedef struct ALsource
     ALuint NumChannels;
     ALuint SampleSize;
 
-    /* HRTF info */
+    /* HRTF info. The Values rings are sized for the device's HRTF, a power
+     * of two at least HrtfIrSize long for each channel, and are NULL without
+     * one. */
     ALboolean HrtfMoving;
-    ALuint HrtfCounter;
     ALfloat HrtfHistory[MAXCHANNELS][SRC_HISTORY_LENGTH];
-    ALfloat HrtfValues[MAXCHANNELS][HRIR_LENGTH][2];
+    ALfloat (*HrtfValues)[2];
+    ALuint HrtfValuesMask;
+    ALuint HrtfIrSize;
     ALuint HrtfOffset;
+    HrtfConvState *HrtfConv;
+    ALuint HrtfConvChannels;
 
-    /* Current target parameters used for mixing */
-    struct {
-        MixerFunc DoMix;
-
-        ALint Step;
+    SourceMixTemp *MixTemp;
+    ALuint MixTempChannels;
 
-        ALfloat HrtfGain;
-        ALfloat HrtfDir[3];
-        ALfloat HrtfCoeffs[MAXCHANNELS][HRIR_LENGTH][2];
-        ALuint HrtfDelay[MAXCHANNELS][2];
-        ALfloat HrtfCoeffStep[HRIR_LENGTH][2];
-        ALint HrtfDelayStep[2];
+    BufferDecodeCache DecodeCache;
 
-        /* A mixing matrix. First subscript is the channel number of the input
-         * data (regardless of channel configuration) and the second is the
-         * channel target (eg. FRONT_LEFT) */
-        ALfloat DryGains[MAXCHANNELS][MAXCHANNELS];
+    /* Current target parameters used for mixing. With
+     * DEVICE_APP_SOURCE_UPDATES, there may also be an update from the app
+     * waiting to replace them, and the app keeps track of the last ones it
+     * handed over (either of the two) to carry on from. */
+    ALsourceParams *Params;
+    ALsourceParams *volatile PendingParams;
+    ALsourceParams *LastParams;
+    volatile ALenum NeedsUpdate;
 
+    /* The dry and send filters. Their histories carry on from one set of
+     * parameters to the next, so they're kept here, and take their
+     * coefficients from the current parameters as they're mixed. */
+    FILTER iirFilter;
+    ALfloat history[MAXCHANNELS*2];
+    struct {
         FILTER iirFilter;
-        ALfloat history[MAXCHANNELS*2];
-
-        struct {
-            struct ALeffectslot *Slot;
-            ALfloat WetGain;
-            FILTER iirFilter;
-            ALfloat history[MAXCHANNELS];
-        } Send[MAX_SENDS];
-    } Params;
-    volatile ALenum NeedsUpdate;
+        ALfloat history[MAXCHANNELS];
+    } SendFilter[MAX_SENDS];
+
+    /* The properties the mixer is currently using, and an update from the app
+     * waiting to replace them */
+    ALsourceProps Props;
+    ALsourceProps *volatile PendingProps;
 
-    ALvoid (*Update)(struct ALsource *self, const ALCcontext *context);
+    ALvoid (*Update)(struct ALsource *self, ALsourceParams *params,
+                     const ALCcontext *context);
 
     // Index to itself
     ALuint source;
 } ALsource;
-#define ALsource_Update(s,a)                 ((s)->Update(s,a))
-
+#define ALsource_Update(s,p,a)               ((s)->Update(s,p,a))
+
+ALboolean AllocSourceParams(ALsource *Source, ALCdevice *Device);
+ALvoid UpdateSourceProps(ALsource *Source, ALCcontext *Context);
+ALboolean ApplySourceProps(ALsource *Source, ALCcontext *Context);
+ALsourceParams *GetSourceCommitParams(ALsource *Source, ALCcontext *Context);
+ALvoid UpdateSourceParams(ALsource *Source, ALsourceParams *params, ALCcontext *Context);
+ALboolean ApplySourceParams(ALsource *Source, ALCcontext *Context);
 ALvoid SetSourceState(ALsource *Source, ALCcontext *Context, ALenum state);
-ALboolean ApplyOffset(ALsource *Source);
+ALboolean ApplyOffset(ALsource *Source, ALCcontext *Context);
+ALvoid ApplySourceCmds(ALCcontext *Context);
+
+/* The source's state as far as the app is concerned */
+static __inline ALenum GetSourceState(const ALsource *Source)
+{
+    if(Source->CmdsDone != Source->CmdsQueued)
+        return Source->QueuedState;
+    return Source->state;
+}
 
 ALvoid ReleaseALSources(ALCcontext *Context);
 
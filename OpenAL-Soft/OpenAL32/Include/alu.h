@@ -57,11 +57,15 @@ extern "C" {
 #endif
 
 struct ALsource;
+struct ALsourceParams;
 struct ALbuffer;
+struct MixBuffers;
+struct AmbiDecoder;
 
 typedef ALvoid (*MixerFunc)(struct ALsource *self, ALCdevice *Device,
+                            struct MixBuffers *Target,
                             const ALvoid *RESTRICT data,
-                            ALuint *DataPosInt, ALuint *DataPosFrac,
+                            ALuint DataPosFrac, ALuint increment,
                             ALuint OutPos, ALuint SamplesToDo,
                             ALuint BufferSize);
 
@@ -69,6 +73,7 @@ enum Resampler {
     POINT_RESAMPLER = 0,
     LINEAR_RESAMPLER,
     CUBIC_RESAMPLER,
+    SINC_RESAMPLER,
 
     RESAMPLER_MAX,
     RESAMPLER_MIN = -1,
@@ -89,6 +94,15 @@ enum Channel {
     MAXCHANNELS
 };
 
+/* Highest ambisonic order sources can be mixed at, and how many channels its
+ * bus has. The bus takes the place of the output channels in the dry buffer
+ * and the sources' DryGains, so it can't have more than MAXCHANNELS. */
+#define MAX_AMBI_ORDER     2
+#define MAX_AMBI_CHANNELS  ((MAX_AMBI_ORDER+1)*(MAX_AMBI_ORDER+1))
+
+/* The most frames the output limiter can look ahead (and delay the output) */
+#define LIMITER_MAX_LOOKAHEAD  1024
+
 enum DistanceModel {
     InverseDistanceClamped  = AL_INVERSE_DISTANCE_CLAMPED,
     LinearDistanceClamped   = AL_LINEAR_DISTANCE_CLAMPED,
@@ -101,23 +115,53 @@ enum DistanceModel {
 
 #define BUFFERSIZE 4096
 
+/* The dry buffer and click removal values sources get mixed into. The sends
+ * always go to the effect slots' own wet buffers. */
+typedef struct MixBuffers {
+    ALfloat (*DryBuffer)[BUFFERSIZE];
+    ALfloat *ClickRemoval;
+    ALfloat *PendingClicks;
+} MixBuffers;
+
 #define FRACTIONBITS (14)
 #define FRACTIONONE  (1<<FRACTIONBITS)
 #define FRACTIONMASK (FRACTIONONE-1)
 
-/* Size for temporary stack storage of buffer data. Larger values need more
- * stack, while smaller values may need more iterations. The value needs to be
- * a sensible size, however, as it constrains the max stepping value used for
- * mixing.
- * The mixer requires being able to do two samplings per mixing loop. A 16KB
- * buffer can hold 512 sample frames for a 7.1 float buffer. With the cubic
- * resampler (which requires 3 padding sample frames), this limits the maximum
- * step to about 508. This means that buffer_freq*source_pitch cannot exceed
- * device_freq*508 for an 8-channel 32-bit buffer. */
+/* The sinc resampler's filter length, in sample frames, and how many phases
+ * between samples its coefficients are tabled for. Coefficients between phases
+ * are interpolated from the remaining fraction bits. The filter covers
+ * SINC_PRE_POINTS frames before the current one. */
+#define SINC_POINTS      24
+#define SINC_PRE_POINTS  (SINC_POINTS/2 - 1)
+#define SINC_PHASE_BITS  5
+#define SINC_PHASES      (1<<SINC_PHASE_BITS)
+#define SINC_FRAC_BITS   (FRACTIONBITS-SINC_PHASE_BITS)
+#define SINC_FRAC_ONE    (1<<SINC_FRAC_BITS)
+#define SINC_FRAC_MASK   (SINC_FRAC_ONE-1)
+
+/* How many phases between samples the cubic resampler's coefficients are
+ * tabled for. The vector resamplers work out several sample positions at once,
+ * which only fit in 32 bits with steps up to RESAMPLE_VEC_MAX_STEP. */
+#define CUBIC_PHASE_BITS  12
+#define CUBIC_PHASES      (1<<CUBIC_PHASE_BITS)
+#define CUBIC_FRAC_BITS   (FRACTIONBITS-CUBIC_PHASE_BITS)
+
+#define RESAMPLE_VEC_MAX_STEP  (1<<28)
+
+/* Size for temporary stack storage of buffer data. Sources are mixed straight
+ * from their buffers where possible, so this is only used to piece together
+ * samples across buffer edges and loop points. Larger values need more stack,
+ * while smaller values may need more iterations there. It doesn't limit the
+ * stepping value; when a step is too large for two samplings to fit, only the
+ * sample frames each sampling reads get copied. */
 #ifndef STACK_DATA_SIZE
 #define STACK_DATA_SIZE  16384
 #endif
 
+/* Sample magnitude below which effect inputs and tails are considered silent
+ * (about -100dB). */
+#define GAIN_SILENCE_THRESHOLD  (0.00001f)
+
 
 static __inline ALfloat minf(ALfloat a, ALfloat b)
 { return ((a > b) ? b : a); }
@@ -140,32 +184,83 @@ static __inline ALint maxi(ALint a, ALint b)
 static __inline ALint clampi(ALint val, ALint min, ALint max)
 { return mini(max, maxi(min, val)); }
 
+static __inline ALint64 mini64(ALint64 a, ALint64 b)
+{ return ((a > b) ? b : a); }
+static __inline ALint64 maxi64(ALint64 a, ALint64 b)
+{ return ((a > b) ? a : b); }
+static __inline ALuint64 minu64(ALuint64 a, ALuint64 b)
+{ return ((a > b) ? b : a); }
+
 
 static __inline ALdouble lerp(ALdouble val1, ALdouble val2, ALdouble mu)
 {
     return val1 + (val2-val1)*mu;
 }
-static __inline ALdouble cubic(ALdouble val0, ALdouble val1, ALdouble val2, ALdouble val3, ALdouble mu)
+static __inline ALfloat lerpf(ALfloat val1, ALfloat val2, ALfloat mu)
 {
-    ALdouble mu2 = mu*mu;
-    ALdouble a0 = -0.5*val0 +  1.5*val1 + -1.5*val2 +  0.5*val3;
-    ALdouble a1 =      val0 + -2.5*val1 +  2.0*val2 + -0.5*val3;
-    ALdouble a2 = -0.5*val0             +  0.5*val2;
-    ALdouble a3 =                  val1;
+    return val1 + (val2-val1)*mu;
+}
+
+static __inline ALboolean IsSilentBuffer(const ALfloat *buffer, ALuint len)
+{
+    ALuint i;
+    for(i = 0;i < len;i++)
+    {
+        if(buffer[i] > GAIN_SILENCE_THRESHOLD || buffer[i] < -GAIN_SILENCE_THRESHOLD)
+            return AL_FALSE;
+    }
+    return AL_TRUE;
+}
 
-    return a0*mu*mu2 + a1*mu2 + a2*mu + a3;
+static __inline ALshort aluF2S(ALfloat val)
+{
+    if(val > 1.0f) return 32767;
+    if(val < -1.0f) return -32768;
+    return (ALint)(val*32767.0f);
 }
+static __inline ALushort aluF2US(ALfloat val)
+{ return aluF2S(val)+32768; }
+static __inline ALbyte aluF2B(ALfloat val)
+{ return aluF2S(val)>>8; }
+static __inline ALubyte aluF2UB(ALfloat val)
+{ return aluF2US(val)>>8; }
+
 
 ALvoid aluInitPanning(ALCdevice *Device);
 ALint aluCart2LUTpos(ALfloat re, ALfloat im);
 
-ALvoid CalcSourceParams(struct ALsource *ALSource, const ALCcontext *ALContext);
-ALvoid CalcNonAttnSourceParams(struct ALsource *ALSource, const ALCcontext *ALContext);
+ALvoid aluCalcAmbiCoeffs(const ALCdevice *device, const ALfloat dir[3],
+                         ALfloat DirGain, ALfloat coeffs[MAXCHANNELS]);
+struct AmbiDecoder *aluCreateAmbiDecoder(void);
+ALvoid aluDestroyAmbiDecoder(struct AmbiDecoder *dec);
+ALvoid aluInitAmbiDecoder(ALCdevice *device);
+ALvoid aluAmbiDecode(ALCdevice *device, ALuint SamplesToDo);
+
+struct Limiter *aluCreateLimiter(void);
+ALvoid aluDestroyLimiter(struct Limiter *limiter);
+ALvoid aluInitLimiter(ALCdevice *device);
+ALvoid aluApplyLimiter(ALCdevice *device, ALuint SamplesToDo);
+ALint aluGetLimiterReduction(const ALCdevice *device);
+
+ALvoid CalcSourceParams(struct ALsource *ALSource, struct ALsourceParams *Params, const ALCcontext *ALContext);
+ALvoid CalcSourceParamsBatch(struct ALsource *const*sources, struct ALsourceParams *const*params, ALuint count, const ALCcontext *ALContext);
+ALvoid aluUpdateSources(ALCcontext *ALContext, ALboolean UpdateAll);
+ALvoid aluCommitSourceUpdate(struct ALsource *Source, ALCcontext *Context);
+ALvoid aluCommitUpdates(ALCcontext *Context);
+ALvoid CalcNonAttnSourceParams(struct ALsource *ALSource, struct ALsourceParams *Params, const ALCcontext *ALContext);
 
 MixerFunc SelectMixer(struct ALbuffer *Buffer, enum Resampler Resampler);
 MixerFunc SelectHrtfMixer(struct ALbuffer *Buffer, enum Resampler Resampler);
+ALvoid aluInitMixers(void);
+
+ALvoid MixSource(struct ALsource *Source, ALCdevice *Device, MixBuffers *Target,
+                 ALuint SamplesToDo);
+ALvoid MixSourceTemp(struct ALsource *Source, ALCdevice *Device,
+                     MixBuffers *Target, ALuint SamplesToDo);
 
-ALvoid MixSource(struct ALsource *Source, ALCdevice *Device, ALuint SamplesToDo);
+ALboolean aluInitMixThreads(ALCdevice *device);
+ALvoid aluFreeMixThreads(ALCdevice *device);
+ALvoid aluMixThreadSources(ALCdevice *device, ALCcontext *context, ALuint SamplesToDo);
 
 ALvoid aluMixData(ALCdevice *device, ALvoid *buffer, ALsizei size);
 ALvoid aluHandleDisconnect(ALCdevice *device);
@@ -35,6 +35,7 @@
 static ALvoid InitializeEffect(ALCcontext *Context, ALeffectslot *EffectSlot, ALeffect *effect);
 static ALenum ResizeEffectSlotArray(ALCcontext *Context, ALsizei count);
 static ALvoid RemoveEffectSlotArray(ALCcontext *Context, ALeffectslot *val);
+static ALvoid RemoveSourceParamsSlot(ALCcontext *Context, ALeffectslot *slot);
 
 #define LookupEffectSlot(m, k) ((ALeffectslot*)LookupUIntMapKey(&(m), (k)))
 #define RemoveEffectSlot(m, k) ((ALeffectslot*)PopUIntMapValue(&(m), (k)))
@@ -80,6 +81,7 @@ AL_API ALvoid AL_APIENTRY alGenAuxiliaryEffectSlots(ALsizei n, ALuint *effectslo
             slot->NeedsUpdate = AL_FALSE;
             for(j = 0;j < BUFFERSIZE;j++)
                 slot->WetBuffer[j] = 0.0f;
+            slot->WetMixed = AL_FALSE;
             for(j = 0;j < 1;j++)
             {
                 slot->ClickRemoval[j] = 0.0f;
@@ -148,6 +150,7 @@ AL_API ALvoid AL_APIENTRY alDeleteAuxiliaryEffectSlots(ALsizei n, ALuint *effect
         }
 
         // All effectslots are valid
+        EnterCriticalSection(&Context->PropLock);
         for(i = 0;i < n;i++)
         {
             // Recheck that the effectslot is valid, because there could be duplicated names
@@ -157,12 +160,14 @@ AL_API ALvoid AL_APIENTRY alDeleteAuxiliaryEffectSlots(ALsizei n, ALuint *effect
 
             LockContext(Context);
             RemoveEffectSlotArray(Context, EffectSlot);
+            RemoveSourceParamsSlot(Context, EffectSlot);
             UnlockContext(Context);
             ALEffect_Destroy(EffectSlot->EffectState);
 
             memset(EffectSlot, 0, sizeof(ALeffectslot));
             free(EffectSlot);
         }
+        LeaveCriticalSection(&Context->PropLock);
     }
 
     ALCcontext_DecRef(Context);
@@ -456,13 +461,19 @@ static ALvoid NoneUpdate(ALeffectState *State, ALCcontext *Context, const ALeffe
     (void)Context;
     (void)Slot;
 }
-static ALvoid NoneProcess(ALeffectState *State, const ALeffectslot *Slot, ALuint SamplesToDo, const ALfloat *SamplesIn, ALfloat (*SamplesOut)[MAXCHANNELS])
+static ALvoid NoneProcess(ALeffectState *State, const ALeffectslot *Slot, ALuint SamplesToDo, const ALfloat *SamplesIn, ALfloat (*SamplesOut)[BUFFERSIZE], ALuint NumChannels)
 {
     (void)State;
     (void)Slot;
     (void)SamplesToDo;
     (void)SamplesIn;
     (void)SamplesOut;
+    (void)NumChannels;
+}
+static ALboolean NoneIsSilent(ALeffectState *State)
+{
+    return AL_TRUE;
+    (void)State;
 }
 ALeffectState *NoneCreate(void)
 {
@@ -476,6 +487,7 @@ ALeffectState *NoneCreate(void)
     state->DeviceUpdate = NoneDeviceUpdate;
     state->Update = NoneUpdate;
     state->Process = NoneProcess;
+    state->IsSilent = NoneIsSilent;
 
     return state;
 }
@@ -499,6 +511,32 @@ static ALvoid RemoveEffectSlotArray(ALCcontext *Context, ALeffectslot *slot)
     }
 }
 
+/* Sources that stopped sending to the slot can still have it in their mixing
+ * parameters, when the app's thread calculates them and hasn't committed the
+ * change. Must be called with the context's PropLock held and the device
+ * locked, so neither thread can change them meanwhile. */
+static ALvoid RemoveSourceParamsSlot(ALCcontext *Context, ALeffectslot *slot)
+{
+    ALsizei pos;
+    ALuint i;
+
+    LockUIntMapRead(&Context->SourceMap);
+    for(pos = 0;pos < Context->SourceMap.size;pos++)
+    {
+        ALsource *Source = Context->SourceMap.array[pos].value;
+        ALsourceParams *params = Source->PendingParams;
+
+        for(i = 0;i < MAX_SENDS;i++)
+        {
+            if(Source->Params->Send[i].Slot == slot)
+                Source->Params->Send[i].Slot = NULL;
+            if(params && params->Send[i].Slot == slot)
+                params->Send[i].Slot = NULL;
+        }
+    }
+    UnlockUIntMapRead(&Context->SourceMap);
+}
+
 static ALenum ResizeEffectSlotArray(ALCcontext *Context, ALsizei count)
 {
     ALsizei newcount;
@@ -522,40 +560,27 @@ static ALenum ResizeEffectSlotArray(ALCcontext *Context, ALsizei count)
 static ALvoid InitializeEffect(ALCcontext *Context, ALeffectslot *EffectSlot, ALeffect *effect)
 {
     ALenum newtype = (effect ? effect->type : AL_EFFECT_NULL);
+    const struct EffectList *newinfo, *oldinfo;
     ALeffectState *NewState = NULL;
     ALenum err = AL_NO_ERROR;
 
-    if(newtype == AL_EFFECT_NULL && EffectSlot->effect.type != AL_EFFECT_NULL)
-    {
-        NewState = NoneCreate();
-        if(!NewState) err = AL_OUT_OF_MEMORY;
-    }
-    else if(newtype == AL_EFFECT_EAXREVERB || newtype == AL_EFFECT_REVERB)
-    {
-        if(EffectSlot->effect.type != AL_EFFECT_EAXREVERB && EffectSlot->effect.type != AL_EFFECT_REVERB)
-        {
-            NewState = ReverbCreate();
-            if(!NewState) err = AL_OUT_OF_MEMORY;
-        }
-    }
-    else if(newtype == AL_EFFECT_ECHO && EffectSlot->effect.type != AL_EFFECT_ECHO)
-    {
-        NewState = EchoCreate();
-        if(!NewState) err = AL_OUT_OF_MEMORY;
-    }
-    else if(newtype == AL_EFFECT_RING_MODULATOR && EffectSlot->effect.type != AL_EFFECT_RING_MODULATOR)
+    newinfo = ((newtype != AL_EFFECT_NULL) ? LookupEffectType(newtype) : NULL);
+    oldinfo = ((EffectSlot->effect.type != AL_EFFECT_NULL) ?
+               LookupEffectType(EffectSlot->effect.type) : NULL);
+
+    /* Only create a new state when the type needs a different one */
+    if(!newinfo != !oldinfo ||
+       (newinfo && (newinfo->Create != oldinfo->Create ||
+                    newinfo->Plugin != oldinfo->Plugin)))
     {
-        NewState = ModulatorCreate();
+        if(!newinfo)
+            NewState = NoneCreate();
+        else if(newinfo->Plugin)
+            NewState = PluginCreate(newinfo->Plugin);
+        else
+            NewState = newinfo->Create();
         if(!NewState) err = AL_OUT_OF_MEMORY;
     }
-    else if(newtype == AL_EFFECT_DEDICATED_DIALOGUE || newtype == AL_EFFECT_DEDICATED_LOW_FREQUENCY_EFFECT)
-    {
-        if(EffectSlot->effect.type != AL_EFFECT_DEDICATED_DIALOGUE && EffectSlot->effect.type != AL_EFFECT_DEDICATED_LOW_FREQUENCY_EFFECT)
-        {
-            NewState = DedicatedCreate();
-            if(!NewState) err = AL_OUT_OF_MEMORY;
-        }
-    }
 
     if(err != AL_NO_ERROR)
     {
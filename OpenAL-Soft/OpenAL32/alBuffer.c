@@ -30,14 +30,24 @@
 #include "AL/alc.h"
 #include "alError.h"
 #include "alBuffer.h"
+#include "alSource.h"
 #include "alThunk.h"
 
 
-static ALenum LoadData(ALbuffer *ALBuf, ALuint freq, ALenum NewFormat, ALsizei frames, enum UserFmtChannels chans, enum UserFmtType type, const ALvoid *data, ALboolean storesrc);
+static ALenum LoadData(ALCdevice *device, ALbuffer *ALBuf, ALuint freq, ALenum NewFormat, ALsizei frames, enum UserFmtChannels chans, enum UserFmtType type, const ALvoid *data, ALboolean storesrc);
 static void ConvertData(ALvoid *dst, enum UserFmtType dstType, const ALvoid *src, enum UserFmtType srcType, ALsizei numchans, ALsizei len);
 static ALboolean IsValidType(ALenum type);
 static ALboolean IsValidChannels(ALenum channels);
 
+/* Returns how many more bytes the buffer takes for being stored as float. */
+static __inline ALsizei FloatStorageExtra(const ALbuffer *ALBuf)
+{
+    if(ALBuf->FmtType == ALBuf->LoadedType)
+        return 0;
+    return ALBuf->size - ALBuf->size/BytesFromFmt(ALBuf->FmtType)*
+                         BytesFromFmt(ALBuf->LoadedType);
+}
+
 #define LookupBuffer(m, k) ((ALbuffer*)LookupUIntMapKey(&(m), (k)))
 #define RemoveBuffer(m, k) ((ALbuffer*)PopUIntMapValue(&(m), (k)))
 
@@ -46,6 +56,26 @@ static ALboolean IsValidChannels(ALenum channels);
  * Global Variables
  */
 
+/* Keep 8- and 16-bit buffer data as float, so mixing doesn't need to convert
+ * it each time it's played */
+ALboolean FloatBufferStorage = AL_FALSE;
+
+/* Keep IMA4 and mu-law buffer data as it was given, and decode it as it's
+ * mixed */
+ALboolean CompressedBufferStorage = AL_FALSE;
+
+static volatile RefCount BufferSerial = 0;
+
+static __inline ALuint NextBufferSerial(void)
+{
+    ALuint serial;
+    /* 0 is kept for empty decode caches */
+    do {
+        serial = IncrementRef(&BufferSerial);
+    } while(serial == 0);
+    return serial;
+}
+
 /* IMA ADPCM Stepsize table */
 static const long IMAStep_size[89] = {
        7,    8,    9,   10,   11,   12,   13,   14,   16,   17,   19,
@@ -233,6 +263,13 @@ AL_API ALvoid AL_APIENTRY alDeleteBuffers(ALsizei n, const ALuint *buffers)
                 continue;
             FreeThunkEntry(ALBuf->buffer);
 
+            if(FloatStorageExtra(ALBuf) > 0)
+            {
+                LockDevice(device);
+                device->FloatBufferExtra -= FloatStorageExtra(ALBuf);
+                UnlockDevice(device);
+            }
+
             /* Release the memory used to store audio data */
             free(ALBuf->data);
 
@@ -306,7 +343,7 @@ AL_API ALvoid AL_APIENTRY alBufferData(ALuint buffer,ALenum format,const ALvoid
             if((size%FrameSize) != 0)
                 err = AL_INVALID_VALUE;
             else
-                err = LoadData(ALBuf, freq, format, size/FrameSize,
+                err = LoadData(device, ALBuf, freq, format, size/FrameSize,
                                SrcChannels, SrcType, data, AL_TRUE);
             if(err != AL_NO_ERROR)
                 alSetError(Context, err);
@@ -330,7 +367,7 @@ AL_API ALvoid AL_APIENTRY alBufferData(ALuint buffer,ALenum format,const ALvoid
             if((size%FrameSize) != 0)
                 err = AL_INVALID_VALUE;
             else
-                err = LoadData(ALBuf, freq, NewFormat, size/FrameSize,
+                err = LoadData(device, ALBuf, freq, NewFormat, size/FrameSize,
                                SrcChannels, SrcType, data, AL_TRUE);
             if(err != AL_NO_ERROR)
                 alSetError(Context, err);
@@ -359,7 +396,7 @@ AL_API ALvoid AL_APIENTRY alBufferData(ALuint buffer,ALenum format,const ALvoid
             if((size%FrameSize) != 0)
                 err = AL_INVALID_VALUE;
             else
-                err = LoadData(ALBuf, freq, NewFormat, size/FrameSize,
+                err = LoadData(device, ALBuf, freq, NewFormat, size/FrameSize,
                                SrcChannels, SrcType, data, AL_TRUE);
             if(err != AL_NO_ERROR)
                 alSetError(Context, err);
@@ -400,6 +437,12 @@ AL_API ALvoid AL_APIENTRY alBufferSubDataSOFT(ALuint buffer,ALenum format,const
             (offset%ALBuf->OriginalAlign) != 0 ||
             (length%ALBuf->OriginalAlign) != 0)
         alSetError(Context, AL_INVALID_VALUE);
+    else if(ALBuf->Compressed)
+    {
+        /* Compressed data is kept in the format it's given in */
+        memcpy(&((ALubyte*)ALBuf->data)[offset], data, length);
+        ALBuf->Serial = NextBufferSerial();
+    }
     else
     {
         ALuint Channels = ChannelsFromFmt(ALBuf->FmtChannels);
@@ -458,7 +501,7 @@ AL_API void AL_APIENTRY alBufferSamplesSOFT(ALuint buffer,
             else err = AL_INVALID_VALUE;
         }
         if(err == AL_NO_ERROR)
-            err = LoadData(ALBuf, samplerate, internalformat, frames,
+            err = LoadData(device, ALBuf, samplerate, internalformat, frames,
                            channels, type, data, AL_FALSE);
         if(err != AL_NO_ERROR)
             alSetError(Context, err);
@@ -486,6 +529,12 @@ AL_API void AL_APIENTRY alBufferSubSamplesSOFT(ALuint buffer,
     else if(channels != (ALenum)ALBuf->FmtChannels ||
             IsValidType(type) == AL_FALSE)
         alSetError(Context, AL_INVALID_ENUM);
+    else if(ALBuf->Compressed)
+    {
+        /* Compressed data can only be replaced in its own format, with
+         * alBufferSubDataSOFT */
+        alSetError(Context, AL_INVALID_OPERATION);
+    }
     else
     {
         ALuint FrameSize = FrameSizeFromFmt(ALBuf->FmtChannels, ALBuf->FmtType);
@@ -536,6 +585,24 @@ AL_API void AL_APIENTRY alGetBufferSamplesSOFT(ALuint buffer,
             alSetError(Context, AL_INVALID_VALUE);
         else if(type == UserFmtIMA4 && (frames%65) != 0)
             alSetError(Context, AL_INVALID_VALUE);
+        else if(ALBuf->Compressed)
+        {
+            BufferDecodeCache cache;
+            ALshort *temp = NULL;
+
+            if(frames > 0 && (temp=malloc(frames*FrameSize)) == NULL)
+                alSetError(Context, AL_OUT_OF_MEMORY);
+            else if(frames > 0)
+            {
+                cache.Serial = 0;
+                DecodeBufferFrames(ALBuf, offset, frames, temp, &cache);
+                /* frames -> IMA4 block count */
+                if(type == UserFmtIMA4) frames /= 65;
+                ConvertData(data, type, temp, UserFmtShort,
+                            ChannelsFromFmt(ALBuf->FmtChannels), frames);
+            }
+            free(temp);
+        }
         else
         {
             /* offset -> byte offset */
@@ -860,7 +927,7 @@ AL_API ALvoid AL_APIENTRY alGetBufferi(ALuint buffer, ALenum eParam, ALint *plVa
             break;
 
         case AL_BITS:
-            *plValue = BytesFromFmt(pBuffer->FmtType) * 8;
+            *plValue = BytesFromFmt(pBuffer->LoadedType) * 8;
             break;
 
         case AL_CHANNELS:
@@ -868,7 +935,7 @@ AL_API ALvoid AL_APIENTRY alGetBufferi(ALuint buffer, ALenum eParam, ALint *plVa
             break;
 
         case AL_SIZE:
-            *plValue = pBuffer->size;
+            *plValue = pBuffer->size - FloatStorageExtra(pBuffer);
             break;
 
         default:
@@ -1035,6 +1102,50 @@ static void DecodeIMA4Block(ALshort *dst, const ALima4 *src, ALint numchans)
     }
 }
 
+/* Decodes count frames of a compressed buffer, starting at frame start, to
+ * 16-bit samples. IMA4 blocks that are only partly needed go through the
+ * cache, so the rest of the block is ready for the next call. */
+ALvoid DecodeBufferFrames(const ALbuffer *ALBuf, ALuint start, ALuint count, ALshort *dst, BufferDecodeCache *cache)
+{
+    const ALubyte *src = ALBuf->data;
+    ALuint NumChannels = ChannelsFromFmt(ALBuf->FmtChannels);
+    ALuint i;
+
+    if(ALBuf->OriginalType == UserFmtMulaw)
+    {
+        src += start*NumChannels;
+        for(i = 0;i < count*NumChannels;i++)
+            dst[i] = DecodeMuLaw(src[i]);
+        return;
+    }
+
+    while(count > 0)
+    {
+        ALuint block = start / 65;
+        ALuint pos = start % 65;
+        ALuint todo = minu(65 - pos, count);
+
+        if(todo == 65 && (cache->Serial != ALBuf->Serial || cache->Block != block))
+            DecodeIMA4Block(dst, &src[block*ALBuf->OriginalAlign], NumChannels);
+        else
+        {
+            if(cache->Serial != ALBuf->Serial || cache->Block != block)
+            {
+                DecodeIMA4Block(cache->Samples, &src[block*ALBuf->OriginalAlign],
+                                NumChannels);
+                cache->Serial = ALBuf->Serial;
+                cache->Block = block;
+            }
+            memcpy(dst, &cache->Samples[pos*NumChannels],
+                   todo*NumChannels*sizeof(ALshort));
+        }
+
+        dst += todo*NumChannels;
+        start += todo;
+        count -= todo;
+    }
+}
+
 static void EncodeIMA4Block(ALima4 *dst, const ALshort *src, ALint *sample, ALint *index, ALint numchans)
 {
     ALsizei j,k,c;
@@ -1760,13 +1871,18 @@ static void ConvertData(ALvoid *dst, enum UserFmtType dstType, const ALvoid *src
  *
  * Loads the specified data into the buffer, using the specified formats.
  * Currently, the new format must have the same channel configuration as the
- * original format.
+ * original format. With FloatBufferStorage, 8- and 16-bit formats are stored
+ * as float instead. With CompressedBufferStorage, IMA4 and mu-law data given
+ * to alBufferData is kept as-is and decoded by the mixer, while the buffer
+ * otherwise acts as if it held the 16-bit format.
  */
-static ALenum LoadData(ALbuffer *ALBuf, ALuint freq, ALenum NewFormat, ALsizei frames, enum UserFmtChannels SrcChannels, enum UserFmtType SrcType, const ALvoid *data, ALboolean storesrc)
+static ALenum LoadData(ALCdevice *device, ALbuffer *ALBuf, ALuint freq, ALenum NewFormat, ALsizei frames, enum UserFmtChannels SrcChannels, enum UserFmtType SrcType, const ALvoid *data, ALboolean storesrc)
 {
     ALuint NewChannels, NewBytes;
     enum FmtChannels DstChannels;
-    enum FmtType DstType;
+    enum FmtType DstType, StoreType;
+    ALsizei oldextra, extra;
+    ALboolean Compress;
     ALuint64 newsize;
     ALvoid *temp;
 
@@ -1774,10 +1890,49 @@ static ALenum LoadData(ALbuffer *ALBuf, ALuint freq, ALenum NewFormat, ALsizei f
        (long)SrcChannels != (long)DstChannels)
         return AL_INVALID_ENUM;
 
+    Compress = (CompressedBufferStorage && storesrc &&
+                (SrcType == UserFmtIMA4 || SrcType == UserFmtMulaw));
+
+    StoreType = DstType;
+    if(FloatBufferStorage && DstType != FmtFloat && !Compress)
+        StoreType = FmtFloat;
+    oldextra = FloatStorageExtra(ALBuf);
+
     NewChannels = ChannelsFromFmt(DstChannels);
-    NewBytes = BytesFromFmt(DstType);
+    NewBytes = BytesFromFmt(StoreType);
 
-    if(SrcType == UserFmtIMA4)
+    if(Compress)
+    {
+        ALuint OrigChannels = ChannelsFromUserFmt(SrcChannels);
+        ALuint BlockFrames = (SrcType == UserFmtIMA4) ? 65 : 1;
+        ALuint BlockSize = (SrcType == UserFmtIMA4) ? (36 * OrigChannels) :
+                                                      OrigChannels;
+
+        newsize = frames;
+        newsize *= BlockFrames;
+        newsize *= NewBytes;
+        newsize *= NewChannels;
+        if(newsize > INT_MAX)
+            return AL_OUT_OF_MEMORY;
+
+        /* The size is of the decoded data, as the mixer sees it */
+        temp = realloc(ALBuf->data, frames * BlockSize);
+        if(!temp && frames) return AL_OUT_OF_MEMORY;
+        ALBuf->data = temp;
+        ALBuf->size = newsize;
+
+        if(data != NULL)
+            memcpy(ALBuf->data, data, frames * BlockSize);
+
+        ALBuf->OriginalChannels = SrcChannels;
+        ALBuf->OriginalType     = SrcType;
+        ALBuf->OriginalSize     = frames * BlockSize;
+        ALBuf->OriginalAlign    = BlockSize;
+
+        TRACE("Buffer %u kept compressed in %d bytes, instead of %d\n",
+              ALBuf->buffer, ALBuf->OriginalSize, ALBuf->size);
+    }
+    else if(SrcType == UserFmtIMA4)
     {
         ALuint OrigChannels = ChannelsFromUserFmt(SrcChannels);
 
@@ -1794,7 +1949,7 @@ static ALenum LoadData(ALbuffer *ALBuf, ALuint freq, ALenum NewFormat, ALsizei f
         ALBuf->size = newsize;
 
         if(data != NULL)
-            ConvertData(ALBuf->data, DstType, data, SrcType, NewChannels, frames);
+            ConvertData(ALBuf->data, StoreType, data, SrcType, NewChannels, frames);
 
         if(storesrc)
         {
@@ -1821,7 +1976,7 @@ static ALenum LoadData(ALbuffer *ALBuf, ALuint freq, ALenum NewFormat, ALsizei f
         ALBuf->size = newsize;
 
         if(data != NULL)
-            ConvertData(ALBuf->data, DstType, data, SrcType, NewChannels, frames);
+            ConvertData(ALBuf->data, StoreType, data, SrcType, NewChannels, frames);
 
         if(storesrc)
         {
@@ -1834,14 +1989,30 @@ static ALenum LoadData(ALbuffer *ALBuf, ALuint freq, ALenum NewFormat, ALsizei f
 
     if(!storesrc)
     {
+        ALuint OrigBytes = BytesFromFmt(DstType);
+
         ALBuf->OriginalChannels = DstChannels;
         ALBuf->OriginalType     = DstType;
-        ALBuf->OriginalSize     = frames * NewBytes * NewChannels;
-        ALBuf->OriginalAlign    = NewBytes * NewChannels;
+        ALBuf->OriginalSize     = frames * OrigBytes * NewChannels;
+        ALBuf->OriginalAlign    = OrigBytes * NewChannels;
     }
     ALBuf->Frequency = freq;
     ALBuf->FmtChannels = DstChannels;
-    ALBuf->FmtType = DstType;
+    ALBuf->FmtType = StoreType;
+    ALBuf->LoadedType = DstType;
+    ALBuf->Compressed = Compress;
+    ALBuf->Serial = NextBufferSerial();
+
+    extra = FloatStorageExtra(ALBuf);
+    if(extra > 0 || oldextra > 0)
+    {
+        LockDevice(device);
+        device->FloatBufferExtra -= oldextra;
+        device->FloatBufferExtra += extra;
+        if(device->FloatBufferExtra > device->FloatBufferPeak)
+            device->FloatBufferPeak = device->FloatBufferExtra;
+        UnlockDevice(device);
+    }
 
     ALBuf->LoopStart = 0;
     ALBuf->LoopEnd = newsize / NewChannels / NewBytes;
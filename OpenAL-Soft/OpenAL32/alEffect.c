@@ -27,15 +27,30 @@
 #include "AL/alc.h"
 #include "alMain.h"
 #include "alEffect.h"
+#include "alAuxEffectSlot.h"
 #include "alThunk.h"
 #include "alError.h"
 
 
-ALboolean DisabledEffects[MAX_EFFECTS];
+struct EffectList EffectList[MAX_EFFECT_TYPES+1] = {
+    { "eaxreverb", "AL_EFFECT_EAXREVERB",      AL_EFFECT_EAXREVERB, ReverbCreate, NULL, AL_FALSE },
+    { "reverb",    "AL_EFFECT_REVERB",         AL_EFFECT_REVERB, ReverbCreate, NULL, AL_FALSE },
+    { "echo",      "AL_EFFECT_ECHO",           AL_EFFECT_ECHO, EchoCreate, NULL, AL_FALSE },
+    { "modulator", "AL_EFFECT_RING_MODULATOR", AL_EFFECT_RING_MODULATOR, ModulatorCreate, NULL, AL_FALSE },
+    { "dedicated", "AL_EFFECT_DEDICATED_LOW_FREQUENCY_EFFECT", AL_EFFECT_DEDICATED_LOW_FREQUENCY_EFFECT, DedicatedCreate, NULL, AL_FALSE },
+    { "dedicated", "AL_EFFECT_DEDICATED_DIALOGUE", AL_EFFECT_DEDICATED_DIALOGUE, DedicatedCreate, NULL, AL_FALSE },
+    { NULL, NULL, (ALenum)0, NULL, NULL, AL_FALSE }
+};
 
 
 static void InitEffectParams(ALeffect *effect, ALenum type);
 
+static __inline const ALeffectPluginSOFT *GetEffectPlugin(ALenum type)
+{
+    const struct EffectList *info = LookupEffectType(type);
+    return (info ? info->Plugin : NULL);
+}
+
 #define LookupEffect(m, k) ((ALeffect*)LookupUIntMapKey(&(m), (k)))
 #define RemoveEffect(m, k) ((ALeffect*)PopUIntMapValue(&(m), (k)))
 
@@ -148,6 +163,7 @@ AL_API ALboolean AL_APIENTRY alIsEffect(ALuint effect)
 
 AL_API ALvoid AL_APIENTRY alEffecti(ALuint effect, ALenum param, ALint iValue)
 {
+    const ALeffectPluginSOFT *plugin;
     ALCcontext *Context;
     ALCdevice  *Device;
     ALeffect   *ALEffect;
@@ -160,20 +176,17 @@ AL_API ALvoid AL_APIENTRY alEffecti(ALuint effect, ALenum param, ALint iValue)
     {
         if(param == AL_EFFECT_TYPE)
         {
-            ALboolean isOk = (iValue == AL_EFFECT_NULL);
-            ALint i;
-            for(i = 0;!isOk && EffectList[i].val;i++)
-            {
-                if(iValue == EffectList[i].val &&
-                   !DisabledEffects[EffectList[i].type])
-                    isOk = AL_TRUE;
-            }
-
-            if(isOk)
+            if(iValue == AL_EFFECT_NULL || LookupEffectType(iValue) != NULL)
                 InitEffectParams(ALEffect, iValue);
             else
                 alSetError(Context, AL_INVALID_VALUE);
         }
+        else if((plugin=GetEffectPlugin(ALEffect->type)) != NULL)
+        {
+            ALenum err = plugin->SetParamiv(ALEffect->Params.Plugin, param, &iValue);
+            if(err != AL_NO_ERROR)
+                alSetError(Context, err);
+        }
         else if(ALEffect->type == AL_EFFECT_EAXREVERB)
         {
             switch(param)
@@ -261,12 +274,33 @@ AL_API ALvoid AL_APIENTRY alEffecti(ALuint effect, ALenum param, ALint iValue)
 
 AL_API ALvoid AL_APIENTRY alEffectiv(ALuint effect, ALenum param, ALint *piValues)
 {
-    /* There are no multi-value int effect parameters */
+    const ALeffectPluginSOFT *plugin;
+    ALCcontext *Context;
+    ALeffect   *ALEffect;
+
+    Context = GetLockedContext();
+    if(!Context) return;
+
+    /* Registered effects may have multi-value int parameters */
+    if(param != AL_EFFECT_TYPE &&
+       (ALEffect=LookupEffect(Context->Device->EffectMap, effect)) != NULL &&
+       (plugin=GetEffectPlugin(ALEffect->type)) != NULL)
+    {
+        ALenum err = plugin->SetParamiv(ALEffect->Params.Plugin, param, piValues);
+        if(err != AL_NO_ERROR)
+            alSetError(Context, err);
+        UnlockContext(Context);
+        return;
+    }
+    UnlockContext(Context);
+
+    /* There are no multi-value int built-in effect parameters */
     alEffecti(effect, param, piValues[0]);
 }
 
 AL_API ALvoid AL_APIENTRY alEffectf(ALuint effect, ALenum param, ALfloat flValue)
 {
+    const ALeffectPluginSOFT *plugin;
     ALCcontext *Context;
     ALCdevice  *Device;
     ALeffect   *ALEffect;
@@ -277,7 +311,13 @@ AL_API ALvoid AL_APIENTRY alEffectf(ALuint effect, ALenum param, ALfloat flValue
     Device = Context->Device;
     if((ALEffect=LookupEffect(Device->EffectMap, effect)) != NULL)
     {
-        if(ALEffect->type == AL_EFFECT_EAXREVERB)
+        if((plugin=GetEffectPlugin(ALEffect->type)) != NULL)
+        {
+            ALenum err = plugin->SetParamfv(ALEffect->Params.Plugin, param, &flValue);
+            if(err != AL_NO_ERROR)
+                alSetError(Context, err);
+        }
+        else if(ALEffect->type == AL_EFFECT_EAXREVERB)
         {
             switch(param)
             {
@@ -647,6 +687,7 @@ AL_API ALvoid AL_APIENTRY alEffectf(ALuint effect, ALenum param, ALfloat flValue
 
 AL_API ALvoid AL_APIENTRY alEffectfv(ALuint effect, ALenum param, ALfloat *pflValues)
 {
+    const ALeffectPluginSOFT *plugin;
     ALCcontext *Context;
     ALCdevice  *Device;
     ALeffect   *ALEffect;
@@ -657,7 +698,13 @@ AL_API ALvoid AL_APIENTRY alEffectfv(ALuint effect, ALenum param, ALfloat *pflVa
     Device = Context->Device;
     if((ALEffect=LookupEffect(Device->EffectMap, effect)) != NULL)
     {
-        if(ALEffect->type == AL_EFFECT_EAXREVERB)
+        if((plugin=GetEffectPlugin(ALEffect->type)) != NULL)
+        {
+            ALenum err = plugin->SetParamfv(ALEffect->Params.Plugin, param, pflValues);
+            if(err != AL_NO_ERROR)
+                alSetError(Context, err);
+        }
+        else if(ALEffect->type == AL_EFFECT_EAXREVERB)
         {
             switch(param)
             {
@@ -703,6 +750,7 @@ AL_API ALvoid AL_APIENTRY alEffectfv(ALuint effect, ALenum param, ALfloat *pflVa
 
 AL_API ALvoid AL_APIENTRY alGetEffecti(ALuint effect, ALenum param, ALint *piValue)
 {
+    const ALeffectPluginSOFT *plugin;
     ALCcontext *Context;
     ALCdevice  *Device;
     ALeffect   *ALEffect;
@@ -717,6 +765,12 @@ AL_API ALvoid AL_APIENTRY alGetEffecti(ALuint effect, ALenum param, ALint *piVal
         {
             *piValue = ALEffect->type;
         }
+        else if((plugin=GetEffectPlugin(ALEffect->type)) != NULL)
+        {
+            ALenum err = plugin->GetParamiv(ALEffect->Params.Plugin, param, piValue);
+            if(err != AL_NO_ERROR)
+                alSetError(Context, err);
+        }
         else if(ALEffect->type == AL_EFFECT_EAXREVERB)
         {
             switch(param)
@@ -782,12 +836,13 @@ AL_API ALvoid AL_APIENTRY alGetEffecti(ALuint effect, ALenum param, ALint *piVal
 
 AL_API ALvoid AL_APIENTRY alGetEffectiv(ALuint effect, ALenum param, ALint *piValues)
 {
-    /* There are no multi-value int effect parameters */
+    /* Registered effects get the array passed on as-is */
     alGetEffecti(effect, param, piValues);
 }
 
 AL_API ALvoid AL_APIENTRY alGetEffectf(ALuint effect, ALenum param, ALfloat *pflValue)
 {
+    const ALeffectPluginSOFT *plugin;
     ALCcontext *Context;
     ALCdevice  *Device;
     ALeffect   *ALEffect;
@@ -798,7 +853,13 @@ AL_API ALvoid AL_APIENTRY alGetEffectf(ALuint effect, ALenum param, ALfloat *pfl
     Device = Context->Device;
     if((ALEffect=LookupEffect(Device->EffectMap, effect)) != NULL)
     {
-        if(ALEffect->type == AL_EFFECT_EAXREVERB)
+        if((plugin=GetEffectPlugin(ALEffect->type)) != NULL)
+        {
+            ALenum err = plugin->GetParamfv(ALEffect->Params.Plugin, param, pflValue);
+            if(err != AL_NO_ERROR)
+                alSetError(Context, err);
+        }
+        else if(ALEffect->type == AL_EFFECT_EAXREVERB)
         {
             switch(param)
             {
@@ -1014,6 +1075,7 @@ AL_API ALvoid AL_APIENTRY alGetEffectf(ALuint effect, ALenum param, ALfloat *pfl
 
 AL_API ALvoid AL_APIENTRY alGetEffectfv(ALuint effect, ALenum param, ALfloat *pflValues)
 {
+    const ALeffectPluginSOFT *plugin;
     ALCcontext *Context;
     ALCdevice  *Device;
     ALeffect   *ALEffect;
@@ -1024,7 +1086,13 @@ AL_API ALvoid AL_APIENTRY alGetEffectfv(ALuint effect, ALenum param, ALfloat *pf
     Device = Context->Device;
     if((ALEffect=LookupEffect(Device->EffectMap, effect)) != NULL)
     {
-        if(ALEffect->type == AL_EFFECT_EAXREVERB)
+        if((plugin=GetEffectPlugin(ALEffect->type)) != NULL)
+        {
+            ALenum err = plugin->GetParamfv(ALEffect->Params.Plugin, param, pflValues);
+            if(err != AL_NO_ERROR)
+                alSetError(Context, err);
+        }
+        else if(ALEffect->type == AL_EFFECT_EAXREVERB)
         {
             switch(param)
             {
@@ -1075,9 +1143,77 @@ ALvoid ReleaseALEffects(ALCdevice *device)
 }
 
 
+const struct EffectList *LookupEffectType(ALenum type)
+{
+    ALsizei i;
+    for(i = 0;EffectList[i].name;i++)
+    {
+        if(EffectList[i].val == type)
+            return (EffectList[i].Disabled ? NULL : &EffectList[i]);
+    }
+    return NULL;
+}
+
+ALboolean RegisterEffectPlugin(const ALeffectPluginSOFT *plugin)
+{
+    ALsizei i;
+
+    if(plugin->Version != ALSOFT_EFFECT_PLUGIN_VERSION)
+    {
+        ERR("Effect plugin version %u does not match %u\n", plugin->Version,
+            ALSOFT_EFFECT_PLUGIN_VERSION);
+        return AL_FALSE;
+    }
+    if(!plugin->Name || !plugin->TypeName || plugin->Type == AL_EFFECT_NULL ||
+       plugin->PropsSize > ALSOFT_EFFECT_MAX_PROPS_SIZE || !plugin->InitProps ||
+       !plugin->SetParamiv || !plugin->SetParamfv || !plugin->GetParamiv ||
+       !plugin->GetParamfv || plugin->NumOutputs < 1 || plugin->NumOutputs > 2 ||
+       !plugin->Create || !plugin->Destroy || !plugin->DeviceUpdate ||
+       !plugin->Update || !plugin->Process)
+    {
+        ERR("Invalid effect plugin \"%s\"\n", (plugin->Name ? plugin->Name : "(null)"));
+        return AL_FALSE;
+    }
+
+    for(i = 0;EffectList[i].name;i++)
+    {
+        if(EffectList[i].val == plugin->Type)
+        {
+            ERR("Effect plugin \"%s\" type 0x%04x is already used by \"%s\"\n",
+                plugin->Name, plugin->Type, EffectList[i].name);
+            return AL_FALSE;
+        }
+    }
+    if(i >= MAX_EFFECT_TYPES)
+    {
+        ERR("Too many effect types, cannot add \"%s\"\n", plugin->Name);
+        return AL_FALSE;
+    }
+
+    EffectList[i].name = plugin->Name;
+    EffectList[i].ename = plugin->TypeName;
+    EffectList[i].val = plugin->Type;
+    EffectList[i].Create = NULL;
+    EffectList[i].Plugin = plugin;
+    EffectList[i].Disabled = AL_FALSE;
+    TRACE("Added effect plugin \"%s\" (%s)\n", plugin->Name, plugin->TypeName);
+
+    return AL_TRUE;
+}
+
+
 static void InitEffectParams(ALeffect *effect, ALenum type)
 {
+    const ALeffectPluginSOFT *plugin;
+
     effect->type = type;
+    if((plugin=GetEffectPlugin(type)) != NULL)
+    {
+        memset(&effect->Params, 0, sizeof(effect->Params));
+        plugin->InitProps(effect->Params.Plugin);
+        return;
+    }
+
     switch(type)
     {
     /* NOTE: Standard reverb and EAX reverb use the same defaults for the
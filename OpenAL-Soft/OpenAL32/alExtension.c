@@ -322,17 +322,6 @@ static const ALenums enumeration[] = {
 };
 
 
-const struct EffectList EffectList[] = {
-    { "eaxreverb", EAXREVERB, "AL_EFFECT_EAXREVERB",      AL_EFFECT_EAXREVERB },
-    { "reverb",    REVERB,    "AL_EFFECT_REVERB",         AL_EFFECT_REVERB },
-    { "echo",      ECHO,      "AL_EFFECT_ECHO",           AL_EFFECT_ECHO },
-    { "modulator", MODULATOR, "AL_EFFECT_RING_MODULATOR", AL_EFFECT_RING_MODULATOR },
-    { "dedicated", DEDICATED, "AL_EFFECT_DEDICATED_LOW_FREQUENCY_EFFECT", AL_EFFECT_DEDICATED_LOW_FREQUENCY_EFFECT },
-    { "dedicated", DEDICATED, "AL_EFFECT_DEDICATED_DIALOGUE", AL_EFFECT_DEDICATED_DIALOGUE },
-    { NULL, 0, NULL, (ALenum)0 }
-};
-
-
 AL_API ALboolean AL_APIENTRY alIsExtensionPresent(const ALchar *extName)
 {
     ALboolean bIsSupported = AL_FALSE;
@@ -385,9 +374,8 @@ AL_API ALenum AL_APIENTRY alGetEnumValue(const ALchar *enumName)
 
     for(i = 0;EffectList[i].ename;i++)
     {
-        if(DisabledEffects[EffectList[i].type] &&
-           strcmp(EffectList[i].ename, enumName) == 0)
-            return (ALenum)0;
+        if(strcmp(EffectList[i].ename, enumName) == 0)
+            return (EffectList[i].Disabled ? (ALenum)0 : EffectList[i].val);
     }
 
     i = 0;
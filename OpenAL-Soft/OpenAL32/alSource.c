@@ -31,6 +31,7 @@
 #include "alBuffer.h"
 #include "alThunk.h"
 #include "alAuxEffectSlot.h"
+#include "alu.h"
 
 
 enum Resampler DefaultResampler;
@@ -38,17 +39,22 @@ const ALsizei ResamplerPadding[RESAMPLER_MAX] = {
     0, /* Point */
     1, /* Linear */
     2, /* Cubic */
+    SINC_POINTS-SINC_PRE_POINTS-1, /* Sinc */
 };
 const ALsizei ResamplerPrePadding[RESAMPLER_MAX] = {
     0, /* Point */
     0, /* Linear */
     1, /* Cubic */
+    SINC_PRE_POINTS, /* Sinc */
 };
 
 
 static ALvoid InitSourceParams(ALsource *Source);
+static ALvoid CopySourceProps(ALsourceProps *props, const ALsource *Source);
 static ALvoid GetSourceOffset(ALsource *Source, ALenum eName, ALdouble *Offsets, ALdouble updateLen);
 static ALint GetByteOffset(ALsource *Source);
+static ALboolean GetOffsetPosition(ALsource *Source, ALuint *BuffersPlayedOut, ALuint *Position);
+static ALvoid ApplySourceCmd(const ALsourceCmd *cmd, ALCcontext *Context);
 
 #define LookupSource(m, k) ((ALsource*)LookupUIntMapKey(&(m), (k)))
 #define RemoveSource(m, k) ((ALsource*)PopUIntMapValue(&(m), (k)))
@@ -84,12 +90,25 @@ AL_API ALvoid AL_APIENTRY alGenSources(ALsizei n,ALuint *sources)
                 break;
             }
 
-            err = NewThunkEntry(&source->source);
-            if(err == AL_NO_ERROR)
-                err = InsertUIntMapEntry(&Context->SourceMap, source->source, source);
+            /* Hold the ParamsLock until the source is in the map, so a device
+             * reset can't change the HRTF its parameters are sized for
+             * without seeing it, and only sees it set up */
+            EnterCriticalSection(&Device->ParamsLock);
+            err = AL_OUT_OF_MEMORY;
+            if(AllocSourceParams(source, Device))
+            {
+                InitSourceParams(source);
+                err = NewThunkEntry(&source->source);
+                if(err == AL_NO_ERROR)
+                    err = InsertUIntMapEntry(&Context->SourceMap, source->source, source);
+                if(err != AL_NO_ERROR)
+                    FreeThunkEntry(source->source);
+            }
+            LeaveCriticalSection(&Device->ParamsLock);
             if(err != AL_NO_ERROR)
             {
-                FreeThunkEntry(source->source);
+                free(source->Params);
+                free(source->HrtfValues);
                 memset(source, 0, sizeof(ALsource));
                 free(source);
 
@@ -98,7 +117,6 @@ AL_API ALvoid AL_APIENTRY alGenSources(ALsizei n,ALuint *sources)
                 break;
             }
 
-            InitSourceParams(source);
             sources[i++] = source->source;
         }
     }
@@ -117,6 +135,7 @@ AL_API ALvoid AL_APIENTRY alDeleteSources(ALsizei n, const ALuint *sources)
     Context = GetContextRef();
     if(!Context) return;
 
+    EnterCriticalSection(&Context->PropLock);
     if(n < 0)
         alSetError(Context, AL_INVALID_VALUE);
     else
@@ -144,6 +163,7 @@ AL_API ALvoid AL_APIENTRY alDeleteSources(ALsizei n, const ALuint *sources)
             FreeThunkEntry(Source->source);
 
             LockContext(Context);
+            ApplySourceCmds(Context);
             srclist = Context->ActiveSources;
             srclistend = srclist + Context->ActiveSourceCount;
             while(srclist != srclistend)
@@ -175,11 +195,18 @@ AL_API ALvoid AL_APIENTRY alDeleteSources(ALsizei n, const ALuint *sources)
                     DecrementRef(&Source->Send[j].Slot->ref);
                 Source->Send[j].Slot = NULL;
             }
+            free(Source->PendingProps);
+            free(Source->Params);
+            free(Source->PendingParams);
+            free(Source->HrtfValues);
+            free(Source->HrtfConv);
+            free(Source->MixTemp);
 
             memset(Source,0,sizeof(ALsource));
             free(Source);
         }
     }
+    LeaveCriticalSection(&Context->PropLock);
 
     ALCcontext_DecRef(Context);
 }
@@ -206,9 +233,11 @@ AL_API ALvoid AL_APIENTRY alSourcef(ALuint source, ALenum eParam, ALfloat flValu
     ALCcontext    *pContext;
     ALsource    *Source;
 
-    pContext = GetLockedContext();
+    pContext = GetContextRef();
     if(!pContext) return;
 
+    EnterCriticalSection(&pContext->PropLock);
+
     if((Source=LookupSource(pContext->SourceMap, source)) != NULL)
     {
         switch(eParam)
@@ -217,7 +246,7 @@ AL_API ALvoid AL_APIENTRY alSourcef(ALuint source, ALenum eParam, ALfloat flValu
                 if(flValue >= 0.0f)
                 {
                     Source->flPitch = flValue;
-                    Source->NeedsUpdate = AL_TRUE;
+                    UpdateSourceProps(Source, pContext);
                 }
                 else
                     alSetError(pContext, AL_INVALID_VALUE);
@@ -227,7 +256,7 @@ AL_API ALvoid AL_APIENTRY alSourcef(ALuint source, ALenum eParam, ALfloat flValu
                 if(flValue >= 0.0f && flValue <= 360.0f)
                 {
                     Source->flInnerAngle = flValue;
-                    Source->NeedsUpdate = AL_TRUE;
+                    UpdateSourceProps(Source, pContext);
                 }
                 else
                     alSetError(pContext, AL_INVALID_VALUE);
@@ -237,7 +266,7 @@ AL_API ALvoid AL_APIENTRY alSourcef(ALuint source, ALenum eParam, ALfloat flValu
                 if(flValue >= 0.0f && flValue <= 360.0f)
                 {
                     Source->flOuterAngle = flValue;
-                    Source->NeedsUpdate = AL_TRUE;
+                    UpdateSourceProps(Source, pContext);
                 }
                 else
                     alSetError(pContext, AL_INVALID_VALUE);
@@ -247,7 +276,7 @@ AL_API ALvoid AL_APIENTRY alSourcef(ALuint source, ALenum eParam, ALfloat flValu
                 if(flValue >= 0.0f)
                 {
                     Source->flGain = flValue;
-                    Source->NeedsUpdate = AL_TRUE;
+                    UpdateSourceProps(Source, pContext);
                 }
                 else
                     alSetError(pContext, AL_INVALID_VALUE);
@@ -257,7 +286,7 @@ AL_API ALvoid AL_APIENTRY alSourcef(ALuint source, ALenum eParam, ALfloat flValu
                 if(flValue >= 0.0f)
                 {
                     Source->flMaxDistance = flValue;
-                    Source->NeedsUpdate = AL_TRUE;
+                    UpdateSourceProps(Source, pContext);
                 }
                 else
                     alSetError(pContext, AL_INVALID_VALUE);
@@ -267,7 +296,7 @@ AL_API ALvoid AL_APIENTRY alSourcef(ALuint source, ALenum eParam, ALfloat flValu
                 if(flValue >= 0.0f)
                 {
                     Source->flRollOffFactor = flValue;
-                    Source->NeedsUpdate = AL_TRUE;
+                    UpdateSourceProps(Source, pContext);
                 }
                 else
                     alSetError(pContext, AL_INVALID_VALUE);
@@ -277,7 +306,7 @@ AL_API ALvoid AL_APIENTRY alSourcef(ALuint source, ALenum eParam, ALfloat flValu
                 if(flValue >= 0.0f)
                 {
                     Source->flRefDistance = flValue;
-                    Source->NeedsUpdate = AL_TRUE;
+                    UpdateSourceProps(Source, pContext);
                 }
                 else
                     alSetError(pContext, AL_INVALID_VALUE);
@@ -287,7 +316,7 @@ AL_API ALvoid AL_APIENTRY alSourcef(ALuint source, ALenum eParam, ALfloat flValu
                 if(flValue >= 0.0f && flValue <= 1.0f)
                 {
                     Source->flMinGain = flValue;
-                    Source->NeedsUpdate = AL_TRUE;
+                    UpdateSourceProps(Source, pContext);
                 }
                 else
                     alSetError(pContext, AL_INVALID_VALUE);
@@ -297,7 +326,7 @@ AL_API ALvoid AL_APIENTRY alSourcef(ALuint source, ALenum eParam, ALfloat flValu
                 if(flValue >= 0.0f && flValue <= 1.0f)
                 {
                     Source->flMaxGain = flValue;
-                    Source->NeedsUpdate = AL_TRUE;
+                    UpdateSourceProps(Source, pContext);
                 }
                 else
                     alSetError(pContext, AL_INVALID_VALUE);
@@ -307,7 +336,7 @@ AL_API ALvoid AL_APIENTRY alSourcef(ALuint source, ALenum eParam, ALfloat flValu
                 if(flValue >= 0.0f && flValue <= 1.0f)
                 {
                     Source->flOuterGain = flValue;
-                    Source->NeedsUpdate = AL_TRUE;
+                    UpdateSourceProps(Source, pContext);
                 }
                 else
                     alSetError(pContext, AL_INVALID_VALUE);
@@ -317,7 +346,7 @@ AL_API ALvoid AL_APIENTRY alSourcef(ALuint source, ALenum eParam, ALfloat flValu
                 if(flValue >= 0.0f && flValue <= 1.0f)
                 {
                     Source->OuterGainHF = flValue;
-                    Source->NeedsUpdate = AL_TRUE;
+                    UpdateSourceProps(Source, pContext);
                 }
                 else
                     alSetError(pContext, AL_INVALID_VALUE);
@@ -327,7 +356,7 @@ AL_API ALvoid AL_APIENTRY alSourcef(ALuint source, ALenum eParam, ALfloat flValu
                 if(flValue >= 0.0f && flValue <= 10.0f)
                 {
                     Source->AirAbsorptionFactor = flValue;
-                    Source->NeedsUpdate = AL_TRUE;
+                    UpdateSourceProps(Source, pContext);
                 }
                 else
                     alSetError(pContext, AL_INVALID_VALUE);
@@ -337,7 +366,7 @@ AL_API ALvoid AL_APIENTRY alSourcef(ALuint source, ALenum eParam, ALfloat flValu
                 if(flValue >= 0.0f && flValue <= 10.0f)
                 {
                     Source->RoomRolloffFactor = flValue;
-                    Source->NeedsUpdate = AL_TRUE;
+                    UpdateSourceProps(Source, pContext);
                 }
                 else
                     alSetError(pContext, AL_INVALID_VALUE);
@@ -347,7 +376,7 @@ AL_API ALvoid AL_APIENTRY alSourcef(ALuint source, ALenum eParam, ALfloat flValu
                 if(flValue >= 0.0f && flValue <= 1.0f)
                 {
                     Source->DopplerFactor = flValue;
-                    Source->NeedsUpdate = AL_TRUE;
+                    UpdateSourceProps(Source, pContext);
                 }
                 else
                     alSetError(pContext, AL_INVALID_VALUE);
@@ -358,6 +387,8 @@ AL_API ALvoid AL_APIENTRY alSourcef(ALuint source, ALenum eParam, ALfloat flValu
             case AL_BYTE_OFFSET:
                 if(flValue >= 0.0f)
                 {
+                    ALenum state = GetSourceState(Source);
+
                     Source->lOffsetType = eParam;
 
                     // Store Offset (convert Seconds into Milliseconds)
@@ -366,10 +397,10 @@ AL_API ALvoid AL_APIENTRY alSourcef(ALuint source, ALenum eParam, ALfloat flValu
                     else
                         Source->lOffset = (ALint)flValue;
 
-                    if((Source->state == AL_PLAYING || Source->state == AL_PAUSED) &&
+                    if((state == AL_PLAYING || state == AL_PAUSED) &&
                        !pContext->DeferUpdates)
                     {
-                        if(ApplyOffset(Source) == AL_FALSE)
+                        if(ApplyOffset(Source, pContext) == AL_FALSE)
                             alSetError(pContext, AL_INVALID_VALUE);
                     }
                 }
@@ -388,7 +419,8 @@ AL_API ALvoid AL_APIENTRY alSourcef(ALuint source, ALenum eParam, ALfloat flValu
         alSetError(pContext, AL_INVALID_NAME);
     }
 
-    UnlockContext(pContext);
+    LeaveCriticalSection(&pContext->PropLock);
+    ALCcontext_DecRef(pContext);
 }
 
 
@@ -397,9 +429,11 @@ AL_API ALvoid AL_APIENTRY alSource3f(ALuint source, ALenum eParam, ALfloat flVal
     ALCcontext    *pContext;
     ALsource    *Source;
 
-    pContext = GetLockedContext();
+    pContext = GetContextRef();
     if(!pContext) return;
 
+    EnterCriticalSection(&pContext->PropLock);
+
     if((Source=LookupSource(pContext->SourceMap, source)) != NULL)
     {
         switch(eParam)
@@ -410,7 +444,7 @@ AL_API ALvoid AL_APIENTRY alSource3f(ALuint source, ALenum eParam, ALfloat flVal
                     Source->vPosition[0] = flValue1;
                     Source->vPosition[1] = flValue2;
                     Source->vPosition[2] = flValue3;
-                    Source->NeedsUpdate = AL_TRUE;
+                    UpdateSourceProps(Source, pContext);
                 }
                 else
                     alSetError(pContext, AL_INVALID_VALUE);
@@ -422,7 +456,7 @@ AL_API ALvoid AL_APIENTRY alSource3f(ALuint source, ALenum eParam, ALfloat flVal
                     Source->vVelocity[0] = flValue1;
                     Source->vVelocity[1] = flValue2;
                     Source->vVelocity[2] = flValue3;
-                    Source->NeedsUpdate = AL_TRUE;
+                    UpdateSourceProps(Source, pContext);
                 }
                 else
                     alSetError(pContext, AL_INVALID_VALUE);
@@ -434,7 +468,7 @@ AL_API ALvoid AL_APIENTRY alSource3f(ALuint source, ALenum eParam, ALfloat flVal
                     Source->vOrientation[0] = flValue1;
                     Source->vOrientation[1] = flValue2;
                     Source->vOrientation[2] = flValue3;
-                    Source->NeedsUpdate = AL_TRUE;
+                    UpdateSourceProps(Source, pContext);
                 }
                 else
                     alSetError(pContext, AL_INVALID_VALUE);
@@ -448,7 +482,8 @@ AL_API ALvoid AL_APIENTRY alSource3f(ALuint source, ALenum eParam, ALfloat flVal
     else
         alSetError(pContext, AL_INVALID_NAME);
 
-    UnlockContext(pContext);
+    LeaveCriticalSection(&pContext->PropLock);
+    ALCcontext_DecRef(pContext);
 }
 
 
@@ -487,7 +522,7 @@ AL_API ALvoid AL_APIENTRY alSourcefv(ALuint source, ALenum eParam, const ALfloat
         }
     }
 
-    pContext = GetLockedContext();
+    pContext = GetContextRef();
     if(!pContext) return;
 
     if(pflValues)
@@ -507,7 +542,7 @@ AL_API ALvoid AL_APIENTRY alSourcefv(ALuint source, ALenum eParam, const ALfloat
     else
         alSetError(pContext, AL_INVALID_VALUE);
 
-    UnlockContext(pContext);
+    ALCcontext_DecRef(pContext);
 }
 
 
@@ -528,9 +563,11 @@ AL_API ALvoid AL_APIENTRY alSourcei(ALuint source,ALenum eParam,ALint lValue)
             return;
     }
 
-    pContext = GetLockedContext();
+    pContext = GetContextRef();
     if(!pContext) return;
 
+    EnterCriticalSection(&pContext->PropLock);
+
     if((Source=LookupSource(pContext->SourceMap, source)) != NULL)
     {
         ALCdevice *device = pContext->Device;
@@ -541,7 +578,7 @@ AL_API ALvoid AL_APIENTRY alSourcei(ALuint source,ALenum eParam,ALint lValue)
                 if(lValue == AL_FALSE || lValue == AL_TRUE)
                 {
                     Source->bHeadRelative = (ALboolean)lValue;
-                    Source->NeedsUpdate = AL_TRUE;
+                    UpdateSourceProps(Source, pContext);
                 }
                 else
                     alSetError(pContext, AL_INVALID_VALUE);
@@ -555,6 +592,8 @@ AL_API ALvoid AL_APIENTRY alSourcei(ALuint source,ALenum eParam,ALint lValue)
                 break;
 
             case AL_BUFFER:
+                LockContext(pContext);
+                ApplySourceCmds(pContext);
                 if(Source->state == AL_STOPPED || Source->state == AL_INITIAL)
                 {
                     ALbufferlistitem *oldlist;
@@ -614,6 +653,7 @@ AL_API ALvoid AL_APIENTRY alSourcei(ALuint source,ALenum eParam,ALint lValue)
                 }
                 else
                     alSetError(pContext, AL_INVALID_OPERATION);
+                UnlockContext(pContext);
                 break;
 
             case AL_SOURCE_STATE:
@@ -626,6 +666,8 @@ AL_API ALvoid AL_APIENTRY alSourcei(ALuint source,ALenum eParam,ALint lValue)
             case AL_BYTE_OFFSET:
                 if(lValue >= 0)
                 {
+                    ALenum state = GetSourceState(Source);
+
                     Source->lOffsetType = eParam;
 
                     // Store Offset (convert Seconds into Milliseconds)
@@ -634,10 +676,10 @@ AL_API ALvoid AL_APIENTRY alSourcei(ALuint source,ALenum eParam,ALint lValue)
                     else
                         Source->lOffset = lValue;
 
-                    if((Source->state == AL_PLAYING || Source->state == AL_PAUSED) &&
+                    if((state == AL_PLAYING || state == AL_PAUSED) &&
                        !pContext->DeferUpdates)
                     {
-                        if(ApplyOffset(Source) == AL_FALSE)
+                        if(ApplyOffset(Source, pContext) == AL_FALSE)
                             alSetError(pContext, AL_INVALID_VALUE);
                     }
                 }
@@ -661,7 +703,7 @@ AL_API ALvoid AL_APIENTRY alSourcei(ALuint source,ALenum eParam,ALint lValue)
                         Source->DirectGain = filter->Gain;
                         Source->DirectGainHF = filter->GainHF;
                     }
-                    Source->NeedsUpdate = AL_TRUE;
+                    UpdateSourceProps(Source, pContext);
                 }
                 else
                     alSetError(pContext, AL_INVALID_VALUE);
@@ -671,7 +713,7 @@ AL_API ALvoid AL_APIENTRY alSourcei(ALuint source,ALenum eParam,ALint lValue)
                 if(lValue == AL_TRUE || lValue == AL_FALSE)
                 {
                     Source->DryGainHFAuto = lValue;
-                    Source->NeedsUpdate = AL_TRUE;
+                    UpdateSourceProps(Source, pContext);
                 }
                 else
                     alSetError(pContext, AL_INVALID_VALUE);
@@ -681,7 +723,7 @@ AL_API ALvoid AL_APIENTRY alSourcei(ALuint source,ALenum eParam,ALint lValue)
                 if(lValue == AL_TRUE || lValue == AL_FALSE)
                 {
                     Source->WetGainAuto = lValue;
-                    Source->NeedsUpdate = AL_TRUE;
+                    UpdateSourceProps(Source, pContext);
                 }
                 else
                     alSetError(pContext, AL_INVALID_VALUE);
@@ -691,7 +733,7 @@ AL_API ALvoid AL_APIENTRY alSourcei(ALuint source,ALenum eParam,ALint lValue)
                 if(lValue == AL_TRUE || lValue == AL_FALSE)
                 {
                     Source->WetGainHFAuto = lValue;
-                    Source->NeedsUpdate = AL_TRUE;
+                    UpdateSourceProps(Source, pContext);
                 }
                 else
                     alSetError(pContext, AL_INVALID_VALUE);
@@ -701,7 +743,7 @@ AL_API ALvoid AL_APIENTRY alSourcei(ALuint source,ALenum eParam,ALint lValue)
                 if(lValue == AL_TRUE || lValue == AL_FALSE)
                 {
                     Source->VirtualChannels = lValue;
-                    Source->NeedsUpdate = AL_TRUE;
+                    UpdateSourceProps(Source, pContext);
                 }
                 else
                     alSetError(pContext, AL_INVALID_VALUE);
@@ -717,8 +759,7 @@ AL_API ALvoid AL_APIENTRY alSourcei(ALuint source,ALenum eParam,ALint lValue)
                    lValue == AL_EXPONENT_DISTANCE_CLAMPED)
                 {
                     Source->DistanceModel = lValue;
-                    if(pContext->SourceDistanceModel)
-                        Source->NeedsUpdate = AL_TRUE;
+                    UpdateSourceProps(Source, pContext);
                 }
                 else
                     alSetError(pContext, AL_INVALID_VALUE);
@@ -732,7 +773,8 @@ AL_API ALvoid AL_APIENTRY alSourcei(ALuint source,ALenum eParam,ALint lValue)
     else
         alSetError(pContext, AL_INVALID_NAME);
 
-    UnlockContext(pContext);
+    LeaveCriticalSection(&pContext->PropLock);
+    ALCcontext_DecRef(pContext);
 }
 
 
@@ -750,9 +792,11 @@ AL_API void AL_APIENTRY alSource3i(ALuint source, ALenum eParam, ALint lValue1,
             return;
     }
 
-    pContext = GetLockedContext();
+    pContext = GetContextRef();
     if(!pContext) return;
 
+    EnterCriticalSection(&pContext->PropLock);
+
     if((Source=LookupSource(pContext->SourceMap, source)) != NULL)
     {
         ALCdevice *device = pContext->Device;
@@ -788,7 +832,7 @@ AL_API void AL_APIENTRY alSource3i(ALuint source, ALenum eParam, ALint lValue1,
                         Source->Send[lValue2].WetGain = ALFilter->Gain;
                         Source->Send[lValue2].WetGainHF = ALFilter->GainHF;
                     }
-                    Source->NeedsUpdate = AL_TRUE;
+                    UpdateSourceProps(Source, pContext);
                 }
                 else
                     alSetError(pContext, AL_INVALID_VALUE);
@@ -802,7 +846,8 @@ AL_API void AL_APIENTRY alSource3i(ALuint source, ALenum eParam, ALint lValue1,
     else
         alSetError(pContext, AL_INVALID_NAME);
 
-    UnlockContext(pContext);
+    LeaveCriticalSection(&pContext->PropLock);
+    ALCcontext_DecRef(pContext);
 }
 
 
@@ -844,7 +889,7 @@ AL_API void AL_APIENTRY alSourceiv(ALuint source, ALenum eParam, const ALint* pl
         }
     }
 
-    pContext = GetLockedContext();
+    pContext = GetContextRef();
     if(!pContext) return;
 
     if(plValues)
@@ -864,7 +909,7 @@ AL_API void AL_APIENTRY alSourceiv(ALuint source, ALenum eParam, const ALint* pl
     else
         alSetError(pContext, AL_INVALID_VALUE);
 
-    UnlockContext(pContext);
+    ALCcontext_DecRef(pContext);
 }
 
 
@@ -875,9 +920,11 @@ AL_API ALvoid AL_APIENTRY alGetSourcef(ALuint source, ALenum eParam, ALfloat *pf
     ALdouble    Offsets[2];
     ALdouble    updateLen;
 
-    pContext = GetLockedContext();
+    pContext = GetContextRef();
     if(!pContext) return;
 
+    EnterCriticalSection(&pContext->PropLock);
+
     if(pflValue)
     {
         if((Source=LookupSource(pContext->SourceMap, source)) != NULL)
@@ -919,9 +966,12 @@ AL_API ALvoid AL_APIENTRY alGetSourcef(ALuint source, ALenum eParam, ALfloat *pf
                 case AL_SEC_OFFSET:
                 case AL_SAMPLE_OFFSET:
                 case AL_BYTE_OFFSET:
+                    LockContext(pContext);
+                    ApplySourceCmds(pContext);
                     updateLen = (ALdouble)pContext->Device->UpdateSize /
                                 pContext->Device->Frequency;
                     GetSourceOffset(Source, eParam, Offsets, updateLen);
+                    UnlockContext(pContext);
                     *pflValue = Offsets[0];
                     break;
 
@@ -960,7 +1010,8 @@ AL_API ALvoid AL_APIENTRY alGetSourcef(ALuint source, ALenum eParam, ALfloat *pf
     else
         alSetError(pContext, AL_INVALID_VALUE);
 
-    UnlockContext(pContext);
+    LeaveCriticalSection(&pContext->PropLock);
+    ALCcontext_DecRef(pContext);
 }
 
 
@@ -969,9 +1020,11 @@ AL_API ALvoid AL_APIENTRY alGetSource3f(ALuint source, ALenum eParam, ALfloat* p
     ALCcontext    *pContext;
     ALsource    *Source;
 
-    pContext = GetLockedContext();
+    pContext = GetContextRef();
     if(!pContext) return;
 
+    EnterCriticalSection(&pContext->PropLock);
+
     if(pflValue1 && pflValue2 && pflValue3)
     {
         if((Source=LookupSource(pContext->SourceMap, source)) != NULL)
@@ -1007,7 +1060,8 @@ AL_API ALvoid AL_APIENTRY alGetSource3f(ALuint source, ALenum eParam, ALfloat* p
     else
         alSetError(pContext, AL_INVALID_VALUE);
 
-    UnlockContext(pContext);
+    LeaveCriticalSection(&pContext->PropLock);
+    ALCcontext_DecRef(pContext);
 }
 
 
@@ -1047,9 +1101,11 @@ AL_API ALvoid AL_APIENTRY alGetSourcefv(ALuint source, ALenum eParam, ALfloat *p
             return;
     }
 
-    pContext = GetLockedContext();
+    pContext = GetContextRef();
     if(!pContext) return;
 
+    EnterCriticalSection(&pContext->PropLock);
+
     if(pflValues)
     {
         if((Source=LookupSource(pContext->SourceMap, source)) != NULL)
@@ -1058,9 +1114,12 @@ AL_API ALvoid AL_APIENTRY alGetSourcefv(ALuint source, ALenum eParam, ALfloat *p
             {
                 case AL_SAMPLE_RW_OFFSETS_SOFT:
                 case AL_BYTE_RW_OFFSETS_SOFT:
+                    LockContext(pContext);
+                    ApplySourceCmds(pContext);
                     updateLen = (ALdouble)pContext->Device->UpdateSize /
                                 pContext->Device->Frequency;
                     GetSourceOffset(Source, eParam, Offsets, updateLen);
+                    UnlockContext(pContext);
                     pflValues[0] = Offsets[0];
                     pflValues[1] = Offsets[1];
                     break;
@@ -1076,7 +1135,8 @@ AL_API ALvoid AL_APIENTRY alGetSourcefv(ALuint source, ALenum eParam, ALfloat *p
     else
         alSetError(pContext, AL_INVALID_VALUE);
 
-    UnlockContext(pContext);
+    LeaveCriticalSection(&pContext->PropLock);
+    ALCcontext_DecRef(pContext);
 }
 
 
@@ -1088,9 +1148,11 @@ AL_API ALvoid AL_APIENTRY alGetSourcei(ALuint source, ALenum eParam, ALint *plVa
     ALdouble   Offsets[2];
     ALdouble   updateLen;
 
-    pContext = GetLockedContext();
+    pContext = GetContextRef();
     if(!pContext) return;
 
+    EnterCriticalSection(&pContext->PropLock);
+
     if(plValue)
     {
         if((Source=LookupSource(pContext->SourceMap, source)) != NULL)
@@ -1126,6 +1188,8 @@ AL_API ALvoid AL_APIENTRY alGetSourcei(ALuint source, ALenum eParam, ALint *plVa
                     break;
 
                 case AL_BUFFER:
+                    LockContext(pContext);
+                    ApplySourceCmds(pContext);
                     BufferList = Source->queue;
                     if(Source->lSourceType != AL_STATIC)
                     {
@@ -1138,10 +1202,11 @@ AL_API ALvoid AL_APIENTRY alGetSourcei(ALuint source, ALenum eParam, ALint *plVa
                     }
                     *plValue = ((BufferList && BufferList->buffer) ?
                                 BufferList->buffer->buffer : 0);
+                    UnlockContext(pContext);
                     break;
 
                 case AL_SOURCE_STATE:
-                    *plValue = Source->state;
+                    *plValue = GetSourceState(Source);
                     break;
 
                 case AL_BUFFERS_QUEUED:
@@ -1149,6 +1214,8 @@ AL_API ALvoid AL_APIENTRY alGetSourcei(ALuint source, ALenum eParam, ALint *plVa
                     break;
 
                 case AL_BUFFERS_PROCESSED:
+                    LockContext(pContext);
+                    ApplySourceCmds(pContext);
                     if(Source->bLooping || Source->lSourceType != AL_STREAMING)
                     {
                         /* Buffers on a looping source are in a perpetual state
@@ -1157,6 +1224,7 @@ AL_API ALvoid AL_APIENTRY alGetSourcei(ALuint source, ALenum eParam, ALint *plVa
                     }
                     else
                         *plValue = Source->BuffersPlayed;
+                    UnlockContext(pContext);
                     break;
 
                 case AL_SOURCE_TYPE:
@@ -1166,9 +1234,12 @@ AL_API ALvoid AL_APIENTRY alGetSourcei(ALuint source, ALenum eParam, ALint *plVa
                 case AL_SEC_OFFSET:
                 case AL_SAMPLE_OFFSET:
                 case AL_BYTE_OFFSET:
+                    LockContext(pContext);
+                    ApplySourceCmds(pContext);
                     updateLen = (ALdouble)pContext->Device->UpdateSize /
                                 pContext->Device->Frequency;
                     GetSourceOffset(Source, eParam, Offsets, updateLen);
+                    UnlockContext(pContext);
                     *plValue = (ALint)Offsets[0];
                     break;
 
@@ -1207,7 +1278,8 @@ AL_API ALvoid AL_APIENTRY alGetSourcei(ALuint source, ALenum eParam, ALint *plVa
     else
         alSetError(pContext, AL_INVALID_VALUE);
 
-    UnlockContext(pContext);
+    LeaveCriticalSection(&pContext->PropLock);
+    ALCcontext_DecRef(pContext);
 }
 
 
@@ -1216,9 +1288,11 @@ AL_API void AL_APIENTRY alGetSource3i(ALuint source, ALenum eParam, ALint* plVal
     ALCcontext  *pContext;
     ALsource    *Source;
 
-    pContext = GetLockedContext();
+    pContext = GetContextRef();
     if(!pContext) return;
 
+    EnterCriticalSection(&pContext->PropLock);
+
     if(plValue1 && plValue2 && plValue3)
     {
         if((Source=LookupSource(pContext->SourceMap, source)) != NULL)
@@ -1254,7 +1328,8 @@ AL_API void AL_APIENTRY alGetSource3i(ALuint source, ALenum eParam, ALint* plVal
     else
         alSetError(pContext, AL_INVALID_VALUE);
 
-    UnlockContext(pContext);
+    LeaveCriticalSection(&pContext->PropLock);
+    ALCcontext_DecRef(pContext);
 }
 
 
@@ -1299,9 +1374,11 @@ AL_API void AL_APIENTRY alGetSourceiv(ALuint source, ALenum eParam, ALint* plVal
             return;
     }
 
-    pContext = GetLockedContext();
+    pContext = GetContextRef();
     if(!pContext) return;
 
+    EnterCriticalSection(&pContext->PropLock);
+
     if(plValues)
     {
         if((Source=LookupSource(pContext->SourceMap, source)) != NULL)
@@ -1310,9 +1387,12 @@ AL_API void AL_APIENTRY alGetSourceiv(ALuint source, ALenum eParam, ALint* plVal
             {
                 case AL_SAMPLE_RW_OFFSETS_SOFT:
                 case AL_BYTE_RW_OFFSETS_SOFT:
+                    LockContext(pContext);
+                    ApplySourceCmds(pContext);
                     updateLen = (ALdouble)pContext->Device->UpdateSize /
                                 pContext->Device->Frequency;
                     GetSourceOffset(Source, eParam, Offsets, updateLen);
+                    UnlockContext(pContext);
                     plValues[0] = (ALint)Offsets[0];
                     plValues[1] = (ALint)Offsets[1];
                     break;
@@ -1328,7 +1408,8 @@ AL_API void AL_APIENTRY alGetSourceiv(ALuint source, ALenum eParam, ALint* plVal
     else
         alSetError(pContext, AL_INVALID_VALUE);
 
-    UnlockContext(pContext);
+    LeaveCriticalSection(&pContext->PropLock);
+    ALCcontext_DecRef(pContext);
 }
 
 
@@ -1343,9 +1424,11 @@ AL_API ALvoid AL_APIENTRY alSourcePlayv(ALsizei n, const ALuint *sources)
     ALsource         *Source;
     ALsizei          i;
 
-    Context = GetLockedContext();
+    Context = GetContextRef();
     if(!Context) return;
 
+    EnterCriticalSection(&Context->PropLock);
+
     if(n < 0)
     {
         alSetError(Context, AL_INVALID_VALUE);
@@ -1367,25 +1450,6 @@ AL_API ALvoid AL_APIENTRY alSourcePlayv(ALsizei n, const ALuint *sources)
         }
     }
 
-    while(Context->MaxActiveSources-Context->ActiveSourceCount < n)
-    {
-        void *temp = NULL;
-        ALsizei newcount;
-
-        newcount = Context->MaxActiveSources << 1;
-        if(newcount > 0)
-            temp = realloc(Context->ActiveSources,
-                           sizeof(*Context->ActiveSources) * newcount);
-        if(!temp)
-        {
-            alSetError(Context, AL_OUT_OF_MEMORY);
-            goto done;
-        }
-
-        Context->ActiveSources = temp;
-        Context->MaxActiveSources = newcount;
-    }
-
     for(i = 0;i < n;i++)
     {
         Source = LookupSource(Context->SourceMap, sources[i]);
@@ -1394,7 +1458,8 @@ AL_API ALvoid AL_APIENTRY alSourcePlayv(ALsizei n, const ALuint *sources)
     }
 
 done:
-    UnlockContext(Context);
+    LeaveCriticalSection(&Context->PropLock);
+    ALCcontext_DecRef(Context);
 }
 
 AL_API ALvoid AL_APIENTRY alSourcePause(ALuint source)
@@ -1408,9 +1473,11 @@ AL_API ALvoid AL_APIENTRY alSourcePausev(ALsizei n, const ALuint *sources)
     ALsource *Source;
     ALsizei i;
 
-    Context = GetLockedContext();
+    Context = GetContextRef();
     if(!Context) return;
 
+    EnterCriticalSection(&Context->PropLock);
+
     if(n < 0)
     {
         alSetError(Context, AL_INVALID_VALUE);
@@ -1440,7 +1507,8 @@ AL_API ALvoid AL_APIENTRY alSourcePausev(ALsizei n, const ALuint *sources)
     }
 
 done:
-    UnlockContext(Context);
+    LeaveCriticalSection(&Context->PropLock);
+    ALCcontext_DecRef(Context);
 }
 
 AL_API ALvoid AL_APIENTRY alSourceStop(ALuint source)
@@ -1454,9 +1522,11 @@ AL_API ALvoid AL_APIENTRY alSourceStopv(ALsizei n, const ALuint *sources)
     ALsource *Source;
     ALsizei i;
 
-    Context = GetLockedContext();
+    Context = GetContextRef();
     if(!Context) return;
 
+    EnterCriticalSection(&Context->PropLock);
+
     if(n < 0)
     {
         alSetError(Context, AL_INVALID_VALUE);
@@ -1486,7 +1556,8 @@ AL_API ALvoid AL_APIENTRY alSourceStopv(ALsizei n, const ALuint *sources)
     }
 
 done:
-    UnlockContext(Context);
+    LeaveCriticalSection(&Context->PropLock);
+    ALCcontext_DecRef(Context);
 }
 
 AL_API ALvoid AL_APIENTRY alSourceRewind(ALuint source)
@@ -1500,9 +1571,11 @@ AL_API ALvoid AL_APIENTRY alSourceRewindv(ALsizei n, const ALuint *sources)
     ALsource *Source;
     ALsizei i;
 
-    Context = GetLockedContext();
+    Context = GetContextRef();
     if(!Context) return;
 
+    EnterCriticalSection(&Context->PropLock);
+
     if(n < 0)
     {
         alSetError(Context, AL_INVALID_VALUE);
@@ -1532,7 +1605,8 @@ AL_API ALvoid AL_APIENTRY alSourceRewindv(ALsizei n, const ALuint *sources)
     }
 
 done:
-    UnlockContext(Context);
+    LeaveCriticalSection(&Context->PropLock);
+    ALCcontext_DecRef(Context);
 }
 
 
@@ -1550,9 +1624,11 @@ AL_API ALvoid AL_APIENTRY alSourceQueueBuffers(ALuint source, ALsizei n, const A
     if(n == 0)
         return;
 
-    Context = GetLockedContext();
+    Context = GetContextRef();
     if(!Context) return;
 
+    EnterCriticalSection(&Context->PropLock);
+
     if(n < 0)
     {
         alSetError(Context, AL_INVALID_VALUE);
@@ -1656,8 +1732,10 @@ AL_API ALvoid AL_APIENTRY alSourceQueueBuffers(ALuint source, ALsizei n, const A
         BufferList = BufferList->next;
     }
 
+    /* The new items are linked in with a single swap after they're set up, so
+     * the mixer can keep going through the queue while they're added */
     if(Source->queue == NULL)
-        Source->queue = BufferListStart;
+        ExchangePtr((void**)&Source->queue, BufferListStart);
     else
     {
         // Find end of queue
@@ -1666,14 +1744,15 @@ AL_API ALvoid AL_APIENTRY alSourceQueueBuffers(ALuint source, ALsizei n, const A
             BufferList = BufferList->next;
 
         BufferListStart->prev = BufferList;
-        BufferList->next = BufferListStart;
+        ExchangePtr((void**)&BufferList->next, BufferListStart);
     }
 
     // Update number of buffers in queue
     Source->BuffersInQueue += n;
 
 done:
-    UnlockContext(Context);
+    LeaveCriticalSection(&Context->PropLock);
+    ALCcontext_DecRef(Context);
 }
 
 
@@ -1689,9 +1768,12 @@ AL_API ALvoid AL_APIENTRY alSourceUnqueueBuffers( ALuint source, ALsizei n, ALui
     if(n == 0)
         return;
 
-    Context = GetLockedContext();
+    Context = GetContextRef();
     if(!Context) return;
 
+    EnterCriticalSection(&Context->PropLock);
+    LockContext(Context);
+
     if(n < 0)
     {
         alSetError(Context, AL_INVALID_VALUE);
@@ -1704,6 +1786,10 @@ AL_API ALvoid AL_APIENTRY alSourceUnqueueBuffers( ALuint source, ALsizei n, ALui
         goto done;
     }
 
+    /* The mixer has to be done with the buffers, and have caught up with any
+     * stop or offset change that marks them as processed */
+    ApplySourceCmds(Context);
+
     if(Source->bLooping || Source->lSourceType != AL_STREAMING ||
        (ALuint)n > Source->BuffersPlayed)
     {
@@ -1738,6 +1824,8 @@ AL_API ALvoid AL_APIENTRY alSourceUnqueueBuffers( ALuint source, ALsizei n, ALui
 
 done:
     UnlockContext(Context);
+    LeaveCriticalSection(&Context->PropLock);
+    ALCcontext_DecRef(Context);
 }
 
 
@@ -1781,6 +1869,9 @@ static ALvoid InitSourceParams(ALsource *Source)
 
     Source->state = AL_INITIAL;
     Source->new_state = AL_NONE;
+    Source->QueuedState = AL_INITIAL;
+    Source->CmdsQueued = 0;
+    Source->CmdsDone = 0;
     Source->lSourceType = AL_UNDETERMINED;
     Source->lOffset = -1;
 
@@ -1792,54 +1883,361 @@ static ALvoid InitSourceParams(ALsource *Source)
         Source->Send[i].WetGainHF = 1.0f;
     }
 
+    CopySourceProps(&Source->Props, Source);
+    Source->PendingProps = NULL;
+    Source->PendingParams = NULL;
+    Source->LastParams = NULL;
     Source->NeedsUpdate = AL_TRUE;
 
     Source->HrtfMoving = AL_FALSE;
-    Source->HrtfCounter = 0;
+    Source->Params->HrtfCounter = 0;
 }
 
 
+static ALvoid CopySourceProps(ALsourceProps *props, const ALsource *Source)
+{
+    ALuint i;
+
+    props->flPitch = Source->flPitch;
+    props->flGain = Source->flGain;
+    props->flOuterGain = Source->flOuterGain;
+    props->flMinGain = Source->flMinGain;
+    props->flMaxGain = Source->flMaxGain;
+    props->flInnerAngle = Source->flInnerAngle;
+    props->flOuterAngle = Source->flOuterAngle;
+    props->flRefDistance = Source->flRefDistance;
+    props->flMaxDistance = Source->flMaxDistance;
+    props->flRollOffFactor = Source->flRollOffFactor;
+    for(i = 0;i < 3;i++)
+    {
+        props->vPosition[i] = Source->vPosition[i];
+        props->vVelocity[i] = Source->vVelocity[i];
+        props->vOrientation[i] = Source->vOrientation[i];
+    }
+    props->bHeadRelative = Source->bHeadRelative;
+    props->DistanceModel = Source->DistanceModel;
+    props->VirtualChannels = Source->VirtualChannels;
+
+    props->Resampler = Source->Resampler;
+
+    props->DirectGain = Source->DirectGain;
+    props->DirectGainHF = Source->DirectGainHF;
+    for(i = 0;i < MAX_SENDS;i++)
+    {
+        props->Send[i].Slot = Source->Send[i].Slot;
+        props->Send[i].WetGain = Source->Send[i].WetGain;
+        props->Send[i].WetGainHF = Source->Send[i].WetGainHF;
+    }
+
+    props->DryGainHFAuto = Source->DryGainHFAuto;
+    props->WetGainAuto = Source->WetGainAuto;
+    props->WetGainHFAuto = Source->WetGainHFAuto;
+    props->OuterGainHF = Source->OuterGainHF;
+
+    props->AirAbsorptionFactor = Source->AirAbsorptionFactor;
+    props->RoomRolloffFactor = Source->RoomRolloffFactor;
+    props->DopplerFactor = Source->DopplerFactor;
+}
+
 /*
- * SetSourceState
+ * UpdateSourceProps
  *
- * Sets the source's new play state given its current state
+ * Hands the source's current properties to the mixer. Must be called with the
+ * context's PropLock held, which makes this the only thread taking containers
+ * off the free list (so it can't be fooled by one being taken and put back
+ * between reading the head and swapping it).
  */
-ALvoid SetSourceState(ALsource *Source, ALCcontext *Context, ALenum state)
+ALvoid UpdateSourceProps(ALsource *Source, ALCcontext *Context)
 {
-    if(state == AL_PLAYING)
+    ALsourceProps *props;
+
+    /* Get a container from the free list, or make a new one */
+    do {
+        props = Context->FreeSourceProps;
+        if(!props)
+        {
+            props = malloc(sizeof(*props));
+            if(!props)
+            {
+                ERR("Failed to allocate source properties\n");
+                return;
+            }
+            break;
+        }
+    } while(!CompExchangePtr((void**)&Context->FreeSourceProps, props, props->next));
+
+    CopySourceProps(props, Source);
+
+    /* Replace any update the mixer hasn't taken yet, and put it back on the
+     * free list */
+    props = ExchangePtr((void**)&Source->PendingProps, props);
+    if(props)
     {
-        ALbufferlistitem *BufferList;
-        ALsizei j, k;
+        do {
+            props->next = Context->FreeSourceProps;
+        } while(!CompExchangePtr((void**)&Context->FreeSourceProps, props->next, props));
+    }
+}
 
-        /* Check that there is a queue containing at least one non-null, non zero length AL Buffer */
-        BufferList = Source->queue;
-        while(BufferList)
+/*
+ * ApplySourceProps
+ *
+ * Takes the app's latest property update for the source, if there is one.
+ * Called by the mixer, or with DEVICE_APP_SOURCE_UPDATES, by the app's thread
+ * that calculates the source's parameters. Returns AL_TRUE if the properties
+ * changed.
+ */
+ALboolean ApplySourceProps(ALsource *Source, ALCcontext *Context)
+{
+    ALsourceProps *props;
+
+    props = ExchangePtr((void**)&Source->PendingProps, NULL);
+    if(!props)
+        return AL_FALSE;
+
+    Source->Props = *props;
+    do {
+        props->next = Context->FreeSourceProps;
+    } while(!CompExchangePtr((void**)&Context->FreeSourceProps, props->next, props));
+
+    return AL_TRUE;
+}
+
+/* The HRIR taps each source channel needs room for on the device. Ambisonic
+ * output applies HRTF to the bus instead of each source. */
+static ALuint GetSourceHrtfIrSize(const ALCdevice *Device)
+{
+    if(!(Device->Flags&DEVICE_USE_HRTF) || Device->AmbiOrder)
+        return 0;
+    return GetHrtfIrSize(Device->Hrtf);
+}
+
+/* Allocates a parameter container with room for IrSize taps of HRTF
+ * coefficients */
+static ALsourceParams *NewSourceParams(ALuint IrSize)
+{
+    ALsourceParams *params;
+
+    params = calloc(1, sizeof(*params) +
+                       (MAXCHANNELS+1)*IrSize*sizeof(params->HrtfCoeffs[0]));
+    if(params && IrSize)
+    {
+        params->HrtfCoeffs = (ALfloat(*)[2])(params+1);
+        params->HrtfCoeffStep = params->HrtfCoeffs + MAXCHANNELS*IrSize;
+    }
+    return params;
+}
+
+/*
+ * AllocSourceParams
+ *
+ * Allocates the source's parameters and HRIR rings for the device's current
+ * HRTF, unless they already fit it. New parameters are blank, and any waiting
+ * for the mixer are dropped, so they need to be calculated again. Must be
+ * called with the device's ParamsLock held, and with the device locked if the
+ * source may be playing.
+ */
+ALboolean AllocSourceParams(ALsource *Source, ALCdevice *Device)
+{
+    const ALuint IrSize = GetSourceHrtfIrSize(Device);
+    const ALuint RingSize = (IrSize ? NextPowerOf2(IrSize) : 0);
+    ALfloat (*values)[2] = NULL;
+    ALsourceParams *params;
+
+    if(Source->Params && Source->HrtfIrSize == IrSize)
+        return AL_TRUE;
+
+    params = NewSourceParams(IrSize);
+    if(params && RingSize)
+        values = calloc(MAXCHANNELS*RingSize, sizeof(values[0]));
+    if(!params || (RingSize && !values))
+    {
+        ERR("Failed to allocate source parameters for %u HRIR taps\n", IrSize);
+        free(params);
+        return AL_FALSE;
+    }
+
+    free(ExchangePtr((void**)&Source->PendingParams, NULL));
+    free(Source->Params);
+    Source->Params = params;
+    Source->LastParams = NULL;
+
+    free(Source->HrtfValues);
+    Source->HrtfValues = values;
+    Source->HrtfValuesMask = (RingSize ? RingSize-1 : 0);
+    Source->HrtfIrSize = IrSize;
+    Source->HrtfMoving = AL_FALSE;
+
+    return AL_TRUE;
+}
+
+/*
+ * GetSourceCommitParams
+ *
+ * Returns a container for the app's thread to calculate the source's next
+ * parameters into, or NULL if there isn't one. Must be called with the
+ * context's PropLock held.
+ */
+ALsourceParams *GetSourceCommitParams(ALsource *Source, ALCcontext *Context)
+{
+    const ALuint IrSize = GetSourceHrtfIrSize(Context->Device);
+    const ALsourceParams *prev;
+    ALsourceParams *params;
+
+    do {
+        params = Context->FreeSourceParams;
+        if(!params)
         {
-            if(BufferList->buffer != NULL && BufferList->buffer->size)
-                break;
-            BufferList = BufferList->next;
+            params = NewSourceParams(IrSize);
+            if(!params)
+            {
+                ERR("Failed to allocate source parameters\n");
+                return NULL;
+            }
+            break;
         }
+    } while(!CompExchangePtr((void**)&Context->FreeSourceParams, params, params->next));
+
+    /* The last parameters handed to the mixer, or its own if none were. The
+     * mixer only recycles parameters once newer ones are handed over, which
+     * only this thread does. */
+    prev = Source->LastParams;
+    if(!prev) prev = Source->Params;
+
+    /* The calculations set everything else, apart from the mixing function
+     * and step when the source has no buffer */
+    params->DoMix = prev->DoMix;
+    params->Step = prev->Step;
+
+    /* A moving HRIR carries on from the last one, and from wherever the mixer
+     * got to with it if it has taken it. Only single-channel sources move. */
+    if(Source->Update == CalcSourceParams && IrSize > 0)
+    {
+        params->HrtfGain = prev->HrtfGain;
+        memcpy(params->HrtfDir, prev->HrtfDir, sizeof(params->HrtfDir));
+        memcpy(params->HrtfCoeffs, prev->HrtfCoeffs,
+               IrSize*sizeof(params->HrtfCoeffs[0]));
+        memcpy(params->HrtfDelay[0], prev->HrtfDelay[0],
+               sizeof(params->HrtfDelay[0]));
+        memcpy(params->HrtfCoeffStep, prev->HrtfCoeffStep,
+               IrSize*sizeof(params->HrtfCoeffStep[0]));
+        memcpy(params->HrtfDelayStep, prev->HrtfDelayStep,
+               sizeof(params->HrtfDelayStep));
+        params->HrtfCounter = prev->HrtfCounter;
+    }
+    return params;
+}
 
-        /* If there's nothing to play, or device is disconnected, go right to
-         * stopped */
-        if(!BufferList || !Context->Device->Connected)
+/*
+ * UpdateSourceParams
+ *
+ * Hands the parameters the app's thread calculated into a container from
+ * GetSourceCommitParams to the mixer. Like UpdateSourceProps, this must be
+ * called with the context's PropLock held.
+ */
+ALvoid UpdateSourceParams(ALsource *Source, ALsourceParams *params, ALCcontext *Context)
+{
+    Source->LastParams = params;
+
+    /* Anything the mixer didn't take yet is out of date now */
+    params = ExchangePtr((void**)&Source->PendingParams, params);
+    if(params)
+    {
+        do {
+            params->next = Context->FreeSourceParams;
+        } while(!CompExchangePtr((void**)&Context->FreeSourceParams, params->next, params));
+    }
+}
+
+/*
+ * ApplySourceParams
+ *
+ * Called by the mixer to swap in the parameters the app's thread last
+ * calculated for the source, if there are new ones. Returns AL_TRUE if they
+ * changed.
+ */
+ALboolean ApplySourceParams(ALsource *Source, ALCcontext *Context)
+{
+    ALsourceParams *params, *old;
+
+    params = ExchangePtr((void**)&Source->PendingParams, NULL);
+    if(!params)
+        return AL_FALSE;
+
+    old = Source->Params;
+    Source->Params = params;
+    do {
+        old->next = Context->FreeSourceParams;
+    } while(!CompExchangePtr((void**)&Context->FreeSourceParams, old->next, old));
+
+    return AL_TRUE;
+}
+
+
+/*
+ * SendSourceCmd
+ *
+ * Queues a command for the mixer to apply to the source. Like
+ * UpdateSourceProps, this must be called with the context's PropLock held.
+ */
+static ALvoid SendSourceCmd(ALsource *Source, ALCcontext *Context,
+                            const ALsourceCmd *cmd)
+{
+    ALsourceCmd *newcmd;
+
+    do {
+        newcmd = Context->FreeSourceCmds;
+        if(!newcmd)
         {
-            SetSourceState(Source, Context, AL_STOPPED);
-            return;
+            newcmd = malloc(sizeof(*newcmd));
+            break;
         }
+    } while(!CompExchangePtr((void**)&Context->FreeSourceCmds, newcmd, newcmd->next));
+
+    if(!newcmd)
+    {
+        /* Without a container, wait for the mixer and apply it directly, after
+         * anything that's still pending */
+        ERR("Failed to allocate source command\n");
+        LockContext(Context);
+        ApplySourceCmds(Context);
+        ApplySourceCmd(cmd, Context);
+        UnlockContext(Context);
+        return;
+    }
 
+    *newcmd = *cmd;
+    Source->CmdsQueued++;
+    do {
+        newcmd->next = Context->PendingSourceCmds;
+    } while(!CompExchangePtr((void**)&Context->PendingSourceCmds, newcmd->next, newcmd));
+}
+
+/*
+ * ApplySourceCmd
+ *
+ * Makes the changes for a source command. Only done with the device locked.
+ */
+static ALvoid ApplySourceCmd(const ALsourceCmd *cmd, ALCcontext *Context)
+{
+    ALsource *Source = cmd->Source;
+    ALsizei j, k;
+
+    if(cmd->State == AL_PLAYING)
+    {
         if(Source->state != AL_PLAYING)
         {
             for(j = 0;j < MAXCHANNELS;j++)
             {
                 for(k = 0;k < SRC_HISTORY_LENGTH;k++)
                     Source->HrtfHistory[j][k] = 0.0f;
-                for(k = 0;k < HRIR_LENGTH;k++)
-                {
-                    Source->HrtfValues[j][k][0] = 0.0f;
-                    Source->HrtfValues[j][k][1] = 0.0f;
-                }
             }
+            if(Source->HrtfValues)
+                memset(Source->HrtfValues, 0, Source->NumChannels *
+                       (Source->HrtfValuesMask+1)*sizeof(Source->HrtfValues[0]));
+            if(Source->HrtfConv)
+                memset(Source->HrtfConv, 0,
+                       Source->HrtfConvChannels*sizeof(HrtfConvState));
         }
 
         if(Source->state != AL_PAUSED)
@@ -1852,9 +2250,11 @@ ALvoid SetSourceState(ALsource *Source, ALCcontext *Context, ALenum state)
         else
             Source->state = AL_PLAYING;
 
-        // Check if an Offset has been set
-        if(Source->lOffset != -1)
-            ApplyOffset(Source);
+        if(cmd->Seek)
+        {
+            Source->BuffersPlayed = cmd->BuffersPlayed;
+            Source->position = cmd->Position;
+        }
 
         for(j = 0;j < Context->ActiveSourceCount;j++)
         {
@@ -1864,27 +2264,26 @@ ALvoid SetSourceState(ALsource *Source, ALCcontext *Context, ALenum state)
         if(j == Context->ActiveSourceCount)
             Context->ActiveSources[Context->ActiveSourceCount++] = Source;
     }
-    else if(state == AL_PAUSED)
+    else if(cmd->State == AL_PAUSED)
     {
         if(Source->state == AL_PLAYING)
         {
             Source->state = AL_PAUSED;
             Source->HrtfMoving = AL_FALSE;
-            Source->HrtfCounter = 0;
+            Source->Params->HrtfCounter = 0;
         }
     }
-    else if(state == AL_STOPPED)
+    else if(cmd->State == AL_STOPPED)
     {
         if(Source->state != AL_INITIAL)
         {
             Source->state = AL_STOPPED;
-            Source->BuffersPlayed = Source->BuffersInQueue;
+            Source->BuffersPlayed = cmd->BuffersPlayed;
             Source->HrtfMoving = AL_FALSE;
-            Source->HrtfCounter = 0;
+            Source->Params->HrtfCounter = 0;
         }
-        Source->lOffset = -1;
     }
-    else if(state == AL_INITIAL)
+    else if(cmd->State == AL_INITIAL)
     {
         if(Source->state != AL_INITIAL)
         {
@@ -1893,7 +2292,171 @@ ALvoid SetSourceState(ALsource *Source, ALCcontext *Context, ALenum state)
             Source->position_fraction = 0;
             Source->BuffersPlayed = 0;
             Source->HrtfMoving = AL_FALSE;
-            Source->HrtfCounter = 0;
+            Source->Params->HrtfCounter = 0;
+        }
+    }
+    else if(cmd->Seek)
+    {
+        /* The source may have stopped by itself since the offset was set */
+        if(Source->state == AL_PLAYING || Source->state == AL_PAUSED)
+        {
+            Source->BuffersPlayed = cmd->BuffersPlayed;
+            Source->position = cmd->Position;
+        }
+    }
+}
+
+/*
+ * ApplySourceCmds
+ *
+ * Applies the commands queued on the context, in the order they were sent.
+ * Called by the mixer at the start of an update, and by app calls that lock
+ * the device and need to see the sources as the app left them.
+ */
+ALvoid ApplySourceCmds(ALCcontext *Context)
+{
+    ALsourceCmd *cmds, *next, *prev;
+
+    cmds = ExchangePtr((void**)&Context->PendingSourceCmds, NULL);
+    if(!cmds)
+        return;
+
+    prev = NULL;
+    while(cmds)
+    {
+        next = cmds->next;
+        cmds->next = prev;
+        prev = cmds;
+        cmds = next;
+    }
+
+    cmds = prev;
+    while(cmds)
+    {
+        next = cmds->next;
+
+        ApplySourceCmd(cmds, Context);
+        IncrementRef(&cmds->Source->CmdsDone);
+
+        do {
+            cmds->next = Context->FreeSourceCmds;
+        } while(!CompExchangePtr((void**)&Context->FreeSourceCmds, cmds->next, cmds));
+        cmds = next;
+    }
+}
+
+
+/*
+ * SetSourceState
+ *
+ * Sets the source's new play state given its current state. The mixer makes
+ * the change at its next update, with the app seeing the new state right away.
+ */
+ALvoid SetSourceState(ALsource *Source, ALCcontext *Context, ALenum state)
+{
+    ALenum curstate = GetSourceState(Source);
+    ALsourceCmd cmd;
+
+    cmd.Source = Source;
+    cmd.State = state;
+    cmd.Seek = AL_FALSE;
+    cmd.BuffersPlayed = 0;
+    cmd.Position = 0;
+    cmd.next = NULL;
+
+    if(state == AL_PLAYING)
+    {
+        ALbufferlistitem *BufferList;
+
+        /* Check that there is a queue containing at least one non-null, non zero length AL Buffer */
+        BufferList = Source->queue;
+        while(BufferList)
+        {
+            if(BufferList->buffer != NULL && BufferList->buffer->size)
+                break;
+            BufferList = BufferList->next;
+        }
+
+        /* If there's nothing to play, or device is disconnected, go right to
+         * stopped */
+        if(!BufferList || !Context->Device->Connected)
+        {
+            SetSourceState(Source, Context, AL_STOPPED);
+            return;
+        }
+
+        /* Sources need their own convolvers for long HRIRs. Without them the
+         * mixer applies the whole thing directly. They're only (re)allocated
+         * for a source's first play with more channels than before, and the
+         * device is locked to swap them in case the mixer is still finishing
+         * with the old ones. */
+        if(curstate != AL_PLAYING && Context->Device->Hrtf &&
+           !Context->Device->AmbiOrder &&
+           GetHrtfIrSize(Context->Device->Hrtf) > HRTF_CONV_MIN_IRSIZE &&
+           Source->HrtfConvChannels < Source->NumChannels)
+        {
+            HrtfConvState *conv = calloc(Source->NumChannels,
+                                         sizeof(HrtfConvState));
+            LockContext(Context);
+            free(Source->HrtfConv);
+            Source->HrtfConv = conv;
+            Source->HrtfConvChannels = (conv ? Source->NumChannels : 0);
+            UnlockContext(Context);
+        }
+
+        /* Sources mixed on the device's extra threads need somewhere to keep
+         * their samples until they're added to the mix. Without it, the
+         * device's thread mixes them itself. */
+        if(curstate != AL_PLAYING && Context->Device->NumMixThreads > 1 &&
+           Source->MixTempChannels < Source->NumChannels)
+        {
+            SourceMixTemp *temp = calloc(1, sizeof(SourceMixTemp) +
+                                            Source->NumChannels*sizeof(SourceMixChannel));
+            if(temp)
+                temp->Channels = (SourceMixChannel*)(temp+1);
+            LockContext(Context);
+            free(Source->MixTemp);
+            Source->MixTemp = temp;
+            Source->MixTempChannels = (temp ? Source->NumChannels : 0);
+            UnlockContext(Context);
+        }
+
+        // Check if an Offset has been set
+        if(Source->lOffset != -1)
+            cmd.Seek = GetOffsetPosition(Source, &cmd.BuffersPlayed,
+                                         &cmd.Position);
+
+        /* When the app's thread calculates the source's parameters, the mixer
+         * needs them before it can start */
+        aluCommitSourceUpdate(Source, Context);
+
+        Source->QueuedState = AL_PLAYING;
+        SendSourceCmd(Source, Context, &cmd);
+    }
+    else if(state == AL_PAUSED)
+    {
+        if(curstate == AL_PLAYING)
+        {
+            Source->QueuedState = AL_PAUSED;
+            SendSourceCmd(Source, Context, &cmd);
+        }
+    }
+    else if(state == AL_STOPPED)
+    {
+        if(curstate != AL_INITIAL)
+        {
+            cmd.BuffersPlayed = Source->BuffersInQueue;
+            Source->QueuedState = AL_STOPPED;
+            SendSourceCmd(Source, Context, &cmd);
+        }
+        Source->lOffset = -1;
+    }
+    else if(state == AL_INITIAL)
+    {
+        if(curstate != AL_INITIAL)
+        {
+            Source->QueuedState = AL_INITIAL;
+            SendSourceCmd(Source, Context, &cmd);
         }
         Source->lOffset = -1;
     }
@@ -2019,10 +2582,32 @@ static ALvoid GetSourceOffset(ALsource *Source, ALenum name, ALdouble *offset, A
 /*
     ApplyOffset
 
-    Apply a playback offset to the Source.  This function will update the queue (to correctly
-    mark buffers as 'pending' or 'processed' depending upon the new offset.
+    Moves the Source to its pending playback offset.  The mixer updates the queue (to correctly
+    mark buffers as 'pending' or 'processed' depending upon the new offset) at its next update.
+*/
+ALboolean ApplyOffset(ALsource *Source, ALCcontext *Context)
+{
+    ALsourceCmd cmd;
+
+    cmd.Source = Source;
+    cmd.State = AL_NONE;
+    cmd.next = NULL;
+    cmd.Seek = GetOffsetPosition(Source, &cmd.BuffersPlayed, &cmd.Position);
+    if(!cmd.Seek)
+        return AL_FALSE;
+
+    SendSourceCmd(Source, Context, &cmd);
+    return AL_TRUE;
+}
+
+
+/*
+    GetOffsetPosition
+
+    Finds where in the Source's queue its pending playback offset is, as the number of buffers
+    before it and the sample position in the buffer it's in.
 */
-ALboolean ApplyOffset(ALsource *Source)
+static ALboolean GetOffsetPosition(ALsource *Source, ALuint *BuffersPlayedOut, ALuint *Position)
 {
     const ALbufferlistitem *BufferList;
     const ALbuffer         *Buffer;
@@ -2055,11 +2640,11 @@ ALboolean ApplyOffset(ALsource *Source)
         else if(lTotalBufferSize <= lByteOffset)
         {
             // Offset is within this buffer
-            Source->BuffersPlayed = BuffersPlayed;
+            *BuffersPlayedOut = BuffersPlayed;
 
             // SW Mixer Positions are in Samples
-            Source->position = (lByteOffset - lTotalBufferSize) /
-                                FrameSizeFromFmt(Buffer->FmtChannels, Buffer->FmtType);
+            *Position = (lByteOffset - lTotalBufferSize) /
+                        FrameSizeFromFmt(Buffer->FmtChannels, Buffer->FmtType);
             return AL_TRUE;
         }
 
@@ -2166,6 +2751,12 @@ ALvoid ReleaseALSources(ALCcontext *Context)
                 DecrementRef(&temp->Send[j].Slot->ref);
             temp->Send[j].Slot = NULL;
         }
+        free(temp->PendingProps);
+        free(temp->Params);
+        free(temp->PendingParams);
+        free(temp->HrtfValues);
+        free(temp->HrtfConv);
+        free(temp->MixTemp);
 
         // Release source structure
         FreeThunkEntry(temp->source);
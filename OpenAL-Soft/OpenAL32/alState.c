@@ -28,6 +28,7 @@
 #include "alSource.h"
 #include "alAuxEffectSlot.h"
 #include "alState.h"
+#include "alu.h"
 
 static const ALchar alVendor[] = "OpenAL Community";
 static const ALchar alVersion[] = "1.1 ALSOFT "ALSOFT_VERSION;
@@ -583,30 +584,17 @@ AL_API ALvoid AL_APIENTRY alDeferUpdatesSOFT(void)
     if(!Context->DeferUpdates)
     {
         ALboolean UpdateSources;
-        ALsource **src, **src_end;
         ALeffectslot **slot, **slot_end;
 
         LockContext(Context);
         Context->DeferUpdates = AL_TRUE;
 
-        /* Make sure all pending updates are performed */
-        UpdateSources = ExchangeInt(&Context->UpdateSources, AL_FALSE);
-
-        src = Context->ActiveSources;
-        src_end = src + Context->ActiveSourceCount;
-        while(src != src_end)
+        /* Make sure all pending updates are performed. When the app's thread
+         * calculates source parameters, they're left for it to commit. */
+        if(!(Context->Device->Flags&DEVICE_APP_SOURCE_UPDATES))
         {
-            if((*src)->state != AL_PLAYING)
-            {
-                Context->ActiveSourceCount--;
-                *src = *(--src_end);
-                continue;
-            }
-
-            if(ExchangeInt(&(*src)->NeedsUpdate, AL_FALSE) || UpdateSources)
-                ALsource_Update(*src, Context);
-
-            src++;
+            UpdateSources = ExchangeInt(&Context->UpdateSources, AL_FALSE);
+            aluUpdateSources(Context, UpdateSources);
         }
 
         slot = Context->ActiveEffectSlots;
@@ -631,27 +619,30 @@ AL_API ALvoid AL_APIENTRY alProcessUpdatesSOFT(void)
     Context = GetContextRef();
     if(!Context) return;
 
+    EnterCriticalSection(&Context->PropLock);
     if(ExchangeInt(&Context->DeferUpdates, AL_FALSE))
     {
         ALsizei pos;
 
-        LockContext(Context);
         LockUIntMapRead(&Context->SourceMap);
         for(pos = 0;pos < Context->SourceMap.size;pos++)
         {
             ALsource *Source = Context->SourceMap.array[pos].value;
+            ALenum state = GetSourceState(Source);
             ALenum new_state;
 
-            if(Source->lOffset != -1)
-                ApplyOffset(Source);
+            if(Source->lOffset != -1 &&
+               (state == AL_PLAYING || state == AL_PAUSED))
+                ApplyOffset(Source, Context);
 
             new_state = ExchangeInt(&Source->new_state, AL_NONE);
             if(new_state)
                 SetSourceState(Source, Context, new_state);
         }
         UnlockUIntMapRead(&Context->SourceMap);
-        UnlockContext(Context);
     }
+    aluCommitUpdates(Context);
+    LeaveCriticalSection(&Context->PropLock);
 
     ALCcontext_DecRef(Context);
 }
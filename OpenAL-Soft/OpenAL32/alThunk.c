@@ -26,64 +26,94 @@
 #include "alThunk.h"
 
 
-static ALenum *ThunkArray;
+/* Names are handed out from a stack of free indices, so making and deleting
+ * them doesn't depend on how many are in use. Each index keeps a generation
+ * count, bumped when it's freed, that goes in the name's high bits. */
+static ALuint *ThunkGeneration;
+static ALuint *ThunkFreeList;
+static ALuint  ThunkFreeCount;
 static ALuint  ThunkArraySize;
 static RWLock  ThunkLock;
 
 void ThunkInit(void)
 {
     RWLockInit(&ThunkLock);
-    ThunkArraySize = 1;
-    ThunkArray = calloc(1, ThunkArraySize * sizeof(*ThunkArray));
+    ThunkGeneration = NULL;
+    ThunkFreeList = NULL;
+    ThunkFreeCount = 0;
+    ThunkArraySize = 0;
 }
 
 void ThunkExit(void)
 {
-    free(ThunkArray);
-    ThunkArray = NULL;
+    RWLockTraceStats(&ThunkLock, "Thunk");
+    free(ThunkGeneration);
+    ThunkGeneration = NULL;
+    free(ThunkFreeList);
+    ThunkFreeList = NULL;
+    ThunkFreeCount = 0;
     ThunkArraySize = 0;
 }
 
 ALenum NewThunkEntry(ALuint *index)
 {
-    ALenum *NewList;
-    ALuint i;
+    ALuint idx;
 
-    ReadLock(&ThunkLock);
-    for(i = 0;i < ThunkArraySize;i++)
+    WriteLock(&ThunkLock);
+    if(ThunkFreeCount == 0)
     {
-        if(ExchangeInt(&ThunkArray[i], AL_TRUE) == AL_FALSE)
+        ALuint newsize = (ThunkArraySize ? ThunkArraySize*2 : 64);
+        ALuint *NewGen, *NewFree;
+        ALuint i;
+
+        /* Index 0 isn't used, so names are never 0 */
+        if(newsize > NAME_INDEX_MASK)
+            newsize = NAME_INDEX_MASK;
+        if(newsize <= ThunkArraySize)
         {
-            ReadUnlock(&ThunkLock);
-            *index = i+1;
-            return AL_NO_ERROR;
+            WriteUnlock(&ThunkLock);
+            ERR("Out of object names (%u in use)\n", ThunkArraySize);
+            return AL_OUT_OF_MEMORY;
         }
-    }
-    ReadUnlock(&ThunkLock);
 
-    WriteLock(&ThunkLock);
-    NewList = realloc(ThunkArray, ThunkArraySize*2 * sizeof(*ThunkArray));
-    if(!NewList)
-    {
-        WriteUnlock(&ThunkLock);
-        ERR("Realloc failed to increase to %u enties!\n", ThunkArraySize*2);
-        return AL_OUT_OF_MEMORY;
+        NewGen = realloc(ThunkGeneration, newsize * sizeof(*ThunkGeneration));
+        if(NewGen) ThunkGeneration = NewGen;
+        NewFree = realloc(ThunkFreeList, newsize * sizeof(*ThunkFreeList));
+        if(NewFree) ThunkFreeList = NewFree;
+        if(!NewGen || !NewFree)
+        {
+            WriteUnlock(&ThunkLock);
+            ERR("Realloc failed to increase to %u enties!\n", newsize);
+            return AL_OUT_OF_MEMORY;
+        }
+
+        /* Push the new indices so the lowest comes off first */
+        for(i = newsize;i > ThunkArraySize;i--)
+        {
+            ThunkGeneration[i-1] = 0;
+            ThunkFreeList[ThunkFreeCount++] = i;
+        }
+        ThunkArraySize = newsize;
     }
-    memset(&NewList[ThunkArraySize], 0, ThunkArraySize*sizeof(*ThunkArray));
-    ThunkArraySize *= 2;
-    ThunkArray = NewList;
 
-    ThunkArray[i] = AL_TRUE;
+    idx = ThunkFreeList[--ThunkFreeCount];
+    *index = (ThunkGeneration[idx-1]<<NAME_INDEX_BITS) | idx;
     WriteUnlock(&ThunkLock);
 
-    *index = i+1;
     return AL_NO_ERROR;
 }
 
 void FreeThunkEntry(ALuint index)
 {
-    ReadLock(&ThunkLock);
-    if(index > 0 && index <= ThunkArraySize)
-        ExchangeInt(&ThunkArray[index-1], AL_FALSE);
-    ReadUnlock(&ThunkLock);
+    ALuint idx = index & NAME_INDEX_MASK;
+
+    WriteLock(&ThunkLock);
+    if(idx > 0 && idx <= ThunkArraySize &&
+       ThunkGeneration[idx-1] == (index>>NAME_INDEX_BITS))
+    {
+        ThunkGeneration[idx-1] = (ThunkGeneration[idx-1]+1) &
+                                 (~0u>>NAME_INDEX_BITS);
+        ThunkFreeList[ThunkFreeCount++] = idx;
+    }
+    WriteUnlock(&ThunkLock);
 }
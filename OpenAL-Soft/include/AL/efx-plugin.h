@@ -0,0 +1,78 @@
+#ifndef AL_EFX_PLUGIN_H
+#define AL_EFX_PLUGIN_H
+
+#include "al.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Interface for effect modules loaded by OpenAL Soft at initialization (see
+ * the effect-plugins config option). A module exports a function named by
+ * ALSOFT_EFFECT_PLUGIN_ENTRY which returns a NULL-terminated list of the
+ * effects it provides, given the interface version the library uses. Each
+ * effect becomes available as an AL_EFFECT_TYPE value for every device, and
+ * is processed in the mixer like the built-in effects.
+ */
+#define ALSOFT_EFFECT_PLUGIN_VERSION  1
+#define ALSOFT_EFFECT_PLUGIN_ENTRY    "alsoftGetEffectPlugins"
+
+/* The most samples passed to a single Process call */
+#define ALSOFT_EFFECT_MAX_SAMPLES     4096
+/* The largest property block an effect may use */
+#define ALSOFT_EFFECT_MAX_PROPS_SIZE  256
+
+typedef struct ALeffectPluginSOFT {
+    /* ALSOFT_EFFECT_PLUGIN_VERSION the module was built with */
+    ALuint Version;
+
+    /* Name used by the excludefx config option */
+    const char *Name;
+    /* The AL_EFFECT_TYPE value selecting this effect, and its name for
+     * alGetEnumValue. The value must not be used by another effect. */
+    const char *TypeName;
+    ALenum Type;
+
+    /* Size of the effect's property block, and a function to fill a block
+     * with default values. Blocks are copied by value and may be accessed at
+     * any time, so they must not hold pointers to other allocations. */
+    ALuint PropsSize;
+    void (AL_APIENTRY *InitProps)(ALvoid *props);
+
+    /* Called for alEffect* and alGetEffect* with any parameter besides
+     * AL_EFFECT_TYPE. The scalar calls pass a single value. Return
+     * AL_NO_ERROR, AL_INVALID_ENUM for unknown parameters, or
+     * AL_INVALID_VALUE for out of range values. */
+    ALenum (AL_APIENTRY *SetParamiv)(ALvoid *props, ALenum param, const ALint *values);
+    ALenum (AL_APIENTRY *SetParamfv)(ALvoid *props, ALenum param, const ALfloat *values);
+    ALenum (AL_APIENTRY *GetParamiv)(const ALvoid *props, ALenum param, ALint *values);
+    ALenum (AL_APIENTRY *GetParamfv)(const ALvoid *props, ALenum param, ALfloat *values);
+
+    /* Number of output channels written by Process. One channel is played on
+     * every speaker, while two are played as left and right. */
+    ALuint NumOutputs;
+
+    /* Creates and destroys an instance of the effect for an effect slot. */
+    ALvoid* (AL_APIENTRY *Create)(void);
+    void (AL_APIENTRY *Destroy)(ALvoid *state);
+    /* Called after creation and whenever the device is reset. Any history
+     * should be cleared. Return AL_FALSE if the state can't be used. */
+    ALboolean (AL_APIENTRY *DeviceUpdate)(ALvoid *state, ALuint frequency);
+    /* Called from the mixer when the slot's effect properties change. */
+    void (AL_APIENTRY *Update)(ALvoid *state, const ALvoid *props, ALuint frequency);
+    /* Processes a block of mono input, writing (not adding) SamplesToDo
+     * samples to each of the NumOutputs output buffers. Called from the
+     * mixer, so it must not block. */
+    void (AL_APIENTRY *Process)(ALvoid *state, ALuint SamplesToDo, const ALfloat *input, ALfloat *const *outputs);
+    /* Optional. Returns AL_TRUE when processing silent input would only
+     * produce silence, letting the mixer skip the slot while it's idle. */
+    ALboolean (AL_APIENTRY *IsSilent)(ALvoid *state);
+} ALeffectPluginSOFT;
+
+typedef const ALeffectPluginSOFT* const* (AL_APIENTRY *LPALSOFTGETEFFECTPLUGINS)(ALuint version);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AL_EFX_PLUGIN_H */
@@ -0,0 +1,213 @@
+/*
+ * OpenAL Pitch Benchmark Utility
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/* Measures the CPU time taken to mix a set of sources at increasing pitches,
+ * using a loopback device so no audio hardware is involved. Each source plays
+ * a looping buffer, either as a static source or as a queue of streaming
+ * buffers.
+ *
+ * usage: pitch-bench [-stream] [sources] [buffer rate] [device rate]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "AL/alc.h"
+#include "AL/al.h"
+#include "AL/alext.h"
+
+#ifndef ALC_SOFT_device_loopback
+#define ALC_FORMAT_CHANNELS_SOFT                 0x1990
+#define ALC_FORMAT_TYPE_SOFT                     0x1991
+#define ALC_FLOAT                                0x1406
+#define ALC_STEREO                               0x1501
+typedef ALCdevice* (ALC_APIENTRY*LPALCLOOPBACKOPENDEVICESOFT)(void);
+typedef void (ALC_APIENTRY*LPALCRENDERSAMPLESSOFT)(ALCdevice *device, ALCvoid *buffer, ALCsizei samples);
+#endif
+
+
+#define RENDER_SECONDS  4
+#define UPDATE_SIZE     1024
+#define NUM_QUEUED      4
+
+static const ALfloat Pitches[] = {
+    0.5f, 1.0f, 2.0f, 4.0f, 8.0f, 16.0f, 32.0f, 64.0f, 128.0f, 256.0f, 1024.0f
+};
+
+
+int main(int argc, char *argv[])
+{
+    LPALCLOOPBACKOPENDEVICESOFT alcLoopbackOpenDevice;
+    LPALCRENDERSAMPLESSOFT alcRenderSamples;
+    ALuint buffers[NUM_QUEUED];
+    ALCcontext *context;
+    ALCdevice *device;
+    ALCint attrs[7];
+    ALfloat *output;
+    ALshort *data;
+    ALuint *sources;
+    int streaming = 0;
+    int numSources = 64;
+    int bufferRate = 48000;
+    int deviceRate = 44100;
+    int dataLen;
+    int i, j, p;
+
+    if(argc > 1 && strcmp(argv[1], "-stream") == 0)
+    {
+        streaming = 1;
+        argc--;
+        argv++;
+    }
+    if(argc > 1) numSources = atoi(argv[1]);
+    if(argc > 2) bufferRate = atoi(argv[2]);
+    if(argc > 3) deviceRate = atoi(argv[3]);
+    if(numSources <= 0 || bufferRate <= 0 || deviceRate <= 0)
+    {
+        fprintf(stderr, "usage: %s [-stream] [sources] [buffer rate] [device rate]\n", argv[0]);
+        return 1;
+    }
+
+    alcLoopbackOpenDevice = (LPALCLOOPBACKOPENDEVICESOFT)alcGetProcAddress(NULL, "alcLoopbackOpenDeviceSOFT");
+    alcRenderSamples = (LPALCRENDERSAMPLESSOFT)alcGetProcAddress(NULL, "alcRenderSamplesSOFT");
+    if(!alcLoopbackOpenDevice || !alcRenderSamples)
+    {
+        fprintf(stderr, "Loopback devices not supported\n");
+        return 1;
+    }
+
+    device = alcLoopbackOpenDevice();
+    if(!device)
+    {
+        fprintf(stderr, "Failed to open a loopback device\n");
+        return 1;
+    }
+
+    attrs[0] = ALC_FORMAT_CHANNELS_SOFT;
+    attrs[1] = ALC_STEREO;
+    attrs[2] = ALC_FORMAT_TYPE_SOFT;
+    attrs[3] = ALC_FLOAT;
+    attrs[4] = ALC_FREQUENCY;
+    attrs[5] = deviceRate;
+    attrs[6] = 0;
+    context = alcCreateContext(device, attrs);
+    if(!context || alcMakeContextCurrent(context) == ALC_FALSE)
+    {
+        fprintf(stderr, "Failed to set up a context\n");
+        if(context)
+            alcDestroyContext(context);
+        alcCloseDevice(device);
+        return 1;
+    }
+
+    /* A second of rising triangle wave, split into equal parts for
+     * streaming */
+    dataLen = bufferRate / NUM_QUEUED;
+    data = malloc(dataLen * NUM_QUEUED * sizeof(data[0]));
+    sources = malloc(numSources * sizeof(sources[0]));
+    output = malloc(UPDATE_SIZE * 2 * sizeof(output[0]));
+    if(!data || !sources || !output)
+    {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+    for(i = 0;i < dataLen*NUM_QUEUED;i++)
+    {
+        double t = (double)i / bufferRate;
+        double phase = (220.0 + 440.0*t) * t;
+        phase -= (int)phase;
+        data[i] = (ALshort)((phase < 0.5) ? (phase*4.0 - 1.0) * 16383.0 :
+                                            (3.0 - phase*4.0) * 16383.0);
+    }
+
+    alGenBuffers(NUM_QUEUED, buffers);
+    if(streaming)
+    {
+        for(i = 0;i < NUM_QUEUED;i++)
+            alBufferData(buffers[i], AL_FORMAT_MONO16, data + dataLen*i,
+                         dataLen*sizeof(data[0]), bufferRate);
+    }
+    else
+        alBufferData(buffers[0], AL_FORMAT_MONO16, data,
+                     dataLen*NUM_QUEUED*sizeof(data[0]), bufferRate);
+
+    alGenSources(numSources, sources);
+    for(i = 0;i < numSources;i++)
+    {
+        if(streaming)
+            alSourceQueueBuffers(sources[i], NUM_QUEUED, buffers);
+        else
+            alSourcei(sources[i], AL_BUFFER, buffers[0]);
+        alSourcei(sources[i], AL_LOOPING, AL_TRUE);
+        alSourcef(sources[i], AL_GAIN, 1.0f / numSources);
+        alSource3f(sources[i], AL_POSITION, (ALfloat)((i%5) - 2), 0.0f, -1.0f);
+    }
+    if(alGetError() != AL_NO_ERROR)
+    {
+        fprintf(stderr, "Failed to set up sources\n");
+        return 1;
+    }
+
+    printf("%d %s source%s, %dhz buffer%s, %dhz device\n", numSources,
+           streaming ? "streaming" : "static", (numSources==1) ? "" : "s",
+           bufferRate, streaming ? "s" : "", deviceRate);
+    printf("%10s %12s %16s\n", "pitch", "step", "CPU ms/second");
+
+    for(p = 0;p < (int)(sizeof(Pitches)/sizeof(Pitches[0]));p++)
+    {
+        const int updates = deviceRate * RENDER_SECONDS / UPDATE_SIZE;
+        clock_t start, end;
+
+        for(i = 0;i < numSources;i++)
+        {
+            alSourceStop(sources[i]);
+            alSourcef(sources[i], AL_PITCH, Pitches[p]);
+        }
+        alSourcePlayv(numSources, sources);
+        /* Render one update to settle the new parameters */
+        alcRenderSamples(device, output, UPDATE_SIZE);
+
+        start = clock();
+        for(j = 0;j < updates;j++)
+            alcRenderSamples(device, output, UPDATE_SIZE);
+        end = clock();
+
+        printf("%10.1f %12.2f %16.2f\n", Pitches[p],
+               Pitches[p] * bufferRate / deviceRate,
+               (double)(end-start) * 1000.0 / CLOCKS_PER_SEC / RENDER_SECONDS);
+    }
+
+    alSourceStopv(numSources, sources);
+    alDeleteSources(numSources, sources);
+    alDeleteBuffers(NUM_QUEUED, buffers);
+    free(output);
+    free(sources);
+    free(data);
+
+    alcMakeContextCurrent(NULL);
+    alcDestroyContext(context);
+    alcCloseDevice(device);
+
+    return 0;
+}